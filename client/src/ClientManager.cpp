@@ -1,5 +1,7 @@
 // : ClientManager.cpp (, )
 #include "ClientManager.h"
+#include "DeltaEncoder.h"
+#include "directoryarchive.h"
 #include <QFile>
 #include <QFileInfo>
 #include <QJsonDocument>
@@ -7,6 +9,13 @@
 #include <QJsonArray>
 #include <QDataStream>
 #include <QDebug>
+#include <QTimer>
+
+// Чанк дельты и предел очереди сокета: память не растёт с размером файла
+static const int kDeltaChunkBytes = 1024 * 1024;
+static const qint64 kDeltaScanBudget = 64 * 1024 * 1024;
+static const qint64 kDeltaMaxQueued = 4 * 1024 * 1024;
+static const int kArchiveChunkBytes = 1024 * 1024;
 
 ClientManager::ClientManager(QObject* parent)
     : QObject(parent), blockSize(0), nextId(1)
@@ -17,8 +26,12 @@ ClientManager::ClientManager(QObject* parent)
     connect(socket,
             QOverload<QAbstractSocket::SocketError>::of(&QTcpSocket::error),
             this, &ClientManager::onErrorOccurred);
+    connect(socket, &QTcpSocket::bytesWritten, this, &ClientManager::pumpDeltaUpload);
+    connect(socket, &QTcpSocket::bytesWritten, this, &ClientManager::pumpArchiveUpload);
 }
 
+ClientManager::~ClientManager() = default;
+
 void ClientManager::uploadFile(const QString& localPath, const QString& remotePath) {
     QFile file(localPath);
     if (!file.open(QIODevice::ReadOnly)) {
@@ -38,6 +51,263 @@ void ClientManager::uploadFile(const QString& localPath, const QString& remotePa
     sendJson(request, "uploadFile");
 }
 
+void ClientManager::uploadFileDelta(const QString& localPath, const QString& remotePath) {
+    if (deltaEncoder || !deltaLocalPath.isEmpty()) {
+        emit fileUploadFinished(false, "Another delta upload is in progress");
+        return;
+    }
+    if (!QFileInfo(localPath).isReadable()) {
+        emit fileUploadFinished(false, "Failed to open file");
+        return;
+    }
+    deltaLocalPath = localPath;
+    deltaRemotePath = remotePath;
+
+    QJsonObject request;
+    request["method"] = "getFileSignature";
+    request["params"] = QJsonObject{{"remotePath", remotePath}};
+    sendJson(request, "getFileSignature");
+}
+
+void ClientManager::handleDeltaUploadReply(const QString& method, const QJsonObject& result) {
+    if (method == "getFileSignature") {
+        // Сигнатуры серверной копии получены — можно считать дельту
+        deltaEncoder = std::make_unique<DeltaEncoder>();
+        QString error;
+        if (!deltaEncoder->open(deltaLocalPath, result, &error)) {
+            finishDeltaUpload(false, error);
+            return;
+        }
+        QJsonObject params{{"remotePath", deltaRemotePath}};
+        if (result["exists"].toBool()) {
+            params["block_size"] = result["block_size"];
+            params["base_size"] = result["size"];
+            params["base_mtime"] = result["mtime"];
+        } else {
+            params["base_size"] = 0;
+        }
+        QJsonObject request;
+        request["method"] = "beginDeltaUpload";
+        request["params"] = params;
+        sendJson(request, "beginDeltaUpload");
+    } else if (method == "beginDeltaUpload") {
+        deltaSession = result["session"].toString();
+        pumpDeltaUpload();
+    } else if (method == "finishDeltaUpload") {
+        const qint64 sent = qint64(result["literal_bytes"].toDouble());
+        const qint64 total = qint64(result["size"].toDouble());
+        finishDeltaUpload(true, QString("Delta upload completed: sent %1 of %2 bytes").arg(sent).arg(total));
+    }
+}
+
+void ClientManager::pumpDeltaUpload() {
+    if (!deltaEncoder || deltaSession.isEmpty() || deltaFinishing) return;
+
+    while (socket->bytesToWrite() < kDeltaMaxQueued && !deltaEncoder->atEnd()) {
+        const QByteArray ops = deltaEncoder->nextChunk(kDeltaChunkBytes, kDeltaScanBudget);
+        if (ops.isEmpty()) {
+            // Длинный участок совпадений: отдаём управление циклу событий и продолжаем
+            if (!deltaEncoder->atEnd()) {
+                QTimer::singleShot(0, this, &ClientManager::pumpDeltaUpload);
+                return;
+            }
+            break;
+        }
+        QJsonObject request;
+        request["method"] = "deltaChunk";
+        request["params"] = QJsonObject{{"session", deltaSession}, {"ops", QString::fromLatin1(ops.toBase64())}};
+        sendJson(request, "deltaChunk");
+    }
+    if (!deltaEncoder->atEnd()) return;
+
+    deltaFinishing = true;
+    QJsonObject request;
+    request["method"] = "finishDeltaUpload";
+    request["params"] = QJsonObject{
+        {"session", deltaSession},
+        {"size", deltaEncoder->fileSize()},
+        {"md5", deltaEncoder->md5Hex()}
+    };
+    sendJson(request, "finishDeltaUpload");
+}
+
+void ClientManager::finishDeltaUpload(bool success, const QString& message) {
+    deltaEncoder.reset();
+    deltaLocalPath.clear();
+    deltaRemotePath.clear();
+    deltaSession.clear();
+    deltaFinishing = false;
+    emit fileUploadFinished(success, message);
+}
+
+void ClientManager::downloadDirectory(const QString& remotePath, const QString& localPath,
+                                      const QStringList& include, const QStringList& exclude) {
+    if (archiveUnpacker) {
+        emit directoryDownloadFinished(false, "Another directory download is in progress");
+        return;
+    }
+    archiveUnpacker = std::make_unique<DirectoryUnpacker>(localPath);
+    QString error;
+    if (!archiveUnpacker->open(&error)) {
+        finishDirectoryDownload(false, error);
+        return;
+    }
+    archiveReceived = 0;
+
+    QJsonObject request;
+    request["method"] = "downloadDirectory";
+    request["params"] = QJsonObject{
+        {"remotePath", remotePath},
+        {"include", QJsonArray::fromStringList(include)},
+        {"exclude", QJsonArray::fromStringList(exclude)}
+    };
+    sendJson(request, "downloadDirectory");
+}
+
+// Порции архива распаковываются сразу по приходу — целиком он нигде не хранится
+void ClientManager::handleArchiveData(const QJsonObject& params) {
+    if (!archiveUnpacker || params["transfer"].toString() != archiveTransfer) return;
+
+    const QByteArray data = QByteArray::fromBase64(params["data"].toString().toLatin1());
+    archiveReceived += data.size();
+    if (!data.isEmpty() && !archiveUnpacker->feed(data.constData(), data.size())) {
+        QJsonObject request;
+        request["method"] = "cancelDirectoryDownload";
+        request["params"] = QJsonObject{{"transfer", archiveTransfer}};
+        sendJson(request, "cancelDirectoryDownload");
+        finishDirectoryDownload(false, archiveUnpacker->errorString());
+        return;
+    }
+    emit directoryTransferProgress(archiveReceived);
+    if (!params["done"].toBool()) return;
+
+    // Ошибка на сервере (обход прерван) или обрыв архива — распаковка не завершена
+    QString error = params["status"].toObject()["error"].toString();
+    if (!error.isEmpty() || !archiveUnpacker->finish(&error)) {
+        finishDirectoryDownload(false, error);
+        return;
+    }
+    finishDirectoryDownload(true, QString("Downloaded %1 files, %2 bytes (%3 bytes compressed)")
+                                      .arg(archiveUnpacker->fileCount()).arg(archiveUnpacker->bytesWritten())
+                                      .arg(archiveReceived));
+}
+
+void ClientManager::finishDirectoryDownload(bool success, const QString& message) {
+    archiveUnpacker.reset();
+    archiveTransfer.clear();
+    emit directoryDownloadFinished(success, message);
+}
+
+void ClientManager::readFileRange(const QString& path, qint64 offset, qint64 length) {
+    QJsonObject request;
+    request["method"] = "readFileRange";
+    request["params"] = QJsonObject{{"path", path}, {"offset", offset}, {"length", length}};
+    sendJson(request, "readFileRange");
+}
+
+void ClientManager::tailFile(const QString& path, int lines, bool follow) {
+    QJsonObject request;
+    request["method"] = "tailFile";
+    request["params"] = QJsonObject{{"path", path}, {"lines", lines}, {"follow", follow}};
+    sendJson(request, "tailFile");
+}
+
+void ClientManager::stopTail(const QString& subscription) {
+    QJsonObject request;
+    request["method"] = "stopTail";
+    request["params"] = QJsonObject{{"subscription", subscription}};
+    sendJson(request, "stopTail");
+}
+
+void ClientManager::readJournal(const QJsonObject& query) {
+    QJsonObject request;
+    request["method"] = "readJournal";
+    request["params"] = query;
+    sendJson(request, "readJournal");
+}
+
+void ClientManager::followJournal(const QJsonObject& query) {
+    QJsonObject request;
+    request["method"] = "followJournal";
+    request["params"] = query;
+    sendJson(request, "followJournal");
+}
+
+void ClientManager::stopJournal(const QString& subscription) {
+    QJsonObject request;
+    request["method"] = "stopJournal";
+    request["params"] = QJsonObject{{"subscription", subscription}};
+    sendJson(request, "stopJournal");
+}
+
+void ClientManager::searchContent(const QStringList& paths, const QString& pattern, const QJsonObject& options) {
+    QJsonObject request;
+    request["method"] = "searchContent";
+    request["params"] = QJsonObject{{"paths", QJsonArray::fromStringList(paths)}, {"pattern", pattern}, {"options", options}};
+    sendJson(request, "searchContent");
+}
+
+void ClientManager::cancelContentSearch(const QString& searchId) {
+    QJsonObject request;
+    request["method"] = "cancelContentSearch";
+    request["params"] = QJsonObject{{"search_id", searchId}};
+    sendJson(request, "cancelContentSearch");
+}
+
+void ClientManager::uploadDirectory(const QString& localPath, const QString& remotePath,
+                                    const QStringList& include, const QStringList& exclude) {
+    if (archivePacker) {
+        emit directoryUploadFinished(false, "Another directory upload is in progress");
+        return;
+    }
+    archivePacker = std::make_unique<DirectoryPacker>(localPath, ArchiveFilter(include, exclude));
+    QString error;
+    if (!archivePacker->open(&error)) {
+        finishDirectoryUpload(false, error);
+        return;
+    }
+    archiveSent = 0;
+
+    QJsonObject request;
+    request["method"] = "uploadDirectory";
+    request["params"] = QJsonObject{{"remotePath", remotePath}};
+    sendJson(request, "uploadDirectory");
+}
+
+// Как и дельта: новая порция сжимается, только когда очередь сокета разошлась
+void ClientManager::pumpArchiveUpload() {
+    if (!archivePacker || archiveSession.isEmpty() || archiveFinishing) return;
+
+    while (socket->bytesToWrite() < kDeltaMaxQueued && !archivePacker->atEnd()) {
+        const QByteArray chunk = archivePacker->next(kArchiveChunkBytes);
+        if (chunk.isEmpty()) break;
+        archiveSent += chunk.size();
+        QJsonObject request;
+        request["method"] = "archiveChunk";
+        request["params"] = QJsonObject{{"session", archiveSession}, {"data", QString::fromLatin1(chunk.toBase64())}};
+        sendJson(request, "archiveChunk");
+        emit directoryTransferProgress(archiveSent);
+    }
+    if (!archivePacker->errorString().isEmpty()) {
+        finishDirectoryUpload(false, archivePacker->errorString());
+        return;
+    }
+    if (!archivePacker->atEnd()) return;
+
+    archiveFinishing = true;
+    QJsonObject request;
+    request["method"] = "finishDirectoryUpload";
+    request["params"] = QJsonObject{{"session", archiveSession}};
+    sendJson(request, "finishDirectoryUpload");
+}
+
+void ClientManager::finishDirectoryUpload(bool success, const QString& message) {
+    archivePacker.reset();
+    archiveSession.clear();
+    archiveFinishing = false;
+    emit directoryUploadFinished(success, message);
+}
+
 void ClientManager::downloadFile(const QString& remotePath, const QString& localPath) {
     QJsonObject request;
     request["method"] = "downloadFile";
@@ -48,12 +318,13 @@ void ClientManager::downloadFile(const QString& remotePath, const QString& local
     sendJson(request, "downloadFile");
 }
 
-void ClientManager::setFilePermissions(const QString& filePath, const QString& permissions) {
+void ClientManager::setFilePermissions(const QString& filePath, const QString& permissions, bool recursive) {
     QJsonObject request;
     request["method"] = "setFilePermissions";
     QJsonObject params;
     params["path"] = filePath;
     params["permissions"] = permissions;
+    if (recursive) params["recursive"] = true;
     request["params"] = params;
     sendJson(request, "setFilePermissions");
 }
@@ -68,6 +339,34 @@ void ClientManager::manageService(const QString& serviceName, const QString& act
     sendJson(request, "manageService");
 }
 
+void ClientManager::startServiceJob(const QJsonObject& params) {
+    QJsonObject request;
+    request["method"] = "startServiceJob";
+    request["params"] = params;
+    sendJson(request, "startServiceJob");
+}
+
+void ClientManager::cancelServiceJob(const QString& jobId) {
+    QJsonObject request;
+    request["method"] = "cancelServiceJob";
+    request["params"] = QJsonObject{{"job_id", jobId}};
+    sendJson(request, "cancelServiceJob");
+}
+
+void ClientManager::subscribeUnits(const QString& type, bool resources) {
+    QJsonObject request;
+    request["method"] = "subscribeUnits";
+    request["params"] = QJsonObject{{"type", type}, {"resources", resources}};
+    sendJson(request, "subscribeUnits");
+}
+
+void ClientManager::unsubscribeUnits() {
+    QJsonObject request;
+    request["method"] = "unsubscribeUnits";
+    request["params"] = QJsonObject();
+    sendJson(request, "unsubscribeUnits");
+}
+
 void ClientManager::removeUser(const QString& username) {
     QJsonObject request;
     request["method"] = "removeUser";
@@ -139,6 +438,20 @@ void ClientManager::requestUserList() {
     sendJson(request, "getUserList");
 }
 
+void ClientManager::requestUsers(const QString& filter, bool includeNss) {
+    QJsonObject request;
+    request["method"] = "listUsers";
+    request["params"] = QJsonObject{{"filter", filter}, {"nss", includeNss}};
+    sendJson(request, "listUsers");
+}
+
+void ClientManager::applyUsers(const QJsonArray& operations, const QJsonObject& options) {
+    QJsonObject request;
+    request["method"] = "applyUsers";
+    request["params"] = QJsonObject{{"operations", operations}, {"options", options}};
+    sendJson(request, "applyUsers");
+}
+
 void ClientManager::requestSystemInfo() {
     QJsonObject request;
     request["method"] = "getSystemInfo";
@@ -152,28 +465,107 @@ void ClientManager::requestFileSystem(const QString& path) {
     sendJson(request, "getFileSystem");
 }
 
+void ClientManager::requestDirectoryPage(const QString& path, const QString& cursor, int limit) {
+    QJsonObject params{{"path", path}, {"limit", limit}};
+    if (!cursor.isEmpty()) params["cursor"] = cursor;
+    QJsonObject request;
+    request["method"] = "listDirectory";
+    request["params"] = params;
+    sendJson(request, "listDirectory");
+}
+
+void ClientManager::watchDirectory(const QString& path) {
+    QJsonObject request;
+    request["method"] = "watchDirectory";
+    request["params"] = QJsonObject{{"path", path}};
+    sendJson(request, "watchDirectory");
+}
+
+void ClientManager::unwatchDirectory(const QString& path) {
+    QJsonObject request;
+    request["method"] = "unwatchDirectory";
+    request["params"] = QJsonObject{{"path", path}};
+    sendJson(request, "unwatchDirectory");
+}
+
+void ClientManager::searchFiles(const QString& pattern, int limit) {
+    QJsonObject request;
+    request["method"] = "searchFiles";
+    request["params"] = QJsonObject{{"pattern", pattern}, {"limit", limit}};
+    sendJson(request, "searchFiles");
+}
+
+void ClientManager::requestDirectorySizes(const QString& path, int depth) {
+    QJsonObject request;
+    request["method"] = "getDirectorySizes";
+    request["params"] = QJsonObject{{"path", path}, {"depth", depth}};
+    sendJson(request, "getDirectorySizes");
+}
+
 void ClientManager::requestProcessList() {
     QJsonObject request;
     request["method"] = "getProcessList";
     sendJson(request, "getProcessList");
 }
 
+void ClientManager::requestProcessList(const QJsonObject& query) {
+    QJsonObject request;
+    request["method"] = "getProcessList";
+    request["params"] = query;
+    sendJson(request, "getProcessList");
+}
+
 void ClientManager::onReadyRead() {
     QDataStream in(socket);
     in.setVersion(QDataStream::Qt_5_14);
     in.setByteOrder(QDataStream::BigEndian);
 
-    if (blockSize == 0) {
-        if (socket->bytesAvailable() < static_cast<int>(sizeof(quint32))) return;
-        in >> blockSize;
+    // За один readyRead может прийти несколько кадров (ответ и уведомления)
+    for (;;) {
+        if (blockSize == 0) {
+            if (socket->bytesAvailable() < static_cast<int>(sizeof(quint32))) return;
+            in >> blockSize;
+        }
+        if (socket->bytesAvailable() < blockSize) return;
+
+        QByteArray data;
+        data.resize(blockSize);
+        in.readRawData(data.data(), blockSize);
+        blockSize = 0;
+        handleMessage(data);
     }
-    if (socket->bytesAvailable() < blockSize) return;
+}
 
-    QByteArray data;
-    data.resize(blockSize);
-    in.readRawData(data.data(), blockSize);
-    blockSize = 0;
+void ClientManager::handleNotification(const QString& method, const QJsonObject& params) {
+    if (method == "directorySizes") {
+        emit directorySizesReceived(params, params["done"].toBool());
+    } else if (method == "permissionsProgress") {
+        emit permissionsProgress(params, params["done"].toBool());
+    } else if (method == "fileTail") {
+        emit fileTailReceived(params);
+    } else if (method == "journalEntries") {
+        emit journalEntriesReceived(params);
+    } else if (method == "contentSearchResults") {
+        emit contentSearchResults(params, params["done"].toBool());
+    } else if (method == "serviceJobProgress") {
+        emit serviceJobProgress(params, params["done"].toBool());
+    } else if (method == "unitsChanged") {
+        QStringList removed;
+        for (const QJsonValue& name : params["removed"].toArray()) removed << name.toString();
+        emit unitsChanged(params["units"].toArray(), removed);
+    } else if (method == "unitUsage") {
+        emit unitUsageChanged(params["units"].toObject());
+    } else if (method == "archiveData") {
+        handleArchiveData(params);
+    } else if (method == "directoryChanged") {
+        emit directoryChanged(params["path"].toString(), params["events"].toArray(),
+                              params["overflow"].toBool(), params["removed"].toBool());
+    } else {
+        qWarning() << "Unknown notification:" << method;
+    }
+}
 
+void ClientManager::handleMessage(const QByteArray& data) {
     QJsonParseError parseError;
     QJsonDocument doc = QJsonDocument::fromJson(data, &parseError);
     if (parseError.error != QJsonParseError::NoError) {
@@ -182,6 +574,10 @@ void ClientManager::onReadyRead() {
     }
 
     QJsonObject response = doc.object();
+    if (!response.contains("id") && response.contains("method")) {
+        handleNotification(response["method"].toString(), response["params"].toObject());
+        return;
+    }
     if (!response.contains("id")) {
         qWarning() << "JSON-RPC response without id";
         return;
@@ -195,6 +591,29 @@ void ClientManager::onReadyRead() {
     if (response.contains("error")) {
         QJsonObject err = response["error"].toObject();
         qWarning() << "Server returned error for" << method << ":" << err["message"].toString();
+        // Ошибка на любом шаге дельты обрывает всю загрузку; сервер сессию уже закрыл
+        if (!deltaLocalPath.isEmpty() && (method == "getFileSignature" || method == "beginDeltaUpload"
+                                          || method == "deltaChunk" || method == "finishDeltaUpload")) {
+            finishDeltaUpload(false, err["message"].toString());
+        }
+        if (method == "tailFile" || method == "readFileRange") {
+            emit fileReadFailed(err["message"].toString());
+        }
+        if (method == "readJournal" || method == "followJournal") {
+            emit journalFailed(err["message"].toString());
+        }
+        if (method == "searchContent") {
+            emit contentSearchFailed(err["message"].toString());
+        }
+        if (method == "applyUsers") {
+            emit usersApplied(QJsonObject{{"committed", false}, {"error", err["message"].toString()}});
+        }
+        if (archiveUnpacker && method == "downloadDirectory") {
+            finishDirectoryDownload(false, err["message"].toString());
+        } else if (archivePacker && (method == "uploadDirectory" || method == "archiveChunk"
+                                     || method == "finishDirectoryUpload")) {
+            finishDirectoryUpload(false, err["message"].toString());
+        }
         return;
     }
     if (!response.contains("result")) {
@@ -207,12 +626,30 @@ void ClientManager::onReadyRead() {
         QStringList list;
         for (const auto& val : array) list << val.toString();
         emit userListReceived(list);
+    } else if (method == "listUsers") {
+        emit usersReceived(response["result"].toObject()["users"].toArray());
+    } else if (method == "applyUsers") {
+        emit usersApplied(response["result"].toObject());
+    } else if (method == "subscribeUnits" || method == "listUnits") {
+        emit unitsReceived(response["result"].toObject()["units"].toArray());
     } else if (method == "getSystemInfo") {
         emit systemInfoReceived(response["result"].toObject());
     } else if (method == "getFileSystem") {
         emit fileSystemReceived(response["result"].toArray());
+    } else if (method == "listDirectory") {
+        QJsonObject page = response["result"].toObject();
+        emit directoryPageReceived(page["path"].toString(), page["entries"].toArray(),
+                                   page["cursor"].toString(), page["done"].toBool(true));
+    } else if (method == "searchFiles") {
+        emit fileSearchResults(response["result"].toObject());
+    } else if (method == "getDirectorySizes") {
+        QJsonObject sizes = response["result"].toObject();
+        emit directorySizesReceived(sizes, sizes["done"].toBool());
     } else if (method == "getProcessList") {
-        emit processListReceived(response["result"].toArray());
+        // На запрос с параметрами сервер отвечает страницей {total, processes}
+        const QJsonValue result = response["result"];
+        emit processListReceived(result.isObject() ? result.toObject()["processes"].toArray()
+                                                   : result.toArray());
     } else if (method == "downloadFile") {
         QJsonObject result = response["result"].toObject();
         QString savePath = result["savePath"].toString();
@@ -226,6 +663,36 @@ void ClientManager::onReadyRead() {
         } else {
             qWarning() << "Failed to save file to" << savePath;
         }
+    } else if (method == "getFileSignature" || method == "beginDeltaUpload" || method == "finishDeltaUpload") {
+        handleDeltaUploadReply(method, response["result"].toObject());
+    } else if (method == "deltaChunk") {
+        // Подтверждение чанка; ошибки обрабатываются выше
+    } else if (method == "downloadDirectory") {
+        if (archiveUnpacker) archiveTransfer = response["result"].toObject()["transfer"].toString();
+    } else if (method == "uploadDirectory") {
+        if (archivePacker) {
+            archiveSession = response["result"].toObject()["session"].toString();
+            pumpArchiveUpload();
+        }
+    } else if (method == "readFileRange") {
+        emit fileRangeReceived(response["result"].toObject());
+    } else if (method == "tailFile") {
+        emit fileTailReceived(response["result"].toObject());
+    } else if (method == "readJournal") {
+        emit journalPageReceived(response["result"].toObject());
+    } else if (method == "followJournal") {
+        emit journalEntriesReceived(response["result"].toObject());
+    } else if (method == "searchContent") {
+        // Ответ несёт только search_id; совпадения придут уведомлениями
+        emit contentSearchResults(response["result"].toObject(), false);
+    } else if (method == "archiveChunk" || method == "cancelDirectoryDownload" || method == "stopTail"
+               || method == "cancelContentSearch") {
+        // Подтверждения; ошибки обрабатываются выше
+    } else if (method == "finishDirectoryUpload") {
+        const QJsonObject result = response["result"].toObject();
+        finishDirectoryUpload(true, QString("Uploaded %1 files, %2 bytes (%3 bytes compressed)")
+                                        .arg(qint64(result["files"].toDouble())).arg(qint64(result["bytes"].toDouble()))
+                                        .arg(qint64(result["compressed_bytes"].toDouble())));
     } else if (method == "uploadFile") {
         emit fileUploadFinished(true, "Upload completed");
     } else {
@@ -7,53 +7,174 @@
 #include <QJsonObject>
 #include <QJsonArray>
 #include <QFile>
+#include <QStringList>
+#include <memory>
+
+class DeltaEncoder;
+class DirectoryPacker;
+class DirectoryUnpacker;
 
 class ClientManager : public QObject {
     Q_OBJECT
 public:
     explicit ClientManager(QObject* parent = nullptr);
+    ~ClientManager();
 
     void connectToServer(const QString& host, quint16 port);
 
     void requestUserList();
+    // Полные записи пользователей; filter — human, system или all. Ответ — usersReceived
+    void requestUsers(const QString& filter = "all", bool includeNss = false);
+    // Пакет операций над учётными записями (create, delete, password, groups,
+    // create_group, delete_group); options — atomic, dry_run, create_home. Ответ — usersApplied
+    void applyUsers(const QJsonArray& operations, const QJsonObject& options = QJsonObject());
     void requestSystemInfo();
     void requestFileSystem(const QString& path);
+    // Страница листинга каталога; cursor — из предыдущей страницы (пустой — с начала)
+    void requestDirectoryPage(const QString& path, const QString& cursor = QString(), int limit = 500);
+    // Подписка на изменения каталога: сервер присылает directoryChanged
+    void watchDirectory(const QString& path);
+    void unwatchDirectory(const QString& path);
+    // Поиск по серверному индексу имён: подстрока или glob
+    void searchFiles(const QString& pattern, int limit = 100);
+    // Размеры подкаталогов; пока сервер считает, приходят промежуточные результаты
+    void requestDirectorySizes(const QString& path, int depth);
     void requestProcessList();
+    // Серверная выборка: фильтры, sortBy/order, limit/offset, fields
+    void requestProcessList(const QJsonObject& query);
     void addUser(const QString& username, const QString& password);
     void removeUser(const QString& username);
     void changeUserPassword(const QString& username, const QString& password);
-    void setFilePermissions(const QString& path, const QString& permissions);
+    // permissions — восьмеричный режим или записи ACL (u:alice:rwx,d:g:dev:rX);
+    // recursive=true — сервер обходит каталог в фоне и присылает permissionsProgress
+    void setFilePermissions(const QString& path, const QString& permissions, bool recursive = false);
     void manageService(const QString& service, const QString& action);
+    // Действие над несколькими юнитами: units или pattern, action, concurrency,
+    // stop_on_failure. Ход и итог — serviceJobProgress
+    void startServiceJob(const QJsonObject& params);
+    void cancelServiceJob(const QString& jobId);
+    // Таблица юнитов systemd; type — service, timer, ... (пустой — все).
+    // Сначала приходит unitsReceived с полным списком, затем unitsChanged;
+    // с resources — ещё и unitUsageChanged со сводками ресурсов cgroup
+    void subscribeUnits(const QString& type = "service", bool resources = true);
+    void unsubscribeUnits();
 
     void uploadFile(const QString& localPath, const QString& remotePath);
+    // Загрузка дельтой: передаются только изменившиеся относительно серверной копии части.
+    // Итог — тот же сигнал fileUploadFinished
+    void uploadFileDelta(const QString& localPath, const QString& remotePath);
     void downloadFile(const QString& remotePath, const QString& localPath);
+    // Каталог целиком одним потоком tar+zstd; include/exclude — glob по имени
+    // или, если в шаблоне есть '/', по относительному пути
+    void downloadDirectory(const QString& remotePath, const QString& localPath,
+                           const QStringList& include = QStringList(), const QStringList& exclude = QStringList());
+    void uploadDirectory(const QString& localPath, const QString& remotePath,
+                         const QStringList& include = QStringList(), const QStringList& exclude = QStringList());
+    // Кусок файла; отрицательный offset — от конца. Ответ — fileRangeReceived
+    void readFileRange(const QString& path, qint64 offset, qint64 length);
+    // Последние lines строк; follow=true — дальше сервер присылает дописанное.
+    // И ответ, и последующие порции приходят сигналом fileTailReceived
+    void tailFile(const QString& path, int lines, bool follow);
+    void stopTail(const QString& subscription);
+    // Журнал systemd. query: unit, priority, since, until, boot, match, regex,
+    // cursor, direction, limit. Страница — journalPageReceived
+    void readJournal(const QJsonObject& query);
+    // Те же фильтры и lines; начальные записи и новые порции — journalEntriesReceived
+    void followJournal(const QJsonObject& query);
+    void stopJournal(const QString& subscription);
+    // Поиск по содержимому файлов на сервере (paths — файлы и каталоги).
+    // options: regex, ignoreCase, context, maxMatches, maxBytes, include, exclude.
+    // Совпадения приходят пачками сигналом contentSearchResults
+    void searchContent(const QStringList& paths, const QString& pattern, const QJsonObject& options = QJsonObject());
+    void cancelContentSearch(const QString& searchId);
 
 signals:
     void connected();
     void connectionError(const QString& errorString);
 
     void userListReceived(const QStringList& users);
+    // [{name, uid, gid, group, groups, home, shell, system, password, locked, expired, ...}]
+    void usersReceived(const QJsonArray& users);
+    // {items: [{index, op, name, status, error, warning}], committed, applied, failed, error}
+    void usersApplied(const QJsonObject& result);
     void systemInfoReceived(const QJsonObject& info);
     void fileSystemReceived(const QJsonArray& files);
+    void directoryPageReceived(const QString& path, const QJsonArray& entries, const QString& cursor, bool done);
     void processListReceived(const QJsonArray& processes);
+    void fileSearchResults(const QJsonObject& results);
+    // overflow — часть событий потеряна, каталог нужно перечитать; removed — каталог удалён
+    void directoryChanged(const QString& path, const QJsonArray& events, bool overflow, bool removed);
+    // done=false — частичный результат идущего обхода
+    void directorySizesReceived(const QJsonObject& sizes, bool done);
+    // Прогресс рекурсивной установки прав; при done=true — итог с failures
+    void permissionsProgress(const QJsonObject& status, bool done);
     void operationFinished(const QString& methodName, const QJsonObject& result);
 
     void fileDownloadFinished(bool success, const QString& message);
     void fileUploadFinished(bool success, const QString& message);
+    // Сжатых байт передано в текущей передаче каталога
+    void directoryTransferProgress(qint64 compressedBytes);
+    void directoryDownloadFinished(bool success, const QString& message);
+    void directoryUploadFinished(bool success, const QString& message);
+    void fileRangeReceived(const QJsonObject& range);
+    // {subscription, path, offset, data (base64)}; rotated/truncated — файл заменили или усекли
+    void fileTailReceived(const QJsonObject& chunk);
+    void fileReadFailed(const QString& message);
+    // {entries: [{cursor, time, priority, unit, identifier, pid, message}], cursor, done}
+    void journalPageReceived(const QJsonObject& page);
+    // {subscription, entries, cursor}
+    void journalEntriesReceived(const QJsonObject& batch);
+    void journalFailed(const QString& message);
+    // {search_id, matches: [{file, line, text, before, after}]}; при done=true — итог
+    // с total_matches, scanned_bytes, truncated и errors
+    void contentSearchResults(const QJsonObject& batch, bool done);
+    void contentSearchFailed(const QString& message);
+    // [{name, load, active, sub, description, job, unit_file_state, main_pid, restarts, ...}]
+    void unitsReceived(const QJsonArray& units);
+    void unitsChanged(const QJsonArray& units, const QStringList& removed);
+    // {имя юнита: {cpu_percent, memory_current, memory_peak, io_read_bps, io_write_bps, tasks}}
+    void unitUsageChanged(const QJsonObject& usage);
+    // {job_id, action, total, queued, running, succeeded, failed, cancelled, units: [{name, state, result, error}]}
+    void serviceJobProgress(const QJsonObject& status, bool done);
 
 private slots:
     void onConnected();
     void onReadyRead();
     void onErrorOccurred(QAbstractSocket::SocketError);
+    void pumpDeltaUpload();
+    void pumpArchiveUpload();
 
 private:
     void sendJson(const QJsonObject& obj, const QString& methodName);
+    void handleMessage(const QByteArray& data);
+    void handleNotification(const QString& method, const QJsonObject& params);
+    void handleDeltaUploadReply(const QString& method, const QJsonObject& result);
+    void finishDeltaUpload(bool success, const QString& message);
+    void handleArchiveData(const QJsonObject& params);
+    void finishDirectoryDownload(bool success, const QString& message);
+    void finishDirectoryUpload(bool success, const QString& message);
 
     QTcpSocket* socket;
     quint32 blockSize;
 
     QMap<int, QString> pendingRequests;
     int nextId;
+
+    // Текущая дельта-загрузка (одна за раз)
+    std::unique_ptr<DeltaEncoder> deltaEncoder;
+    QString deltaLocalPath;
+    QString deltaRemotePath;
+    QString deltaSession;
+    bool deltaFinishing = false;
+
+    // Текущие передачи каталогов (по одной в каждую сторону)
+    std::unique_ptr<DirectoryUnpacker> archiveUnpacker;
+    QString archiveTransfer;
+    qint64 archiveReceived = 0;
+    std::unique_ptr<DirectoryPacker> archivePacker;
+    QString archiveSession;
+    qint64 archiveSent = 0;
+    bool archiveFinishing = false;
 };
 
 #endif // CLIENTMANAGER_H
@@ -0,0 +1,184 @@
+#include "DeltaEncoder.h"
+#include <cstring>
+
+static const uchar kOpCopy = 0x01;
+static const uchar kOpLiteral = 0x02;
+static const int kSignatureSize = 4 + 16;
+
+static quint32 getU32(const uchar* in) {
+    return (quint32(in[0]) << 24) | (quint32(in[1]) << 16) | (quint32(in[2]) << 8) | quint32(in[3]);
+}
+
+static void appendU32(QByteArray& out, quint32 value) {
+    const char bytes[4] = { char(value >> 24), char(value >> 16), char(value >> 8), char(value) };
+    out.append(bytes, 4);
+}
+
+static int weakTag(quint32 weak) {
+    return int((weak ^ (weak >> 16)) & 0xffff);
+}
+
+DeltaEncoder::DeltaEncoder() : md5(QCryptographicHash::Md5) { }
+
+bool DeltaEncoder::open(const QString& localPath, const QJsonObject& signature, QString* error) {
+    file.setFileName(localPath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        if (error) *error = file.errorString();
+        return false;
+    }
+    size = file.size();
+    if (size > 0) {
+        data = file.map(0, size);
+        if (!data) {
+            if (error) *error = "Cannot map file: " + file.errorString();
+            return false;
+        }
+    }
+
+    if (signature["exists"].toBool()) {
+        blockSize = signature["block_size"].toInt();
+        baseSize = qint64(signature["size"].toDouble());
+        signatures = QByteArray::fromBase64(signature["signatures"].toString().toLatin1());
+        blockCount = quint32(signatures.size() / kSignatureSize);
+        if (blockSize <= 0 && blockCount > 0) {
+            if (error) *error = "Invalid signature";
+            return false;
+        }
+    }
+
+    weakTags.resize(1 << 16);
+    weakIndex.reserve(int(blockCount));
+    const uchar* raw = reinterpret_cast<const uchar*>(signatures.constData());
+    for (quint32 i = 0; i < blockCount; ++i) {
+        const quint32 weak = getU32(raw + i * kSignatureSize);
+        weakIndex[weak].append(i);
+        weakTags.setBit(weakTag(weak));
+    }
+    return true;
+}
+
+// Блок с той же слабой суммой и тем же MD5; предпочтение — следующему за
+// текущей серией, чтобы копии склеивались в одну операцию
+int DeltaEncoder::findBlock(quint32 weak, const uchar* window, int length) {
+    if (!weakTags.testBit(weakTag(weak))) return -1;
+    auto it = weakIndex.constFind(weak);
+    if (it == weakIndex.constEnd()) return -1;
+
+    const QByteArray strong = QCryptographicHash::hash(
+        QByteArray::fromRawData(reinterpret_cast<const char*>(window), length), QCryptographicHash::Md5);
+    const qint64 expected = copyFirst >= 0 ? copyFirst + copyCount : -1;
+    int found = -1;
+    for (quint32 block : it.value()) {
+        const int blockLength = int(qMin<qint64>(blockSize, baseSize - qint64(block) * blockSize));
+        if (blockLength != length) continue;
+        if (std::memcmp(signatures.constData() + block * kSignatureSize + 4, strong.constData(), 16) != 0) continue;
+        if (qint64(block) == expected) return int(block);
+        if (found < 0) found = int(block);
+    }
+    return found;
+}
+
+void DeltaEncoder::flushLiteral(QByteArray& ops, qint64 end) {
+    if (end <= literalStart) return;
+    flushCopy(ops);
+    const qint64 length = end - literalStart;
+    ops.append(char(kOpLiteral));
+    appendU32(ops, quint32(length));
+    ops.append(reinterpret_cast<const char*>(data + literalStart), int(length));
+    literalTotal += length;
+    literalStart = end;
+}
+
+void DeltaEncoder::flushCopy(QByteArray& ops) {
+    if (copyFirst < 0) return;
+    ops.append(char(kOpCopy));
+    appendU32(ops, quint32(copyFirst));
+    appendU32(ops, copyCount);
+    copyFirst = -1;
+    copyCount = 0;
+}
+
+void DeltaEncoder::addCopy(QByteArray& ops, quint32 block) {
+    if (copyFirst >= 0 && qint64(block) == copyFirst + copyCount) {
+        ++copyCount;
+        return;
+    }
+    flushCopy(ops);
+    copyFirst = block;
+    copyCount = 1;
+}
+
+QByteArray DeltaEncoder::nextChunk(int maxBytes, qint64 scanBudget) {
+    QByteArray ops;
+    const qint64 scanLimit = pos + scanBudget;
+
+    while (pos < size && ops.size() < maxBytes && pos < scanLimit) {
+        // Хвост короче блока может совпасть только с последним, укороченным блоком сервера
+        if (blockCount == 0 || size - pos < blockSize) {
+            const qint64 lastLength = blockCount ? baseSize - qint64(blockCount - 1) * blockSize : 0;
+            if (lastLength > 0 && lastLength < blockSize && size - pos >= lastLength) {
+                const uchar* tail = data + size - lastLength;
+                quint32 ta = 0, tb = 0;
+                for (qint64 i = 0; i < lastLength; ++i) {
+                    ta += tail[i];
+                    tb += quint32(lastLength - i) * tail[i];
+                }
+                const quint32 weak = (ta & 0xffff) | (tb << 16);
+                if (findBlock(weak, tail, int(lastLength)) == int(blockCount - 1)) {
+                    flushLiteral(ops, size - lastLength);
+                    addCopy(ops, blockCount - 1);
+                    literalStart = size;
+                }
+            }
+            pos = size;
+            break;
+        }
+
+        const uchar* window = data + pos;
+        if (!haveWindow) {
+            a = b = 0;
+            for (int i = 0; i < blockSize; ++i) {
+                a += window[i];
+                b += quint32(blockSize - i) * window[i];
+            }
+            haveWindow = true;
+        }
+
+        const int block = findBlock((a & 0xffff) | (b << 16), window, blockSize);
+        if (block >= 0) {
+            flushLiteral(ops, pos);
+            addCopy(ops, quint32(block));
+            pos += blockSize;
+            literalStart = pos;
+            haveWindow = false;
+            continue;
+        }
+
+        // Окно сдвигается на байт: a и b обновляются без пересчёта всего блока
+        if (pos + blockSize < size) {
+            const quint32 out = window[0];
+            const quint32 in = window[blockSize];
+            a += in - out;
+            b += a - quint32(blockSize) * out;
+        } else {
+            haveWindow = false;
+        }
+        ++pos;
+        if (pos - literalStart >= maxBytes) flushLiteral(ops, pos);
+    }
+
+    if (pos >= size) flushLiteral(ops, size);
+    flushCopy(ops);
+
+    // MD5 всего файла считается по мере продвижения, а не отдельным проходом
+    while (hashedUpTo < pos) {
+        const int piece = int(qMin<qint64>(pos - hashedUpTo, 64 * 1024 * 1024));
+        md5.addData(reinterpret_cast<const char*>(data + hashedUpTo), piece);
+        hashedUpTo += piece;
+    }
+    return ops;
+}
+
+QString DeltaEncoder::md5Hex() const {
+    return QString::fromLatin1(md5.result().toHex());
+}
@@ -0,0 +1,62 @@
+#ifndef DELTAENCODER_H
+#define DELTAENCODER_H
+
+#include <QBitArray>
+#include <QCryptographicHash>
+#include <QFile>
+#include <QHash>
+#include <QJsonObject>
+#include <QVector>
+
+// Клиентская половина дельта-загрузки: по сигнатурам серверной копии
+// (getFileSignature) строит поток операций — ссылки на совпавшие блоки и
+// новые данные. Слабая сумма и формат операций описаны в deltatransfer.h
+// сервера. Файл читается через mmap и обрабатывается порциями, чтобы
+// очередь сокета и память оставались ограниченными.
+class DeltaEncoder {
+public:
+    DeltaEncoder();
+
+    bool open(const QString& localPath, const QJsonObject& signature, QString* error);
+
+    // Следующая порция операций: не больше ~maxBytes и не дальше scanBudget байт
+    // файла за вызов. Может вернуть пустой массив, если совпадений ещё ищется.
+    QByteArray nextChunk(int maxBytes, qint64 scanBudget);
+    bool atEnd() const { return pos >= size; }
+
+    qint64 fileSize() const { return size; }
+    qint64 position() const { return pos; }
+    qint64 literalBytes() const { return literalTotal; }
+    // MD5 всего файла, готов после atEnd()
+    QString md5Hex() const;
+
+private:
+    int findBlock(quint32 weak, const uchar* window, int length);
+    void flushLiteral(QByteArray& ops, qint64 end);
+    void flushCopy(QByteArray& ops);
+    void addCopy(QByteArray& ops, quint32 block);
+
+    QFile file;
+    const uchar* data = nullptr;
+    qint64 size = 0;
+
+    int blockSize = 0;
+    quint32 blockCount = 0;
+    qint64 baseSize = 0;
+    QByteArray signatures;                   // weak (u32 BE) + MD5 на блок
+    QHash<quint32, QVector<quint32>> weakIndex;
+    QBitArray weakTags;                      // быстрый отсев по 16 битам слабой суммы
+
+    qint64 pos = 0;
+    qint64 literalStart = 0;
+    bool haveWindow = false;
+    quint32 a = 0, b = 0;
+    qint64 copyFirst = -1;                   // текущая серия подряд идущих блоков
+    quint32 copyCount = 0;
+    qint64 literalTotal = 0;
+
+    QCryptographicHash md5;
+    qint64 hashedUpTo = 0;
+};
+
+#endif // DELTAENCODER_H
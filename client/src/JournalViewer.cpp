@@ -0,0 +1,184 @@
+#include "JournalViewer.h"
+#include "ClientManager.h"
+#include <QComboBox>
+#include <QFontDatabase>
+#include <QHBoxLayout>
+#include <QLabel>
+#include <QLineEdit>
+#include <QPlainTextEdit>
+#include <QPushButton>
+#include <QScrollBar>
+#include <QTextCursor>
+#include <QVBoxLayout>
+
+static const int kInitialEntries = 500;
+static const int kEarlierPage = 500;
+static const int kMaxBlocks = 20000;             // строк в окне при слежении
+
+JournalViewer::JournalViewer(ClientManager* client, const QString& unit, QWidget* parent)
+    : QDialog(parent), client(client), unit(unit)
+{
+    setAttribute(Qt::WA_DeleteOnClose);
+    setWindowTitle("Журнал: " + unit);
+    resize(1000, 600);
+
+    priorityBox = new QComboBox(this);
+    priorityBox->addItem("Все приоритеты", -1);
+    const QStringList priorities{"emerg", "alert", "crit", "err", "warning", "notice", "info", "debug"};
+    for (int p = 0; p < priorities.size(); ++p) priorityBox->addItem(QString("до %1 (%2)").arg(priorities[p]).arg(p), p);
+    matchEdit = new QLineEdit(this);
+    matchEdit->setPlaceholderText("Текст в сообщении");
+    QPushButton* applyButton = new QPushButton("Применить", this);
+
+    view = new QPlainTextEdit(this);
+    view->setReadOnly(true);
+    view->setLineWrapMode(QPlainTextEdit::NoWrap);
+    view->setFont(QFontDatabase::systemFont(QFontDatabase::FixedFont));
+    view->setMaximumBlockCount(kMaxBlocks);
+
+    statusLabel = new QLabel("Загрузка...", this);
+    earlierButton = new QPushButton("Раньше", this);
+    earlierButton->setEnabled(false);
+
+    QHBoxLayout* top = new QHBoxLayout();
+    top->addWidget(priorityBox);
+    top->addWidget(matchEdit, 1);
+    top->addWidget(applyButton);
+    QHBoxLayout* bottom = new QHBoxLayout();
+    bottom->addWidget(statusLabel, 1);
+    bottom->addWidget(earlierButton);
+    QVBoxLayout* layout = new QVBoxLayout(this);
+    layout->addLayout(top);
+    layout->addWidget(view, 1);
+    layout->addLayout(bottom);
+
+    connect(applyButton, &QPushButton::clicked, this, &JournalViewer::applyFilter);
+    connect(matchEdit, &QLineEdit::returnPressed, this, &JournalViewer::applyFilter);
+    connect(earlierButton, &QPushButton::clicked, this, &JournalViewer::loadEarlier);
+    connect(client, &ClientManager::journalEntriesReceived, this, &JournalViewer::onEntries);
+    connect(client, &ClientManager::journalPageReceived, this, &JournalViewer::onPage);
+    connect(client, &ClientManager::journalFailed, this, &JournalViewer::onFailed);
+    applyFilter();
+}
+
+JournalViewer::~JournalViewer() {
+    if (client && !subscription.isEmpty()) client->stopJournal(subscription);
+}
+
+QJsonObject JournalViewer::query() const {
+    QJsonObject q{{"unit", unit}};
+    const int priority = priorityBox->currentData().toInt();
+    if (priority >= 0) q["priority"] = priority;
+    if (!matchEdit->text().isEmpty()) q["match"] = matchEdit->text();
+    return q;
+}
+
+void JournalViewer::applyFilter() {
+    if (!client) return;
+    if (!subscription.isEmpty()) {
+        client->stopJournal(subscription);
+        retired << subscription;
+    }
+    subscription.clear();
+    firstCursor.clear();
+    earlierDone = false;
+    shown = 0;
+    view->clear();
+    view->setMaximumBlockCount(kMaxBlocks);
+
+    QJsonObject q = query();
+    q["lines"] = kInitialEntries;
+    followPending = true;
+    client->followJournal(q);
+    updateStatus();
+}
+
+QString JournalViewer::format(const QJsonObject& entry) {
+    QString source = entry["identifier"].toString();
+    if (entry.contains("pid")) source += QString("[%1]").arg(qint64(entry["pid"].toDouble()));
+    return QString("%1 %2: %3").arg(entry["time"].toString(), source, entry["message"].toString());
+}
+
+void JournalViewer::onEntries(const QJsonObject& batch) {
+    const QString sub = batch["subscription"].toString();
+    if (subscription.isEmpty()) {
+        // Первый ответ на наш followJournal: дальше узнаём свои порции по номеру подписки
+        if (!followPending || sub.isEmpty() || retired.contains(sub)) return;
+        followPending = false;
+        subscription = sub;
+    } else if (sub != subscription) {
+        return;
+    }
+
+    const QJsonArray entries = batch["entries"].toArray();
+    if (firstCursor.isEmpty()) {
+        // Подходящих записей в хвосте нет — листать назад можно от позиции сервера
+        firstCursor = entries.isEmpty() ? batch["cursor"].toString() : entries.first().toObject()["cursor"].toString();
+    }
+    if (entries.isEmpty()) {
+        updateStatus();
+        return;
+    }
+    QStringList lines;
+    for (const QJsonValue& value : entries) lines << format(value.toObject());
+
+    // Прокручиваем за новыми строками, только если пользователь и так внизу
+    QScrollBar* bar = view->verticalScrollBar();
+    const bool atBottom = bar->value() == bar->maximum();
+    view->appendPlainText(lines.join('\n'));
+    if (atBottom) bar->setValue(bar->maximum());
+    shown += entries.size();
+    updateStatus();
+}
+
+void JournalViewer::loadEarlier() {
+    if (!client || pagePending || firstCursor.isEmpty()) return;
+    QJsonObject q = query();
+    q["cursor"] = firstCursor;
+    q["direction"] = "backward";
+    q["limit"] = kEarlierPage;
+    pagePending = true;
+    updateStatus();
+    client->readJournal(q);
+}
+
+void JournalViewer::onPage(const QJsonObject& page) {
+    if (!pagePending) return;
+    pagePending = false;
+    // Сервер мог остановиться по времени, ничего не найдя: продолжение — с его курсора
+    if (!page["cursor"].toString().isEmpty()) firstCursor = page["cursor"].toString();
+    earlierDone = page["done"].toBool();
+
+    // Страница идёт от новых к старым — в начало окна вставляем в обратном порядке
+    const QJsonArray entries = page["entries"].toArray();
+    QStringList lines;
+    for (int i = entries.size() - 1; i >= 0; --i) lines << format(entries[i].toObject());
+    if (!lines.isEmpty()) {
+        // Догруженное пользователем не должно вытесняться пределом строк
+        view->setMaximumBlockCount(view->maximumBlockCount() + lines.size());
+        QScrollBar* bar = view->verticalScrollBar();
+        const int position = bar->value();
+        QTextCursor cursor(view->document());
+        cursor.movePosition(QTextCursor::Start);
+        cursor.insertText(lines.join('\n') + '\n');
+        bar->setValue(position + lines.size());
+        shown += lines.size();
+    }
+    updateStatus();
+}
+
+void JournalViewer::onFailed(const QString& message) {
+    followPending = false;
+    pagePending = false;
+    statusLabel->setText("Ошибка: " + message);
+    earlierButton->setEnabled(!firstCursor.isEmpty() && !earlierDone);
+}
+
+void JournalViewer::updateStatus() {
+    QString text = QString("Записей: %1").arg(shown);
+    if (pagePending) text += ", загрузка более ранних...";
+    else if (earlierDone) text += ", показано с начала журнала";
+    if (!subscription.isEmpty()) text += ", слежение включено";
+    statusLabel->setText(text);
+    earlierButton->setEnabled(!firstCursor.isEmpty() && !earlierDone && !pagePending);
+}
@@ -0,0 +1,56 @@
+#ifndef JOURNALVIEWER_H
+#define JOURNALVIEWER_H
+
+#include <QDialog>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QPointer>
+#include <QStringList>
+
+class ClientManager;
+class QComboBox;
+class QLabel;
+class QLineEdit;
+class QPlainTextEdit;
+class QPushButton;
+
+// Журнал systemd одного юнита: последние записи и слежение за новыми
+// (followJournal). Приоритет и текст фильтруются на сервере — при смене
+// фильтра подписка открывается заново. «Раньше» листает назад страницами
+// readJournal от самой старой показанной записи.
+class JournalViewer : public QDialog {
+    Q_OBJECT
+public:
+    JournalViewer(ClientManager* client, const QString& unit, QWidget* parent = nullptr);
+    ~JournalViewer() override;
+
+private slots:
+    void onEntries(const QJsonObject& batch);
+    void onPage(const QJsonObject& page);
+    void onFailed(const QString& message);
+    void applyFilter();
+    void loadEarlier();
+
+private:
+    QJsonObject query() const;
+    static QString format(const QJsonObject& entry);
+    void updateStatus();
+
+    QPointer<ClientManager> client;     // окно может пережить соединение
+    QString unit;
+    QString subscription;
+    QStringList retired;                // снятые подписки: их запоздавшие порции не наши
+    bool followPending = false;
+    bool pagePending = false;
+    bool earlierDone = false;
+    QString firstCursor;                // самая старая показанная запись
+    int shown = 0;
+
+    QComboBox* priorityBox;
+    QLineEdit* matchEdit;
+    QPlainTextEdit* view;
+    QLabel* statusLabel;
+    QPushButton* earlierButton;
+};
+
+#endif // JOURNALVIEWER_H
@@ -0,0 +1,135 @@
+#include "LogViewer.h"
+#include "ClientManager.h"
+#include <QFontDatabase>
+#include <QHBoxLayout>
+#include <QLabel>
+#include <QPlainTextEdit>
+#include <QPushButton>
+#include <QScrollBar>
+#include <QTextCodec>
+#include <QTextCursor>
+#include <QVBoxLayout>
+
+static const int kInitialLines = 500;
+static const int kMaxBlocks = 20000;             // строк в окне при слежении
+static const qint64 kEarlierChunk = 64 * 1024;
+
+LogViewer::LogViewer(ClientManager* client, const QString& path, QWidget* parent)
+    : QDialog(parent), client(client), path(path)
+{
+    setAttribute(Qt::WA_DeleteOnClose);
+    setWindowTitle("Лог: " + path);
+    resize(900, 600);
+
+    view = new QPlainTextEdit(this);
+    view->setReadOnly(true);
+    view->setLineWrapMode(QPlainTextEdit::NoWrap);
+    view->setFont(QFontDatabase::systemFont(QFontDatabase::FixedFont));
+    view->setMaximumBlockCount(kMaxBlocks);
+
+    statusLabel = new QLabel("Загрузка...", this);
+    earlierButton = new QPushButton("Раньше", this);
+    earlierButton->setEnabled(false);
+
+    QHBoxLayout* bottom = new QHBoxLayout();
+    bottom->addWidget(statusLabel, 1);
+    bottom->addWidget(earlierButton);
+    QVBoxLayout* layout = new QVBoxLayout(this);
+    layout->addWidget(view, 1);
+    layout->addLayout(bottom);
+
+    decoder.reset(QTextCodec::codecForName("UTF-8")->makeDecoder());
+
+    connect(earlierButton, &QPushButton::clicked, this, &LogViewer::loadEarlier);
+    connect(client, &ClientManager::fileTailReceived, this, &LogViewer::onTailReceived);
+    connect(client, &ClientManager::fileRangeReceived, this, &LogViewer::onRangeReceived);
+    connect(client, &ClientManager::fileReadFailed, this, &LogViewer::onReadFailed);
+    client->tailFile(path, kInitialLines, true);
+}
+
+LogViewer::~LogViewer() {
+    if (client && !subscription.isEmpty()) client->stopTail(subscription);
+}
+
+void LogViewer::onTailReceived(const QJsonObject& chunk) {
+    const QString sub = chunk["subscription"].toString();
+    if (subscription.isEmpty()) {
+        // Первый ответ на наш tailFile: дальше узнаём свои порции по номеру подписки
+        if (sub.isEmpty() || chunk["path"].toString() != path) return;
+        subscription = sub;
+        firstOffset = qint64(chunk["offset"].toDouble());
+    } else if (sub != subscription) {
+        return;
+    }
+
+    if (chunk["rotated"].toBool() || chunk["truncated"].toBool()) {
+        appendText(chunk["rotated"].toBool() ? "\n--- файл заменён новым (ротация) ---\n"
+                                             : "\n--- файл усечён, чтение с начала ---\n");
+        decoder.reset(QTextCodec::codecForName("UTF-8")->makeDecoder());
+        // Более ранние данные нового файла уже показаны с начала
+        firstOffset = 0;
+    }
+    const QByteArray data = QByteArray::fromBase64(chunk["data"].toString().toLatin1());
+    appendText(decoder->toUnicode(data));
+    receivedUpTo = qint64(chunk["offset"].toDouble()) + data.size();
+    updateStatus();
+}
+
+void LogViewer::appendText(const QString& text) {
+    if (text.isEmpty()) return;
+    // Прокручиваем за новыми строками, только если пользователь и так внизу
+    QScrollBar* bar = view->verticalScrollBar();
+    const bool atBottom = bar->value() == bar->maximum();
+    QTextCursor cursor(view->document());
+    cursor.movePosition(QTextCursor::End);
+    cursor.insertText(text);
+    if (atBottom) bar->setValue(bar->maximum());
+}
+
+void LogViewer::loadEarlier() {
+    if (!client || rangePending || firstOffset <= 0) return;
+    const qint64 length = qMin(kEarlierChunk, firstOffset);
+    rangePending = true;
+    updateStatus();
+    client->readFileRange(path, firstOffset - length, length);
+}
+
+void LogViewer::onRangeReceived(const QJsonObject& range) {
+    if (!rangePending || range["path"].toString() != path) return;
+    rangePending = false;
+
+    const QByteArray data = QByteArray::fromBase64(range["data"].toString().toLatin1());
+    const qint64 offset = qint64(range["offset"].toDouble());
+    // Кусок начинается посреди строки — обрезаем до первой целой
+    int cut = 0;
+    if (offset > 0) {
+        const int newline = data.indexOf('\n');
+        if (newline >= 0 && newline + 1 < data.size()) cut = newline + 1;
+    }
+    const QString text = QString::fromUtf8(data.mid(cut));
+    firstOffset = offset + cut;
+
+    // Догруженное пользователем не должно вытесняться пределом строк
+    const int lines = text.count('\n');
+    view->setMaximumBlockCount(view->maximumBlockCount() + lines + 1);
+    QScrollBar* bar = view->verticalScrollBar();
+    const int position = bar->value();
+    QTextCursor cursor(view->document());
+    cursor.movePosition(QTextCursor::Start);
+    cursor.insertText(text);
+    bar->setValue(position + lines);
+    updateStatus();
+}
+
+void LogViewer::onReadFailed(const QString& message) {
+    rangePending = false;
+    statusLabel->setText("Ошибка: " + message);
+    earlierButton->setEnabled(firstOffset > 0);
+}
+
+void LogViewer::updateStatus() {
+    statusLabel->setText(QString("Показано с %1 КБ по %2 КБ%3")
+                         .arg(firstOffset / 1024).arg(receivedUpTo / 1024)
+                         .arg(subscription.isEmpty() ? QString() : QString(", слежение включено")));
+    earlierButton->setEnabled(firstOffset > 0 && !rangePending);
+}
@@ -0,0 +1,48 @@
+#ifndef LOGVIEWER_H
+#define LOGVIEWER_H
+
+#include <QDialog>
+#include <QJsonObject>
+#include <QPointer>
+#include <memory>
+
+class ClientManager;
+class QLabel;
+class QPlainTextEdit;
+class QPushButton;
+class QTextDecoder;
+
+// Окно просмотра лога на сервере: открывается на последних строках и
+// дописывает новые по мере появления (tailFile с follow). Файл целиком не
+// передаётся; «Раньше» догружает предыдущий кусок через readFileRange.
+// Число строк в окне ограничено, поэтому оно не тормозит на бесконечных логах.
+class LogViewer : public QDialog {
+    Q_OBJECT
+public:
+    LogViewer(ClientManager* client, const QString& path, QWidget* parent = nullptr);
+    ~LogViewer() override;
+
+private slots:
+    void onTailReceived(const QJsonObject& chunk);
+    void onRangeReceived(const QJsonObject& range);
+    void onReadFailed(const QString& message);
+    void loadEarlier();
+
+private:
+    void appendText(const QString& text);
+    void updateStatus();
+
+    QPointer<ClientManager> client;     // окно может пережить соединение
+    QString path;
+    QString subscription;
+    bool rangePending = false;
+    qint64 firstOffset = -1;      // начало показанного куска в файле
+    qint64 receivedUpTo = 0;      // конец показанного куска
+
+    QPlainTextEdit* view;
+    QLabel* statusLabel;
+    QPushButton* earlierButton;
+    std::unique_ptr<QTextDecoder> decoder;   // UTF-8 может разрываться между порциями
+};
+
+#endif // LOGVIEWER_H
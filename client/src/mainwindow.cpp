@@ -1,4 +1,6 @@
 #include "mainwindow.h"
+#include "LogViewer.h"
+#include "JournalViewer.h"
 #include <QMessageBox>
 #include <QFileDialog>
 #include <QInputDialog>
@@ -16,6 +18,52 @@
 #include <QProgressBar>
 #include <QFont>
 #include <QApplication>
+#include <QScrollBar>
+#include <QDir>
+
+namespace {
+
+// Колонки вкладки служб
+enum ServiceColumn {
+    ServiceName, ServiceState, ServiceEnabled, ServicePid, ServiceCpu,
+    ServiceMemory, ServiceIo, ServiceTasks, ServiceRestarts, ServiceDescription
+};
+
+// Числовые колонки сортируются по значению в Qt::UserRole, а не по тексту;
+// строки без значения уходят в конец при сортировке по убыванию
+class ServiceItem : public QTreeWidgetItem {
+public:
+    using QTreeWidgetItem::QTreeWidgetItem;
+    bool operator<(const QTreeWidgetItem& other) const override {
+        const int column = treeWidget() ? treeWidget()->sortColumn() : 0;
+        const QVariant left = data(column, Qt::UserRole);
+        const QVariant right = other.data(column, Qt::UserRole);
+        if (!left.isValid() && !right.isValid()) return QTreeWidgetItem::operator<(other);
+        return left.toDouble() < right.toDouble() || (!left.isValid() && right.isValid());
+    }
+};
+
+QString formatBytes(double bytes) {
+    static const char* units[] = {"Б", "КБ", "МБ", "ГБ", "ТБ"};
+    int unit = 0;
+    while (bytes >= 1024 && unit < 4) {
+        bytes /= 1024;
+        ++unit;
+    }
+    return QString::number(bytes, 'f', unit ? 1 : 0) + " " + units[unit];
+}
+
+void setNumber(QTreeWidgetItem* item, int column, const QJsonValue& value, const QString& text) {
+    if (value.isUndefined()) {
+        item->setText(column, QString());
+        item->setData(column, Qt::UserRole, QVariant());
+        return;
+    }
+    item->setText(column, text);
+    item->setData(column, Qt::UserRole, value.toDouble());
+}
+
+} // namespace
 
 MainWindow::~MainWindow() {
     delete discovery;
@@ -31,7 +79,8 @@ MainWindow::MainWindow(QWidget* parent)
       connectButton(nullptr),
       statusLabel(nullptr),
       usersTab(nullptr),
-      userListWidget(nullptr),
+      userTree(nullptr),
+      showSystemUsers(nullptr),
       addUserButton(nullptr),
       removeUserButton(nullptr),
       changePasswordButton(nullptr),
@@ -40,6 +89,8 @@ MainWindow::MainWindow(QWidget* parent)
       fileSelectButton(nullptr),
       uploadButton(nullptr),
       downloadButton(nullptr),
+      uploadDirectoryButton(nullptr),
+      viewLogButton(nullptr),
       setPermissionsButton(nullptr),
       filePathLabel(nullptr),
       currentPathLabel(nullptr),
@@ -53,8 +104,10 @@ MainWindow::MainWindow(QWidget* parent)
       ramUsageLabel(nullptr),
       diskList(nullptr),
       servicesTab(nullptr),
-      serviceList(nullptr),
+      serviceTree(nullptr),
       serviceControlButton(nullptr),
+      serviceCancelButton(nullptr),
+      serviceJournalButton(nullptr),
       discovery(nullptr),
       clientMgr(nullptr),
       currentFilePath("")
@@ -143,11 +196,23 @@ MainWindow::MainWindow(QWidget* parent)
 
     connect(clientMgr, &ClientManager::connected, this, &MainWindow::onConnected);
     connect(clientMgr, &ClientManager::connectionError, this, &MainWindow::onConnectionError);
-    connect(clientMgr, &ClientManager::userListReceived, this, &MainWindow::onUserListReceived);
+    connect(clientMgr, &ClientManager::usersReceived, this, &MainWindow::onUsersReceived);
+    connect(clientMgr, &ClientManager::unitsReceived, this, &MainWindow::onUnitsReceived);
+    connect(clientMgr, &ClientManager::unitsChanged, this, &MainWindow::onUnitsChanged);
+    connect(clientMgr, &ClientManager::unitUsageChanged, this, &MainWindow::onUnitUsageChanged);
+    connect(clientMgr, &ClientManager::serviceJobProgress, this, &MainWindow::onServiceJobProgress);
     connect(clientMgr, &ClientManager::systemInfoReceived, this, &MainWindow::onSystemInfoReceived);
     connect(clientMgr, &ClientManager::fileSystemReceived, this, &MainWindow::onFileSystemReceived);
+    connect(clientMgr, &ClientManager::directoryPageReceived, this, &MainWindow::onDirectoryPageReceived);
+    connect(clientMgr, &ClientManager::directoryChanged, this, &MainWindow::onDirectoryChanged);
+    connect(clientMgr, &ClientManager::permissionsProgress, this, &MainWindow::onPermissionsProgress);
     connect(clientMgr, &ClientManager::fileUploadFinished,
             this, &MainWindow::onFileUploadFinished);
+    connect(clientMgr, &ClientManager::directoryDownloadFinished, this, &MainWindow::onDirectoryTransferFinished);
+    connect(clientMgr, &ClientManager::directoryUploadFinished, this, &MainWindow::onDirectoryTransferFinished);
+    connect(clientMgr, &ClientManager::directoryTransferProgress, this, [this](qint64 bytes) {
+        statusLabel->setText(QString("Передача каталога: %1 КБ").arg(bytes / 1024));
+    });
     connect(clientMgr, &ClientManager::fileDownloadFinished,
             this, [this](bool success, const QString& message) {
         if (success) {
@@ -167,10 +232,10 @@ MainWindow::MainWindow(QWidget* parent)
                         "QListWidget::item:selected, QTreeWidget::item:selected { background: #2a82da; }";
 
     hostsList->setStyleSheet(listStyle);
-    userListWidget->setStyleSheet(listStyle);
+    userTree->setStyleSheet(listStyle);
     fileSystemTree->setStyleSheet(listStyle);
     diskList->setStyleSheet(listStyle);
-    serviceList->setStyleSheet(listStyle);
+    serviceTree->setStyleSheet(listStyle);
 
     // Заголовки для дерева файлов
     fileSystemTree->setHeaderLabels({"Имя", "Тип", "Размер", "Права", "Владелец", "Группа"});
@@ -183,10 +248,10 @@ MainWindow::MainWindow(QWidget* parent)
 
     // Включить чередование цветов строк
     hostsList->setAlternatingRowColors(true);
-    userListWidget->setAlternatingRowColors(true);
+    userTree->setAlternatingRowColors(true);
     fileSystemTree->setAlternatingRowColors(true);
     diskList->setAlternatingRowColors(true);
-    serviceList->setAlternatingRowColors(true);
+    serviceTree->setAlternatingRowColors(true);
 }
 
 void MainWindow::setupConnectionTab() {
@@ -238,9 +303,19 @@ void MainWindow::setupUsersTab() {
     titleLabel->setStyleSheet("font-size: 14pt; font-weight: bold; color: #2a82da;");
     layout->addWidget(titleLabel);
 
-    userListWidget = new QListWidget(usersTab);
-    userListWidget->setMinimumHeight(300);
-    layout->addWidget(userListWidget);
+    showSystemUsers = new QCheckBox("Показывать системные учётные записи", usersTab);
+    layout->addWidget(showSystemUsers);
+
+    userTree = new QTreeWidget(usersTab);
+    userTree->setMinimumHeight(300);
+    userTree->setRootIsDecorated(false);
+    userTree->setHeaderLabels({"Имя", "UID", "Группы", "Домашний каталог", "Оболочка", "Состояние"});
+    userTree->setColumnWidth(0, 150);
+    userTree->setColumnWidth(1, 70);
+    userTree->setColumnWidth(2, 200);
+    userTree->setColumnWidth(3, 200);
+    userTree->setColumnWidth(4, 130);
+    layout->addWidget(userTree);
 
     // Кнопки управления пользователями
     QHBoxLayout *buttonLayout = new QHBoxLayout();
@@ -268,6 +343,7 @@ void MainWindow::setupUsersTab() {
     connect(addUserButton, &QPushButton::clicked, this, &MainWindow::onManageUser);
     connect(removeUserButton, &QPushButton::clicked, this, &MainWindow::onManageUser);
     connect(changePasswordButton, &QPushButton::clicked, this, &MainWindow::onManageUser);
+    connect(showSystemUsers, &QCheckBox::toggled, this, &MainWindow::refreshUsers);
 
     tabWidget->addTab(usersTab, "Пользователи");
 }
@@ -296,6 +372,8 @@ void MainWindow::setupFilesTab() {
     fileSystemTree->setMinimumHeight(300);
     fileSystemTree->setIconSize(QSize(24, 24));
     layout->addWidget(fileSystemTree, 1);
+    connect(fileSystemTree->verticalScrollBar(), &QScrollBar::valueChanged,
+            this, &MainWindow::onFileTreeScrolled);
 
     QGridLayout *fileGridLayout = new QGridLayout();
 
@@ -305,6 +383,8 @@ void MainWindow::setupFilesTab() {
 
     uploadButton = new QPushButton("Загрузить", filesTab);
     downloadButton = new QPushButton("Скачать", filesTab);
+    uploadDirectoryButton = new QPushButton("Загрузить папку", filesTab);
+    viewLogButton = new QPushButton("Просмотр лога", filesTab);
     setPermissionsButton = new QPushButton("Права доступа", filesTab);
 
     QString buttonStyle = "QPushButton { background: #444; color: white; padding: 8px; border: none; }"
@@ -314,6 +394,8 @@ void MainWindow::setupFilesTab() {
     fileSelectButton->setStyleSheet(buttonStyle);
     uploadButton->setStyleSheet(buttonStyle);
     downloadButton->setStyleSheet(buttonStyle);
+    uploadDirectoryButton->setStyleSheet(buttonStyle);
+    viewLogButton->setStyleSheet(buttonStyle);
     setPermissionsButton->setStyleSheet(buttonStyle);
 
     fileGridLayout->addWidget(fileSelectButton, 0, 0);
@@ -321,12 +403,16 @@ void MainWindow::setupFilesTab() {
     fileGridLayout->addWidget(uploadButton, 1, 0);
     fileGridLayout->addWidget(downloadButton, 1, 1);
     fileGridLayout->addWidget(setPermissionsButton, 1, 2);
+    fileGridLayout->addWidget(uploadDirectoryButton, 1, 3);
+    fileGridLayout->addWidget(viewLogButton, 1, 4);
 
     layout->addLayout(fileGridLayout);
 
     connect(fileSelectButton, &QPushButton::clicked, this, &MainWindow::onFileSelected);
     connect(uploadButton, &QPushButton::clicked, this, &MainWindow::onUploadFile);
     connect(downloadButton, &QPushButton::clicked, this, &MainWindow::onDownloadFile);
+    connect(uploadDirectoryButton, &QPushButton::clicked, this, &MainWindow::onUploadDirectory);
+    connect(viewLogButton, &QPushButton::clicked, this, &MainWindow::onViewLog);
     connect(setPermissionsButton, &QPushButton::clicked, this, &MainWindow::onSetPermissions);
 
     tabWidget->addTab(filesTab, "Файловая система");
@@ -383,13 +469,39 @@ void MainWindow::setupServicesTab() {
     servicesTab = new QWidget(this);
     QVBoxLayout *layout = new QVBoxLayout(servicesTab);
 
-    serviceList = new QListWidget(servicesTab);
-    layout->addWidget(serviceList);
+    serviceTree = new QTreeWidget(servicesTab);
+    serviceTree->setRootIsDecorated(false);
+    serviceTree->setSelectionMode(QAbstractItemView::ExtendedSelection);
+    serviceTree->setSortingEnabled(true);
+    serviceTree->sortByColumn(0, Qt::AscendingOrder);
+    serviceTree->setHeaderLabels({"Служба", "Состояние", "Автозапуск", "PID", "CPU %", "Память",
+                                  "IO/с", "Задачи", "Перезапуски", "Описание"});
+    serviceTree->setColumnWidth(ServiceName, 250);
+    serviceTree->setColumnWidth(ServiceState, 150);
+    serviceTree->setColumnWidth(ServiceEnabled, 100);
+    serviceTree->setColumnWidth(ServicePid, 70);
+    serviceTree->setColumnWidth(ServiceCpu, 70);
+    serviceTree->setColumnWidth(ServiceMemory, 90);
+    serviceTree->setColumnWidth(ServiceIo, 90);
+    serviceTree->setColumnWidth(ServiceTasks, 60);
+    serviceTree->setColumnWidth(ServiceRestarts, 90);
+    layout->addWidget(serviceTree);
 
+    QHBoxLayout *buttonLayout = new QHBoxLayout();
     serviceControlButton = new QPushButton("Управление службой", servicesTab);
-    layout->addWidget(serviceControlButton);
+    serviceCancelButton = new QPushButton("Отменить", servicesTab);
+    serviceCancelButton->setEnabled(false);
+    serviceJournalButton = new QPushButton("Журнал", servicesTab);
+    buttonLayout->addWidget(serviceControlButton);
+    buttonLayout->addWidget(serviceCancelButton);
+    buttonLayout->addWidget(serviceJournalButton);
+    layout->addLayout(buttonLayout);
 
     connect(serviceControlButton, &QPushButton::clicked, this, &MainWindow::onManageService);
+    connect(serviceJournalButton, &QPushButton::clicked, this, &MainWindow::onViewJournal);
+    connect(serviceCancelButton, &QPushButton::clicked, this, [this]() {
+        if (!serviceJobId.isEmpty()) clientMgr->cancelServiceJob(serviceJobId);
+    });
 
     tabWidget->addTab(servicesTab, "Службы");
 }
@@ -420,10 +532,11 @@ void MainWindow::onConnectClicked() {
 }
 
 void MainWindow::onConnected() {
-    userListWidget->clear();
-    clientMgr->requestUserList();
+    refreshUsers();
     clientMgr->requestSystemInfo();
-    clientMgr->requestFileSystem("/");
+    clientMgr->subscribeUnits("service");
+    listingPath.clear(); // подписки прежнего подключения на сервере уже сняты
+    openDirectory("/");
     statusLabel->setText("Подключено. Загрузка данных...");
     tabWidget->setCurrentIndex(1); // Переключение на вкладку пользователей
 }
@@ -433,9 +546,42 @@ void MainWindow::onConnectionError(const QString& errorString) {
     statusLabel->setText("Ошибка подключения: " + errorString);
 }
 
-void MainWindow::onUserListReceived(const QStringList& users) {
-    userListWidget->clear();
-    userListWidget->addItems(users);
+void MainWindow::refreshUsers() {
+    userTree->clear();
+    clientMgr->requestUsers(showSystemUsers->isChecked() ? "all" : "human");
+}
+
+void MainWindow::onUsersReceived(const QJsonArray& users) {
+    userTree->clear();
+    for (const QJsonValue& value : users) {
+        const QJsonObject user = value.toObject();
+        QStringList groups{user["group"].toString()};
+        for (const QJsonValue& group : user["groups"].toArray()) {
+            if (!groups.contains(group.toString())) groups.append(group.toString());
+        }
+
+        QStringList state;
+        const QString password = user["password"].toString();
+        if (user["locked"].toBool()) state << "заблокирован";
+        else if (password == "disabled") state << "без пароля";
+        else if (password == "empty") state << "пустой пароль";
+        if (user["expired"].toBool()) state << "истёк срок";
+        else if (user["password_expired"].toBool()) state << "пароль устарел";
+        if (user["must_change"].toBool()) state << "сменить пароль";
+        if (state.isEmpty()) state << (password == "unknown" ? "—" : "активен");
+
+        QTreeWidgetItem* item = new QTreeWidgetItem(userTree);
+        item->setText(0, user["name"].toString());
+        item->setText(1, QString::number(qint64(user["uid"].toDouble())));
+        item->setText(2, groups.join(", "));
+        item->setText(3, user["home"].toString());
+        item->setText(4, user["shell"].toString());
+        item->setText(5, state.join(", "));
+        QString tooltip = user["full_name"].toString();
+        if (user.contains("expires")) tooltip += QString("\nУчётная запись действует до %1").arg(user["expires"].toString());
+        if (user.contains("password_expires")) tooltip += QString("\nПароль действует до %1").arg(user["password_expires"].toString());
+        item->setToolTip(0, tooltip.trimmed());
+    }
 }
 
 void MainWindow::onSystemInfoReceived(const QJsonObject& info) {
@@ -491,18 +637,102 @@ void MainWindow::onFileSystemReceived(const QJsonArray& files) {
     fileSystemTree->clear();
 
     for (const QJsonValue& fileVal : files) {
-        QJsonObject file = fileVal.toObject();
-        QTreeWidgetItem* item = new QTreeWidgetItem(fileSystemTree);
+        addFileItem(fileVal.toObject());
+    }
+}
+
+void MainWindow::addFileItem(const QJsonObject& file) {
+    // Запись могла уже появиться из уведомления directoryChanged
+    QTreeWidgetItem* item = fileItems.value(file["name"].toString());
+    if (!item) {
+        item = new QTreeWidgetItem(fileSystemTree);
+        fileItems.insert(file["name"].toString(), item);
+    }
+    updateFileItem(item, file);
+}
 
-        item->setText(0, file["name"].toString());
-        item->setText(1, file["type"].toString());
-        item->setText(2, QString::number(file["size"].toDouble() / 1024, 'f', 1) + " KB");
-        item->setText(3, file["permissions"].toString());
-        item->setText(4, file["owner"].toString());
-        item->setText(5, file["group"].toString());
+void MainWindow::updateFileItem(QTreeWidgetItem* item, const QJsonObject& file) {
+    item->setText(0, file["name"].toString());
+    item->setText(1, file.contains("type") ? file["type"].toString()
+                                           : (file["is_dir"].toBool() ? "dir" : "file"));
+    item->setText(2, QString::number(file["size"].toDouble() / 1024, 'f', 1) + " KB");
+    item->setText(3, file["permissions"].toString());
+    item->setText(4, file["owner"].toString());
+    item->setText(5, file["group"].toString());
+
+    // Сохраняем полный путь в данных
+    item->setData(0, Qt::UserRole, file["path"].toString());
+}
+
+void MainWindow::openDirectory(const QString& path) {
+    if (!listingPath.isEmpty() && listingPath != path) clientMgr->unwatchDirectory(listingPath);
+    if (listingPath != path) clientMgr->watchDirectory(path);
+    fileSystemTree->clear();
+    fileItems.clear();
+    currentPathLabel->setText(path);
+    listingPath = path;
+    listingCursor.clear();
+    listingDone = false;
+    listingLoading = false;
+    requestNextDirectoryPage();
+}
+
+void MainWindow::requestNextDirectoryPage() {
+    if (listingDone || listingLoading) return;
+    listingLoading = true;
+    clientMgr->requestDirectoryPage(listingPath, listingCursor);
+}
+
+void MainWindow::onDirectoryPageReceived(const QString& path, const QJsonArray& entries,
+                                         const QString& cursor, bool done) {
+    if (path != listingPath) return; // ответ для каталога, который уже закрыли
+    listingLoading = false;
+    listingCursor = cursor;
+    listingDone = done;
+
+    fileSystemTree->setUpdatesEnabled(false);
+    for (const QJsonValue& fileVal : entries) {
+        addFileItem(fileVal.toObject());
+    }
+    fileSystemTree->setUpdatesEnabled(true);
+
+    // Первая страница может не заполнить окно — тогда прокрутки не будет, догружаем сразу
+    const int rowHeight = qMax(1, fileSystemTree->sizeHintForRow(0));
+    if (!listingDone && fileSystemTree->topLevelItemCount() * rowHeight < fileSystemTree->viewport()->height()) {
+        requestNextDirectoryPage();
+    }
+}
 
-        // Сохраняем полный путь в данных
-        item->setData(0, Qt::UserRole, file["path"].toString());
+void MainWindow::onDirectoryChanged(const QString& path, const QJsonArray& events, bool overflow, bool removed) {
+    if (path != listingPath) return;
+    if (removed) {
+        statusLabel->setText("Каталог удалён: " + path);
+        return;
+    }
+    if (overflow) {
+        // Сервер потерял часть событий — перечитываем каталог целиком
+        const QString current = listingPath;
+        openDirectory(current);
+        return;
+    }
+
+    for (const QJsonValue& value : events) {
+        const QJsonObject event = value.toObject();
+        const QString name = event["name"].toString();
+        const QJsonObject entry = event["entry"].toObject();
+        if (entry.isEmpty()) {
+            // Удалён (или исчез до того, как сервер успел прочитать атрибуты)
+            delete fileItems.take(name);
+        } else {
+            addFileItem(entry);
+        }
+    }
+}
+
+void MainWindow::onFileTreeScrolled(int value) {
+    QScrollBar* bar = fileSystemTree->verticalScrollBar();
+    if (value >= bar->maximum() - bar->pageStep()) {
+        requestNextDirectoryPage();
     }
 }
 
@@ -528,8 +758,10 @@ void MainWindow::onUploadFile() {
         return;
     }
 
-    QString remotePath = currentPathLabel->text();
-    if (remotePath.isEmpty()) remotePath = "/";
+    QString remoteDir = currentPathLabel->text();
+    if (remoteDir.isEmpty()) remoteDir = "/";
+    const QString remotePath = (remoteDir.endsWith('/') ? remoteDir : remoteDir + '/')
+                               + QFileInfo(currentFilePath).fileName();
 
     // Показываем прогресс
     QProgressBar* progressBar = qobject_cast<QProgressBar*>(statusBar()->children().last());
@@ -539,7 +771,9 @@ void MainWindow::onUploadFile() {
     }
     statusLabel->setText("Загрузка файла на сервер...");
 
-    clientMgr->uploadFile(currentFilePath, remotePath);
+    // Крупный файл почти всегда уже есть на сервере в близкой версии — шлём только разницу
+    if (QFileInfo(currentFilePath).size() >= 64 * 1024) clientMgr->uploadFileDelta(currentFilePath, remotePath);
+    else clientMgr->uploadFile(currentFilePath, remotePath);
 }
 
 void MainWindow::onDownloadFile() {
@@ -550,6 +784,19 @@ void MainWindow::onDownloadFile() {
     }
 
     QString remotePath = item->data(0, Qt::UserRole).toString();
+    if (item->text(1) == "dir") {
+        // Каталог приходит одним сжатым потоком и распаковывается в папку с тем же именем
+        const QString targetDir = QFileDialog::getExistingDirectory(this, "Куда сохранить каталог");
+        if (targetDir.isEmpty()) return;
+        bool ok;
+        const QString exclude = QInputDialog::getText(this, "Скачивание каталога",
+            "Исключить (шаблоны через пробел, например *.log .git):", QLineEdit::Normal, QString(), &ok);
+        if (!ok) return;
+        clientMgr->downloadDirectory(remotePath, QDir(targetDir).filePath(QFileInfo(remotePath).fileName()),
+                                     QStringList(), exclude.split(' ', Qt::SkipEmptyParts));
+        statusLabel->setText("Скачивание каталога с сервера...");
+        return;
+    }
     QString savePath = QFileDialog::getSaveFileName(this, "Сохранить файл");
 
     if (!savePath.isEmpty()) {
@@ -558,6 +805,41 @@ void MainWindow::onDownloadFile() {
     }
 }
 
+void MainWindow::onUploadDirectory() {
+    const QString localDir = QFileDialog::getExistingDirectory(this, "Выберите каталог");
+    if (localDir.isEmpty()) return;
+    bool ok;
+    const QString exclude = QInputDialog::getText(this, "Загрузка каталога",
+        "Исключить (шаблоны через пробел, например *.o build):", QLineEdit::Normal, QString(), &ok);
+    if (!ok) return;
+
+    QString remoteDir = currentPathLabel->text();
+    if (remoteDir.isEmpty()) remoteDir = "/";
+    const QString remotePath = (remoteDir.endsWith('/') ? remoteDir : remoteDir + '/') + QFileInfo(localDir).fileName();
+    clientMgr->uploadDirectory(localDir, remotePath, QStringList(), exclude.split(' ', Qt::SkipEmptyParts));
+    statusLabel->setText("Загрузка каталога на сервер...");
+}
+
+void MainWindow::onViewLog() {
+    QTreeWidgetItem* item = fileSystemTree->currentItem();
+    if (!item || item->text(1) == "dir") {
+        QMessageBox::warning(this, "Ошибка", "Файл не выбран");
+        return;
+    }
+    // Окно само подписывается на хвост файла и отписывается при закрытии
+    LogViewer* viewer = new LogViewer(clientMgr, item->data(0, Qt::UserRole).toString(), this);
+    viewer->show();
+}
+
+void MainWindow::onDirectoryTransferFinished(bool success, const QString& message) {
+    statusLabel->setText(message);
+    if (success) {
+        QMessageBox::information(this, "Успех", message);
+    } else {
+        QMessageBox::warning(this, "Ошибка", "Ошибка передачи каталога: " + message);
+    }
+}
+
 void MainWindow::onSetPermissions() {
     QTreeWidgetItem* item = fileSystemTree->currentItem();
     if (!item) {
@@ -570,14 +852,42 @@ void MainWindow::onSetPermissions() {
 
     bool ok;
     QString newPerms = QInputDialog::getText(this, "Установка прав",
-        "Новые права (например, 755):", QLineEdit::Normal, currentPerms, &ok);
+        "Новые права (например, 755 или u:alice:rwx,g::r-x):", QLineEdit::Normal, currentPerms, &ok);
 
     if (ok && !newPerms.isEmpty()) {
-        clientMgr->setFilePermissions(path, newPerms);
+        bool recursive = false;
+        if (item->text(1) == "dir") {
+            recursive = QMessageBox::question(this, "Установка прав",
+                "Применить ко всему содержимому каталога?") == QMessageBox::Yes;
+        }
+        clientMgr->setFilePermissions(path, newPerms, recursive);
         statusLabel->setText("Установка прав доступа...");
     }
 }
 
+void MainWindow::onPermissionsProgress(const QJsonObject& status, bool done) {
+    const qint64 processed = qint64(status["files"].toDouble() + status["dirs"].toDouble());
+    const qint64 failed = qint64(status["failed"].toDouble());
+    if (!done) {
+        statusLabel->setText(QString("Установка прав: обработано %1, ошибок %2").arg(processed).arg(failed));
+        return;
+    }
+    statusLabel->setText(QString("Права установлены: %1 объектов, изменено %2, ошибок %3")
+                         .arg(processed).arg(qint64(status["changed"].toDouble())).arg(failed));
+    if (failed == 0) return;
+
+    QStringList lines;
+    const QJsonObject reasons = status["errors_by_reason"].toObject();
+    for (auto it = reasons.begin(); it != reasons.end(); ++it) {
+        lines << QString("%1: %2").arg(it.key()).arg(qint64(it.value().toDouble()));
+    }
+    lines << QString();
+    for (const QJsonValue& failure : status["failures"].toArray()) {
+        lines << failure.toObject()["path"].toString();
+    }
+    QMessageBox::warning(this, "Ошибки установки прав", lines.join('\n'));
+}
+
 void MainWindow::onManageUser() {
     QString action = QInputDialog::getItem(this, "Управление пользователями",
         "Действие:", {"Добавить", "Удалить", "Изменить пароль"}, 0, false);
@@ -586,7 +896,9 @@ void MainWindow::onManageUser() {
 
     QString username;
     if (action != "Добавить") {
-        username = QInputDialog::getText(this, "Пользователь", "Имя пользователя:");
+        const QTreeWidgetItem* current = userTree->currentItem();
+        username = QInputDialog::getText(this, "Пользователь", "Имя пользователя:", QLineEdit::Normal,
+                                         current ? current->text(0) : QString());
         if (username.isEmpty()) return;
     }
 
@@ -609,18 +921,122 @@ void MainWindow::onManageUser() {
 }
 
 void MainWindow::onManageService() {
-    QListWidgetItem* item = serviceList->currentItem();
-    if (!item) {
+    const QList<QTreeWidgetItem*> selected = serviceTree->selectedItems();
+    if (selected.isEmpty()) {
         QMessageBox::warning(this, "Ошибка", "Служба не выбрана");
         return;
     }
 
-    QString service = item->text();
+    // Сервер понимает start/stop/restart; в диалоге — русские названия
+    static const QStringList labels{"Запустить", "Остановить", "Перезапустить"};
+    static const QStringList actions{"start", "stop", "restart"};
+    QStringList services;
+    for (QTreeWidgetItem* item : selected) services << item->text(0);
     QString action = QInputDialog::getItem(this, "Управление службой",
-        "Действие:", {"Запустить", "Остановить", "Перезапустить"}, 0, false);
+        "Действие:", labels, 0, false);
+    if (action.isEmpty()) return;
+
+    // Несколько служб обрабатываются по одной и останавливаются на первой ошибке
+    QJsonObject params{{"units", QJsonArray::fromStringList(services)},
+                       {"action", actions.value(labels.indexOf(action))}};
+    if (services.size() > 1) {
+        bool ok = false;
+        const int concurrency = QInputDialog::getInt(this, "Управление службами",
+            "Одновременно служб:", 1, 1, 32, 1, &ok);
+        if (!ok) return;
+        params["concurrency"] = concurrency;
+        params["stop_on_failure"] = true;
+    }
+    clientMgr->startServiceJob(params);
+    statusLabel->setText(QString("%1: служб %2...").arg(action).arg(services.size()));
+}
+
+void MainWindow::onServiceJobProgress(const QJsonObject& status, bool done) {
+    serviceJobId = done ? QString() : status["job_id"].toString();
+    serviceCancelButton->setEnabled(!done);
+
+    const int total = status["total"].toInt();
+    const int finished = status["succeeded"].toInt() + status["failed"].toInt() + status["cancelled"].toInt();
+    QString text = QString("%1: %2 из %3").arg(status["action"].toString()).arg(finished).arg(total);
+    if (status["failed"].toInt() > 0) text += QString(", ошибок: %1").arg(status["failed"].toInt());
+    if (done && status["cancelled"].toInt() > 0) text += QString(", отменено: %1").arg(status["cancelled"].toInt());
+    if (done && status["failed"].toInt() > 0) {
+        QStringList failures;
+        for (const QJsonValue& value : status["units"].toArray()) {
+            const QJsonObject unit = value.toObject();
+            if (unit["state"].toString() != "failed") continue;
+            const QString reason = unit.contains("error") ? unit["error"].toString() : unit["result"].toString();
+            failures << unit["name"].toString() + ": " + reason;
+        }
+        QMessageBox::warning(this, "Управление службами", failures.join("\n"));
+    }
+    statusLabel->setText(text);
+}
+
+void MainWindow::onViewJournal() {
+    QTreeWidgetItem* item = serviceTree->currentItem();
+    if (!item) {
+        QMessageBox::warning(this, "Ошибка", "Служба не выбрана");
+        return;
+    }
+    // Окно само подписывается на журнал юнита и отписывается при закрытии
+    JournalViewer* viewer = new JournalViewer(clientMgr, item->text(0), this);
+    viewer->show();
+}
 
-    if (!action.isEmpty()) {
-        clientMgr->manageService(service, action);
-        statusLabel->setText(action + " службы " + service + "...");
+void MainWindow::onUnitsReceived(const QJsonArray& units) {
+    serviceTree->clear();
+    serviceItems.clear();
+    for (const QJsonValue& unit : units) updateServiceItem(unit.toObject());
+}
+
+void MainWindow::onUnitsChanged(const QJsonArray& units, const QStringList& removed) {
+    for (const QString& name : removed) delete serviceItems.take(name);
+    for (const QJsonValue& unit : units) updateServiceItem(unit.toObject());
+}
+
+void MainWindow::onUnitUsageChanged(const QJsonObject& usage) {
+    for (auto it = usage.constBegin(); it != usage.constEnd(); ++it) {
+        if (QTreeWidgetItem* item = serviceItems.value(it.key())) updateServiceUsage(item, it.value().toObject());
+    }
+}
+
+void MainWindow::updateServiceItem(const QJsonObject& unit) {
+    const QString name = unit["name"].toString();
+    QTreeWidgetItem* item = serviceItems.value(name);
+    if (!item) {
+        item = new ServiceItem(serviceTree);
+        serviceItems.insert(name, item);
+    }
+    QString state = unit["active"].toString() + " (" + unit["sub"].toString() + ")";
+    if (unit.contains("job")) state += ", " + unit["job"].toObject()["type"].toString() + "…";
+    item->setText(ServiceName, name);
+    item->setText(ServiceState, state);
+    item->setText(ServiceEnabled, unit["unit_file_state"].toString());
+    setNumber(item, ServicePid, unit["main_pid"], QString::number(qint64(unit["main_pid"].toDouble())));
+    setNumber(item, ServiceRestarts, unit["restarts"], QString::number(unit["restarts"].toInt()));
+    item->setText(ServiceDescription, unit["description"].toString());
+    // Юнит без cgroup (остановлен) — сводки нет, колонки ресурсов пустые
+    updateServiceUsage(item, unit["usage"].toObject());
+    QString tooltip = unit["fragment_path"].toString();
+    if (unit.contains("active_since")) tooltip += "\nАктивна с " + unit["active_since"].toString();
+    if (unit["restarts"].toInt() > 0) tooltip += QString("\nПерезапусков: %1").arg(unit["restarts"].toInt());
+    item->setToolTip(ServiceName, tooltip.trimmed());
+}
+
+void MainWindow::updateServiceUsage(QTreeWidgetItem* item, const QJsonObject& usage) {
+    const double read = usage["io_read_bps"].toDouble();
+    const double written = usage["io_write_bps"].toDouble();
+    setNumber(item, ServiceCpu, usage["cpu_percent"], QString::number(usage["cpu_percent"].toDouble(), 'f', 1));
+    setNumber(item, ServiceMemory, usage["memory_current"], formatBytes(usage["memory_current"].toDouble()));
+    setNumber(item, ServiceTasks, usage["tasks"], QString::number(usage["tasks"].toInt()));
+    if (usage.contains("io_read_bps")) {
+        setNumber(item, ServiceIo, QJsonValue(read + written), formatBytes(read + written));
+        item->setToolTip(ServiceIo, QString("Чтение: %1/с\nЗапись: %2/с").arg(formatBytes(read), formatBytes(written)));
+    } else {
+        setNumber(item, ServiceIo, QJsonValue(QJsonValue::Undefined), QString());
+        item->setToolTip(ServiceIo, QString());
     }
+    item->setToolTip(ServiceMemory, usage.contains("memory_peak")
+                     ? "Пик: " + formatBytes(usage["memory_peak"].toDouble()) : QString());
 }
@@ -9,6 +9,8 @@
 #include <QTreeWidget>
 #include <QGroupBox>
 #include <QSplitter>
+#include <QHash>
+#include <QCheckBox>
 #include "NetworkDiscovery.h"
 #include "ClientManager.h"
 
@@ -24,17 +26,30 @@ private slots:
     void onConnectClicked();
     void onConnected();
     void onConnectionError(const QString& errorString);
-    void onUserListReceived(const QStringList& users);
+    void onUsersReceived(const QJsonArray& users);
+    void refreshUsers();
     void onSystemInfoReceived(const QJsonObject& info);
     void onFileSystemReceived(const QJsonArray& files);
+    void onDirectoryPageReceived(const QString& path, const QJsonArray& entries, const QString& cursor, bool done);
+    void onFileTreeScrolled(int value);
+    void onDirectoryChanged(const QString& path, const QJsonArray& events, bool overflow, bool removed);
     void onFileUploadFinished(bool success, const QString& message);
 
     void onFileSelected();
     void onUploadFile();
     void onDownloadFile();
+    void onUploadDirectory();
+    void onViewLog();
+    void onDirectoryTransferFinished(bool success, const QString& message);
     void onSetPermissions();
+    void onPermissionsProgress(const QJsonObject& status, bool done);
     void onManageUser();
     void onManageService();
+    void onViewJournal();
+    void onUnitsReceived(const QJsonArray& units);
+    void onUnitsChanged(const QJsonArray& units, const QStringList& removed);
+    void onUnitUsageChanged(const QJsonObject& usage);
+    void onServiceJobProgress(const QJsonObject& status, bool done);
 
 private:
     // Основные виджеты
@@ -49,7 +64,8 @@ private:
 
     // Вкладка пользователей
     QWidget *usersTab;
-    QListWidget *userListWidget;
+    QTreeWidget *userTree;
+    QCheckBox *showSystemUsers;
     QPushButton *addUserButton;
     QPushButton *removeUserButton;
     QPushButton *changePasswordButton;
@@ -60,6 +76,8 @@ private:
     QPushButton *fileSelectButton;
     QPushButton *uploadButton;
     QPushButton *downloadButton;
+    QPushButton *uploadDirectoryButton;
+    QPushButton *viewLogButton;
     QPushButton *setPermissionsButton;
     QLabel *filePathLabel;
     QLabel *currentPathLabel;
@@ -77,20 +95,37 @@ private:
 
     // Вкладка служб
     QWidget *servicesTab;
-    QListWidget *serviceList;
+    QTreeWidget *serviceTree;
     QPushButton *serviceControlButton;
+    QPushButton *serviceCancelButton;
+    QPushButton *serviceJournalButton;
+    QString serviceJobId;                            // выполняющееся задание над службами
+    QHash<QString, QTreeWidgetItem*> serviceItems;   // имя юнита → строка
 
     NetworkDiscovery* discovery;
     ClientManager* clientMgr;
     QList<HostInfo> discoveredHosts;
     QString currentFilePath;
 
+    // Постраничная загрузка каталога: следующая страница запрашивается при прокрутке к концу
+    QString listingPath;
+    QString listingCursor;
+    bool listingDone = true;
+    bool listingLoading = false;
+    QHash<QString, QTreeWidgetItem*> fileItems;   // имя → строка текущего каталога
+
     void setupConnectionTab();
     void setupUsersTab();
     void setupFilesTab();
     void setupSystemTab();
     void setupServicesTab();
     void updateSystemInfo(const QJsonObject& info);
+    void openDirectory(const QString& path);
+    void requestNextDirectoryPage();
+    void addFileItem(const QJsonObject& file);
+    void updateFileItem(QTreeWidgetItem* item, const QJsonObject& file);
+    void updateServiceItem(const QJsonObject& unit);
+    void updateServiceUsage(QTreeWidgetItem* item, const QJsonObject& usage);
 };
 
 #endif // MAINWINDOW_H
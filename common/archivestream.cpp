@@ -0,0 +1,378 @@
+#include "archivestream.h"
+
+#include <zstd.h>
+#include <cstring>
+#include <vector>
+
+static const int kBlock = 512;
+static const qint64 kMaxOctalSize = 077777777777LL;   // 11 восьмеричных цифр ustar
+static const int kMaxPaxSize = 1024 * 1024;
+
+namespace {
+
+void putOctal(char *field, int width, qint64 value) {
+    // width - 1 цифр и завершающий NUL, как пишет GNU tar
+    std::memset(field, '0', size_t(width - 1));
+    field[width - 1] = 0;
+    for (int i = width - 2; i >= 0 && value > 0; --i) {
+        field[i] = char('0' + (value & 7));
+        value >>= 3;
+    }
+}
+
+qint64 parseNumber(const char *field, int width) {
+    // Base-256 (старший бит первого байта) — так GNU tar пишет большие размеры
+    if (static_cast<unsigned char>(field[0]) & 0x80) {
+        qint64 value = static_cast<unsigned char>(field[0]) & 0x7f;
+        for (int i = 1; i < width; ++i) value = (value << 8) | static_cast<unsigned char>(field[i]);
+        return value;
+    }
+    qint64 value = 0;
+    int i = 0;
+    while (i < width && (field[i] == ' ' || field[i] == 0)) ++i;
+    for (; i < width && field[i] >= '0' && field[i] <= '7'; ++i) value = value * 8 + (field[i] - '0');
+    return value;
+}
+
+QByteArray field(const char *data, int width) {
+    return QByteArray(data, int(strnlen(data, size_t(width))));
+}
+
+// Запись pax: "<длина> <ключ>=<значение>\n", длина включает саму себя
+QByteArray paxRecord(const QByteArray &key, const QByteArray &value) {
+    const int body = key.size() + value.size() + 3;   // пробел, '=', '\n'
+    int length = body + 1;
+    while (QByteArray::number(length).size() + body > length) ++length;
+    return QByteArray::number(length) + ' ' + key + '=' + value + '\n';
+}
+
+void fillHeader(char *block, const QByteArray &name, char type, quint32 mode, qint64 size,
+                qint64 mtime, const QByteArray &link) {
+    std::memset(block, 0, kBlock);
+    std::memcpy(block, name.constData(), size_t(qMin(name.size(), 100)));
+    putOctal(block + 100, 8, mode & 07777);
+    putOctal(block + 108, 8, 0);
+    putOctal(block + 116, 8, 0);
+    putOctal(block + 124, 12, qMin(size, kMaxOctalSize));
+    putOctal(block + 136, 12, mtime > 0 ? mtime : 0);
+    block[156] = type;
+    std::memcpy(block + 157, link.constData(), size_t(qMin(link.size(), 100)));
+    std::memcpy(block + 257, "ustar", 6);
+    std::memcpy(block + 263, "00", 2);
+
+    std::memset(block + 148, ' ', 8);
+    unsigned sum = 0;
+    for (int i = 0; i < kBlock; ++i) sum += static_cast<unsigned char>(block[i]);
+    putOctal(block + 148, 7, sum);
+    block[155] = ' ';
+}
+
+} // namespace
+
+ArchiveWriter::ArchiveWriter(int level, int workers) {
+    cctx = ZSTD_createCCtx();
+    ZSTD_CCtx_setParameter(cctx, ZSTD_c_compressionLevel, level);
+    // Без поддержки потоков в libzstd параметр просто не применится
+    if (workers > 0) ZSTD_CCtx_setParameter(cctx, ZSTD_c_nbWorkers, workers);
+}
+
+ArchiveWriter::~ArchiveWriter() {
+    ZSTD_freeCCtx(cctx);
+}
+
+bool ArchiveWriter::addEntry(const ArchiveEntry &entry) {
+    if (entryRemaining != 0) {
+        error = "Previous entry is incomplete";
+        return false;
+    }
+    QByteArray name = entry.path;
+    if (entry.type == ArchiveEntry::Directory && !name.endsWith('/')) name += '/';
+    const qint64 size = entry.type == ArchiveEntry::File ? entry.size : 0;
+
+    // Что не помещается в поля ustar, уходит в pax-заголовок перед записью
+    QByteArray records;
+    if (name.size() > 100) records += paxRecord("path", name);
+    if (entry.linkTarget.size() > 100) records += paxRecord("linkpath", entry.linkTarget);
+    if (size > kMaxOctalSize) records += paxRecord("size", QByteArray::number(size));
+
+    char block[kBlock];
+    if (!records.isEmpty()) {
+        fillHeader(block, "PaxHeaders/" + name.right(80), 'x', 0644, records.size(), entry.mtime, QByteArray());
+        records.append(QByteArray((kBlock - records.size() % kBlock) % kBlock, 0));
+        if (!write(block, kBlock) || !write(records.constData(), records.size())) return false;
+    }
+
+    const char type = entry.type == ArchiveEntry::Directory ? '5'
+                    : entry.type == ArchiveEntry::Symlink ? '2' : '0';
+    fillHeader(block, name, type, entry.mode, size, entry.mtime, entry.linkTarget);
+    if (!write(block, kBlock)) return false;
+
+    entryRemaining = size;
+    entryPadding = (kBlock - size % kBlock) % kBlock;
+    return true;
+}
+
+bool ArchiveWriter::addData(const char *data, qint64 length) {
+    if (length > entryRemaining) {
+        error = "Entry data exceeds declared size";
+        return false;
+    }
+    if (!write(data, length)) return false;
+    entryRemaining -= length;
+    if (entryRemaining == 0 && entryPadding > 0) {
+        static const char zeros[kBlock] = {};
+        if (!write(zeros, entryPadding)) return false;
+        entryPadding = 0;
+    }
+    return true;
+}
+
+bool ArchiveWriter::finish() {
+    if (entryRemaining != 0) {
+        error = "Last entry is incomplete";
+        return false;
+    }
+    static const char zeros[2 * kBlock] = {};
+    return compress(zeros, sizeof(zeros), ZSTD_e_end);
+}
+
+QByteArray ArchiveWriter::takeOutput() {
+    QByteArray result;
+    result.swap(output);
+    return result;
+}
+
+bool ArchiveWriter::write(const char *data, qint64 length) {
+    return compress(data, size_t(length), ZSTD_e_continue);
+}
+
+bool ArchiveWriter::compress(const char *data, size_t length, int mode) {
+    ZSTD_inBuffer in{ data, length, 0 };
+    const size_t chunk = ZSTD_CStreamOutSize();
+    for (;;) {
+        const int used = output.size();
+        output.resize(used + int(chunk));
+        ZSTD_outBuffer out{ output.data() + used, chunk, 0 };
+        const size_t rc = ZSTD_compressStream2(cctx, &out, &in, ZSTD_EndDirective(mode));
+        output.resize(used + int(out.pos));
+        if (ZSTD_isError(rc)) {
+            error = QString("zstd: %1").arg(ZSTD_getErrorName(rc));
+            return false;
+        }
+        // e_continue: пока не забран весь вход; e_end: пока кадр не сброшен целиком
+        if (mode == ZSTD_e_end ? rc == 0 : in.pos == in.size) return true;
+    }
+}
+
+ArchiveReader::ArchiveReader() {
+    dctx = ZSTD_createDCtx();
+}
+
+ArchiveReader::~ArchiveReader() {
+    ZSTD_freeDCtx(dctx);
+}
+
+bool ArchiveReader::feed(const char *data, qint64 length) {
+    if (!error.isEmpty()) return false;
+    ZSTD_inBuffer in{ data, size_t(length), 0 };
+    std::vector<char> buffer(ZSTD_DStreamOutSize());
+    while (state != End) {
+        ZSTD_outBuffer out{ buffer.data(), buffer.size(), 0 };
+        const size_t rc = ZSTD_decompressStream(dctx, &out, &in);
+        if (ZSTD_isError(rc)) {
+            error = QString("zstd: %1").arg(ZSTD_getErrorName(rc));
+            return false;
+        }
+        if (out.pos > 0 && !consume(buffer.data(), out.pos)) return false;
+        // Выход заполнен целиком — в декодере могут оставаться данные
+        if (in.pos == in.size && out.pos < out.size) break;
+    }
+    return true;
+}
+
+bool ArchiveReader::consume(const char *data, size_t length) {
+    while (length > 0 && state != End) {
+        switch (state) {
+        case Header: {
+            const size_t take = qMin(length, size_t(kBlock - header.size()));
+            header.append(data, int(take));
+            data += take;
+            length -= take;
+            if (header.size() < kBlock) break;
+            const bool zero = header.count('\0') == kBlock;
+            if (zero) {
+                if (++zeroBlocks == 2) state = End;
+            } else {
+                zeroBlocks = 0;
+                if (!parseHeader(header.constData())) return false;
+            }
+            header.clear();
+            break;
+        }
+        case Data: {
+            const size_t take = size_t(qMin<qint64>(qint64(length), remaining));
+            if (onData && !onData(data, qint64(take))) {
+                if (error.isEmpty()) error = "Aborted";
+                return false;
+            }
+            data += take;
+            length -= take;
+            remaining -= qint64(take);
+            if (remaining == 0) {
+                if (onEntryEnd && !onEntryEnd()) {
+                    if (error.isEmpty()) error = "Aborted";
+                    return false;
+                }
+                state = padding > 0 ? Padding : Header;
+            }
+            break;
+        }
+        case PaxData: {
+            const size_t take = size_t(qMin<qint64>(qint64(length), remaining));
+            pax.append(data, int(take));
+            data += take;
+            length -= take;
+            remaining -= qint64(take);
+            if (remaining == 0) {
+                if (!parsePax(pax)) return false;
+                pax.clear();
+                state = padding > 0 ? Padding : Header;
+            }
+            break;
+        }
+        case Skip: {
+            const size_t take = size_t(qMin<qint64>(qint64(length), remaining));
+            data += take;
+            length -= take;
+            remaining -= qint64(take);
+            if (remaining == 0) state = padding > 0 ? Padding : Header;
+            break;
+        }
+        case Padding: {
+            const size_t take = size_t(qMin<qint64>(qint64(length), padding));
+            data += take;
+            length -= take;
+            padding -= qint64(take);
+            if (padding == 0) state = Header;
+            break;
+        }
+        case End:
+            break;
+        }
+    }
+    return true;
+}
+
+bool ArchiveReader::parseHeader(const char *block) {
+    unsigned sum = 0;
+    for (int i = 0; i < kBlock; ++i) {
+        sum += (i >= 148 && i < 156) ? unsigned(' ') : static_cast<unsigned char>(block[i]);
+    }
+    if (sum != unsigned(parseNumber(block + 148, 8))) {
+        error = "Corrupted tar header";
+        return false;
+    }
+
+    const char type = block[156];
+    const qint64 size = parseNumber(block + 124, 12);
+    remaining = size;
+    padding = (kBlock - size % kBlock) % kBlock;
+
+    if (type == 'x') {
+        if (size > kMaxPaxSize) {
+            error = "pax header too large";
+            return false;
+        }
+        state = size > 0 ? PaxData : Header;
+        return true;
+    }
+
+    ArchiveEntry entry;
+    entry.path = field(block, 100);
+    const QByteArray prefix = field(block + 345, 155);
+    if (!prefix.isEmpty()) entry.path = prefix + '/' + entry.path;
+    entry.linkTarget = field(block + 157, 100);
+    entry.mode = quint32(parseNumber(block + 100, 8));
+    entry.mtime = parseNumber(block + 136, 12);
+    entry.size = size;
+    if (hasPaxPath) entry.path = paxOverrides.path;
+    if (hasPaxLink) entry.linkTarget = paxOverrides.linkTarget;
+    if (hasPaxSize) {
+        entry.size = paxOverrides.size;
+        remaining = entry.size;
+        padding = (kBlock - entry.size % kBlock) % kBlock;
+    }
+    hasPaxPath = hasPaxLink = hasPaxSize = false;
+
+    switch (type) {
+    case '0':
+    case '\0':
+    case '7':
+        entry.type = ArchiveEntry::File;
+        break;
+    case '5':
+        entry.type = ArchiveEntry::Directory;
+        break;
+    case '2':
+        entry.type = ArchiveEntry::Symlink;
+        break;
+    default:
+        // Жёсткие ссылки, устройства, глобальные pax — пропускаем вместе с данными
+        state = remaining > 0 ? Skip : (padding > 0 ? Padding : Header);
+        return true;
+    }
+    if (entry.type != ArchiveEntry::File) {
+        entry.size = 0;
+        // Данные у каталога или ссылки не ожидаются, но если есть — пропускаем
+        state = remaining > 0 ? Skip : Header;
+    }
+
+    if (entry.path.endsWith('/')) entry.path.chop(1);
+    if (onEntry && !onEntry(entry)) {
+        if (error.isEmpty()) error = "Aborted";
+        return false;
+    }
+    if (entry.type == ArchiveEntry::File) {
+        if (remaining > 0) {
+            state = Data;
+        } else {
+            if (onEntryEnd && !onEntryEnd()) {
+                if (error.isEmpty()) error = "Aborted";
+                return false;
+            }
+            state = Header;
+        }
+    }
+    return true;
+}
+
+bool ArchiveReader::parsePax(const QByteArray &records) {
+    int pos = 0;
+    while (pos < records.size()) {
+        const int space = records.indexOf(' ', pos);
+        if (space < 0) break;
+        const int length = records.mid(pos, space - pos).toInt();
+        if (length <= 0 || pos + length > records.size()) {
+            error = "Malformed pax record";
+            return false;
+        }
+        const QByteArray record = records.mid(space + 1, pos + length - space - 2);  // без '\n'
+        const int equals = record.indexOf('=');
+        if (equals > 0) {
+            const QByteArray key = record.left(equals);
+            const QByteArray value = record.mid(equals + 1);
+            if (key == "path") {
+                paxOverrides.path = value;
+                hasPaxPath = true;
+            } else if (key == "linkpath") {
+                paxOverrides.linkTarget = value;
+                hasPaxLink = true;
+            } else if (key == "size") {
+                paxOverrides.size = value.toLongLong();
+                hasPaxSize = true;
+            }
+        }
+        pos += length;
+    }
+    return true;
+}
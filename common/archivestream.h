@@ -0,0 +1,95 @@
+#ifndef ARCHIVESTREAM_H
+#define ARCHIVESTREAM_H
+
+#include <QByteArray>
+#include <QString>
+#include <functional>
+
+// Общий для сервера и клиента потоковый архив: tar (ustar, длинные имена и
+// большие размеры — через pax-заголовки), сжатый zstd. Обе стороны работают
+// порциями и не держат в памяти ни архив, ни файл целиком.
+
+struct ArchiveEntry {
+    enum Type { File, Directory, Symlink };
+
+    Type type = File;
+    QByteArray path;        // относительный путь, байты ФС
+    QByteArray linkTarget;  // для Symlink
+    quint32 mode = 0644;
+    qint64 size = 0;        // для File
+    qint64 mtime = 0;       // секунды
+};
+
+struct ZSTD_CCtx_s;
+struct ZSTD_DCtx_s;
+
+class ArchiveWriter
+{
+public:
+    // level — уровень zstd; workers > 0 — сжатие в нескольких потоках libzstd
+    explicit ArchiveWriter(int level = 3, int workers = 0);
+    ~ArchiveWriter();
+    ArchiveWriter(const ArchiveWriter &) = delete;
+    ArchiveWriter &operator=(const ArchiveWriter &) = delete;
+
+    // Заголовок записи; данные файла (ровно entry.size байт) — через addData
+    bool addEntry(const ArchiveEntry &entry);
+    bool addData(const char *data, qint64 length);
+    // Завершающие нулевые блоки tar и конец кадра zstd
+    bool finish();
+
+    // Сжатые байты, накопленные с прошлого вызова
+    QByteArray takeOutput();
+    qint64 outputSize() const { return output.size(); }
+    QString errorString() const { return error; }
+
+private:
+    bool write(const char *data, qint64 length);
+    bool compress(const char *data, size_t length, int mode);
+
+    ZSTD_CCtx_s *cctx = nullptr;
+    QByteArray output;
+    qint64 entryRemaining = 0;   // байт данных текущей записи, которые ещё ожидаются
+    qint64 entryPadding = 0;
+    QString error;
+};
+
+class ArchiveReader
+{
+public:
+    ArchiveReader();
+    ~ArchiveReader();
+    ArchiveReader(const ArchiveReader &) = delete;
+    ArchiveReader &operator=(const ArchiveReader &) = delete;
+
+    // Вызываются по ходу разбора; false из обработчика прерывает чтение
+    std::function<bool(const ArchiveEntry &)> onEntry;
+    std::function<bool(const char *data, qint64 length)> onData;
+    std::function<bool()> onEntryEnd;
+
+    // Очередная порция сжатого потока
+    bool feed(const char *data, qint64 length);
+    // Встречен конец архива (два нулевых блока)
+    bool atEnd() const { return state == End; }
+    QString errorString() const { return error; }
+
+private:
+    enum State { Header, Data, Padding, Skip, PaxData, End };
+
+    bool consume(const char *data, size_t length);
+    bool parseHeader(const char *block);
+    bool parsePax(const QByteArray &records);
+
+    ZSTD_DCtx_s *dctx = nullptr;
+    State state = Header;
+    QByteArray header;           // неполный заголовок между порциями
+    QByteArray pax;              // тело pax-записи
+    ArchiveEntry paxOverrides;   // path/linkpath/size из pax для следующей записи
+    bool hasPaxPath = false, hasPaxLink = false, hasPaxSize = false;
+    qint64 remaining = 0;
+    qint64 padding = 0;
+    int zeroBlocks = 0;
+    QString error;
+};
+
+#endif // ARCHIVESTREAM_H
@@ -0,0 +1,393 @@
+#include "directoryarchive.h"
+#include <QDir>
+#include <QFile>
+
+#include <fcntl.h>
+#include <fnmatch.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <cerrno>
+#include <cstring>
+
+static const int kReadChunkSize = 256 * 1024;
+
+namespace fs = std::filesystem;
+
+namespace {
+
+std::vector<std::string> toPatterns(const QStringList &list) {
+    std::vector<std::string> patterns;
+    for (const QString &pattern : list) {
+        if (!pattern.isEmpty()) patterns.push_back(QFile::encodeName(pattern).toStdString());
+    }
+    return patterns;
+}
+
+QString errnoString(const char *what, const QByteArray &path) {
+    return QString("%1 %2: %3").arg(what, QString::fromLocal8Bit(path), QString::fromLocal8Bit(strerror(errno)));
+}
+
+// Компоненты пути из архива; false — путь абсолютный или выходит наверх
+bool splitPath(const QByteArray &path, QList<QByteArray> *parts) {
+    if (path.startsWith('/')) return false;
+    for (const QByteArray &part : path.split('/')) {
+        if (part.isEmpty() || part == ".") continue;
+        if (part == "..") return false;
+        parts->append(part);
+    }
+    return true;
+}
+
+void setMtime(int fd, qint64 mtime) {
+    const struct timespec times[2] = { { 0, UTIME_OMIT }, { time_t(mtime), 0 } };
+    ::futimens(fd, times);
+}
+
+} // namespace
+
+ArchiveFilter::ArchiveFilter(const QStringList &include, const QStringList &exclude)
+    : includes(toPatterns(include)), excludes(toPatterns(exclude)) {
+}
+
+bool ArchiveFilter::matches(const std::vector<std::string> &patterns, const std::string &relative,
+                            const std::string &name) {
+    for (const std::string &pattern : patterns) {
+        const std::string &subject = pattern.find('/') != std::string::npos ? relative : name;
+        if (::fnmatch(pattern.c_str(), subject.c_str(), 0) == 0) return true;
+    }
+    return false;
+}
+
+bool ArchiveFilter::excluded(const std::string &relative, const std::string &name) const {
+    return matches(excludes, relative, name);
+}
+
+bool ArchiveFilter::included(const std::string &relative, const std::string &name) const {
+    return includes.empty() || matches(includes, relative, name);
+}
+
+DirectoryPacker::DirectoryPacker(const QString &root, const ArchiveFilter &filter, int level)
+    : root(QFile::encodeName(QDir::cleanPath(root)).toStdString()), filter(filter), writer(level) {
+}
+
+DirectoryPacker::~DirectoryPacker() {
+    closeFile();
+}
+
+bool DirectoryPacker::open(QString *errorOut) {
+    std::error_code ec;
+    if (!fs::is_directory(root, ec)) {
+        if (errorOut) *errorOut = "Not a directory";
+        return false;
+    }
+    it = fs::recursive_directory_iterator(root, fs::directory_options::skip_permission_denied, ec);
+    if (ec) {
+        if (errorOut) *errorOut = QString::fromLocal8Bit(ec.message().c_str());
+        return false;
+    }
+    buffer.resize(kReadChunkSize);
+    return true;
+}
+
+QByteArray DirectoryPacker::next(int maxBytes) {
+    if (finished || !error.isEmpty()) return QByteArray();
+    while (writer.outputSize() < maxBytes) {
+        if (fileRemaining > 0) {
+            if (!readFile()) break;
+        } else if (!advance()) {
+            break;
+        }
+    }
+    if (!error.isEmpty()) return QByteArray();
+    return writer.takeOutput();
+}
+
+bool DirectoryPacker::advance() {
+    std::error_code ec;
+    if (started) it.increment(ec);
+    started = true;
+
+    for (; !ec && it != fs::recursive_directory_iterator(); it.increment(ec)) {
+        const fs::path &path = it->path();
+        const std::string relative = path.lexically_relative(root).generic_string();
+        const std::string name = path.filename().string();
+
+        struct stat st;
+        if (::lstat(path.c_str(), &st) != 0) {
+            ++skipped;
+            continue;
+        }
+        if (filter.excluded(relative, name)) {
+            if (S_ISDIR(st.st_mode)) it.disable_recursion_pending();
+            continue;
+        }
+
+        ArchiveEntry entry;
+        entry.path = QByteArray::fromStdString(relative);
+        entry.mode = quint32(st.st_mode & 07777);
+        entry.mtime = qint64(st.st_mtime);
+
+        if (S_ISDIR(st.st_mode)) {
+            // С include каталоги создаются при распаковке по путям файлов
+            if (filter.hasIncludes()) continue;
+            entry.type = ArchiveEntry::Directory;
+            ++directories;
+        } else if (S_ISLNK(st.st_mode)) {
+            if (!filter.included(relative, name)) continue;
+            QByteArray target(int(st.st_size > 0 ? st.st_size : 4096), 0);
+            const ssize_t n = ::readlink(path.c_str(), target.data(), size_t(target.size()));
+            if (n < 0) {
+                ++skipped;
+                continue;
+            }
+            target.truncate(int(n));
+            entry.type = ArchiveEntry::Symlink;
+            entry.linkTarget = target;
+        } else if (S_ISREG(st.st_mode)) {
+            if (!filter.included(relative, name)) continue;
+            // Размер берётся с открытого файла: заголовок и данные описывают одну версию
+            fd = ::open(path.c_str(), O_RDONLY | O_NOFOLLOW | O_CLOEXEC);
+            if (fd < 0 || ::fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+                closeFile();
+                ++skipped;
+                continue;
+            }
+            ::posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+            entry.type = ArchiveEntry::File;
+            entry.size = qint64(st.st_size);
+            entry.mode = quint32(st.st_mode & 07777);
+            entry.mtime = qint64(st.st_mtime);
+            fileRemaining = entry.size;
+            ++files;
+        } else {
+            // Устройства, FIFO и сокеты в архив не попадают
+            continue;
+        }
+
+        if (!writer.addEntry(entry)) {
+            error = writer.errorString();
+            return false;
+        }
+        if (entry.type == ArchiveEntry::File && fileRemaining == 0) closeFile();
+        return true;
+    }
+
+    if (ec) {
+        error = QString::fromLocal8Bit(ec.message().c_str());
+        return false;
+    }
+    if (!writer.finish()) error = writer.errorString();
+    finished = true;
+    return false;
+}
+
+bool DirectoryPacker::readFile() {
+    ssize_t n;
+    do {
+        n = ::read(fd, buffer.data(), size_t(qMin<qint64>(qint64(buffer.size()), fileRemaining)));
+    } while (n < 0 && errno == EINTR);
+
+    if (n <= 0) {
+        // Файл укоротили на ходу: заголовок уже отправлен, добиваем нулями
+        std::memset(buffer.data(), 0, buffer.size());
+        while (fileRemaining > 0) {
+            const qint64 piece = qMin<qint64>(qint64(buffer.size()), fileRemaining);
+            if (!writer.addData(buffer.data(), piece)) {
+                error = writer.errorString();
+                return false;
+            }
+            fileRemaining -= piece;
+        }
+        ++skipped;
+        closeFile();
+        return true;
+    }
+
+    if (!writer.addData(buffer.data(), n)) {
+        error = writer.errorString();
+        return false;
+    }
+    bytes += n;
+    fileRemaining -= n;
+    if (fileRemaining == 0) closeFile();
+    return true;
+}
+
+void DirectoryPacker::closeFile() {
+    if (fd >= 0) ::close(fd);
+    fd = -1;
+    fileRemaining = 0;
+}
+
+DirectoryUnpacker::DirectoryUnpacker(const QString &root) : root(QDir::cleanPath(root)) {
+    reader.onEntry = [this](const ArchiveEntry &e) { return beginEntry(e); };
+    reader.onData = [this](const char *data, qint64 length) { return writeData(data, length); };
+    reader.onEntryEnd = [this] { return endEntry(); };
+}
+
+DirectoryUnpacker::~DirectoryUnpacker() {
+    discardFile();
+    if (parentFd >= 0 && parentFd != rootFd) ::close(parentFd);
+    if (rootFd >= 0) ::close(rootFd);
+}
+
+bool DirectoryUnpacker::open(QString *errorOut) {
+    if (!QDir().mkpath(root)) {
+        if (errorOut) *errorOut = "Cannot create " + root;
+        return false;
+    }
+    const QByteArray encoded = QFile::encodeName(root);
+    rootFd = ::open(encoded.constData(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (rootFd < 0) {
+        if (errorOut) *errorOut = errnoString("Cannot open", encoded);
+        return false;
+    }
+    return true;
+}
+
+bool DirectoryUnpacker::feed(const char *data, qint64 length) {
+    return reader.feed(data, length);
+}
+
+QString DirectoryUnpacker::errorString() const {
+    return error.isEmpty() ? reader.errorString() : error;
+}
+
+int DirectoryUnpacker::openParent(const QByteArray &path, QByteArray *name, bool create) {
+    QList<QByteArray> parts;
+    if (!splitPath(path, &parts) || parts.isEmpty()) {
+        error = "Unsafe path in archive: " + QString::fromLocal8Bit(path);
+        return -1;
+    }
+    *name = parts.takeLast();
+    const QByteArray parent = parts.join('/');
+    if (parentFd >= 0 && parent == parentPath) return parentFd;
+
+    if (parentFd >= 0 && parentFd != rootFd) ::close(parentFd);
+    parentFd = -1;
+    int fd = rootFd;
+    for (const QByteArray &part : parts) {
+        if (create && ::mkdirat(fd, part.constData(), 0755) != 0 && errno != EEXIST) {
+            error = errnoString("Cannot create", part);
+        }
+        // O_NOFOLLOW: ссылка на месте каталога — ошибка, а не переход за пределы root
+        const int next = error.isEmpty() ? ::openat(fd, part.constData(), O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC) : -1;
+        if (next < 0 && error.isEmpty()) error = errnoString("Cannot open", parts.join('/'));
+        if (fd != rootFd) ::close(fd);
+        if (next < 0) return -1;
+        fd = next;
+    }
+    parentPath = parent;
+    parentFd = fd;
+    return fd;
+}
+
+bool DirectoryUnpacker::beginEntry(const ArchiveEntry &e) {
+    entry = e;
+    if (e.type == ArchiveEntry::Directory) {
+        QList<QByteArray> parts;
+        if (!splitPath(e.path, &parts)) {
+            error = "Unsafe path in archive: " + QString::fromLocal8Bit(e.path);
+            return false;
+        }
+        if (parts.isEmpty()) return true;    // сам корень
+        QByteArray name;
+        const int parent = openParent(e.path, &name, true);
+        if (parent < 0) return false;
+        // Права выставляются в finish(): каталог только для чтения не должен мешать записи внутрь
+        if (::mkdirat(parent, name.constData(), 0700) != 0 && errno != EEXIST) {
+            error = errnoString("Cannot create", e.path);
+            return false;
+        }
+        pendingDirectories.push_back(PendingDirectory{ parts.join('/'), e.mode, e.mtime });
+        return true;
+    }
+
+    const int parent = openParent(e.path, &fileName, true);
+    if (parent < 0) return false;
+
+    if (e.type == ArchiveEntry::Symlink) {
+        // Ссылки создаются как есть: распаковка сама никогда по ним не ходит
+        if (::unlinkat(parent, fileName.constData(), 0) != 0 && errno != ENOENT) {
+            error = errnoString("Cannot replace", e.path);
+            return false;
+        }
+        if (::symlinkat(e.linkTarget.constData(), parent, fileName.constData()) != 0) {
+            error = errnoString("Cannot create link", e.path);
+            return false;
+        }
+        const struct timespec times[2] = { { 0, UTIME_OMIT }, { time_t(e.mtime), 0 } };
+        ::utimensat(parent, fileName.constData(), times, AT_SYMLINK_NOFOLLOW);
+        return true;
+    }
+
+    for (int attempt = 0; fileFd < 0 && attempt < 100; ++attempt) {
+        tempName = "." + fileName + ".unpack" + QByteArray::number(attempt);
+        fileFd = ::openat(parent, tempName.constData(), O_WRONLY | O_CREAT | O_EXCL | O_NOFOLLOW | O_CLOEXEC, 0600);
+        if (fileFd < 0 && errno != EEXIST) break;
+    }
+    if (fileFd < 0) {
+        error = errnoString("Cannot create", e.path);
+        return false;
+    }
+    return true;
+}
+
+bool DirectoryUnpacker::writeData(const char *data, qint64 length) {
+    while (length > 0) {
+        const ssize_t n = ::write(fileFd, data, size_t(length));
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) {
+            error = errnoString("Cannot write", entry.path);
+            discardFile();
+            return false;
+        }
+        data += n;
+        length -= n;
+        bytes += n;
+    }
+    return true;
+}
+
+bool DirectoryUnpacker::endEntry() {
+    // setuid/setgid из чужого архива не переносим
+    ::fchmod(fileFd, mode_t(entry.mode & 0777));
+    setMtime(fileFd, entry.mtime);
+    const bool closed = ::close(fileFd) == 0;
+    fileFd = -1;
+    if (!closed || ::renameat(parentFd, tempName.constData(), parentFd, fileName.constData()) != 0) {
+        error = errnoString("Cannot write", entry.path);
+        ::unlinkat(parentFd, tempName.constData(), 0);
+        return false;
+    }
+    ++files;
+    return true;
+}
+
+void DirectoryUnpacker::discardFile() {
+    if (fileFd < 0) return;
+    ::close(fileFd);
+    fileFd = -1;
+    ::unlinkat(parentFd, tempName.constData(), 0);
+}
+
+bool DirectoryUnpacker::finish(QString *errorOut) {
+    if (!reader.atEnd()) {
+        discardFile();
+        if (errorOut) *errorOut = error.isEmpty() ? QString("Archive is truncated") : errorString();
+        return false;
+    }
+    // Глубокие каталоги первыми: время родителя не должно сбиваться записью внутрь
+    for (auto it = pendingDirectories.rbegin(); it != pendingDirectories.rend(); ++it) {
+        QByteArray name;
+        const int parent = openParent(it->path, &name, false);
+        if (parent < 0) continue;
+        const int fd = ::openat(parent, name.constData(), O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+        if (fd < 0) continue;
+        ::fchmod(fd, mode_t(it->mode & 03777));
+        setMtime(fd, it->mtime);
+        ::close(fd);
+    }
+    error.clear();
+    return true;
+}
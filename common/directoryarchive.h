@@ -0,0 +1,125 @@
+#ifndef DIRECTORYARCHIVE_H
+#define DIRECTORYARCHIVE_H
+
+#include "archivestream.h"
+#include <QStringList>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+// Фильтр путей внутри архива. Шаблон с '/' сравнивается с относительным путём,
+// без '/' — с именем записи (как в fnmatch и поиске по индексу).
+// exclude отсекает и файлы, и каталоги целиком; include, если задан,
+// оставляет только подходящие файлы.
+class ArchiveFilter
+{
+public:
+    ArchiveFilter(const QStringList &include = QStringList(), const QStringList &exclude = QStringList());
+
+    bool excluded(const std::string &relative, const std::string &name) const;
+    bool included(const std::string &relative, const std::string &name) const;
+    bool hasIncludes() const { return !includes.empty(); }
+
+private:
+    static bool matches(const std::vector<std::string> &patterns, const std::string &relative,
+                        const std::string &name);
+
+    std::vector<std::string> includes;
+    std::vector<std::string> excludes;
+};
+
+// Упаковывает каталог в сжатый tar по запросу: каждый next() обходит дерево
+// дальше ровно настолько, чтобы набрать порцию. Файл читается кусками,
+// поэтому память не зависит ни от размера файлов, ни от размера дерева
+// (кроме стека открытых каталогов). Символические ссылки не разыменовываются.
+class DirectoryPacker
+{
+public:
+    DirectoryPacker(const QString &root, const ArchiveFilter &filter, int level = 3);
+    ~DirectoryPacker();
+
+    bool open(QString *error);
+    // Очередная порция сжатого архива, около maxBytes; пустая — конец или ошибка
+    QByteArray next(int maxBytes);
+    bool atEnd() const { return finished; }
+    QString errorString() const { return error; }
+
+    qint64 fileCount() const { return files; }
+    qint64 directoryCount() const { return directories; }
+    qint64 bytesRead() const { return bytes; }
+    qint64 skippedCount() const { return skipped; }
+
+private:
+    bool advance();           // следующая запись дерева в архив
+    bool readFile();          // очередной кусок текущего файла
+    void closeFile();
+
+    std::filesystem::path root;
+    ArchiveFilter filter;
+    ArchiveWriter writer;
+    std::filesystem::recursive_directory_iterator it;
+    bool started = false;
+    bool finished = false;
+
+    int fd = -1;              // читаемый файл
+    qint64 fileRemaining = 0; // байт, объявленных в заголовке и ещё не записанных
+    std::vector<char> buffer;
+
+    qint64 files = 0;
+    qint64 directories = 0;
+    qint64 bytes = 0;
+    qint64 skipped = 0;
+    QString error;
+};
+
+// Распаковывает поток, полученный от DirectoryPacker, в каталог root.
+// Пути из архива не могут выйти за root: абсолютные пути и ".." отвергаются,
+// а каждый компонент открывается через openat с O_NOFOLLOW, так что ссылка
+// из того же архива не уведёт запись в чужой каталог. Файл пишется во
+// временный и переименовывается на место после последнего байта.
+class DirectoryUnpacker
+{
+public:
+    explicit DirectoryUnpacker(const QString &root);
+    ~DirectoryUnpacker();
+
+    bool open(QString *error);
+    bool feed(const char *data, qint64 length);
+    // Проверяет, что архив дочитан, и выставляет права и время каталогов
+    bool finish(QString *error);
+    QString errorString() const;
+
+    qint64 fileCount() const { return files; }
+    qint64 bytesWritten() const { return bytes; }
+
+private:
+    struct PendingDirectory {
+        QByteArray path;
+        quint32 mode;
+        qint64 mtime;
+    };
+
+    bool beginEntry(const ArchiveEntry &entry);
+    bool writeData(const char *data, qint64 length);
+    bool endEntry();
+    int openParent(const QByteArray &path, QByteArray *name, bool create);
+    void discardFile();
+
+    QString root;
+    ArchiveReader reader;
+    int rootFd = -1;
+    QByteArray parentPath;    // последний открытый родительский каталог
+    int parentFd = -1;
+
+    int fileFd = -1;
+    QByteArray fileName;
+    QByteArray tempName;
+    ArchiveEntry entry;
+    std::vector<PendingDirectory> pendingDirectories;
+
+    qint64 files = 0;
+    qint64 bytes = 0;
+    QString error;
+};
+
+#endif // DIRECTORYARCHIVE_H
@@ -0,0 +1,141 @@
+#include "permissionengine.h"
+#include "idnamecache.h"
+#include <benchmark/benchmark.h>
+#include <QCoreApplication>
+#include <QDir>
+#include <QEventLoop>
+#include <QFile>
+#include <QProcess>
+#include <QStandardPaths>
+#include <QStringList>
+#include <QTemporaryDir>
+#include <unistd.h>
+
+// Рекурсивная смена прав: прежний путь — отдельный chmod/setfacl на каждый
+// файл — против обхода PermissionEngine (openat + O_PATH, libacl в процессе).
+// Аргумент — число файлов во временном дереве, по 50 в каталоге. Режим и
+// запись ACL чередуются между итерациями, чтобы каждый проход что-то менял.
+
+namespace {
+
+constexpr int kFilesPerDir = 50;
+
+struct Tree {
+    QTemporaryDir dir;
+    QStringList paths;   // каталоги и файлы в порядке обхода
+
+    explicit Tree(int files) {
+        for (int i = 0; i < files; ++i) {
+            const QString sub = dir.path() + QString("/d%1").arg(i / kFilesPerDir);
+            if (i % kFilesPerDir == 0) {
+                QDir().mkpath(sub);
+                paths.append(sub);
+            }
+            const QString path = sub + QString("/f%1").arg(i);
+            QFile file(path);
+            file.open(QIODevice::WriteOnly);
+            paths.append(path);
+        }
+    }
+};
+
+// Прежний путь: процесс на каждый файл
+bool runPerFile(const QString &program, const QStringList &args, const QStringList &paths) {
+    for (const QString &path : paths) {
+        if (QProcess::execute(program, args + QStringList{path}) != 0) return false;
+    }
+    return true;
+}
+
+// Запуск задания и ожидание finished во вложенном цикле событий
+qint64 runEngine(PermissionEngine &engine, const QString &root, const QString &spec) {
+    qint64 changed = -1;
+    QEventLoop loop;
+    QObject::connect(&engine, &PermissionEngine::finished, &loop, [&](quint64, const QJsonObject &status) {
+        changed = status["failed"].toInt() == 0 ? status["changed"].toInt() : -1;
+        loop.quit();
+    });
+    if (engine.startApply(root, spec, QJsonObject()).isEmpty()) return -1;
+    loop.exec();
+    QObject::disconnect(&engine, &PermissionEngine::finished, &loop, nullptr);
+    return changed;
+}
+
+QString aclSpec(int iteration) {
+    return QString("u:%1:%2").arg(::getuid()).arg(iteration % 2 ? "r--" : "rw-");
+}
+
+void BM_Chmod_PerFileProcess(benchmark::State &state) {
+    Tree tree(int(state.range(0)));
+    int iteration = 0;
+    for (auto _ : state) {
+        const QString mode = iteration++ % 2 ? "750" : "755";
+        if (!runPerFile("chmod", {mode}, tree.paths)) {
+            state.SkipWithError("chmod failed");
+            break;
+        }
+    }
+    state.counters["entries"] = tree.paths.size();
+}
+BENCHMARK(BM_Chmod_PerFileProcess)->Arg(200)->Arg(2000)->Unit(benchmark::kMillisecond);
+
+void BM_Chmod_Engine(benchmark::State &state) {
+    Tree tree(int(state.range(0)));
+    IdNameCache names;
+    PermissionEngine engine;
+    engine.setIdNameCache(&names);
+    int iteration = 0;
+    for (auto _ : state) {
+        const QString mode = iteration++ % 2 ? "750" : "755";
+        if (runEngine(engine, tree.dir.path(), mode) < 0) {
+            state.SkipWithError("permission job failed");
+            break;
+        }
+    }
+    state.counters["entries"] = tree.paths.size();
+}
+BENCHMARK(BM_Chmod_Engine)->Arg(200)->Arg(2000)->Unit(benchmark::kMillisecond);
+
+void BM_Setfacl_PerFileProcess(benchmark::State &state) {
+    if (QStandardPaths::findExecutable("setfacl").isEmpty()) {
+        state.SkipWithError("setfacl not installed");
+        return;
+    }
+    Tree tree(int(state.range(0)));
+    int iteration = 0;
+    for (auto _ : state) {
+        if (!runPerFile("setfacl", {"-m", aclSpec(iteration++)}, tree.paths)) {
+            state.SkipWithError("setfacl failed (filesystem without ACL support?)");
+            break;
+        }
+    }
+    state.counters["entries"] = tree.paths.size();
+}
+BENCHMARK(BM_Setfacl_PerFileProcess)->Arg(200)->Arg(2000)->Unit(benchmark::kMillisecond);
+
+void BM_Setfacl_Engine(benchmark::State &state) {
+    Tree tree(int(state.range(0)));
+    IdNameCache names;
+    PermissionEngine engine;
+    engine.setIdNameCache(&names);
+    int iteration = 0;
+    for (auto _ : state) {
+        if (runEngine(engine, tree.dir.path(), aclSpec(iteration++)) < 0) {
+            state.SkipWithError("permission job failed (filesystem without ACL support?)");
+            break;
+        }
+    }
+    state.counters["entries"] = tree.paths.size();
+}
+BENCHMARK(BM_Setfacl_Engine)->Arg(200)->Arg(2000)->Unit(benchmark::kMillisecond);
+
+} // namespace
+
+int main(int argc, char **argv) {
+    QCoreApplication app(argc, argv);
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
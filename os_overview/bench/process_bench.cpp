@@ -0,0 +1,100 @@
+#include "processmanager.h"
+#include "idnamecache.h"
+#include "procfs.h"
+#include <benchmark/benchmark.h>
+#include <QCoreApplication>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QProcess>
+
+// Список процессов для getProcessList: прежний путь через ps против обхода
+// /proc в ProcessManager. Cold — новый менеджер на каждой итерации (первый
+// обход, cmdline читаются все), Warm — повторные обходы с кэшем между ними.
+
+namespace {
+
+// Прежний getProcessListAsJsonArray: ps -eo и разбор вывода построчно
+QJsonArray psProcessList() {
+    QJsonArray processesArray;
+    QProcess process;
+    process.start("ps", QStringList() << "-eo" << "pid,comm,state,ppid,utime,stime,rss,user,args");
+    process.waitForFinished();
+    QByteArray output = process.readAllStandardOutput();
+    procfs::Scanner lines(std::string_view(output.constData(), size_t(output.size())));
+    lines.line(); // заголовок
+    auto text = [](std::string_view v) { return QString::fromUtf8(v.data(), int(v.size())); };
+    while (!lines.atEnd()) {
+        procfs::Scanner sc(lines.line());
+        uint64_t pid = 0, ppid = 0, utime = 0, stime = 0, rss = 0;
+        if (!sc.u64(pid)) continue;
+        const std::string_view name = sc.word();
+        const std::string_view state = sc.word();
+        if (!sc.u64(ppid) || !sc.u64(utime) || !sc.u64(stime) || !sc.u64(rss)) continue;
+        const std::string_view user = sc.word();
+        sc.skipSpaces();
+        QJsonObject processObj;
+        processObj["pid"] = int(pid);
+        processObj["name"] = text(name);
+        processObj["state"] = text(state);
+        processObj["ppid"] = int(ppid);
+        processObj["utime"] = qint64(utime);
+        processObj["stime"] = qint64(stime);
+        processObj["rss"] = qint64(rss) * 1024;
+        processObj["user"] = text(user);
+        processObj["cmdline"] = text(sc.rest());
+        processesArray.append(processObj);
+    }
+    return processesArray;
+}
+
+void BM_ProcessList_Ps(benchmark::State &state) {
+    int count = 0;
+    for (auto _ : state) {
+        const QJsonArray list = psProcessList();
+        count = list.size();
+        benchmark::DoNotOptimize(count);
+    }
+    if (count == 0) state.SkipWithError("ps returned no processes");
+    state.counters["processes"] = count;
+}
+BENCHMARK(BM_ProcessList_Ps)->Unit(benchmark::kMillisecond);
+
+void BM_ProcessList_Procfs_Cold(benchmark::State &state) {
+    IdNameCache names;
+    int count = 0;
+    for (auto _ : state) {
+        ProcessManager manager;
+        manager.setIdNameCache(&names);
+        const QJsonArray list = manager.getProcessListAsJsonArray();
+        count = list.size();
+        benchmark::DoNotOptimize(count);
+    }
+    state.counters["processes"] = count;
+}
+BENCHMARK(BM_ProcessList_Procfs_Cold)->Unit(benchmark::kMillisecond);
+
+void BM_ProcessList_Procfs_Warm(benchmark::State &state) {
+    IdNameCache names;
+    ProcessManager manager;
+    manager.setIdNameCache(&names);
+    manager.getProcessListAsJsonArray();
+    int count = 0;
+    for (auto _ : state) {
+        const QJsonArray list = manager.getProcessListAsJsonArray();
+        count = list.size();
+        benchmark::DoNotOptimize(count);
+    }
+    state.counters["processes"] = count;
+}
+BENCHMARK(BM_ProcessList_Procfs_Warm)->Unit(benchmark::kMillisecond);
+
+} // namespace
+
+int main(int argc, char **argv) {
+    QCoreApplication app(argc, argv);
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
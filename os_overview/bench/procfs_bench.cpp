@@ -0,0 +1,344 @@
+#include "procfs.h"
+#include <benchmark/benchmark.h>
+#include <QFile>
+#include <QRegularExpression>
+#include <QStringList>
+#include <QTextStream>
+#include <string>
+#include <vector>
+
+// Каждая пара сравнивает прежний разбор из SystemInfo (QFile + QTextStream +
+// split) с procfs. *Parse — только разбор заранее прочитанного текста,
+// *Read — чтение файла вместе с разбором, как в сборщиках. /proc/[pid]/stat,
+// status и /proc/diskstats прежний код не читал (ps и df), для них
+// Qt-вариант написан в том же стиле QTextStream + split.
+
+namespace {
+
+std::string readText(const char *path) {
+    procfs::FileBuffer buffer;
+    if (!buffer.read(path)) return std::string();
+    return std::string(buffer.view());
+}
+
+// Прежний getCpuLoad + getCpuLoadPerCore: первая строка и строки cpuN
+qint64 qtParseStat(QTextStream &in) {
+    qint64 sum = 0;
+    while (!in.atEnd()) {
+        const QString line = in.readLine();
+        if (!line.startsWith("cpu")) continue;
+        const QStringList values = line.split(' ', Qt::SkipEmptyParts);
+        if (values.size() < 5) continue;
+        sum += values[1].toLongLong() + values[2].toLongLong() + values[3].toLongLong() + values[4].toLongLong();
+    }
+    return sum;
+}
+
+// Прежний getMemoryInfo
+qint64 qtParseMeminfo(QTextStream &in) {
+    qint64 total = 0, free = 0, available = 0;
+    while (!in.atEnd()) {
+        const QString line = in.readLine();
+        if (line.startsWith("MemTotal:"))          total = line.split(' ', Qt::SkipEmptyParts)[1].toLongLong();
+        else if (line.startsWith("MemFree:"))      free = line.split(' ', Qt::SkipEmptyParts)[1].toLongLong();
+        else if (line.startsWith("MemAvailable:")) available = line.split(' ', Qt::SkipEmptyParts)[1].toLongLong();
+    }
+    return total + free + available;
+}
+
+// /proc/[pid]/stat: comm в скобках может содержать пробелы, поля после ')'
+// нумеруются с state; индекс = номер поля из proc(5) минус 3
+qint64 qtParsePidStat(const QString &text) {
+    const int open = text.indexOf('(');
+    const int close = text.lastIndexOf(')');
+    if (open < 0 || close < open) return -1;
+    const QString comm = text.mid(open + 1, close - open - 1);
+    const QStringList fields = text.mid(close + 2).split(' ', Qt::SkipEmptyParts);
+    if (fields.size() < 22) return -1;
+    return comm.size() + fields[1].toLongLong() + fields[11].toLongLong() + fields[12].toLongLong()
+         + fields[17].toLongLong() + fields[19].toLongLong() + fields[20].toLongLong() + fields[21].toLongLong();
+}
+
+qint64 procfsPidStatSum(const procfs::PidStat &stat) {
+    return qint64(stat.comm.size()) + stat.ppid + qint64(stat.utime + stat.stime) + stat.numThreads
+         + qint64(stat.starttime + stat.vsize) + stat.rssPages;
+}
+
+qint64 qtParsePidStatus(QTextStream &in) {
+    qint64 sum = 0;
+    auto value = [](const QString &line, int index) {
+        return line.split(QRegularExpression("\\s+"), Qt::SkipEmptyParts).value(index).toLongLong();
+    };
+    while (!in.atEnd()) {
+        const QString line = in.readLine();
+        if (line.startsWith("Name:"))                            sum += line.mid(5).trimmed().size();
+        else if (line.startsWith("Uid:") || line.startsWith("Gid:")) sum += value(line, 1) + value(line, 2);
+        else if (line.startsWith("VmRSS:") || line.startsWith("VmSwap:") || line.startsWith("Threads:")
+                 || line.startsWith("voluntary_ctxt_switches:") || line.startsWith("nonvoluntary_ctxt_switches:"))
+            sum += value(line, 1);
+    }
+    return sum;
+}
+
+qint64 procfsPidStatusSum(const procfs::PidStatus &status) {
+    return qint64(status.name.size()) + status.uid[0] + status.uid[1] + status.gid[0] + status.gid[1]
+         + qint64(status.vmRssKb + status.vmSwapKb) + status.threads
+         + qint64(status.voluntarySwitches + status.nonvoluntarySwitches);
+}
+
+qint64 qtParseDiskstats(QTextStream &in) {
+    qint64 sum = 0;
+    while (!in.atEnd()) {
+        const QStringList parts = in.readLine().split(' ', Qt::SkipEmptyParts);
+        if (parts.size() < 14) continue;
+        sum += parts[2].size() + parts[3].toLongLong() + parts[5].toLongLong()
+             + parts[7].toLongLong() + parts[9].toLongLong();
+    }
+    return sum;
+}
+
+qint64 procfsDiskstatsSum(const std::vector<procfs::DiskStat> &disks) {
+    qint64 sum = 0;
+    for (const procfs::DiskStat &disk : disks) {
+        sum += qint64(disk.name.size() + disk.readsCompleted + disk.sectorsRead + disk.writesCompleted + disk.sectorsWritten);
+    }
+    return sum;
+}
+
+qint64 procfsSum(const procfs::StatSnapshot &stat) {
+    qint64 sum = qint64(stat.total.user + stat.total.nice + stat.total.system + stat.total.idle);
+    for (const procfs::CpuTimes &core : stat.cores) sum += qint64(core.user + core.nice + core.system + core.idle);
+    return sum;
+}
+
+void BM_StatParse_Qt(benchmark::State &state) {
+    const QString text = QString::fromStdString(readText("/proc/stat"));
+    for (auto _ : state) {
+        QString copy = text;
+        QTextStream in(&copy);
+        benchmark::DoNotOptimize(qtParseStat(in));
+    }
+}
+BENCHMARK(BM_StatParse_Qt);
+
+void BM_StatParse_Procfs(benchmark::State &state) {
+    const std::string text = readText("/proc/stat");
+    procfs::StatSnapshot stat;
+    for (auto _ : state) {
+        procfs::parseStat(text, stat);
+        benchmark::DoNotOptimize(procfsSum(stat));
+    }
+}
+BENCHMARK(BM_StatParse_Procfs);
+
+void BM_StatRead_Qt(benchmark::State &state) {
+    for (auto _ : state) {
+        QFile file("/proc/stat");
+        if (!file.open(QIODevice::ReadOnly)) {
+            state.SkipWithError("/proc/stat is not readable");
+            break;
+        }
+        QTextStream in(&file);
+        benchmark::DoNotOptimize(qtParseStat(in));
+    }
+}
+BENCHMARK(BM_StatRead_Qt);
+
+void BM_StatRead_Procfs(benchmark::State &state) {
+    procfs::ProcFile file("/proc/stat");
+    procfs::StatSnapshot stat;
+    for (auto _ : state) {
+        if (!file.refresh() || !procfs::parseStat(file.view(), stat)) {
+            state.SkipWithError("/proc/stat is not readable");
+            break;
+        }
+        benchmark::DoNotOptimize(procfsSum(stat));
+    }
+}
+BENCHMARK(BM_StatRead_Procfs);
+
+void BM_MeminfoParse_Qt(benchmark::State &state) {
+    const QString text = QString::fromStdString(readText("/proc/meminfo"));
+    for (auto _ : state) {
+        QString copy = text;
+        QTextStream in(&copy);
+        benchmark::DoNotOptimize(qtParseMeminfo(in));
+    }
+}
+BENCHMARK(BM_MeminfoParse_Qt);
+
+void BM_MeminfoParse_Procfs(benchmark::State &state) {
+    const std::string text = readText("/proc/meminfo");
+    for (auto _ : state) {
+        procfs::MemInfo info;
+        procfs::parseMeminfo(text, info);
+        benchmark::DoNotOptimize(info.totalKb + info.freeKb + info.availableKb);
+    }
+}
+BENCHMARK(BM_MeminfoParse_Procfs);
+
+void BM_MeminfoRead_Qt(benchmark::State &state) {
+    for (auto _ : state) {
+        QFile file("/proc/meminfo");
+        if (!file.open(QIODevice::ReadOnly)) {
+            state.SkipWithError("/proc/meminfo is not readable");
+            break;
+        }
+        QTextStream in(&file);
+        benchmark::DoNotOptimize(qtParseMeminfo(in));
+    }
+}
+BENCHMARK(BM_MeminfoRead_Qt);
+
+void BM_MeminfoRead_Procfs(benchmark::State &state) {
+    procfs::FileBuffer buffer;
+    for (auto _ : state) {
+        procfs::MemInfo info;
+        if (!buffer.read("/proc/meminfo") || !procfs::parseMeminfo(buffer.view(), info)) {
+            state.SkipWithError("/proc/meminfo is not readable");
+            break;
+        }
+        benchmark::DoNotOptimize(info.totalKb + info.freeKb + info.availableKb);
+    }
+}
+BENCHMARK(BM_MeminfoRead_Procfs);
+
+void BM_PidStatParse_Qt(benchmark::State &state) {
+    const QString text = QString::fromStdString(readText("/proc/self/stat"));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(qtParsePidStat(text));
+    }
+}
+BENCHMARK(BM_PidStatParse_Qt);
+
+void BM_PidStatParse_Procfs(benchmark::State &state) {
+    const std::string text = readText("/proc/self/stat");
+    procfs::PidStat stat;
+    for (auto _ : state) {
+        procfs::parsePidStat(text, stat);
+        benchmark::DoNotOptimize(procfsPidStatSum(stat));
+    }
+}
+BENCHMARK(BM_PidStatParse_Procfs);
+
+void BM_PidStatRead_Qt(benchmark::State &state) {
+    for (auto _ : state) {
+        QFile file("/proc/self/stat");
+        if (!file.open(QIODevice::ReadOnly)) {
+            state.SkipWithError("/proc/self/stat is not readable");
+            break;
+        }
+        benchmark::DoNotOptimize(qtParsePidStat(QString::fromLocal8Bit(file.readAll())));
+    }
+}
+BENCHMARK(BM_PidStatRead_Qt);
+
+void BM_PidStatRead_Procfs(benchmark::State &state) {
+    procfs::FileBuffer buffer;
+    procfs::PidStat stat;
+    for (auto _ : state) {
+        if (!buffer.read("/proc/self/stat") || !procfs::parsePidStat(buffer.view(), stat)) {
+            state.SkipWithError("/proc/self/stat is not readable");
+            break;
+        }
+        benchmark::DoNotOptimize(procfsPidStatSum(stat));
+    }
+}
+BENCHMARK(BM_PidStatRead_Procfs);
+
+void BM_PidStatusParse_Qt(benchmark::State &state) {
+    const QString text = QString::fromStdString(readText("/proc/self/status"));
+    for (auto _ : state) {
+        QString copy = text;
+        QTextStream in(&copy);
+        benchmark::DoNotOptimize(qtParsePidStatus(in));
+    }
+}
+BENCHMARK(BM_PidStatusParse_Qt);
+
+void BM_PidStatusParse_Procfs(benchmark::State &state) {
+    const std::string text = readText("/proc/self/status");
+    for (auto _ : state) {
+        procfs::PidStatus status;
+        procfs::parsePidStatus(text, status);
+        benchmark::DoNotOptimize(procfsPidStatusSum(status));
+    }
+}
+BENCHMARK(BM_PidStatusParse_Procfs);
+
+void BM_PidStatusRead_Qt(benchmark::State &state) {
+    for (auto _ : state) {
+        QFile file("/proc/self/status");
+        if (!file.open(QIODevice::ReadOnly)) {
+            state.SkipWithError("/proc/self/status is not readable");
+            break;
+        }
+        QTextStream in(&file);
+        benchmark::DoNotOptimize(qtParsePidStatus(in));
+    }
+}
+BENCHMARK(BM_PidStatusRead_Qt);
+
+void BM_PidStatusRead_Procfs(benchmark::State &state) {
+    procfs::FileBuffer buffer;
+    for (auto _ : state) {
+        procfs::PidStatus status;
+        if (!buffer.read("/proc/self/status") || !procfs::parsePidStatus(buffer.view(), status)) {
+            state.SkipWithError("/proc/self/status is not readable");
+            break;
+        }
+        benchmark::DoNotOptimize(procfsPidStatusSum(status));
+    }
+}
+BENCHMARK(BM_PidStatusRead_Procfs);
+
+void BM_DiskstatsParse_Qt(benchmark::State &state) {
+    const QString text = QString::fromStdString(readText("/proc/diskstats"));
+    for (auto _ : state) {
+        QString copy = text;
+        QTextStream in(&copy);
+        benchmark::DoNotOptimize(qtParseDiskstats(in));
+    }
+}
+BENCHMARK(BM_DiskstatsParse_Qt);
+
+void BM_DiskstatsParse_Procfs(benchmark::State &state) {
+    const std::string text = readText("/proc/diskstats");
+    std::vector<procfs::DiskStat> disks;
+    for (auto _ : state) {
+        procfs::parseDiskstats(text, disks);
+        benchmark::DoNotOptimize(procfsDiskstatsSum(disks));
+    }
+    state.counters["devices"] = double(disks.size());
+}
+BENCHMARK(BM_DiskstatsParse_Procfs);
+
+void BM_DiskstatsRead_Qt(benchmark::State &state) {
+    for (auto _ : state) {
+        QFile file("/proc/diskstats");
+        if (!file.open(QIODevice::ReadOnly)) {
+            state.SkipWithError("/proc/diskstats is not readable");
+            break;
+        }
+        QTextStream in(&file);
+        benchmark::DoNotOptimize(qtParseDiskstats(in));
+    }
+}
+BENCHMARK(BM_DiskstatsRead_Qt);
+
+void BM_DiskstatsRead_Procfs(benchmark::State &state) {
+    procfs::ProcFile file("/proc/diskstats");
+    std::vector<procfs::DiskStat> disks;
+    for (auto _ : state) {
+        if (!file.refresh() || !procfs::parseDiskstats(file.view(), disks)) {
+            state.SkipWithError("/proc/diskstats is not readable");
+            break;
+        }
+        benchmark::DoNotOptimize(procfsDiskstatsSum(disks));
+    }
+}
+BENCHMARK(BM_DiskstatsRead_Procfs);
+
+} // namespace
+
+BENCHMARK_MAIN();
@@ -4,7 +4,106 @@
 #include <QJsonObject>
 #include <QJsonArray>
 #include <QDateTime>
-#include <QProcess>
+#include <QFile>
+#include "procfs.h"
+#include "idnamecache.h"
+#include "permissionengine.h"
+#include <QSet>
+#include <QHash>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <cerrno>
+#include <cstring>
+
+static const int kDefaultPageSize = 500;
+static const int kMaxPageSize = 5000;
+static const qint64 kMaxRangeLength = 4 * 1024 * 1024;
+
+// Поля листинга и атрибуты statx, которые для них нужны
+enum ListField {
+    FieldPath        = 1 << 0,
+    FieldType        = 1 << 1,
+    FieldSize        = 1 << 2,
+    FieldPermissions = 1 << 3,
+    FieldMode        = 1 << 4,
+    FieldOwner       = 1 << 5,
+    FieldGroup       = 1 << 6,
+    FieldModified    = 1 << 7,
+    FieldCreated     = 1 << 8,
+    FieldInode       = 1 << 9,
+    FieldLinks       = 1 << 10,
+    FieldUid         = 1 << 11,
+    FieldGid         = 1 << 12,
+    FieldAcl         = 1 << 13
+};
+
+static int parseFields(const QJsonArray &fields) {
+    static const QHash<QString, int> known = {
+        {"path", FieldPath}, {"type", FieldType}, {"is_dir", FieldType},
+        {"size", FieldSize}, {"permissions", FieldPermissions}, {"mode", FieldMode},
+        {"owner", FieldOwner}, {"group", FieldGroup}, {"modified", FieldModified},
+        {"created", FieldCreated}, {"inode", FieldInode}, {"nlink", FieldLinks},
+        {"uid", FieldUid}, {"gid", FieldGid}, {"acl", FieldAcl}
+    };
+    // Без явного списка отдаём те же поля, что и getFileSystem
+    if (fields.isEmpty()) {
+        return FieldPath | FieldType | FieldSize | FieldPermissions | FieldOwner | FieldGroup
+             | FieldCreated | FieldModified;
+    }
+    int mask = 0;
+    for (const QJsonValue &field : fields) mask |= known.value(field.toString(), 0);
+    return mask;
+}
+
+static unsigned statxMaskFor(int fields) {
+    unsigned mask = 0;
+    if (fields & FieldSize)                                 mask |= STATX_SIZE;
+    if (fields & (FieldPermissions | FieldMode))            mask |= STATX_MODE;
+    if (fields & (FieldOwner | FieldUid))                   mask |= STATX_UID;
+    if (fields & (FieldGroup | FieldGid))                   mask |= STATX_GID;
+    if (fields & FieldModified)                             mask |= STATX_MTIME;
+    if (fields & FieldCreated)                              mask |= STATX_BTIME;
+    if (fields & FieldLinks)                                mask |= STATX_NLINK;
+    return mask;
+}
+
+static const char *typeName(unsigned mode) {
+    switch (mode & S_IFMT) {
+    case S_IFDIR:  return "dir";
+    case S_IFREG:  return "file";
+    case S_IFLNK:  return "symlink";
+    case S_IFIFO:  return "fifo";
+    case S_IFSOCK: return "socket";
+    case S_IFCHR:  return "char";
+    case S_IFBLK:  return "block";
+    default:       return "unknown";
+    }
+}
+
+static unsigned modeFromDirentType(unsigned char type) {
+    switch (type) {
+    case DT_DIR:  return S_IFDIR;
+    case DT_REG:  return S_IFREG;
+    case DT_LNK:  return S_IFLNK;
+    case DT_FIFO: return S_IFIFO;
+    case DT_SOCK: return S_IFSOCK;
+    case DT_CHR:  return S_IFCHR;
+    case DT_BLK:  return S_IFBLK;
+    default:      return 0;
+    }
+}
+
+static QString modeToString(unsigned mode) {
+    static const char flags[] = "rwxrwxrwx";
+    QString result(9, '-');
+    for (int i = 0; i < 9; ++i) {
+        if (mode & (0400u >> i)) result[i] = QLatin1Char(flags[i]);
+    }
+    return result;
+}
 
 // Конструктор/деструктор остаются без изменений
 FileManager::FileManager(QObject *parent) : QObject(parent) { }
@@ -23,6 +122,155 @@ QJsonArray FileManager::getFileSystemInfo(const QString &path) const {
     return files;
 }
 
+QJsonObject FileManager::listDirectory(const QJsonObject &params) {
+    QString path = params["path"].toString();
+    if (path.isEmpty()) path = QDir::rootPath();
+    const int limit = qBound(1, params["limit"].toInt(kDefaultPageSize), kMaxPageSize);
+    int fields = parseFields(params["fields"].toArray());
+    const bool numericIds = params["numericIds"].toBool(false);
+    if (numericIds) {
+        if (fields & FieldOwner) fields = (fields & ~FieldOwner) | FieldUid;
+        if (fields & FieldGroup) fields = (fields & ~FieldGroup) | FieldGid;
+    }
+    QSet<uint> uids, gids;
+
+    const int dirFd = ::open(QFile::encodeName(path).constData(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dirFd < 0) return QJsonObject();
+
+    // Курсор — смещение d_off последней отданной записи. Передаётся строкой:
+    // на ext4 это 64-битный хэш, который не помещается в double без потерь
+    const qint64 cursor = params["cursor"].toString().toLongLong();
+    if (cursor != 0 && ::lseek(dirFd, cursor, SEEK_SET) < 0) {
+        ::close(dirFd);
+        return QJsonObject();
+    }
+
+    const QString prefix = path.endsWith('/') ? path : path + '/';
+    procfs::DirReader reader(64 * 1024);
+    reader.reset(dirFd);
+    procfs::DirReader::Entry entry;
+    QJsonArray entries;
+    qint64 lastOffset = cursor;
+    bool done = true;
+
+    while (reader.next(entry)) {
+        if (entry.name[0] == '.' && (entry.name[1] == 0 || (entry.name[1] == '.' && entry.name[2] == 0))) {
+            lastOffset = entry.offset;
+            continue;
+        }
+        // Запись сверх лимита не отдаём: следующая страница начнётся с неё
+        if (entries.size() == limit) {
+            done = false;
+            break;
+        }
+
+        const QString name = QFile::decodeName(entry.name);
+        QJsonObject file = statEntry(dirFd, entry.name, prefix + name, entry.inode, entry.type, fields);
+        if (!file.isEmpty()) {
+            if (numericIds) {
+                if (file.contains("uid")) uids.insert(uint(file["uid"].toDouble()));
+                if (file.contains("gid")) gids.insert(uint(file["gid"].toDouble()));
+            }
+            entries.append(file);
+        }
+        lastOffset = entry.offset;
+    }
+    const bool failed = reader.failed();
+    ::close(dirFd);
+    if (failed && entries.isEmpty()) return QJsonObject();
+
+    QJsonObject result;
+    result["path"] = path;
+    result["entries"] = entries;
+    result["cursor"] = QString::number(lastOffset);
+    result["done"] = done;
+    if (numericIds) {
+        QJsonObject users, groups;
+        for (uint uid : uids) users[QString::number(uid)] = userName(uid);
+        for (uint gid : gids) groups[QString::number(gid)] = groupName(gid);
+        result["users"] = users;
+        result["groups"] = groups;
+    }
+    return result;
+}
+
+// Атрибуты одной записи каталога: statx запрашивается только для нужных полей
+QJsonObject FileManager::statEntry(int dirFd, const char *name, const QString &path,
+                                   quint64 inode, unsigned char direntType, int fields) {
+    const unsigned wanted = statxMaskFor(fields);
+    unsigned mode = modeFromDirentType(direntType);
+    struct statx sx;
+    std::memset(&sx, 0, sizeof(sx));
+    unsigned mask = wanted;
+    if (mode == 0 && (fields & (FieldType | FieldAcl))) mask |= STATX_TYPE;
+    // Если нужны только имя и тип, statx не вызывается вовсе
+    if (mask != 0 && ::statx(dirFd, name, AT_SYMLINK_NOFOLLOW | AT_STATX_DONT_SYNC, mask, &sx) == 0) {
+        if (sx.stx_mask & STATX_TYPE) mode = (mode & ~S_IFMT) | (sx.stx_mode & S_IFMT);
+        if (sx.stx_mask & STATX_MODE) mode = sx.stx_mode;
+    } else {
+        if (mask != 0 && errno == ENOENT) return QJsonObject();  // удалён между getdents и statx
+        sx.stx_mask = 0;
+    }
+
+    QJsonObject file;
+    file["name"] = QFile::decodeName(name);
+    if (fields & FieldPath) file["path"] = path;
+    if (fields & FieldType) {
+        file["type"] = typeName(mode);
+        file["is_dir"] = (mode & S_IFMT) == S_IFDIR;
+    }
+    if (fields & FieldInode) file["inode"] = QString::number(inode);
+    if (sx.stx_mask & STATX_SIZE)  file["size"] = qint64(sx.stx_size);
+    if (sx.stx_mask & STATX_MODE) {
+        if (fields & FieldPermissions) file["permissions"] = modeToString(sx.stx_mode);
+        if (fields & FieldMode)        file["mode"] = int(sx.stx_mode & 07777);
+    }
+    if (sx.stx_mask & STATX_UID) {
+        if (fields & FieldOwner) file["owner"] = userName(sx.stx_uid);
+        if (fields & FieldUid)   file["uid"] = qint64(sx.stx_uid);
+    }
+    if (sx.stx_mask & STATX_GID) {
+        if (fields & FieldGroup) file["group"] = groupName(sx.stx_gid);
+        if (fields & FieldGid)   file["gid"] = qint64(sx.stx_gid);
+    }
+    if (sx.stx_mask & STATX_MTIME) {
+        file["modified"] = QDateTime::fromSecsSinceEpoch(sx.stx_mtime.tv_sec).toString(Qt::ISODate);
+    }
+    if (sx.stx_mask & STATX_BTIME) {
+        file["created"] = QDateTime::fromSecsSinceEpoch(sx.stx_btime.tv_sec).toString(Qt::ISODate);
+    }
+    if (sx.stx_mask & STATX_NLINK) file["nlink"] = qint64(sx.stx_nlink);
+    // Только расширенные записи; у ссылок ACL нет, а acl_get_file прошёл бы к цели
+    if ((fields & FieldAcl) && permissions && (mode & S_IFMT) != S_IFLNK) {
+        const QJsonArray acl = permissions->aclEntries(path, (mode & S_IFMT) == S_IFDIR);
+        if (!acl.isEmpty()) file["acl"] = acl;
+    }
+    return file;
+}
+
+QJsonObject FileManager::getEntryInfo(const QString &path) {
+    QJsonObject file = statEntry(AT_FDCWD, QFile::encodeName(path).constData(), path, 0, DT_UNKNOWN,
+                                 parseFields(QJsonArray()));
+    if (!file.isEmpty()) file["name"] = QFileInfo(path).fileName();
+    return file;
+}
+
+void FileManager::setIdNameCache(IdNameCache *cache) {
+    idNames = cache;
+}
+
+void FileManager::setPermissionEngine(PermissionEngine *engine) {
+    permissions = engine;
+}
+
+QString FileManager::userName(uint uid) const {
+    return idNames ? idNames->userName(uid) : QString::number(uid);
+}
+
+QString FileManager::groupName(uint gid) const {
+    return idNames ? idNames->groupName(gid) : QString::number(gid);
+}
+
 // Преобразуем права доступа в строку «rwxrwxrwx»
 QString permissionsToString(QFile::Permissions permissions) {
     QString result;
@@ -48,17 +296,62 @@ QJsonObject FileManager::fileInfoToJson(const QFileInfo &info) const {
     file["is_dir"] = info.isDir();             // вместо «type» теперь boolean
     file["size"] = static_cast<qint64>(info.size());
     file["permissions"] = permissionsToString(info.permissions());
-    file["owner"] = info.owner();
-    file["group"] = info.group();
+    file["owner"] = userName(info.ownerId());
+    file["group"] = groupName(info.groupId());
     file["created"] = info.birthTime().toString(Qt::ISODate);
     file["modified"] = info.lastModified().toString(Qt::ISODate);
     return file;
 }
 
-bool FileManager::setPermissions(const QString &path, const QString &perms) {
-    // Заменить на поддержку ACL (setfacl)
-    QProcess process;
-    process.start("setfacl", {"-m", perms, path});
-    process.waitForFinished();
-    return (process.exitCode() == 0);
+bool FileManager::setPermissions(const QString &path, const QString &perms, QString *error) {
+    if (!permissions) {
+        if (error) *error = "Permission engine is not available";
+        return false;
+    }
+    return permissions->apply(path, perms, error);
+}
+
+QJsonObject FileManager::readRange(const QString &path, qint64 offset, qint64 length, QString *error) {
+    const QByteArray encoded = QFile::encodeName(QDir::cleanPath(path));
+    const int fd = ::open(encoded.constData(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+    struct stat st;
+    if (fd < 0 || ::fstat(fd, &st) != 0) {
+        if (error) *error = QString::fromLocal8Bit(strerror(errno));
+        if (fd >= 0) ::close(fd);
+        return QJsonObject();
+    }
+    if (!S_ISREG(st.st_mode)) {
+        if (error) *error = "Not a regular file";
+        ::close(fd);
+        return QJsonObject();
+    }
+
+    const qint64 size = qint64(st.st_size);
+    if (offset < 0) offset = qMax<qint64>(0, size + offset);
+    offset = qMin(offset, size);
+    length = qBound<qint64>(0, length, qMin(kMaxRangeLength, size - offset));
+
+    QByteArray data(int(length), Qt::Uninitialized);
+    qint64 got = 0;
+    while (got < length) {
+        const ssize_t n = ::pread(fd, data.data() + got, size_t(length - got), offset + got);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) {
+            if (error) *error = QString::fromLocal8Bit(strerror(errno));
+            ::close(fd);
+            return QJsonObject();
+        }
+        if (n == 0) break;      // файл укоротили на ходу
+        got += n;
+    }
+    ::close(fd);
+    data.truncate(int(got));
+
+    QJsonObject result;
+    result["path"] = QFile::decodeName(encoded);
+    result["offset"] = offset;
+    result["size"] = size;
+    result["data"] = QString::fromLatin1(data.toBase64());
+    result["eof"] = offset + got >= size;
+    return result;
 }
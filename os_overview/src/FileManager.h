@@ -6,6 +6,9 @@
 #include <QJsonObject>
 #include <QFileInfo>
 
+class IdNameCache;
+class PermissionEngine;
+
 class FileManager : public QObject
 {
     Q_OBJECT
@@ -13,11 +16,33 @@ public:
     explicit FileManager(QObject *parent = nullptr);
     ~FileManager();
 
+    void setIdNameCache(IdNameCache *cache);
+    void setPermissionEngine(PermissionEngine *engine);
+
     QJsonArray getFileSystemInfo(const QString &path) const;
-    bool setPermissions(const QString &path, const QString &perms);
+    // Постраничный листинг через getdents64 + statx. params: path, cursor (строка
+    // из предыдущей страницы), limit, fields — statx запрашивает только нужные атрибуты.
+    // Возвращает {path, entries, cursor, done}; пустой объект — каталог не открыть.
+    // numericIds=true — вместо owner/group отдаются uid/gid и словари users/groups.
+    // Поле "acl" (только по запросу) — расширенные записи ACL, см. PermissionEngine.
+    QJsonObject listDirectory(const QJsonObject &params);
+    // Атрибуты одного файла в формате записи listDirectory; пустой объект — файла нет
+    QJsonObject getEntryInfo(const QString &path);
+    // Восьмеричный режим или записи ACL в формате setfacl -m, без запуска процессов
+    bool setPermissions(const QString &path, const QString &perms, QString *error = nullptr);
+    // Кусок файла без чтения остального: {path, offset, size (всего файла), data (base64), eof}.
+    // length ограничен; отрицательный offset отсчитывается от конца. Пустой объект — ошибка.
+    QJsonObject readRange(const QString &path, qint64 offset, qint64 length, QString *error = nullptr);
 
 private:
     QJsonObject fileInfoToJson(const QFileInfo &info) const;
+    QJsonObject statEntry(int dirFd, const char *name, const QString &path,
+                          quint64 inode, unsigned char direntType, int fields);
+    QString userName(uint uid) const;
+    QString groupName(uint gid) const;
+
+    IdNameCache *idNames = nullptr;
+    PermissionEngine *permissions = nullptr;
 };
 
 #endif // FILEMANAGER_H
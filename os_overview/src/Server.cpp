@@ -6,8 +6,35 @@
 #include <QDataStream>
 #include <QFile>
 #include <QDebug>
+#include <cmath>
 
 Server::Server(QObject* parent) : QTcpServer(parent) {
+    systemInfo.setResourceSampler(&resourceSampler);
+    fileManager.setIdNameCache(&idNames);
+    fileManager.setPermissionEngine(&permissionEngine);
+    permissionEngine.setIdNameCache(&idNames);
+    processManager.setIdNameCache(&idNames);
+    serviceManager.setResourceSampler(&resourceSampler);
+    resourceSampler.start();
+    connectionManager.start();
+
+    connect(&diskUsageScanner, &DiskUsageScanner::progress, this, &Server::onDirectorySizesProgress);
+    connect(&diskUsageScanner, &DiskUsageScanner::finished, this, &Server::onDirectorySizesFinished);
+    connect(&directoryWatcher, &DirectoryWatcher::changed, this, &Server::onDirectoryChanged);
+    connect(&directoryWatcher, &DirectoryWatcher::removed, this, &Server::onDirectoryRemoved);
+    connect(&permissionEngine, &PermissionEngine::progress, this, &Server::onPermissionsProgress);
+    connect(&permissionEngine, &PermissionEngine::finished, this, &Server::onPermissionsFinished);
+    connect(&deltaTransfer, &DeltaTransfer::signatureReady, this, &Server::onFileSignatureReady);
+    connect(&archiveTransfer, &ArchiveTransfer::downloadData, this, &Server::onArchiveData);
+    connect(&fileTailer, &FileTailer::appended, this, &Server::onFileTailAppended);
+    connect(&journalReader, &JournalReader::entries, this, &Server::onJournalEntries);
+    connect(&contentSearch, &ContentSearch::matches, this, &Server::onContentMatches);
+    connect(&contentSearch, &ContentSearch::finished, this, &Server::onContentSearchFinished);
+    connect(&userManager, &UserManager::usersApplied, this, &Server::onUsersApplied);
+    connect(&serviceManager, &ServiceManager::unitsChanged, this, &Server::onUnitsChanged);
+    connect(&serviceManager, &ServiceManager::usageChanged, this, &Server::onUnitUsageChanged);
+    connect(&serviceManager, &ServiceManager::jobProgress, this, &Server::onServiceJobProgress);
+    connect(&serviceManager, &ServiceManager::jobFinished, this, &Server::onServiceJobFinished);
 }
 
 Server::~Server() {}
@@ -25,6 +52,14 @@ void Server::startDiscovery(quint16 discoveryPort, quint16 tcpPort) {
     discovery.start(discoveryPort, tcpPort);
 }
 
+bool Server::enableProcessEvents(int reconcileIntervalMs) {
+    return processManager.enableEventTracking(reconcileIntervalMs);
+}
+
+void Server::enableFileIndex(const QStringList& roots, int rescanIntervalSec) {
+    fileIndex.start(roots, rescanIntervalSec);
+}
+
 void Server::incomingConnection(qintptr socketDescriptor) {
     QTcpSocket* client = new QTcpSocket(this);
     if (!client->setSocketDescriptor(socketDescriptor)) {
@@ -48,6 +83,15 @@ void Server::handleClientDisconnected() {
 
     clientBuffers.remove(client);
     clientBlockSizes.remove(client);
+    directoryWatcher.unwatchAll(client);
+    deltaTransfer.abortAll(client);
+    archiveTransfer.abortAll(client);
+    fileTailer.stopAll(client);
+    journalReader.stopAll(client);
+    unitSubscribers.remove(client);
+    for (auto it = contentSearchClients.begin(); it != contentSearchClients.end(); ++it) {
+        if (it.value() == client) contentSearch.cancel(it.key());
+    }
     client->deleteLater();
     qInfo() << "Client disconnected";
 }
@@ -60,20 +104,26 @@ void Server::onClientReadyRead() {
     in.setVersion(QDataStream::Qt_5_14);
     in.setByteOrder(QDataStream::BigEndian);
 
-    quint32 &blockSize = clientBlockSizes[client];
-    QByteArray &buffer = clientBuffers[client];
+    // За один readyRead может прийти несколько кадров (например, поток чанков дельты)
+    for (;;) {
+        quint32 &blockSize = clientBlockSizes[client];
+        if (blockSize == 0) {
+            if (client->bytesAvailable() < static_cast<int>(sizeof(quint32))) return;
+            in >> blockSize;
+        }
+        if (client->bytesAvailable() < static_cast<qint64>(blockSize)) return;
 
-    if (blockSize == 0) {
-        if (client->bytesAvailable() < static_cast<int>(sizeof(quint32))) return;
-        in >> blockSize;
+        QByteArray data;
+        data.resize(blockSize);
+        in.readRawData(data.data(), blockSize);
+        blockSize = 0;
+        processRequest(client, data);
+        // Обработчик мог закрыть соединение
+        if (client->state() != QAbstractSocket::ConnectedState) return;
     }
-    if (client->bytesAvailable() < static_cast<int>(blockSize)) return;
-
-    QByteArray data;
-    data.resize(blockSize);
-    in.readRawData(data.data(), blockSize);
-    blockSize = 0;
+}
 
+void Server::processRequest(QTcpSocket* client, const QByteArray& data) {
     QJsonParseError parseError;
     QJsonDocument doc = QJsonDocument::fromJson(data, &parseError);
     if (parseError.error != QJsonParseError::NoError) {
@@ -92,18 +142,118 @@ void Server::onClientReadyRead() {
     if (method == "getUserList") {
         response["result"] = userManager.getUserListAsJsonArray();
     }
+    else if (method == "listUsers") {
+        // Полные записи из разобранных passwd/group/shadow; filter: human | system | all
+        response["result"] = userManager.listUsers(request["params"].toObject());
+    }
     else if (method == "getSystemInfo") {
-        response["result"] = systemInfo.collectSystemInfo();
+        auto p = request["params"].toObject();
+        // Отрицательный срок QDeadlineTimer понимает как «ждать вечно»
+        response["result"] = systemInfo.collectSystemInfo(qBound(0, p["timeoutMs"].toInt(1000), 10000));
     }
     else if (method == "getFileSystem") {
         response["result"] = fileManager.getFileSystemInfo(request["params"].toObject()["path"].toString());
     }
+    else if (method == "listDirectory") {
+        QJsonObject page = fileManager.listDirectory(request["params"].toObject());
+        if (!page.isEmpty()) response["result"] = page;
+        else response["error"] = QJsonObject{{"code", -32009}, {"message", "Cannot open directory"}};
+    }
+    else if (method == "watchDirectory") {
+        auto p = request["params"].toObject();
+        bool ok = directoryWatcher.watch(client, p["path"].toString());
+        response[ok ? "result" : "error"] = ok ? QJsonObject{{"status", "success"}, {"path", p["path"].toString()}} : QJsonObject{{"code", -32011}, {"message", "Failed to watch directory"}};
+    }
+    else if (method == "unwatchDirectory") {
+        auto p = request["params"].toObject();
+        bool ok = directoryWatcher.unwatch(client, p["path"].toString());
+        response[ok ? "result" : "error"] = ok ? QJsonObject{{"status", "success"}, {"path", p["path"].toString()}} : QJsonObject{{"code", -32012}, {"message", "Directory is not watched"}};
+    }
+    else if (method == "searchFiles") {
+        auto p = request["params"].toObject();
+        if (!fileIndex.isEnabled()) {
+            response["error"] = QJsonObject{{"code", -32013}, {"message", "File index is disabled"}};
+        } else {
+            QString error;
+            QJsonObject result = fileIndex.search(p["pattern"].toString(), p["limit"].toInt(100), &error);
+            if (!result.isEmpty()) response["result"] = result;
+            else response["error"] = QJsonObject{{"code", -32602}, {"message", "Invalid params: " + error}};
+        }
+    }
+    else if (method == "getServerStats") {
+        response["result"] = QJsonObject{{"file_index", fileIndex.stats()}};
+    }
+    else if (method == "getDirectorySizes") {
+        auto p = request["params"].toObject();
+        QJsonObject sizes = diskUsageScanner.getDirectorySizes(p["path"].toString(), p["depth"].toInt(1));
+        if (sizes.isEmpty()) {
+            response["error"] = QJsonObject{{"code", -32010}, {"message", "Cannot scan directory"}};
+        } else {
+            // Пока обход идёт, частичные результаты приходят уведомлениями directorySizes
+            if (!sizes["done"].toBool()) {
+                directorySizeSubscribers[sizes["scan_id"].toString().toULongLong()].append(
+                    SizeSubscriber{client, sizes["path"].toString(), sizes["depth"].toInt()});
+            }
+            response["result"] = sizes;
+        }
+    }
     else if (method == "getProcessList") {
-        response["result"] = processManager.getProcessListAsJsonArray();
+        auto p = request["params"].toObject();
+        if (p.isEmpty()) {
+            response["result"] = processManager.getProcessListAsJsonArray();
+        } else {
+            QString error;
+            QJsonObject result = processManager.queryProcesses(p, &error);
+            if (!result.isEmpty()) response["result"] = result;
+            else response["error"] = QJsonObject{{"code", -32602}, {"message", "Invalid params: " + error}};
+        }
+    }
+    else if (method == "getProcessDetail") {
+        auto p = request["params"].toObject();
+        QJsonObject detail = processManager.getProcessDetail(p["pid"].toInt());
+        if (!detail.isEmpty()) response["result"] = detail;
+        else response["error"] = QJsonObject{{"code", -32008}, {"message", "Process not found"}};
+    }
+    else if (method == "getProcessEvents") {
+        auto p = request["params"].toObject();
+        // since приходит от клиента: в quint64 приводится только целое 0 ≤ since ≤ 2^53
+        const QJsonValue since = p["since"];
+        const double sinceValue = since.toDouble(0);
+        if (!since.isUndefined() && !since.isNull()
+                && (!since.isDouble() || !(sinceValue >= 0 && sinceValue <= 9007199254740992.0)
+                    || std::floor(sinceValue) != sinceValue)) {
+            response["error"] = QJsonObject{{"code", -32602}, {"message", "Invalid params: since must be a non-negative integer"}};
+        } else {
+            response["result"] = processManager.getProcessEvents(quint64(sinceValue), p["limit"].toInt(1000));
+        }
+    }
+    else if (method == "getConnections") {
+        response["result"] = connectionManager.getConnections(request["params"].toObject());
     }
     else if (method == "getServiceList") {
         response["result"] = serviceManager.getServices();
     }
+    else if (method == "listUnits") {
+        const QJsonObject params = request["params"].toObject();
+        response["result"] = serviceManager.listUnits(params["type"].toString(), params["resources"].toBool(true));
+    }
+    else if (method == "subscribeUnits") {
+        // Ответ — текущая таблица, дальше приходят только изменения (unitsChanged)
+        // и, если resources, свежие сводки ресурсов (unitUsage)
+        const QJsonObject params = request["params"].toObject();
+        UnitSubscription subscription;
+        subscription.type = params["type"].toString();
+        subscription.resources = params["resources"].toBool(true);
+        unitSubscribers.insert(client, subscription);
+        response["result"] = serviceManager.listUnits(subscription.type, subscription.resources);
+    }
+    else if (method == "unsubscribeUnits") {
+        unitSubscribers.remove(client);
+        response["result"] = QJsonObject{{"status", "success"}};
+    }
+    else if (method == "getResourcePressure") {
+        response["result"] = resourceSampler.snapshot();
+    }
     else if (method == "addUser") {
         auto p = request["params"].toObject();
         bool ok = userManager.addUser(p["username"].toString(), p["password"].toString());
@@ -119,15 +269,194 @@ void Server::onClientReadyRead() {
         bool ok = userManager.changePassword(p["username"].toString(), p["newPassword"].toString());
         response[ok ? "result" : "error"] = ok ? QJsonObject{{"status", "success"}} : QJsonObject{{"code", -32003}, {"message", "Failed to change password"}};
     }
+    else if (method == "applyUsers") {
+        // Пакет выполняется в фоне, ответ с тем же id уходит из onUsersApplied
+        auto p = request["params"].toObject();
+        if (!p["operations"].isArray()) {
+            response["error"] = QJsonObject{{"code", -32020}, {"message", "operations must be an array"}};
+        } else {
+            const quint64 requestId = userManager.applyUsers(p["operations"].toArray(), p["options"].toObject());
+            pendingUserBatches.insert(requestId, PendingReply{ client, id });
+            return;
+        }
+    }
     else if (method == "setFilePermissions") {
         auto p = request["params"].toObject();
-        bool ok = fileManager.setPermissions(p["filePath"].toString(), p["permissions"].toString());
-        response[ok ? "result" : "error"] = ok ? QJsonObject{{"status", "success"}} : QJsonObject{{"code", -32004}, {"message", "Failed to set permissions"}};
+        const QString path = p.contains("path") ? p["path"].toString() : p["filePath"].toString();
+        QString error;
+        if (p["recursive"].toBool()) {
+            // Обход идёт в фоне: прогресс и итог с ошибками приходят уведомлениями permissionsProgress
+            QJsonObject job = permissionEngine.startApply(path, p["permissions"].toString(), p, &error);
+            if (job.isEmpty()) {
+                response["error"] = QJsonObject{{"code", -32004}, {"message", "Failed to set permissions: " + error}};
+            } else {
+                permissionJobClients.insert(job["job_id"].toString().toULongLong(), client);
+                response["result"] = job;
+            }
+        } else if (fileManager.setPermissions(path, p["permissions"].toString(), &error)) {
+            response["result"] = QJsonObject{{"status", "success"}};
+        } else {
+            response["error"] = QJsonObject{{"code", -32004}, {"message", "Failed to set permissions: " + error}};
+        }
+    }
+    else if (method == "cancelPermissions") {
+        const quint64 jobId = request["params"].toObject()["job_id"].toString().toULongLong();
+        if (permissionJobClients.value(jobId) == client && permissionEngine.cancel(jobId)) response["result"] = QJsonObject{{"status", "cancelling"}};
+        else response["error"] = QJsonObject{{"code", -32014}, {"message", "No such permission job"}};
     }
     else if (method == "manageService") {
         auto p = request["params"].toObject();
-        bool ok = serviceManager.manageService(p["serviceName"].toString(), p["action"].toString());
-        response[ok ? "result" : "error"] = ok ? QJsonObject{{"status", "success"}} : QJsonObject{{"code", -32005}, {"message", "Failed to manage service"}};
+        const QString service = p.contains("serviceName") ? p["serviceName"].toString() : p["service"].toString();
+        // Ответ уходит сразу; итог задания systemd приходит уведомлениями serviceJobProgress
+        QString error;
+        QJsonObject job = serviceManager.startJob(QJsonObject{{"units", QJsonArray{service}}, {"action", p["action"].toString()}}, &error);
+        if (job.isEmpty()) {
+            response["error"] = QJsonObject{{"code", -32005}, {"message", "Failed to manage service: " + error}};
+        } else {
+            serviceJobClients.insert(job["job_id"].toString().toULongLong(), client);
+            job["status"] = "queued";
+            response["result"] = job;
+        }
+    }
+    else if (method == "startServiceJob") {
+        QString error;
+        const QJsonObject job = serviceManager.startJob(request["params"].toObject(), &error);
+        if (job.isEmpty()) {
+            response["error"] = QJsonObject{{"code", -32005}, {"message", "Failed to manage services: " + error}};
+        } else {
+            serviceJobClients.insert(job["job_id"].toString().toULongLong(), client);
+            response["result"] = job;
+        }
+    }
+    else if (method == "cancelServiceJob") {
+        const quint64 jobId = request["params"].toObject()["job_id"].toString().toULongLong();
+        if (serviceJobClients.value(jobId) == client && serviceManager.cancelJob(jobId)) response["result"] = QJsonObject{{"status", "cancelling"}};
+        else response["error"] = QJsonObject{{"code", -32021}, {"message", "No such service job"}};
+    }
+    else if (method == "getFileSignature") {
+        // Сигнатуры считаются в фоне, ответ с тем же id уходит из onFileSignatureReady
+        auto p = request["params"].toObject();
+        const quint64 requestId = deltaTransfer.requestSignature(p["remotePath"].toString(), p["block_size"].toInt());
+        pendingSignatures.insert(requestId, PendingReply{ client, id });
+        return;
+    }
+    else if (method == "beginDeltaUpload") {
+        QString error;
+        const QString session = deltaTransfer.beginUpload(client, request["params"].toObject(), &error);
+        if (!session.isEmpty()) response["result"] = QJsonObject{{"session", session}};
+        else response["error"] = QJsonObject{{"code", -32016}, {"message", "Delta upload failed: " + error}};
+    }
+    else if (method == "deltaChunk") {
+        auto p = request["params"].toObject();
+        QString error;
+        const qint64 written = deltaTransfer.applyChunk(client, p["session"].toString(),
+                                                        QByteArray::fromBase64(p["ops"].toString().toLatin1()), &error);
+        if (written >= 0) response["result"] = QJsonObject{{"written", written}};
+        else response["error"] = QJsonObject{{"code", -32016}, {"message", "Delta upload failed: " + error}};
+    }
+    else if (method == "finishDeltaUpload") {
+        auto p = request["params"].toObject();
+        QString error;
+        QJsonObject result = deltaTransfer.finishUpload(client, p["session"].toString(), qint64(p["size"].toDouble()),
+                                                        p["md5"].toString(), &error);
+        if (!result.isEmpty()) response["result"] = result;
+        else response["error"] = QJsonObject{{"code", -32016}, {"message", "Delta upload failed: " + error}};
+    }
+    else if (method == "downloadDirectory") {
+        // Архив уходит уведомлениями archiveData с номером передачи из ответа
+        auto p = request["params"].toObject();
+        QStringList include, exclude;
+        for (const QJsonValue& v : p["include"].toArray()) include.append(v.toString());
+        for (const QJsonValue& v : p["exclude"].toArray()) exclude.append(v.toString());
+        QString error;
+        const quint64 transferId = archiveTransfer.startDownload(client, p["remotePath"].toString(), include, exclude, &error);
+        if (transferId) response["result"] = QJsonObject{{"transfer", QString::number(transferId)}, {"compression", "zstd"}, {"format", "tar"}};
+        else response["error"] = QJsonObject{{"code", -32017}, {"message", "Archive transfer failed: " + error}};
+    }
+    else if (method == "cancelDirectoryDownload") {
+        const bool ok = archiveTransfer.cancelDownload(client, request["params"].toObject()["transfer"].toString().toULongLong());
+        if (ok) response["result"] = QJsonObject{{"status", "cancelled"}};
+        else response["error"] = QJsonObject{{"code", -32017}, {"message", "Archive transfer failed: no such transfer"}};
+    }
+    else if (method == "uploadDirectory") {
+        QString error;
+        const QString session = archiveTransfer.beginUpload(client, request["params"].toObject(), &error);
+        if (!session.isEmpty()) response["result"] = QJsonObject{{"session", session}, {"compression", "zstd"}, {"format", "tar"}};
+        else response["error"] = QJsonObject{{"code", -32017}, {"message", "Archive transfer failed: " + error}};
+    }
+    else if (method == "archiveChunk") {
+        auto p = request["params"].toObject();
+        QString error;
+        const qint64 written = archiveTransfer.applyChunk(client, p["session"].toString(),
+                                                          QByteArray::fromBase64(p["data"].toString().toLatin1()), &error);
+        if (written >= 0) response["result"] = QJsonObject{{"written", written}};
+        else response["error"] = QJsonObject{{"code", -32017}, {"message", "Archive transfer failed: " + error}};
+    }
+    else if (method == "finishDirectoryUpload") {
+        QString error;
+        QJsonObject result = archiveTransfer.finishUpload(client, request["params"].toObject()["session"].toString(), &error);
+        if (!result.isEmpty()) response["result"] = result;
+        else response["error"] = QJsonObject{{"code", -32017}, {"message", "Archive transfer failed: " + error}};
+    }
+    else if (method == "readFileRange") {
+        auto p = request["params"].toObject();
+        QString error;
+        QJsonObject result = fileManager.readRange(p["path"].toString(), qint64(p["offset"].toDouble()),
+                                                   qint64(p["length"].toDouble(64 * 1024)), &error);
+        if (!result.isEmpty()) response["result"] = result;
+        else response["error"] = QJsonObject{{"code", -32015}, {"message", "Cannot read file: " + error}};
+    }
+    else if (method == "tailFile") {
+        // Последние строки — сразу в ответе; при follow дописанное приходит уведомлениями fileTail
+        auto p = request["params"].toObject();
+        QString error;
+        QJsonObject result = fileTailer.tail(client, p["path"].toString(), p["lines"].toInt(100),
+                                             p["follow"].toBool(), &error);
+        if (!result.isEmpty()) response["result"] = result;
+        else response["error"] = QJsonObject{{"code", -32015}, {"message", "Cannot read file: " + error}};
+    }
+    else if (method == "stopTail") {
+        const bool ok = fileTailer.stop(client, request["params"].toObject()["subscription"].toString().toULongLong());
+        if (ok) response["result"] = QJsonObject{{"status", "success"}};
+        else response["error"] = QJsonObject{{"code", -32018}, {"message", "No such tail subscription"}};
+    }
+    else if (method == "readJournal") {
+        // Страница журнала; продолжение — тот же запрос с cursor из ответа
+        QString error;
+        QJsonObject result = journalReader.read(request["params"].toObject(), &error);
+        if (!result.isEmpty()) response["result"] = result;
+        else response["error"] = QJsonObject{{"code", -32022}, {"message", "Cannot read journal: " + error}};
+    }
+    else if (method == "followJournal") {
+        // Последние записи — сразу в ответе, новые приходят уведомлениями journalEntries
+        QString error;
+        QJsonObject result = journalReader.follow(client, request["params"].toObject(), &error);
+        if (!result.isEmpty()) response["result"] = result;
+        else response["error"] = QJsonObject{{"code", -32022}, {"message", "Cannot read journal: " + error}};
+    }
+    else if (method == "stopJournal") {
+        const bool ok = journalReader.stop(client, request["params"].toObject()["subscription"].toString().toULongLong());
+        if (ok) response["result"] = QJsonObject{{"status", "success"}};
+        else response["error"] = QJsonObject{{"code", -32022}, {"message", "No such journal subscription"}};
+    }
+    else if (method == "searchContent") {
+        // Совпадения приходят пачками в уведомлениях contentSearchResults, последнее — с done
+        auto p = request["params"].toObject();
+        QStringList paths;
+        for (const QJsonValue& value : p["paths"].toArray()) paths.append(value.toString());
+        QString error;
+        QJsonObject result = contentSearch.start(paths, p["pattern"].toString(), p["options"].toObject(), &error);
+        if (result.isEmpty()) {
+            response["error"] = QJsonObject{{"code", -32019}, {"message", "Content search failed: " + error}};
+        } else {
+            contentSearchClients.insert(result["search_id"].toString().toULongLong(), client);
+            response["result"] = result;
+        }
+    }
+    else if (method == "cancelContentSearch") {
+        const quint64 searchId = request["params"].toObject()["search_id"].toString().toULongLong();
+        if (contentSearchClients.value(searchId) == client && contentSearch.cancel(searchId)) response["result"] = QJsonObject{{"status", "cancelling"}};
+        else response["error"] = QJsonObject{{"code", -32019}, {"message", "Content search failed: no such search"}};
     }
     else if (method == "uploadFile") {
         auto p = request["params"].toObject();
@@ -161,6 +490,170 @@ void Server::onClientReadyRead() {
     sendJsonResponse(client, response);
 }
 
+void Server::onDirectorySizesProgress(quint64 scanId, const QJsonObject& snapshot) {
+    const QString path = snapshot["path"].toString();
+    const int depth = snapshot["depth"].toInt();
+    for (const SizeSubscriber& subscriber : directorySizeSubscribers.value(scanId)) {
+        if (subscriber.client && subscriber.path == path && subscriber.depth == depth) {
+            sendNotification(subscriber.client, "directorySizes", snapshot);
+        }
+    }
+}
+
+void Server::onDirectorySizesFinished(quint64 scanId, const QJsonObject& result) {
+    // finished приходит по разу на каждый срез обхода
+    auto it = directorySizeSubscribers.find(scanId);
+    if (it == directorySizeSubscribers.end()) return;
+    const QString path = result["path"].toString();
+    const int depth = result["depth"].toInt();
+    for (int i = it->size() - 1; i >= 0; --i) {
+        const SizeSubscriber& subscriber = it->at(i);
+        if (subscriber.path != path || subscriber.depth != depth) continue;
+        if (subscriber.client) sendNotification(subscriber.client, "directorySizes", result);
+        it->removeAt(i);
+    }
+    if (it->isEmpty()) directorySizeSubscribers.erase(it);
+}
+
+void Server::onFileSignatureReady(quint64 requestId, const QJsonObject& result) {
+    const PendingReply reply = pendingSignatures.take(requestId);
+    if (!reply.client) return;
+    QJsonObject response;
+    if (reply.id >= 0) response["id"] = reply.id;
+    if (result.contains("error")) {
+        response["error"] = QJsonObject{{"code", -32015}, {"message", "Cannot read file: " + result["error"].toString()}};
+    } else {
+        response["result"] = result;
+    }
+    sendJsonResponse(reply.client, response);
+}
+
+void Server::onArchiveData(QObject* owner, quint64 transferId, const QByteArray& data, bool done, const QJsonObject& status) {
+    auto* client = qobject_cast<QTcpSocket*>(owner);
+    if (!client) return;
+    QJsonObject params{{"transfer", QString::number(transferId)}, {"data", QString::fromLatin1(data.toBase64())}, {"done", done}};
+    if (done) params["status"] = status;
+    sendNotification(client, "archiveData", params);
+}
+
+void Server::onFileTailAppended(QObject* owner, const QJsonObject& params) {
+    if (auto* client = qobject_cast<QTcpSocket*>(owner)) sendNotification(client, "fileTail", params);
+}
+
+void Server::onJournalEntries(QObject* owner, const QJsonObject& params) {
+    if (auto* client = qobject_cast<QTcpSocket*>(owner)) sendNotification(client, "journalEntries", params);
+}
+
+void Server::onContentMatches(quint64 searchId, const QJsonObject& batch) {
+    if (QPointer<QTcpSocket> client = contentSearchClients.value(searchId)) sendNotification(client, "contentSearchResults", batch);
+}
+
+void Server::onContentSearchFinished(quint64 searchId, const QJsonObject& status) {
+    if (QPointer<QTcpSocket> client = contentSearchClients.take(searchId)) sendNotification(client, "contentSearchResults", status);
+}
+
+void Server::onUsersApplied(quint64 requestId, const QJsonObject& result) {
+    const PendingReply reply = pendingUserBatches.take(requestId);
+    if (!reply.client) return;
+    QJsonObject response;
+    if (reply.id >= 0) response["id"] = reply.id;
+    // Без items пакет не дошёл до операций (блокировка, чтение баз) — это ошибка
+    // запроса; отказ отдельных операций описан в самом результате
+    if (!result.contains("items")) {
+        response["error"] = QJsonObject{{"code", -32020}, {"message", "Cannot apply user changes: " + result["error"].toString()}};
+    } else {
+        response["result"] = result;
+    }
+    sendJsonResponse(reply.client, response);
+}
+
+void Server::onUnitsChanged(const QJsonArray& units, const QStringList& removed) {
+    // Каждый подписчик получает только юниты своего типа
+    for (auto it = unitSubscribers.cbegin(); it != unitSubscribers.cend(); ++it) {
+        const QString suffix = it.value().type.isEmpty() ? QString() : "." + it.value().type;
+        QJsonArray matching;
+        for (const QJsonValue& unit : units) {
+            QJsonObject object = unit.toObject();
+            if (!object["name"].toString().endsWith(suffix)) continue;
+            if (!it.value().resources) {
+                object.remove("usage");
+                object.remove("resources");
+            }
+            matching.append(object);
+        }
+        QJsonArray gone;
+        for (const QString& name : removed) {
+            if (name.endsWith(suffix)) gone.append(name);
+        }
+        if (!matching.isEmpty() || !gone.isEmpty()) {
+            sendNotification(it.key(), "unitsChanged", QJsonObject{{"units", matching}, {"removed", gone}});
+        }
+    }
+}
+
+void Server::onUnitUsageChanged(const QJsonObject& usage) {
+    for (auto it = unitSubscribers.cbegin(); it != unitSubscribers.cend(); ++it) {
+        if (!it.value().resources) continue;
+        const QString suffix = it.value().type.isEmpty() ? QString() : "." + it.value().type;
+        QJsonObject matching;
+        for (auto unit = usage.constBegin(); unit != usage.constEnd(); ++unit) {
+            if (unit.key().endsWith(suffix)) matching.insert(unit.key(), unit.value());
+        }
+        if (!matching.isEmpty()) sendNotification(it.key(), "unitUsage", QJsonObject{{"units", matching}});
+    }
+}
+
+void Server::onServiceJobProgress(quint64 jobId, const QJsonObject& status) {
+    if (QPointer<QTcpSocket> client = serviceJobClients.value(jobId)) sendNotification(client, "serviceJobProgress", status);
+}
+
+void Server::onServiceJobFinished(quint64 jobId, const QJsonObject& status) {
+    if (QPointer<QTcpSocket> client = serviceJobClients.take(jobId)) sendNotification(client, "serviceJobProgress", status);
+}
+
+void Server::onPermissionsProgress(quint64 jobId, const QJsonObject& status) {
+    if (QPointer<QTcpSocket> client = permissionJobClients.value(jobId)) sendNotification(client, "permissionsProgress", status);
+}
+
+void Server::onPermissionsFinished(quint64 jobId, const QJsonObject& status) {
+    if (QPointer<QTcpSocket> client = permissionJobClients.take(jobId)) sendNotification(client, "permissionsProgress", status);
+}
+
+// Пакет изменений каталога: к созданным и изменённым записям прикладываются
+// их атрибуты, чтобы клиент обновил строку без повторного листинга
+void Server::onDirectoryChanged(const QString& path, const QJsonArray& events, bool overflow) {
+    const QList<QObject*> subscribers = directoryWatcher.subscribers(path);
+    if (subscribers.isEmpty()) return;
+
+    QJsonArray enriched;
+    const QString prefix = path.endsWith('/') ? path : path + '/';
+    for (const QJsonValue& value : events) {
+        QJsonObject event = value.toObject();
+        const QJsonArray types = event["types"].toArray();
+        if (!(types.size() == 1 && types.first().toString() == "delete")) {
+            QJsonObject entry = fileManager.getEntryInfo(prefix + event["name"].toString());
+            if (!entry.isEmpty()) event["entry"] = entry;
+        }
+        enriched.append(event);
+    }
+
+    const QJsonObject params{{"path", path}, {"events", enriched}, {"overflow", overflow}};
+    for (QObject* subscriber : subscribers) {
+        if (auto* client = qobject_cast<QTcpSocket*>(subscriber)) sendNotification(client, "directoryChanged", params);
+    }
+}
+
+void Server::onDirectoryRemoved(const QString& path, const QList<QObject*>& subscribers) {
+    const QJsonObject params{{"path", path}, {"events", QJsonArray()}, {"removed", true}};
+    for (QObject* subscriber : subscribers) {
+        if (auto* client = qobject_cast<QTcpSocket*>(subscriber)) sendNotification(client, "directoryChanged", params);
+    }
+}
+
+void Server::sendNotification(QTcpSocket* client, const QString& method, const QJsonObject& params) {
+    sendJsonResponse(client, QJsonObject{{"method", method}, {"params", params}});
+}
+
 void Server::sendJsonResponse(QTcpSocket* client, const QJsonObject& response) {
     QJsonDocument doc(response);
     QByteArray payload = doc.toJson(QJsonDocument::Compact);
@@ -2,12 +2,26 @@
 #define SERVER_H
 
 #include <QTcpServer>
+#include <QTcpSocket>
 #include "networkdiscovery.h"
 #include "filemanager.h"
 #include "usermanager.h"
 #include "servicemanager.h"
 #include "systeminfo.h"
 #include "processmanager.h"
+#include "resourcesampler.h"
+#include "connectionmanager.h"
+#include "diskusagescanner.h"
+#include "directorywatcher.h"
+#include "fileindex.h"
+#include "idnamecache.h"
+#include "permissionengine.h"
+#include "deltatransfer.h"
+#include "archivetransfer.h"
+#include "filetailer.h"
+#include "contentsearch.h"
+#include "journalreader.h"
+#include <QPointer>
 
 class Server : public QTcpServer {
     Q_OBJECT
@@ -17,6 +31,8 @@ public:
 
     bool start(quint16 port);
     void startDiscovery(quint16 discoveryPort, quint16 tcpPort); // <--- Добавляем
+    bool enableProcessEvents(int reconcileIntervalMs);
+    void enableFileIndex(const QStringList& roots, int rescanIntervalSec);
 
 protected:
     void incomingConnection(qintptr socketDescriptor) override;
@@ -24,22 +40,80 @@ protected:
 private slots:
     void onClientReadyRead();
     void handleClientDisconnected();
+    void onDirectorySizesProgress(quint64 scanId, const QJsonObject& snapshot);
+    void onDirectorySizesFinished(quint64 scanId, const QJsonObject& result);
+    void onDirectoryChanged(const QString& path, const QJsonArray& events, bool overflow);
+    void onDirectoryRemoved(const QString& path, const QList<QObject*>& subscribers);
+    void onPermissionsProgress(quint64 jobId, const QJsonObject& status);
+    void onPermissionsFinished(quint64 jobId, const QJsonObject& status);
+    void onFileSignatureReady(quint64 requestId, const QJsonObject& result);
+    void onArchiveData(QObject* owner, quint64 transferId, const QByteArray& data, bool done, const QJsonObject& status);
+    void onFileTailAppended(QObject* owner, const QJsonObject& params);
+    void onJournalEntries(QObject* owner, const QJsonObject& params);
+    void onContentMatches(quint64 searchId, const QJsonObject& batch);
+    void onContentSearchFinished(quint64 searchId, const QJsonObject& status);
+    void onUsersApplied(quint64 requestId, const QJsonObject& result);
+    void onUnitsChanged(const QJsonArray& units, const QStringList& removed);
+    void onUnitUsageChanged(const QJsonObject& usage);
+    void onServiceJobProgress(quint64 jobId, const QJsonObject& status);
+    void onServiceJobFinished(quint64 jobId, const QJsonObject& status);
 
 private:
+    // Ответ на запрос, который готовится в фоне
+    struct PendingReply {
+        QPointer<QTcpSocket> client;
+        int id = -1;
+    };
+
+    // Подписчик размеров каталогов: получает срезы только своего (path, depth)
+    struct SizeSubscriber {
+        QPointer<QTcpSocket> client;
+        QString path;
+        int depth = 0;
+    };
+
+    // Подписка на таблицу юнитов: тип и нужны ли сводки ресурсов
+    struct UnitSubscription {
+        QString type;
+        bool resources = true;
+    };
+
+    void processRequest(QTcpSocket* client, const QByteArray& data);
     void sendJsonResponse(QTcpSocket* client, const QJsonObject& response);
+    // Уведомление без id: сервер сам присылает клиенту данные по подписке
+    void sendNotification(QTcpSocket* client, const QString& method, const QJsonObject& params);
     void handleUploadFile(QTcpSocket* client, const QJsonObject& params, int id);
     void handleDownloadFile(QTcpSocket* client, const QJsonObject& params, int id);
 
 
     NetworkDiscovery discovery;
+    IdNameCache idNames;
+    PermissionEngine permissionEngine;
+    ResourceSampler resourceSampler;
     FileManager fileManager;
     UserManager userManager;
     ServiceManager serviceManager;
     SystemInfo systemInfo;
     ProcessManager processManager;
+    ConnectionManager connectionManager;
+    DiskUsageScanner diskUsageScanner;
+    DirectoryWatcher directoryWatcher;
+    FileIndex fileIndex;
+    DeltaTransfer deltaTransfer;
+    ArchiveTransfer archiveTransfer;
+    FileTailer fileTailer;
+    ContentSearch contentSearch;
+    JournalReader journalReader;
 
     QMap<QTcpSocket*, QByteArray> clientBuffers;
     QMap<QTcpSocket*, quint32> clientBlockSizes;
+    QHash<quint64, QList<SizeSubscriber>> directorySizeSubscribers;        // scan id → клиенты
+    QHash<quint64, QPointer<QTcpSocket>> permissionJobClients;             // job id → клиент
+    QHash<quint64, PendingReply> pendingSignatures;                        // запрос сигнатур → ответ
+    QHash<quint64, QPointer<QTcpSocket>> contentSearchClients;             // search id → клиент
+    QHash<quint64, PendingReply> pendingUserBatches;                       // пакет учётных записей → ответ
+    QMap<QTcpSocket*, UnitSubscription> unitSubscribers;                   // подписчик unitsChanged → тип юнитов
+    QHash<quint64, QPointer<QTcpSocket>> serviceJobClients;                // задание над службами → клиент
 };
 
 #endif // SERVER_H
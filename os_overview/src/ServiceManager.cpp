@@ -1,44 +1,514 @@
 #include "servicemanager.h"
-#include <QProcess>
-#include <QJsonObject>
+#include "resourcesampler.h"
+#include <QDateTime>
+#include <QDBusArgument>
+#include <QDBusConnection>
+#include <QDBusPendingCallWatcher>
+#include <QDBusServiceWatcher>
+#include <QDebug>
+#include <QRegularExpression>
+
+static const QString kSystemdService = QStringLiteral("org.freedesktop.systemd1");
+static const QString kSystemdPath = QStringLiteral("/org/freedesktop/systemd1");
+static const QString kManagerInterface = QStringLiteral("org.freedesktop.systemd1.Manager");
+static const QString kUnitInterface = QStringLiteral("org.freedesktop.systemd1.Unit");
+static const QString kServiceInterface = QStringLiteral("org.freedesktop.systemd1.Service");
+static const QString kPropertiesInterface = QStringLiteral("org.freedesktop.DBus.Properties");
+static const QString kJobInterface = QStringLiteral("org.freedesktop.systemd1.Job");
+static const int kFlushIntervalMs = 250;
+static const int kCallTimeoutMs = 10000;
+static const int kMaxJobUnits = 1000;
+static const int kMaxConcurrency = 32;
+
+namespace {
+
+qint64 nowMs() {
+    return QDateTime::currentMSecsSinceEpoch();
+}
+
+QDBusMessage managerCall(const QString &method) {
+    return QDBusMessage::createMethodCall(kSystemdService, kSystemdPath, kManagerInterface, method);
+}
+
+// Unit.Job — структура (uo): номер задания и его объект; 0 — задания нет
+quint32 jobIdOf(const QVariant &value) {
+    if (!value.canConvert<QDBusArgument>()) return 0;
+    const QDBusArgument argument = value.value<QDBusArgument>();
+    quint32 id = 0;
+    QDBusObjectPath path;
+    argument.beginStructure();
+    argument >> id >> path;
+    argument.endStructure();
+    return id;
+}
+
+} // namespace
+
+ServiceManager::ServiceManager(QObject* parent) : QObject(parent) {
+    flushTimer.setSingleShot(true);
+    connect(&flushTimer, &QTimer::timeout, this, &ServiceManager::flushChanges);
+    // available выставит первый успешный ListUnits: systemd1 может не быть на шине
+    if (!connectBus()) {
+        busError = QDBusConnection::systemBus().lastError().message();
+        if (busError.isEmpty()) busError = "System bus is not connected";
+        qWarning() << "Service manager: system bus is not reachable, service list is empty:" << busError;
+    }
+}
 
-// Конструктор/деструктор без изменений
-ServiceManager::ServiceManager(QObject* parent) : QObject(parent) { }
 ServiceManager::~ServiceManager() { }
 
-// Возвращает массив служб (каждый объект содержит: name, load, active, sub, description)
+void ServiceManager::setResourceSampler(const ResourceSampler* sampler) {
+    if (resourceSampler) disconnect(resourceSampler, nullptr, this, nullptr);
+    resourceSampler = sampler;
+    lastUsage.clear();
+    if (resourceSampler) connect(resourceSampler, &ResourceSampler::sampled, this, &ServiceManager::onResourcesSampled);
+}
+
+void ServiceManager::onResourcesSampled() {
+    QJsonObject changedUsage;
+    QHash<QString, QJsonObject> current;
+    for (const Unit &unit : units) {
+        const QJsonObject usage = resourceSampler->unitUsage(unit.name);
+        if (usage.isEmpty()) continue;
+        current.insert(unit.name, usage);
+        if (lastUsage.value(unit.name) != usage) changedUsage[unit.name] = usage;
+    }
+    lastUsage.swap(current);
+    if (!changedUsage.isEmpty()) emit usageChanged(changedUsage);
+}
+
+bool ServiceManager::connectBus() {
+    QDBusConnection bus = QDBusConnection::systemBus();
+    if (!bus.isConnected()) return false;
+
+    bus.connect(kSystemdService, kSystemdPath, kManagerInterface, "UnitNew",
+                this, SLOT(onUnitNew(QString,QDBusObjectPath)));
+    bus.connect(kSystemdService, kSystemdPath, kManagerInterface, "UnitRemoved",
+                this, SLOT(onUnitRemoved(QString,QDBusObjectPath)));
+    bus.connect(kSystemdService, kSystemdPath, kManagerInterface, "Reloading",
+                this, SLOT(onReloading(bool)));
+    bus.connect(kSystemdService, kSystemdPath, kManagerInterface, "JobRemoved",
+                this, SLOT(onJobRemoved(uint,QDBusObjectPath,QString,QString)));
+    // Пустой путь — сигнал от объекта любого юнита; путь берётся из сообщения
+    bus.connect(kSystemdService, QString(), kPropertiesInterface, "PropertiesChanged",
+                this, SLOT(onPropertiesChanged(QDBusMessage)));
+
+    // После перезапуска systemd (daemon-reexec) подписку и таблицу надо восстановить
+    systemdWatcher = new QDBusServiceWatcher(kSystemdService, bus, QDBusServiceWatcher::WatchForRegistration, this);
+    connect(systemdWatcher, &QDBusServiceWatcher::serviceRegistered, this, &ServiceManager::onSystemdRegistered);
+
+    subscribe();
+    reloadUnits();
+    return true;
+}
+
+// Без Subscribe systemd не рассылает UnitNew/UnitRemoved и изменения свойств
+void ServiceManager::subscribe() {
+    QDBusConnection::systemBus().asyncCall(managerCall("Subscribe"));
+}
+
+void ServiceManager::onSystemdRegistered() {
+    // Задания прежнего экземпляра systemd уже не завершатся сигналом JobRemoved
+    const auto pending = unitBySystemdJob.values();
+    for (const auto &entry : pending) finishUnit(entry.first, entry.second, "failed", QString(), "systemd restarted");
+    subscribe();
+    reloadUnits();
+}
+
+void ServiceManager::reloadUnits() {
+    auto *watcher = new QDBusPendingCallWatcher(QDBusConnection::systemBus().asyncCall(managerCall("ListUnits"), kCallTimeoutMs), this);
+    connect(watcher, &QDBusPendingCallWatcher::finished, this, [this](QDBusPendingCallWatcher *w) { onUnitsListed(w, true); });
+}
+
+void ServiceManager::requestUnits(const QStringList &names) {
+    QDBusMessage call = managerCall("ListUnitsByNames");
+    call << names;
+    auto *watcher = new QDBusPendingCallWatcher(QDBusConnection::systemBus().asyncCall(call, kCallTimeoutMs), this);
+    connect(watcher, &QDBusPendingCallWatcher::finished, this, [this](QDBusPendingCallWatcher *w) { onUnitsListed(w, false); });
+}
+
+// Ответ ListUnits/ListUnitsByNames: a(ssssssouso). full — полный список,
+// юниты, которых в нём нет, выгружены.
+void ServiceManager::onUnitsListed(QDBusPendingCallWatcher *watcher, bool full) {
+    watcher->deleteLater();
+    const QDBusMessage reply = watcher->reply();
+    if (reply.type() != QDBusMessage::ReplyMessage || reply.arguments().isEmpty()) {
+        qWarning() << "Service manager: listing units failed:" << reply.errorMessage();
+        // Повтор — по регистрации org.freedesktop.systemd1 (onSystemdRegistered)
+        if (full && !available) busError = reply.errorName() + ": " + reply.errorMessage();
+        return;
+    }
+    if (full && !available) {
+        available = true;
+        busError.clear();
+    }
+
+    QSet<QString> seen;
+    const QDBusArgument argument = reply.arguments().first().value<QDBusArgument>();
+    argument.beginArray();
+    while (!argument.atEnd()) {
+        QString name, description, load, active, sub, following, jobType;
+        QDBusObjectPath unitPath, jobPath;
+        quint32 jobId = 0;
+        argument.beginStructure();
+        argument >> name >> description >> load >> active >> sub >> following >> unitPath >> jobId >> jobType >> jobPath;
+        argument.endStructure();
+        seen.insert(name);
+
+        const bool isNew = !units.contains(name);
+        Unit &unit = units[name];
+        unit.name = name;
+        unit.description = description;
+        unit.load = load;
+        unit.active = active;
+        unit.sub = sub;
+        unit.following = following;
+        unit.path = unitPath.path();
+        unit.jobId = jobId;
+        unit.jobType = jobId ? jobType : QString();
+        nameByPath.insert(unit.path, name);
+        markChanged(name);
+        if (isNew && load == "loaded") requestProperties(name, unit.path);
+    }
+    argument.endArray();
+
+    if (!full) return;
+    for (auto it = units.begin(); it != units.end();) {
+        if (seen.contains(it.key())) {
+            ++it;
+            continue;
+        }
+        nameByPath.remove(it->path);
+        changed.remove(it.key());
+        removed.insert(it.key());
+        it = units.erase(it);
+    }
+    if (!flushTimer.isActive()) flushTimer.start(kFlushIntervalMs);
+}
+
+// Свойства, которых нет в ListUnits. Запросы асинхронные и уходят разом,
+// ответы разбираются по мере прихода.
+void ServiceManager::requestProperties(const QString &name, const QString &path) {
+    QStringList interfaces{kUnitInterface};
+    if (name.endsWith(".service")) interfaces << kServiceInterface;
+    for (const QString &interface : interfaces) {
+        QDBusMessage call = QDBusMessage::createMethodCall(kSystemdService, path, kPropertiesInterface, "GetAll");
+        call << interface;
+        auto *watcher = new QDBusPendingCallWatcher(QDBusConnection::systemBus().asyncCall(call, kCallTimeoutMs), this);
+        connect(watcher, &QDBusPendingCallWatcher::finished, this, [this, name](QDBusPendingCallWatcher *w) {
+            w->deleteLater();
+            const QDBusMessage reply = w->reply();
+            auto it = units.find(name);
+            if (reply.type() != QDBusMessage::ReplyMessage || reply.arguments().isEmpty() || it == units.end()) return;
+            const QVariantMap properties = qdbus_cast<QVariantMap>(reply.arguments().first());
+            for (auto p = properties.cbegin(); p != properties.cend(); ++p) applyProperty(*it, p.key(), p.value());
+            markChanged(name);
+        });
+    }
+}
+
+void ServiceManager::applyProperty(Unit &unit, const QString &property, const QVariant &value) {
+    if      (property == "Description")          unit.description = value.toString();
+    else if (property == "LoadState")            unit.load = value.toString();
+    else if (property == "ActiveState")          unit.active = value.toString();
+    else if (property == "SubState")             unit.sub = value.toString();
+    else if (property == "Following")            unit.following = value.toString();
+    else if (property == "UnitFileState")        unit.unitFileState = value.toString();
+    else if (property == "FragmentPath")         unit.fragmentPath = value.toString();
+    else if (property == "ActiveEnterTimestamp") unit.activeEnterUs = value.toULongLong();
+    else if (property == "MainPID")              unit.mainPid = value.toUInt();
+    else if (property == "NRestarts")            unit.restarts = value.toUInt();
+    else if (property == "Result")               unit.result = value.toString();
+    else if (property == "Job") {
+        // Тип задания в свойстве не передаётся — его вернёт ListUnitsByNames
+        unit.jobId = jobIdOf(value);
+        if (!unit.jobId) unit.jobType.clear();
+        else pendingNew.insert(unit.name);
+    }
+}
+
+void ServiceManager::onUnitNew(const QString &name, const QDBusObjectPath &path) {
+    nameByPath.insert(path.path(), name);
+    pendingNew.insert(name);
+    if (!flushTimer.isActive()) flushTimer.start(kFlushIntervalMs);
+}
+
+void ServiceManager::onUnitRemoved(const QString &name, const QDBusObjectPath &path) {
+    nameByPath.remove(path.path());
+    pendingNew.remove(name);
+    if (units.remove(name) == 0) return;
+    changed.remove(name);
+    removed.insert(name);
+    if (!flushTimer.isActive()) flushTimer.start(kFlushIntervalMs);
+}
+
+// PropertiesChanged(s interface, a{sv} changed, as invalidated)
+void ServiceManager::onPropertiesChanged(const QDBusMessage &message) {
+    const QList<QVariant> arguments = message.arguments();
+    if (arguments.size() < 3) return;
+    const QString interface = arguments[0].toString();
+    if (interface != kUnitInterface && interface != kServiceInterface) return;
+    const QString name = nameByPath.value(message.path());
+    auto it = units.find(name);
+    if (name.isEmpty() || it == units.end()) return;
+
+    const QVariantMap properties = qdbus_cast<QVariantMap>(arguments[1]);
+    for (auto p = properties.cbegin(); p != properties.cend(); ++p) applyProperty(*it, p.key(), p.value());
+    // Свойства, переданные без значения, перечитываются целиком
+    if (!arguments[2].toStringList().isEmpty()) requestProperties(name, it->path);
+    markChanged(name);
+}
+
+void ServiceManager::onReloading(bool active) {
+    // После daemon-reload юниты могли появиться, исчезнуть или сменить описание
+    if (!active) reloadUnits();
+}
+
+void ServiceManager::markChanged(const QString &name) {
+    removed.remove(name);
+    changed.insert(name);
+    if (!flushTimer.isActive()) flushTimer.start(kFlushIntervalMs);
+}
+
+void ServiceManager::flushChanges() {
+    if (!pendingNew.isEmpty()) {
+        requestUnits(pendingNew.values());
+        pendingNew.clear();
+    }
+    if (changed.isEmpty() && removed.isEmpty()) return;
+    ++generation;
+    QJsonArray changedUnits;
+    for (const QString &name : changed) {
+        auto it = units.constFind(name);
+        if (it != units.cend()) changedUnits.append(toJson(*it));
+    }
+    const QStringList removedNames = removed.values();
+    changed.clear();
+    removed.clear();
+    emit unitsChanged(changedUnits, removedNames);
+}
+
+QJsonObject ServiceManager::toJson(const Unit &unit, bool withResources) const {
+    QJsonObject object;
+    object["name"] = unit.name;
+    object["load"] = unit.load;
+    object["active"] = unit.active;
+    object["sub"] = unit.sub;
+    object["description"] = unit.description;
+    if (!unit.following.isEmpty()) object["following"] = unit.following;
+    if (unit.jobId) object["job"] = QJsonObject{{"id", qint64(unit.jobId)}, {"type", unit.jobType}};
+    if (!unit.unitFileState.isEmpty()) object["unit_file_state"] = unit.unitFileState;
+    if (!unit.fragmentPath.isEmpty()) object["fragment_path"] = unit.fragmentPath;
+    if (unit.activeEnterUs) {
+        object["active_since"] = QDateTime::fromMSecsSinceEpoch(qint64(unit.activeEnterUs / 1000)).toString(Qt::ISODate);
+    }
+    if (unit.name.endsWith(".service")) {
+        if (unit.mainPid) object["main_pid"] = qint64(unit.mainPid);
+        object["restarts"] = qint64(unit.restarts);
+        if (!unit.result.isEmpty()) object["result"] = unit.result;
+    }
+    if (withResources && resourceSampler) {
+        // PSI и счётчики cgroup юнита из последнего фонового снимка
+        QJsonObject resources = resourceSampler->unitResources(unit.name);
+        if (!resources.isEmpty()) {
+            object["usage"] = resources.take("usage");
+            object["resources"] = resources;
+        }
+    }
+    return object;
+}
+
+// Возвращает массив служб (каждый объект содержит: name, load, active, sub, description,
+// restarts и сводку ресурсов cgroup usage)
 QJsonArray ServiceManager::getServices() const {
     QJsonArray services;
-    QProcess process;
-    process.start("systemctl", { "list-units", "--type=service", "--all", "--no-pager", "--no-legend" });
-    process.waitForFinished();
+    for (const Unit &unit : units) {
+        if (unit.name.endsWith(".service")) services.append(toJson(unit));
+    }
+    return services;
+}
+
+QJsonObject ServiceManager::listUnits(const QString &type, bool withResources) const {
+    const QString suffix = type.isEmpty() ? QString() : "." + type;
+    QJsonArray list;
+    for (const Unit &unit : units) {
+        if (suffix.isEmpty() || unit.name.endsWith(suffix)) list.append(toJson(unit, withResources));
+    }
+    QJsonObject result{{"units", list}, {"available", available}, {"generation", QString::number(generation)}};
+    if (!available && !busError.isEmpty()) result["error"] = busError;
+    return result;
+}
+
+QJsonObject ServiceManager::startJob(const QJsonObject &params, QString *error) {
+    static const QHash<QString, QString> methods{
+        {"start", "StartUnit"}, {"stop", "StopUnit"}, {"restart", "RestartUnit"}, {"reload", "ReloadUnit"}};
+    const QString action = params["action"].toString();
+    if (!methods.contains(action)) {
+        if (error) *error = "Unknown action: " + action;
+        return QJsonObject();
+    }
+    if (!available) {
+        if (error) *error = busError.isEmpty() ? QString("systemd is not available") : "systemd is not available: " + busError;
+        return QJsonObject();
+    }
+
+    QStringList names;
+    if (params.contains("pattern")) {
+        // Как systemctl: шаблон без суффикса относится к службам
+        QString pattern = params["pattern"].toString();
+        if (!pattern.contains('.')) pattern += ".service";
+        const QRegularExpression re(QRegularExpression::anchoredPattern(QRegularExpression::wildcardToRegularExpression(pattern)));
+        for (const Unit &unit : units) {
+            if (unit.load == "loaded" && re.match(unit.name).hasMatch()) names << unit.name;
+        }
+        names.sort();
+    }
+    for (const QJsonValue &value : params["units"].toArray()) {
+        const QString name = value.toString();
+        if (name.isEmpty()) continue;
+        const QString unit = name.contains('.') ? name : name + ".service";
+        if (!names.contains(unit)) names << unit;
+    }
+    if (names.isEmpty()) {
+        if (error) *error = "No units match";
+        return QJsonObject();
+    }
+    if (names.size() > kMaxJobUnits) {
+        if (error) *error = QString("Too many units (limit %1)").arg(kMaxJobUnits);
+        return QJsonObject();
+    }
 
-    QString output = process.readAllStandardOutput();
-    QStringList lines = output.split('\n', Qt::SkipEmptyParts);
+    Job job;
+    job.id = nextJobId++;
+    job.action = action;
+    job.method = methods.value(action);
+    job.concurrency = qBound(1, params["concurrency"].toInt(1), kMaxConcurrency);
+    job.stopOnFailure = params["stop_on_failure"].toBool(false);
+    job.startedMs = nowMs();
+    for (const QString &name : names) {
+        JobUnit unit;
+        unit.name = name;
+        job.units.append(unit);
+    }
+    jobs.insert(job.id, job);
+    launchJobs(job.id);
 
-    for (const QString& line : lines) {
-        QStringList parts = line.split(' ', Qt::SkipEmptyParts);
-        if (parts.size() < 5) continue;
+    return QJsonObject{{"job_id", QString::number(job.id)}, {"action", action},
+                       {"units", QJsonArray::fromStringList(names)}, {"total", names.size()}};
+}
 
-        QJsonObject service;
-        service["name"] = parts[0];
-        service["load"] = parts[1];
-        service["active"] = parts[2];
-        service["sub"] = parts[3];
-        service["description"] = parts.mid(4).join(' ');
+// Отдаёт systemd следующие юниты, пока не занято concurrency мест. Вызов
+// асинхронный: ответ означает, что задание в очереди systemd, а его итог
+// приходит сигналом JobRemoved. systemd отправляет ответ раньше сигнала,
+// а порядок сообщений одного отправителя шина сохраняет.
+void ServiceManager::launchJobs(quint64 jobId) {
+    auto it = jobs.find(jobId);
+    if (it == jobs.end()) return;
+    Job &job = *it;
+    while (!job.cancelled && job.running < job.concurrency && job.next < job.units.size()) {
+        const int index = job.next++;
+        JobUnit &unit = job.units[index];
+        unit.state = "running";
+        ++job.running;
 
-        services.append(service);
+        QDBusMessage call = managerCall(job.method);
+        call << unit.name << QString("replace");
+        auto *watcher = new QDBusPendingCallWatcher(QDBusConnection::systemBus().asyncCall(call, kCallTimeoutMs), this);
+        connect(watcher, &QDBusPendingCallWatcher::finished, this, [this, jobId, index](QDBusPendingCallWatcher *w) {
+            w->deleteLater();
+            const QDBusMessage reply = w->reply();
+            auto found = jobs.find(jobId);
+            if (found == jobs.end()) return;
+            if (reply.type() != QDBusMessage::ReplyMessage || reply.arguments().isEmpty()) {
+                finishUnit(jobId, index, "failed", QString(), reply.errorMessage());
+                return;
+            }
+            const QString path = reply.arguments().first().value<QDBusObjectPath>().path();
+            found->units[index].systemdJob = path;
+            unitBySystemdJob.insert(path, qMakePair(jobId, index));
+            if (found->cancelled) cancelSystemdJob(path);
+            emit jobProgress(jobId, jobStatus(*found));
+        });
     }
-    return services;
+    emit jobProgress(jobId, jobStatus(job));
+    if (job.running > 0 || (!job.cancelled && job.next < job.units.size())) return;
+
+    // Всё, что так и не было запущено, отменено
+    for (JobUnit &unit : job.units) {
+        if (unit.state == "queued") unit.state = "cancelled";
+    }
+    QJsonObject status = jobStatus(job);
+    status["done"] = true;
+    status["cancelled"] = job.cancelled;
+    jobs.erase(it);
+    emit jobFinished(jobId, status);
+}
+
+void ServiceManager::finishUnit(quint64 jobId, int index, const QString &state, const QString &result, const QString &error) {
+    auto it = jobs.find(jobId);
+    if (it == jobs.end() || index >= it->units.size()) return;
+    JobUnit &unit = it->units[index];
+    if (unit.state != "running") return;
+    if (!unit.systemdJob.isEmpty()) unitBySystemdJob.remove(unit.systemdJob);
+    unit.systemdJob.clear();
+    unit.state = state;
+    unit.result = result;
+    unit.error = error;
+    --it->running;
+    if (state == "failed" && it->stopOnFailure) it->cancelled = true;
+    launchJobs(jobId);
 }
 
-bool ServiceManager::manageService(const QString& service, const QString& action) {
-    QProcess process;
-    if      (action == "start")   process.start("systemctl", { "start", service });
-    else if (action == "stop")    process.start("systemctl", { "stop", service });
-    else if (action == "restart") process.start("systemctl", { "restart", service });
-    else                          return false;
+// JobRemoved приходит по каждому заданию systemd, в том числе чужому
+void ServiceManager::onJobRemoved(uint id, const QDBusObjectPath &job, const QString &unit, const QString &result) {
+    Q_UNUSED(id);
+    Q_UNUSED(unit);
+    const auto entry = unitBySystemdJob.value(job.path(), qMakePair(quint64(0), -1));
+    if (entry.second < 0) return;
+    // skipped — например, reload неактивной службы: делать было нечего, это не ошибка
+    QString state = "failed";
+    if (result == "done" || result == "skipped") state = "done";
+    else if (result == "canceled") state = "cancelled";
+    finishUnit(entry.first, entry.second, state, result, QString());
+}
 
-    process.waitForFinished();
-    return process.exitCode() == 0;
+void ServiceManager::cancelSystemdJob(const QString &path) {
+    QDBusConnection::systemBus().asyncCall(QDBusMessage::createMethodCall(kSystemdService, path, kJobInterface, "Cancel"));
+}
+
+bool ServiceManager::cancelJob(quint64 jobId) {
+    auto it = jobs.find(jobId);
+    if (it == jobs.end()) return false;
+    it->cancelled = true;
+    for (const JobUnit &unit : it->units) {
+        if (!unit.systemdJob.isEmpty()) cancelSystemdJob(unit.systemdJob);
+    }
+    // Ответы на ещё не подтверждённые вызовы отменят свои задания сами
+    launchJobs(jobId);
+    return true;
+}
+
+QJsonObject ServiceManager::jobStatus(const Job &job) const {
+    QJsonObject counts{{"queued", 0}, {"running", 0}, {"done", 0}, {"failed", 0}, {"cancelled", 0}};
+    QJsonArray list;
+    for (const JobUnit &unit : job.units) {
+        counts[unit.state] = counts[unit.state].toInt() + 1;
+        QJsonObject item{{"name", unit.name}, {"state", unit.state}};
+        if (!unit.result.isEmpty()) item["result"] = unit.result;
+        if (!unit.error.isEmpty()) item["error"] = unit.error;
+        list.append(item);
+    }
+    return QJsonObject{
+        {"job_id", QString::number(job.id)},
+        {"action", job.action},
+        {"total", job.units.size()},
+        {"queued", counts["queued"]},
+        {"running", counts["running"]},
+        {"succeeded", counts["done"]},
+        {"failed", counts["failed"]},
+        {"cancelled", counts["cancelled"]},
+        {"units", list},
+        {"done", false},
+        {"elapsed_ms", nowMs() - job.startedMs}
+    };
 }
@@ -2,8 +2,25 @@
 #define SERVICEMANAGER_H
 
 #include <QObject>
+#include <QDBusMessage>
+#include <QDBusObjectPath>
 #include <QJsonArray>
+#include <QJsonObject>
+#include <QHash>
+#include <QSet>
+#include <QStringList>
+#include <QTimer>
+#include <QVector>
 
+class QDBusPendingCallWatcher;
+class QDBusServiceWatcher;
+class ResourceSampler;
+
+// Службы берутся у systemd по D-Bus (org.freedesktop.systemd1), а не из
+// вывода systemctl. Таблица юнитов загружается один раз ListUnits и дальше
+// поддерживается сигналами UnitNew/UnitRemoved/PropertiesChanged, так что
+// запрос списка — чтение готовой таблицы. Изменения копятся и рассылаются
+// подписчикам пачкой не чаще раза в 250 мс.
 class ServiceManager : public QObject
 {
     Q_OBJECT
@@ -11,8 +28,118 @@ public:
     explicit ServiceManager(QObject *parent = nullptr);
     ~ServiceManager();
 
+    // Только .service: [{name, load, active, sub, description, restarts, usage, ...}]
     QJsonArray getServices() const;
-    bool manageService(const QString &service, const QString &action);
+    // type — суффикс юнита (service, timer, socket, ...); пустой — все.
+    // withResources — добавить к юнитам usage и resources из cgroup.
+    // Ответ: {units, available, generation}; пока systemd недоступен — ещё
+    // error с текстом ошибки D-Bus
+    QJsonObject listUnits(const QString &type, bool withResources = true) const;
+    // Действие над набором юнитов. params: units (имена; без суффикса — .service)
+    // или pattern (glob по загруженным юнитам), action (start | stop | restart |
+    // reload), concurrency — сколько заданий systemd выполняется одновременно
+    // (по умолчанию 1: поочерёдный перезапуск), stop_on_failure — после первой
+    // ошибки оставшиеся юниты не трогать. Возвращается сразу: {job_id, action,
+    // units, total}; пустой объект — ошибка, текст в error.
+    QJsonObject startJob(const QJsonObject &params, QString *error = nullptr);
+    // Очередь больше не запускается, выполняющиеся задания systemd отменяются
+    bool cancelJob(quint64 jobId);
+
+    void setResourceSampler(const ResourceSampler *sampler);
+
+signals:
+    // units — новые и изменившиеся юниты целиком, removed — имена выгруженных
+    void unitsChanged(const QJsonArray &units, const QStringList &removed);
+    // После каждого прохода ResourceSampler: {имя юнита: usage} только для
+    // загруженных юнитов, чья сводка изменилась с прошлого раза
+    void usageChanged(const QJsonObject &usage);
+    // Состояние юнитов задания: {job_id, total, queued, running, succeeded, failed,
+    // cancelled, units: [{name, state, result, error}], elapsed_ms}
+    void jobProgress(quint64 jobId, const QJsonObject &status);
+    void jobFinished(quint64 jobId, const QJsonObject &status);
+
+private slots:
+    void onUnitNew(const QString &name, const QDBusObjectPath &path);
+    void onUnitRemoved(const QString &name, const QDBusObjectPath &path);
+    void onPropertiesChanged(const QDBusMessage &message);
+    void onReloading(bool active);
+    void onJobRemoved(uint id, const QDBusObjectPath &job, const QString &unit, const QString &result);
+    void onSystemdRegistered();
+    void flushChanges();
+    void onResourcesSampled();
+
+private:
+    struct Unit {
+        QString name;
+        QString description;
+        QString load;
+        QString active;
+        QString sub;
+        QString following;
+        QString path;
+        QString jobType;
+        quint32 jobId = 0;
+        // Дополнительные свойства, догружаются GetAll после ListUnits
+        QString unitFileState;
+        QString fragmentPath;
+        quint64 activeEnterUs = 0;
+        quint32 mainPid = 0;
+        quint32 restarts = 0;
+        QString result;
+    };
+
+    // Юнит в задании: queued → running → done | failed | cancelled
+    struct JobUnit {
+        QString name;
+        QString state = "queued";
+        QString result;              // результат задания systemd: done, failed, timeout, dependency, ...
+        QString error;
+        QString systemdJob;          // объектный путь задания, пока оно выполняется
+    };
+
+    struct Job {
+        quint64 id = 0;
+        QString action;
+        QString method;              // StartUnit, StopUnit, ...
+        int concurrency = 1;
+        bool stopOnFailure = false;
+        bool cancelled = false;
+        int next = 0;                // первый юнит, ещё не отданный systemd
+        int running = 0;
+        QVector<JobUnit> units;
+        qint64 startedMs = 0;
+    };
+
+    bool connectBus();
+    void subscribe();
+    void reloadUnits();
+    void requestUnits(const QStringList &names);
+    void onUnitsListed(QDBusPendingCallWatcher *watcher, bool full);
+    void requestProperties(const QString &name, const QString &path);
+    void applyProperty(Unit &unit, const QString &property, const QVariant &value);
+    void markChanged(const QString &name);
+    QJsonObject toJson(const Unit &unit, bool withResources = true) const;
+    void launchJobs(quint64 jobId);
+    void finishUnit(quint64 jobId, int index, const QString &state, const QString &result, const QString &error);
+    void cancelSystemdJob(const QString &path);
+    QJsonObject jobStatus(const Job &job) const;
+
+    const ResourceSampler *resourceSampler = nullptr;
+    QHash<QString, QJsonObject> lastUsage;   // уже разосланные сводки ресурсов
+    bool available = false;               // первый ListUnits прошёл успешно
+    QString busError;                     // почему systemd недоступен
+    quint64 generation = 0;
+    QHash<QString, Unit> units;
+    QHash<QString, QString> nameByPath;   // объектный путь → имя юнита
+    QSet<QString> changed;
+    QSet<QString> removed;
+    QSet<QString> pendingNew;             // UnitNew, ещё не прочитанные ListUnitsByNames
+    QTimer flushTimer;
+
+    QHash<quint64, Job> jobs;
+    QHash<QString, QPair<quint64, int>> unitBySystemdJob;   // путь задания systemd → (задание, юнит)
+    quint64 nextJobId = 1;
+    QDBusServiceWatcher *systemdWatcher = nullptr;
 };
 
 #endif // SERVICEMANAGER_H
@@ -1,4 +1,6 @@
 #include "systeminfo.h"
+#include "resourcesampler.h"
+#include "procfs.h"
 #include <QFile>
 #include <QTextStream>
 #include <QJsonArray>
@@ -6,23 +8,89 @@
 #include <QProcess>
 #include <QDateTime>
 #include <QDir>
+#include <QDeadlineTimer>
+#include <QDebug>
 
-SystemInfo::SystemInfo(QObject* parent) : QObject(parent) { }
-SystemInfo::~SystemInfo() { }
+static const int kShutdownTimeoutMs = 3000;
+
+SystemInfo::SystemInfo(QObject* parent)
+    : QObject(parent), shared(std::make_shared<Shared>()), pool(new QThreadPool)
+{
+    collectors = {
+        { "os_name",           [this] { return QJsonValue(getOSInfo()); } },
+        { "cpu_model",         [this] { return QJsonValue(getCpuInfo()); } },
+        { "cpu_cores",         [this] { return QJsonValue(getCpuCores()); } },
+        { "cpu_load",          [this] { return QJsonValue(getCpuLoad()); } },
+        { "cpu_load_per_core", [this] { return QJsonValue(getCpuLoadPerCore()); } },
+        { "memory",            [this] { return QJsonValue(getMemoryInfo()); } },
+        { "disks",             [this] { return QJsonValue(getDiskInfo()); } },
+        { "temperature",       [this] { return QJsonValue(getTemperatureInfo()); } },
+        { "uptime",            [this] { return QJsonValue(getUptime()); } },
+        { "peripherals",       [this] { return QJsonValue(getPeripheralDevices()); } },
+        { "disk_io",           [this] { return QJsonValue(getDiskIo()); } },
+        { "pressure",          [this] { return QJsonValue(resourceSampler ? resourceSampler->systemPressure() : QJsonObject()); } },
+    };
+    // По потоку на сборщик: зависший df не должен занимать место остальных
+    pool->setMaxThreadCount(collectors.size());
+    // Потоки не завершаются, чтобы их thread_local буферы procfs жили между запросами
+    pool->setExpiryTimeout(-1);
+}
+
+SystemInfo::~SystemInfo() {
+    // Деструктор QThreadPool ждёт задачи без срока, поэтому зависший пул не удаляем
+    if (pool->waitForDone(kShutdownTimeoutMs)) delete pool;
+    else qWarning() << "System info: collectors did not finish in" << kShutdownTimeoutMs << "ms, abandoning them";
+}
+
+void SystemInfo::setResourceSampler(const ResourceSampler* sampler) {
+    resourceSampler = sampler;
+}
+
+QJsonObject SystemInfo::collectSystemInfo(int timeoutMs) const {
+    QDeadlineTimer deadline(timeoutMs);
+    QHash<QString, quint64> startGenerations;
+
+    QMutexLocker locker(&shared->mutex);
+    for (const auto& collector : collectors) {
+        CollectorState& state = shared->states[collector.first];
+        startGenerations[collector.first] = state.generation;
+        if (state.running) continue; // результат предыдущего запуска ещё в пути
+
+        state.running = true;
+        const QString key = collector.first;
+        const auto fn = collector.second;
+        const std::shared_ptr<Shared> target = shared;
+        pool->start([target, key, fn] {
+            QJsonValue value = fn();
+            QMutexLocker done(&target->mutex);
+            CollectorState& s = target->states[key];
+            s.value = value;
+            s.generation++;
+            s.running = false;
+            target->changed.wakeAll();
+        });
+    }
+
+    auto allFresh = [&] {
+        for (auto it = startGenerations.cbegin(); it != startGenerations.cend(); ++it) {
+            if (shared->states.value(it.key()).generation == it.value()) return false;
+        }
+        return true;
+    };
+    while (!allFresh()) {
+        if (!shared->changed.wait(&shared->mutex, deadline)) break;
+    }
 
-QJsonObject SystemInfo::collectSystemInfo() const {
     QJsonObject info;
+    QJsonArray stale;
+    for (const auto& collector : collectors) {
+        const CollectorState& state = shared->states[collector.first];
+        info[collector.first] = state.value;
+        if (state.generation == startGenerations[collector.first]) stale.append(collector.first);
+    }
+    locker.unlock();
 
-    info["os_name"]       = getOSInfo();
-    info["cpu_model"]     = getCpuInfo();
-    info["cpu_cores"]     = getCpuCores();
-    info["cpu_load"]      = getCpuLoad();
-    info["cpu_load_per_core"] = getCpuLoadPerCore();
-    info["memory"]        = getMemoryInfo();
-    info["disks"]         = getDiskInfo();
-    info["temperature"]   = getTemperatureInfo();
-    info["uptime"]        = getUptime();
-    info["peripherals"]   = getPeripheralDevices();
+    info["stale"]         = stale;
     info["timestamp"]     = QDateTime::currentDateTime().toString(Qt::ISODate);
 
     return info;
@@ -70,17 +138,14 @@ int SystemInfo::getCpuCores() const {
 
 QJsonObject SystemInfo::getCpuLoad() const {
     QJsonObject cpuLoad;
-    QFile file("/proc/stat");
-    if (!file.open(QIODevice::ReadOnly)) return cpuLoad;
-    QTextStream in(&file);
-    QString line = in.readLine(); //     load
-    QStringList values = line.split(' ', Qt::SkipEmptyParts);
-    if (values.size() < 5) return cpuLoad;
-
-    qint64 user   = values[1].toLongLong();
-    qint64 nice   = values[2].toLongLong();
-    qint64 system = values[3].toLongLong();
-    qint64 idle   = values[4].toLongLong();
+    thread_local procfs::ProcFile file("/proc/stat");
+    thread_local procfs::StatSnapshot stat;
+    if (!file.refresh() || !procfs::parseStat(file.view(), stat)) return cpuLoad;
+
+    qint64 user   = qint64(stat.total.user);
+    qint64 nice   = qint64(stat.total.nice);
+    qint64 system = qint64(stat.total.system);
+    qint64 idle   = qint64(stat.total.idle);
     qint64 total  = user + nice + system + idle;
 
     double usagePercent = (total > 0) ? (100.0 * (user + nice + system) / total) : 0.0;
@@ -92,9 +157,9 @@ QJsonObject SystemInfo::getCpuLoad() const {
 
 QJsonArray SystemInfo::getCpuLoadPerCore() const {
     QJsonArray loads;
-    QFile file("/proc/stat");
-    if (!file.open(QIODevice::ReadOnly)) return loads;
-    QTextStream in(&file);
+    thread_local procfs::ProcFile file("/proc/stat");
+    thread_local procfs::StatSnapshot stat;
+    if (!file.refresh() || !procfs::parseStat(file.view(), stat)) return loads;
     double maxFreq = 0.0; // .  ()
     QFile cpuFreq("/sys/devices/system/cpu/cpu0/cpufreq/cpuinfo_max_freq");
     if (cpuFreq.open(QIODevice::ReadOnly)) {
@@ -103,20 +168,15 @@ QJsonArray SystemInfo::getCpuLoadPerCore() const {
         maxFreq = 5.0; //   ,    
     }
 
-    while (!in.atEnd()) {
-        QString line = in.readLine();
-        if (line.startsWith("cpu") && line[3].isDigit()) { // cpu0, cpu1, etc.
-            QStringList values = line.split(' ', Qt::SkipEmptyParts);
-            if (values.size() < 5) continue;
-            qint64 user = values[1].toLongLong();
-            qint64 nice = values[2].toLongLong();
-            qint64 system = values[3].toLongLong();
-            qint64 idle = values[4].toLongLong();
-            qint64 total = user + nice + system + idle;
-            double usagePercent = (total > 0) ? (100.0 * (user + nice + system) / total) : 0.0;
-            double currentFreq = (usagePercent / 100.0) * maxFreq; //    
-            loads.append(QString("%1GHz/%2GHz").arg(currentFreq, 0, 'f', 1).arg(maxFreq, 0, 'f', 1));
-        }
+    for (const procfs::CpuTimes& core : stat.cores) {
+        qint64 user = qint64(core.user);
+        qint64 nice = qint64(core.nice);
+        qint64 system = qint64(core.system);
+        qint64 idle = qint64(core.idle);
+        qint64 total = user + nice + system + idle;
+        double usagePercent = (total > 0) ? (100.0 * (user + nice + system) / total) : 0.0;
+        double currentFreq = (usagePercent / 100.0) * maxFreq; //    
+        loads.append(QString("%1GHz/%2GHz").arg(currentFreq, 0, 'f', 1).arg(maxFreq, 0, 'f', 1));
     }
     return loads;
 }
@@ -130,23 +190,11 @@ double SystemInfo::getCpuTemperature() const {
 
 QJsonObject SystemInfo::getMemoryInfo() const {
     QJsonObject memory;
-    QFile file("/proc/meminfo");
-    if (!file.open(QIODevice::ReadOnly)) return memory;
 
-    qint64 total = 0, free = 0, available = 0;
-    QTextStream in(&file);
-    while (!in.atEnd()) {
-        QString line = in.readLine();
-        if (line.startsWith("MemTotal:")) {
-            total = line.split(' ', Qt::SkipEmptyParts)[1].toLongLong();
-        }
-        else if (line.startsWith("MemFree:")) {
-            free = line.split(' ', Qt::SkipEmptyParts)[1].toLongLong();
-        }
-        else if (line.startsWith("MemAvailable:")) {
-            available = line.split(' ', Qt::SkipEmptyParts)[1].toLongLong();
-        }
-    }
+    thread_local procfs::FileBuffer buffer;
+    procfs::MemInfo info;
+    if (!buffer.read("/proc/meminfo") || !procfs::parseMeminfo(buffer.view(), info)) return memory;
+    qint64 total = qint64(info.totalKb), free = qint64(info.freeKb), available = qint64(info.availableKb);
 
     memory["total_mb"]     = total / 1024;
     memory["used_mb"]      = (total - free) / 1024;
@@ -179,6 +227,25 @@ QJsonArray SystemInfo::getDiskInfo() const {
     return disks;
 }
 
+// Накопительные счётчики /proc/diskstats по блочным устройствам (без loop/ram)
+QJsonArray SystemInfo::getDiskIo() const {
+    QJsonArray devices;
+    thread_local procfs::ProcFile file("/proc/diskstats");
+    thread_local std::vector<procfs::DiskStat> stats;
+    if (!file.refresh() || !procfs::parseDiskstats(file.view(), stats)) return devices;
+    for (const procfs::DiskStat& d : stats) {
+        const QString name = QString::fromLatin1(d.name.data(), int(d.name.size()));
+        if (name.startsWith("loop") || name.startsWith("ram")) continue;
+        QJsonObject device;
+        device["device"]        = name;
+        device["read_bytes"]    = qint64(d.sectorsRead * 512);
+        device["written_bytes"] = qint64(d.sectorsWritten * 512);
+        device["io_time_ms"]    = qint64(d.ioTimeMs);
+        devices.append(device);
+    }
+    return devices;
+}
+
 QString SystemInfo::getUptime() const {
     QFile file("/proc/uptime");
     if (!file.open(QIODevice::ReadOnly)) return "Unknown";
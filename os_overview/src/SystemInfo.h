@@ -4,6 +4,14 @@
 #include <QObject>
 #include <QJsonObject>
 #include <QJsonArray>
+#include <QHash>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QThreadPool>
+#include <functional>
+#include <memory>
+
+class ResourceSampler;
 
 class SystemInfo : public QObject
 {
@@ -12,7 +20,11 @@ public:
     explicit SystemInfo(QObject *parent = nullptr);
     ~SystemInfo();
 
-    QJsonObject collectSystemInfo() const;
+    // Сборщики работают параллельно; те, кто не уложился в timeoutMs,
+    // отдают последнее закэшированное значение и попадают в массив "stale"
+    QJsonObject collectSystemInfo(int timeoutMs = 1000) const;
+
+    void setResourceSampler(const ResourceSampler *sampler);
 
 private:
     QString getOSInfo() const;
@@ -24,10 +36,32 @@ private:
     double getHddTemperature() const;
     QJsonObject getMemoryInfo() const;
     QJsonArray getDiskInfo() const;
+    QJsonArray getDiskIo() const;
     QString getUptime() const;
     QJsonObject getTemperatureInfo() const;
     QJsonArray getPeripheralDevices() const;
     QJsonObject getNetworkInfo() const;
+
+    struct CollectorState {
+        QJsonValue value;
+        quint64 generation = 0; // растёт после каждого завершённого прогона
+        bool running = false;   // не запускаем второй экземпляр зависшего сборщика
+    };
+
+    // Состояние, общее с задачами пула: брошенный при остановке сборщик
+    // может завершиться уже после разрушения SystemInfo
+    struct Shared {
+        QMutex mutex;
+        QWaitCondition changed;
+        QHash<QString, CollectorState> states;
+    };
+
+    const ResourceSampler *resourceSampler = nullptr;
+    QList<QPair<QString, std::function<QJsonValue()>>> collectors;
+    std::shared_ptr<Shared> shared;
+    // Без владельца: если сборщик завис на мёртвой точке монтирования,
+    // пул при остановке бросается вместе с ним
+    QThreadPool *pool;
 };
 
 #endif // SYSTEMINFO_H
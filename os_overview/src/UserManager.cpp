@@ -1,47 +1,355 @@
 #include "usermanager.h"
-#include <QProcess>
+#include "accountbatch.h"
+#include <QDate>
+#include <QDateTime>
+#include <QFile>
+#include <QSet>
+#include <QSocketNotifier>
+#include <QDebug>
 
-UserManager::UserManager(QObject* parent) : QObject(parent) {}
-UserManager::~UserManager() {}
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <pwd.h>
+#include <cerrno>
+#include <cstring>
+#include <thread>
 
-QJsonArray UserManager::getUserListAsJsonArray() const {
-    QJsonArray array;
-    QProcess process;
-    process.start("cut", { "-d:", "-f1", "/etc/passwd" });
-    process.waitForFinished();
-    QString output = process.readAllStandardOutput();
-    QStringList users = output.split('\n', Qt::SkipEmptyParts);
-    for (const QString& u : users) {
-        array.append(u);
+static const qint64 kNssMaxAgeMs = 5 * 60 * 1000;
+static const int kMaxNssAccounts = 50000;
+static const qint64 kNeverExpires = 99999;       // так passwd -x пишет «без срока»
+
+namespace {
+
+QList<QByteArray> readLines(const char *path, bool *ok = nullptr) {
+    QFile file(QString::fromLatin1(path));
+    const bool opened = file.open(QIODevice::ReadOnly);
+    if (ok) *ok = opened;
+    if (!opened) return QList<QByteArray>();
+    return file.readAll().split('\n');
+}
+
+// Числовое поле shadow: пустое — не задано
+qint64 days(const QByteArray &field) {
+    bool ok = false;
+    const qint64 value = field.toLongLong(&ok);
+    return ok ? value : -1;
+}
+
+QString isoDay(qint64 day) {
+    return QDate(1970, 1, 1).addDays(day).toString(Qt::ISODate);
+}
+
+bool isWatchedName(const char *name) {
+    return strcmp(name, "passwd") == 0 || strcmp(name, "group") == 0
+        || strcmp(name, "shadow") == 0 || strcmp(name, "login.defs") == 0;
+}
+
+} // namespace
+
+struct UserManager::BatchJob {
+    quint64 id = 0;
+    std::thread worker;
+    QJsonObject result;
+
+    ~BatchJob() {
+        // Пакет не прерывается на середине: записанные базы должны быть согласованы
+        if (worker.joinable()) worker.join();
+    }
+};
+
+UserManager::UserManager(QObject* parent) : QObject(parent) {
+    // Следим за каталогом: файлы учётных записей заменяются переименованием
+    fd = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd >= 0 && ::inotify_add_watch(fd, "/etc", IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_DELETE | IN_ONLYDIR) < 0) {
+        ::close(fd);
+        fd = -1;
+    }
+    if (fd < 0) {
+        qWarning() << "User manager: cannot watch /etc, accounts will be re-read on every request:" << strerror(errno);
+        return;
+    }
+    notifier = new QSocketNotifier(fd, QSocketNotifier::Read, this);
+    connect(notifier, &QSocketNotifier::activated, this, &UserManager::readEvents);
+}
+
+UserManager::~UserManager() {
+    batchJobs.clear();
+    delete notifier;
+    if (fd >= 0) ::close(fd);
+}
+
+void UserManager::readEvents() {
+    alignas(inotify_event) char buffer[4096];
+    for (;;) {
+        const ssize_t length = ::read(fd, buffer, sizeof(buffer));
+        if (length < 0) {
+            if (errno == EINTR) continue;
+            break; // EAGAIN: очередь пуста
+        }
+        for (char *p = buffer; p < buffer + length;) {
+            const auto *event = reinterpret_cast<const inotify_event *>(p);
+            p += sizeof(inotify_event) + event->len;
+            if ((event->mask & (IN_Q_OVERFLOW | IN_IGNORED)) || (event->len > 0 && isWatchedName(event->name))) {
+                stale = true;
+            }
+            if (event->mask & IN_IGNORED) {
+                // Watch на /etc снят — дальше без inotify, с перечитыванием на каждый запрос
+                delete notifier;
+                notifier = nullptr;
+                ::close(fd);
+                fd = -1;
+                return;
+            }
+        }
+    }
+}
+
+void UserManager::ensureLoaded() {
+    if (!stale && fd >= 0) return;
+    stale = false;
+    ++generation;
+    accounts.clear();
+    byName.clear();
+    groupNames.clear();
+    nssAccounts.clear();
+    nssLoadedMs = 0;
+
+    uidMin = 1000;
+    uidMax = 60000;
+    for (const QByteArray &line : readLines("/etc/login.defs")) {
+        const QList<QByteArray> parts = line.simplified().split(' ');
+        if (parts.size() < 2) continue;
+        bool ok = false;
+        const uint value = parts[1].toUInt(&ok);
+        if (!ok) continue;
+        if (parts[0] == "UID_MIN") uidMin = value;
+        else if (parts[0] == "UID_MAX") uidMax = value;
+    }
+
+    // name:password:gid:member,member
+    QHash<QString, QStringList> memberOf;
+    for (const QByteArray &line : readLines("/etc/group")) {
+        const QList<QByteArray> fields = line.split(':');
+        if (fields.size() < 4 || line.startsWith('#') || line.startsWith('+') || line.startsWith('-')) continue;
+        bool ok = false;
+        const uint gid = fields[2].toUInt(&ok);
+        if (!ok) continue;
+        const QString group = QString::fromLocal8Bit(fields[0]);
+        if (!groupNames.contains(gid)) groupNames.insert(gid, group);
+        for (const QByteArray &member : fields[3].split(',')) {
+            if (!member.isEmpty()) memberOf[QString::fromLocal8Bit(member)].append(group);
+        }
+    }
+
+    // name:password:uid:gid:gecos:home:shell; строки +/- — совместимость с NIS
+    for (const QByteArray &line : readLines("/etc/passwd")) {
+        const QList<QByteArray> fields = line.split(':');
+        if (fields.size() < 7 || line.startsWith('#') || line.startsWith('+') || line.startsWith('-')) continue;
+        bool uidOk = false, gidOk = false;
+        Account account;
+        account.name = QString::fromLocal8Bit(fields[0]);
+        account.uid = fields[2].toUInt(&uidOk);
+        account.gid = fields[3].toUInt(&gidOk);
+        if (!uidOk || !gidOk || byName.contains(account.name)) continue;
+        account.gecos = QString::fromLocal8Bit(fields[4]);
+        account.home = QString::fromLocal8Bit(fields[5]);
+        account.shell = QString::fromLocal8Bit(fields[6]);
+        account.groups = memberOf.value(account.name);
+        if (fields[1] != "x") {
+            // Хэш прямо в passwd (без shadow) — встречается во встраиваемых системах
+            account.hasShadow = true;
+            account.passwordField = fields[1];
+        }
+        byName.insert(account.name, accounts.size());
+        accounts.append(account);
+    }
+
+    // name:password:lastchg:min:max:warn:inactive:expire:reserved — читается только root
+    for (const QByteArray &line : readLines("/etc/shadow", &shadowReadable)) {
+        const QList<QByteArray> fields = line.split(':');
+        if (fields.size() < 8) continue;
+        const int index = byName.value(QString::fromLocal8Bit(fields[0]), -1);
+        if (index < 0) continue;
+        Account &account = accounts[index];
+        account.hasShadow = true;
+        account.passwordField = fields[1];
+        account.lastChange = days(fields[2]);
+        account.minDays = days(fields[3]);
+        account.maxDays = days(fields[4]);
+        account.warnDays = days(fields[5]);
+        account.inactiveDays = days(fields[6]);
+        account.expireDay = days(fields[7]);
+    }
+}
+
+// Перечисление NSS может идти в сеть, поэтому результат кэшируется на время
+void UserManager::loadNss() {
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    if (nssLoadedMs != 0 && now - nssLoadedMs < kNssMaxAgeMs) return;
+    nssLoadedMs = now;
+    nssAccounts.clear();
+
+    QSet<QString> seen;
+    ::setpwent();
+    while (nssAccounts.size() < kMaxNssAccounts) {
+        errno = 0;
+        const struct passwd *pw = ::getpwent();
+        if (!pw) break;
+        const QString name = QString::fromLocal8Bit(pw->pw_name);
+        if (byName.contains(name) || seen.contains(name)) continue;
+        seen.insert(name);
+        Account account;
+        account.name = name;
+        account.uid = pw->pw_uid;
+        account.gid = pw->pw_gid;
+        account.gecos = QString::fromLocal8Bit(pw->pw_gecos);
+        account.home = QString::fromLocal8Bit(pw->pw_dir);
+        account.shell = QString::fromLocal8Bit(pw->pw_shell);
+        account.fromNss = true;
+        nssAccounts.append(account);
+    }
+    ::endpwent();
+}
+
+bool UserManager::isSystem(uint uid) const {
+    return uid < uidMin || uid > uidMax;
+}
+
+QJsonObject UserManager::toJson(const Account &account, qint64 today) const {
+    QJsonObject user;
+    user["name"] = account.name;
+    user["uid"] = qint64(account.uid);
+    user["gid"] = qint64(account.gid);
+    user["group"] = groupNames.value(account.gid, QString::number(account.gid));
+    user["groups"] = QJsonArray::fromStringList(account.groups);
+    user["gecos"] = account.gecos;
+    user["full_name"] = account.gecos.section(',', 0, 0);
+    user["home"] = account.home;
+    user["shell"] = account.shell;
+    user["system"] = isSystem(account.uid);
+    user["source"] = account.fromNss ? "nss" : "files";
+    // Пустая оболочка означает /bin/sh
+    const bool loginShell = !account.shell.endsWith("/nologin") && !account.shell.endsWith("/false");
+
+    if (!account.hasShadow) {
+        user["password"] = "unknown";
+        user["can_login"] = loginShell;
+        return user;
+    }
+
+    // "!hash" — заблокирован (usermod -L), "!", "!!", "*" — пароля нет вовсе
+    const QByteArray &pw = account.passwordField;
+    int bang = 0;
+    while (bang < pw.size() && pw[bang] == '!') ++bang;
+    const QByteArray hash = pw.mid(bang);
+    QString state;
+    if (pw.isEmpty()) state = "empty";
+    else if (hash.isEmpty() || hash.startsWith('*')) state = "disabled";
+    else if (bang > 0) state = "locked";
+    else state = "set";
+    user["password"] = state;
+    user["locked"] = bang > 0;
+
+    bool expired = false;
+    if (account.expireDay >= 0) {
+        user["expires"] = isoDay(account.expireDay);
+        expired = today >= account.expireDay;
+    }
+    user["expired"] = expired;
+
+    if (account.lastChange == 0) user["must_change"] = true;   // passwd -e
+    if (account.lastChange > 0) user["last_change"] = isoDay(account.lastChange);
+    if (account.minDays >= 0) user["min_days"] = account.minDays;
+    if (account.maxDays >= 0 && account.maxDays < kNeverExpires) {
+        user["max_days"] = account.maxDays;
+        if (account.lastChange > 0) {
+            const qint64 passwordExpires = account.lastChange + account.maxDays;
+            user["password_expires"] = isoDay(passwordExpires);
+            user["password_expired"] = today > passwordExpires;
+        }
     }
+    if (account.warnDays >= 0) user["warn_days"] = account.warnDays;
+    if (account.inactiveDays >= 0) user["inactive_days"] = account.inactiveDays;
+    user["can_login"] = loginShell && state != "disabled" && bang == 0 && !expired;
+    return user;
+}
+
+QJsonArray UserManager::getUserListAsJsonArray() {
+    ensureLoaded();
+    QJsonArray array;
+    for (const Account &account : accounts) array.append(account.name);
     return array;
 }
 
-bool UserManager::addUser(const QString& username, const QString& password) {
-    QProcess process;
-    process.start("useradd", { username });
-    process.waitForFinished();
-    if (process.exitCode() != 0) return false;
+QJsonObject UserManager::listUsers(const QJsonObject &query) {
+    ensureLoaded();
+    const QString filter = query["filter"].toString("all");
+    const bool withNss = query["nss"].toBool(false);
+    if (withNss) loadNss();
+
+    const qint64 today = QDateTime::currentSecsSinceEpoch() / 86400;
+    QJsonArray users;
+    auto append = [&](const Account &account) {
+        const bool system = isSystem(account.uid);
+        if ((filter == "human" && system) || (filter == "system" && !system)) return;
+        users.append(toJson(account, today));
+    };
+    for (const Account &account : accounts) append(account);
+    if (withNss) {
+        for (const Account &account : nssAccounts) append(account);
+    }
 
-    process.start("chpasswd");
-    process.write(QString("%1:%2").arg(username, password).toUtf8());
-    process.closeWriteChannel();
-    process.waitForFinished();
-    return process.exitCode() == 0;
+    QJsonObject result;
+    result["users"] = users;
+    result["shadow"] = shadowReadable;
+    result["uid_min"] = qint64(uidMin);
+    result["uid_max"] = qint64(uidMax);
+    result["generation"] = QString::number(generation);
+    return result;
+}
+
+// Одиночные операции идут тем же путём, что и пакет, только синхронно
+bool UserManager::addUser(const QString& username, const QString& password) {
+    QJsonObject op{{"op", "create"}, {"name", username}, {"password", password}};
+    const QJsonObject result = accounts::applyBatch(QJsonArray{op}, QJsonObject());
+    stale = true;
+    return result["applied"].toInt() == 1;
 }
 
 bool UserManager::removeUser(const QString& username) {
-    QProcess process;
-    process.start("userdel", { "-r", username });
-    process.waitForFinished();
-    return process.exitCode() == 0;
+    QJsonObject op{{"op", "delete"}, {"name", username}, {"remove_home", true}};
+    const QJsonObject result = accounts::applyBatch(QJsonArray{op}, QJsonObject());
+    stale = true;
+    return result["applied"].toInt() == 1;
 }
 
 bool UserManager::changePassword(const QString& username, const QString& password) {
-    QProcess process;
-    process.start("chpasswd");
-    process.write(QString("%1:%2").arg(username, password).toUtf8());
-    process.closeWriteChannel();
-    process.waitForFinished();
-    return process.exitCode() == 0;
+    QJsonObject op{{"op", "password"}, {"name", username}, {"password", password}};
+    const QJsonObject result = accounts::applyBatch(QJsonArray{op}, QJsonObject());
+    stale = true;
+    return result["applied"].toInt() == 1;
+}
+
+quint64 UserManager::applyUsers(const QJsonArray &operations, const QJsonObject &options) {
+    auto job = std::make_shared<BatchJob>();
+    job->id = nextRequestId++;
+    batchJobs.insert(job->id, job);
+
+    // Пакеты сериализуются внутри applyBatch блокировкой баз
+    BatchJob *raw = job.get();
+    const quint64 id = job->id;
+    job->worker = std::thread([this, raw, id, operations, options] {
+        raw->result = accounts::applyBatch(operations, options);
+        // ~UserManager дожидается потока, так что объект ещё жив
+        QMetaObject::invokeMethod(this, [this, id] { finishBatch(id); }, Qt::QueuedConnection);
+    });
+    return job->id;
+}
+
+void UserManager::finishBatch(quint64 requestId) {
+    const std::shared_ptr<BatchJob> job = batchJobs.take(requestId);
+    if (!job) return;
+    // Не ждём inotify: следующий listUsers уже должен видеть изменения
+    if (job->result["committed"].toBool()) stale = true;
+    emit usersApplied(job->id, job->result);
 }
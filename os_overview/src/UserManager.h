@@ -3,7 +3,20 @@
 
 #include <QObject>
 #include <QJsonArray>
+#include <QJsonObject>
+#include <QHash>
+#include <QStringList>
+#include <QVector>
+#include <memory>
 
+class QSocketNotifier;
+
+// Учётные записи разбираются прямо из /etc/passwd, /etc/group и /etc/shadow
+// и держатся в памяти: список пользователей — чтение готовой таблицы, а не
+// запуск процессов. Изменения файлов (useradd и т.п. заменяют их
+// переименованием) ловятся inotify на /etc и лишь помечают таблицу
+// устаревшей — перечитывается она при следующем запросе. Записи из NSS
+// (LDAP, sssd) добавляются по запросу и живут ограниченное время.
 class UserManager : public QObject
 {
     Q_OBJECT
@@ -11,10 +24,70 @@ public:
     explicit UserManager(QObject *parent = nullptr);
     ~UserManager();
 
-    QJsonArray getUserListAsJsonArray() const;
+    // Только имена — для старых клиентов
+    QJsonArray getUserListAsJsonArray();
+    // query: filter (human | system | all), nss — дополнить перечислением NSS.
+    // Ответ: {users: [{name, uid, gid, group, groups, gecos, home, shell, system,
+    // source, password, locked, expired, expires, ...}], shadow, generation}
+    QJsonObject listUsers(const QJsonObject &query);
+
     bool addUser(const QString &username, const QString &password);
     bool removeUser(const QString &username);
     bool changePassword(const QString &username, const QString &password);
+
+    // Пакет операций (см. accounts::applyBatch) выполняется в фоновом потоке;
+    // результат приходит сигналом usersApplied с тем же номером.
+    quint64 applyUsers(const QJsonArray &operations, const QJsonObject &options);
+
+signals:
+    void usersApplied(quint64 requestId, const QJsonObject &result);
+
+private slots:
+    void readEvents();
+
+private:
+    struct BatchJob;
+
+    struct Account {
+        QString name;
+        uint uid = 0;
+        uint gid = 0;
+        QString gecos;
+        QString home;
+        QString shell;
+        QStringList groups;          // дополнительные, из списков членов /etc/group
+        bool fromNss = false;
+
+        bool hasShadow = false;
+        QByteArray passwordField;    // только чтобы определить состояние, наружу не отдаётся
+        qint64 lastChange = -1;      // дни с 1970-01-01; -1 — поле пусто
+        qint64 minDays = -1, maxDays = -1, warnDays = -1, inactiveDays = -1;
+        qint64 expireDay = -1;
+    };
+
+    void finishBatch(quint64 requestId);
+    void ensureLoaded();
+    void loadNss();
+    QJsonObject toJson(const Account &account, qint64 today) const;
+    bool isSystem(uint uid) const;
+
+    int fd = -1;
+    QSocketNotifier *notifier = nullptr;
+    bool stale = true;
+    bool shadowReadable = false;
+    quint64 generation = 0;
+    uint uidMin = 1000;
+    uint uidMax = 60000;
+
+    QVector<Account> accounts;
+    QHash<QString, int> byName;      // имя → индекс в accounts
+    QHash<uint, QString> groupNames;
+
+    QVector<Account> nssAccounts;
+    qint64 nssLoadedMs = 0;
+
+    QHash<quint64, std::shared_ptr<BatchJob>> batchJobs;
+    quint64 nextRequestId = 1;
 };
 
 #endif // USERMANAGER_H
@@ -0,0 +1,960 @@
+#include "accountbatch.h"
+#include <QDateTime>
+#include <QFile>
+#include <QHash>
+#include <QSet>
+
+#include <crypt.h>
+#include <shadow.h>
+#include <spawn.h>
+#include <sys/random.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#ifdef HAVE_SELINUX
+#include <selinux/selinux.h>
+#endif
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+static const int kMaxOperations = 10000;
+static const int kMaxNameLength = 32;
+
+namespace accounts {
+namespace {
+
+typedef QByteArrayList Row;
+
+qint64 nowMs() {
+    return QDateTime::currentMSecsSinceEpoch();
+}
+
+QString errnoText(int error) {
+    return QString::fromLocal8Bit(strerror(error));
+}
+
+QByteArray field(const Row &row, int index) {
+    return index < row.size() ? row[index] : QByteArray();
+}
+
+void setField(Row &row, int index, const QByteArray &value) {
+    while (row.size() <= index) row.append(QByteArray());
+    row[index] = value;
+}
+
+bool readFd(int fd, QByteArray &data) {
+    char buffer[64 * 1024];
+    for (;;) {
+        const ssize_t n = ::read(fd, buffer, sizeof(buffer));
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) return false;
+        if (n == 0) return true;
+        data.append(buffer, int(n));
+    }
+}
+
+// Файл базы учётных записей: строки, разбитые по ':'. Склейка обратно даёт
+// исходный текст байт в байт, так что комментарии и записи +/- NIS
+// переживают перезапись без изменений.
+struct Table {
+    QByteArray path;
+    bool exists = false;
+    bool changed = false;
+    struct stat st {};
+    QByteArray original;
+    QList<Row> rows;
+
+    bool load(QString *error) {
+        const int fd = ::open(path.constData(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            if (errno == ENOENT) return true;    // gshadow есть не везде
+            if (error) *error = QString("%1: %2").arg(QString::fromLatin1(path), errnoText(errno));
+            return false;
+        }
+        const bool ok = ::fstat(fd, &st) == 0 && readFd(fd, original);
+        const int savedErrno = errno;
+        ::close(fd);
+        if (!ok) {
+            if (error) *error = QString("%1: %2").arg(QString::fromLatin1(path), errnoText(savedErrno));
+            return false;
+        }
+        exists = true;
+        for (const QByteArray &line : original.split('\n')) rows.append(line.split(':'));
+        return true;
+    }
+
+    int find(const QByteArray &name) const {
+        for (int i = 0; i < rows.size(); ++i) {
+            if (rows[i].size() > 1 && rows[i][0] == name) return i;
+        }
+        return -1;
+    }
+
+    void append(const Row &row) {
+        // Последняя «строка» после завершающего '\n' пуста — вставляем перед ней
+        if (!rows.isEmpty() && rows.last().size() == 1 && rows.last()[0].isEmpty()) {
+            rows.insert(rows.size() - 1, row);
+        } else {
+            rows.append(row);
+            rows.append(Row{QByteArray()});
+        }
+        changed = true;
+    }
+
+    void remove(int index) {
+        rows.removeAt(index);
+        changed = true;
+    }
+
+    QByteArray serialize() const {
+        QByteArray out;
+        out.reserve(original.size() + 4096);
+        for (int i = 0; i < rows.size(); ++i) {
+            if (i) out += '\n';
+            out += rows[i].join(':');
+        }
+        return out;
+    }
+};
+
+struct Databases {
+    Table passwd, shadow, group, gshadow;
+    QSet<uint> uids, gids;
+
+    QList<Table *> tables() { return {&group, &gshadow, &passwd, &shadow}; }
+};
+
+struct Defaults {
+    uint uidMin = 1000, uidMax = 60000, sysUidMin = 100, sysUidMax = 999;
+    uint gidMin = 1000, gidMax = 60000, sysGidMin = 100, sysGidMax = 999;
+    QByteArray homeBase = "/home";
+    QByteArray shell = "/bin/sh";
+    QByteArray skel = "/etc/skel";
+    QByteArray mailDir = "/var/mail";
+    QByteArray passMinDays, passMaxDays, passWarnAge;
+    mode_t homeMode = 0755;
+    bool createHome = false;
+};
+
+// Те же умолчания, что берёт useradd: login.defs и /etc/default/useradd
+Defaults loadDefaults() {
+    Defaults d;
+    QFile defs("/etc/login.defs");
+    mode_t umaskValue = 022;
+    bool homeModeSet = false;
+    if (defs.open(QIODevice::ReadOnly)) {
+        for (const QByteArray &raw : defs.readAll().split('\n')) {
+            const QByteArrayList parts = raw.simplified().split(' ');
+            if (parts.size() < 2 || parts[0].startsWith('#')) continue;
+            const QByteArray &key = parts[0];
+            const QByteArray &value = parts[1];
+            bool ok = false;
+            const uint number = value.toUInt(&ok);
+            if (key == "UID_MIN" && ok) d.uidMin = number;
+            else if (key == "UID_MAX" && ok) d.uidMax = number;
+            else if (key == "SYS_UID_MIN" && ok) d.sysUidMin = number;
+            else if (key == "SYS_UID_MAX" && ok) d.sysUidMax = number;
+            else if (key == "GID_MIN" && ok) d.gidMin = number;
+            else if (key == "GID_MAX" && ok) d.gidMax = number;
+            else if (key == "SYS_GID_MIN" && ok) d.sysGidMin = number;
+            else if (key == "SYS_GID_MAX" && ok) d.sysGidMax = number;
+            else if (key == "PASS_MIN_DAYS") d.passMinDays = value;
+            else if (key == "PASS_MAX_DAYS") d.passMaxDays = value;
+            else if (key == "PASS_WARN_AGE") d.passWarnAge = value;
+            else if (key == "MAIL_DIR") d.mailDir = value;
+            else if (key == "CREATE_HOME") d.createHome = value.toLower() == "yes";
+            else if (key == "UMASK") umaskValue = mode_t(value.toUInt(&ok, 8));
+            else if (key == "HOME_MODE") {
+                d.homeMode = mode_t(value.toUInt(&ok, 8));
+                homeModeSet = ok;
+            }
+        }
+    }
+    if (!homeModeSet) d.homeMode = 0777 & ~umaskValue;
+
+    QFile useradd("/etc/default/useradd");
+    if (useradd.open(QIODevice::ReadOnly)) {
+        for (const QByteArray &raw : useradd.readAll().split('\n')) {
+            const QByteArray line = raw.trimmed();
+            const int eq = line.indexOf('=');
+            if (line.startsWith('#') || eq <= 0) continue;
+            const QByteArray key = line.left(eq);
+            const QByteArray value = line.mid(eq + 1);
+            if (value.isEmpty()) continue;
+            if (key == "SHELL") d.shell = value;
+            else if (key == "HOME") d.homeBase = value;
+            else if (key == "SKEL") d.skel = value;
+        }
+    }
+    return d;
+}
+
+// Блокировка баз, совместимая с shadow-utils: lckpwdf на /etc/.pwd.lock и
+// файл <база>.lock с pid владельца у каждого файла. lckpwdf защищает только
+// системные базы и для других корней не берётся. Блокировки fcntl
+// принадлежат процессу, поэтому пакеты внутри сервера дополнительно
+// идут по одному через мьютекс.
+class DatabaseLock
+{
+public:
+    ~DatabaseLock() { release(); }
+
+    void release() {
+        for (const QByteArray &lock : fileLocks) ::unlink(lock.constData());
+        fileLocks.clear();
+        if (pwdLocked) ::ulckpwdf();
+        pwdLocked = false;
+        if (processLock.owns_lock()) processLock.unlock();
+    }
+
+    bool acquire(Databases &db, bool system, QString *error) {
+        processLock = std::unique_lock<std::mutex>(processMutex());
+        // lckpwdf сам ждёт до 15 секунд, если базы заняты
+        if (system && ::lckpwdf() != 0) {
+            if (error) *error = "Account databases are locked by another process";
+            return false;
+        }
+        pwdLocked = system;
+        for (Table *table : db.tables()) {
+            if (!lockFile(table->path, error)) return false;
+        }
+        return true;
+    }
+
+private:
+    static std::mutex &processMutex() {
+        static std::mutex mutex;
+        return mutex;
+    }
+
+    bool lockFile(const QByteArray &path, QString *error) {
+        const QByteArray lock = path + ".lock";
+        for (int attempt = 0; attempt < 2; ++attempt) {
+            const int fd = ::open(lock.constData(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+            if (fd >= 0) {
+                const QByteArray pid = QByteArray::number(qint64(::getpid()));
+                const bool written = ::write(fd, pid.constData(), size_t(pid.size())) == pid.size();
+                ::close(fd);
+                fileLocks.append(lock);
+                if (written) return true;
+                break;
+            }
+            if (errno != EEXIST) break;
+            // Блокировку, оставшуюся от завершившегося процесса, снимаем
+            QFile existing(QString::fromLatin1(lock));
+            const pid_t owner = existing.open(QIODevice::ReadOnly) ? pid_t(existing.readAll().trimmed().toLong()) : 0;
+            if (owner <= 0 || (::kill(owner, 0) != 0 && errno == ESRCH)) {
+                ::unlink(lock.constData());
+                continue;
+            }
+            if (error) *error = QString("%1 is locked by process %2").arg(QString::fromLatin1(path)).arg(owner);
+            return false;
+        }
+        if (error) *error = QString("Cannot lock %1: %2").arg(QString::fromLatin1(path), errnoText(errno));
+        return false;
+    }
+
+    std::unique_lock<std::mutex> processLock;
+    bool pwdLocked = false;
+    QByteArrayList fileLocks;
+};
+
+// Контекст SELinux заменяемого файла, а если его нет — контекст по политике
+// для этого пути. Без него файл после переименования получит контекст
+// каталога (etc_t вместо passwd_file_t / shadow_t).
+bool copySecurityContext(const Table &table, int fd) {
+#ifdef HAVE_SELINUX
+    if (::is_selinux_enabled() <= 0) return true;
+    char *context = nullptr;
+    if (::lgetfilecon(table.path.constData(), &context) < 0
+        && ::matchpathcon(table.path.constData(), table.st.st_mode, &context) != 0) {
+        return true;    // политика ничего не назначает — остаётся контекст по умолчанию
+    }
+    const bool ok = ::fsetfilecon(fd, context) == 0;
+    ::freecon(context);
+    return ok;
+#else
+    (void)table;
+    (void)fd;
+    return true;
+#endif
+}
+
+// Новое содержимое пишется во временный файл с правами, владельцем и
+// контекстом SELinux оригинала и попадает на место переименованием
+bool replaceFile(const Table &table, const QByteArray &data, QString *error) {
+    const QByteArray temp = table.path + "+";
+    const int fd = ::open(temp.constData(), O_WRONLY | O_CREAT | O_TRUNC | O_NOFOLLOW | O_CLOEXEC, 0600);
+    bool ok = fd >= 0
+           && ::fchown(fd, table.st.st_uid, table.st.st_gid) == 0
+           && ::fchmod(fd, table.st.st_mode & 07777) == 0
+           && copySecurityContext(table, fd);
+    qint64 written = 0;
+    while (ok && written < data.size()) {
+        const ssize_t n = ::write(fd, data.constData() + written, size_t(data.size() - written));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) ok = false;
+        else written += n;
+    }
+    ok = ok && ::fsync(fd) == 0;
+    const int savedErrno = errno;
+    if (fd >= 0) ::close(fd);
+    if (ok && ::rename(temp.constData(), table.path.constData()) == 0) return true;
+    if (error) *error = QString("Cannot write %1: %2").arg(QString::fromLatin1(table.path), errnoText(ok ? errno : savedErrno));
+    ::unlink(temp.constData());
+    return false;
+}
+
+// Резервная копия <база>- как у shadow-utils, затем замена. При сбое уже
+// заменённые файлы возвращаются к исходному содержимому.
+bool commit(Databases &db, QString *error, bool *rolledBack) {
+    QList<Table *> changed;
+    for (Table *table : db.tables()) {
+        if (table->exists && table->changed) changed.append(table);
+    }
+    for (Table *table : changed) {
+        Table backup = *table;
+        backup.path = table->path + "-";
+        QString ignored;
+        replaceFile(backup, table->original, &ignored);   // копия — не повод отказаться от записи
+    }
+    for (int i = 0; i < changed.size(); ++i) {
+        if (replaceFile(*changed[i], changed[i]->serialize(), error)) continue;
+        for (int j = 0; j < i; ++j) {
+            QString ignored;
+            replaceFile(*changed[j], changed[j]->original, &ignored);
+        }
+        *rolledBack = i > 0;
+        return false;
+    }
+    return true;
+}
+
+// Запуск вспомогательной программы с ожиданием; вывод отбрасывается.
+// posix_spawn, а не QProcess: пакет выполняется вне потоков Qt.
+void runQuietly(std::vector<const char *> argv) {
+    argv.push_back(nullptr);
+    posix_spawn_file_actions_t actions;
+    ::posix_spawn_file_actions_init(&actions);
+    ::posix_spawn_file_actions_addopen(&actions, STDOUT_FILENO, "/dev/null", O_WRONLY, 0);
+    ::posix_spawn_file_actions_addopen(&actions, STDERR_FILENO, "/dev/null", O_WRONLY, 0);
+    pid_t pid = 0;
+    if (::posix_spawnp(&pid, argv[0], &actions, nullptr, const_cast<char *const *>(argv.data()), environ) == 0) {
+        int status = 0;
+        while (::waitpid(pid, &status, 0) < 0 && errno == EINTR) {}
+    }
+    ::posix_spawn_file_actions_destroy(&actions);
+}
+
+// Как shadow-utils после записи: иначе nscd и sssd ещё долго отдают
+// прежние записи. Нет программы или демона — сбрасывать нечего.
+void invalidateCaches(const Databases &db) {
+    const bool users = db.passwd.changed || db.shadow.changed;
+    const bool groups = db.group.changed || db.gshadow.changed;
+    if (users) runQuietly({"nscd", "-i", "passwd"});
+    if (groups) runQuietly({"nscd", "-i", "group"});
+    if (users && groups) runQuietly({"sss_cache", "-U", "-G"});
+    else if (users) runQuietly({"sss_cache", "-U"});
+    else if (groups) runQuietly({"sss_cache", "-G"});
+}
+
+QByteArray makeSalt() {
+#ifdef CRYPT_GENSALT_IMPLEMENTS_DEFAULT_PREFIX
+    // libxcrypt выбирает самый стойкий метод системы (yescrypt) и сам берёт энтропию
+    char buffer[CRYPT_GENSALT_OUTPUT_SIZE];
+    if (::crypt_gensalt_rn(nullptr, 0, nullptr, 0, buffer, sizeof(buffer))) return QByteArray(buffer);
+#endif
+    static const char alphabet[] = "./0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz";
+    unsigned char random[16];
+    if (::getrandom(random, sizeof(random), 0) != ssize_t(sizeof(random))) return QByteArray();
+    QByteArray salt = "$6$";
+    for (unsigned char byte : random) salt += alphabet[byte % 64];
+    return salt + '$';
+}
+
+// Хэширование намеренно медленное (десятки миллисекунд на пароль), поэтому
+// идёт параллельно и до взятия блокировки баз
+void hashPasswords(const std::vector<QByteArray> &plain, std::vector<QByteArray> &hashes) {
+    hashes.assign(plain.size(), QByteArray());
+    std::atomic<size_t> next{0};
+    auto worker = [&] {
+        std::unique_ptr<crypt_data> data(new crypt_data());
+        for (size_t i = next++; i < plain.size(); i = next++) {
+            if (plain[i].isNull()) continue;
+            const QByteArray salt = makeSalt();
+            const char *hash = salt.isEmpty() ? nullptr : ::crypt_r(plain[i].constData(), salt.constData(), data.get());
+            if (hash && hash[0] != '*') hashes[i] = QByteArray(hash);
+        }
+    };
+    size_t pending = 0;
+    for (const QByteArray &password : plain) pending += password.isNull() ? 0 : 1;
+    const int threads = int(std::min<size_t>(pending, size_t(qBound(1, int(std::thread::hardware_concurrency()), 8))));
+    std::vector<std::thread> pool;
+    for (int i = 1; i < threads; ++i) pool.emplace_back(worker);
+    if (threads > 0) worker();
+    for (std::thread &thread : pool) thread.join();
+}
+
+bool validName(const QByteArray &name) {
+    if (name.isEmpty() || name.size() > kMaxNameLength) return false;
+    for (int i = 0; i < name.size(); ++i) {
+        const char c = name[i];
+        const bool lead = (c >= 'a' && c <= 'z') || c == '_';
+        const bool body = lead || (c >= '0' && c <= '9') || c == '-' || c == '.';
+        const bool tail = c == '$' && i == name.size() - 1;     // учётные записи машин Samba
+        if (!(i == 0 ? lead : (body || tail))) return false;
+    }
+    return true;
+}
+
+bool validField(const QByteArray &value) {
+    return !value.contains(':') && !value.contains('\n');
+}
+
+// uid/gid из запроса: целое число 0 ≤ id < 4294967295 ((uid_t)-1 зарезервирован)
+bool parseId(const QJsonValue &value, uint &id) {
+    if (!value.isDouble()) return false;
+    const double number = value.toDouble();
+    if (!(number >= 0 && number < 4294967295.0) || std::floor(number) != number) return false;
+    id = uint(number);
+    return true;
+}
+
+// Задание на каталог, выполняемое после записи баз
+struct HomeAction {
+    int item = 0;
+    bool create = false;
+    QByteArray path;
+    QByteArray mail;
+    uid_t uid = 0;
+    gid_t gid = 0;
+};
+
+class Batch
+{
+public:
+    Batch(const QJsonArray &operations, const QJsonObject &options, const DatabasePaths &paths)
+        : operations(operations), options(options), paths(paths), defaults(loadDefaults()) {}
+
+    QJsonObject run();
+
+private:
+    QString apply(int index, const QJsonObject &op, QJsonObject &item);
+    QString createUser(int index, const QJsonObject &op, QJsonObject &item);
+    QString deleteUser(int index, const QJsonObject &op);
+    QString setPassword(int index, const QJsonObject &op);
+    QString changeGroups(const QJsonObject &op);
+    QString createGroup(const QJsonObject &op, QJsonObject &item);
+    QString deleteGroup(const QJsonObject &op);
+
+    bool allocate(QSet<uint> &used, uint low, uint high, bool fromTop, uint &id) const;
+    bool resolveGroup(const QJsonValue &value, QByteArray &name, uint &gid) const;
+    void setMember(const QByteArray &group, const QByteArray &user, bool member);
+    QByteArray passwordFor(int index, const QJsonObject &op, QString *error) const;
+    void runHomeActions(QJsonArray &items);
+
+    QJsonArray operations;
+    QJsonObject options;
+    DatabasePaths paths;
+    Defaults defaults;
+    Databases db;
+    std::vector<QByteArray> hashes;     // по индексу операции; пусто — пароля нет
+    QList<HomeAction> homeActions;
+    qint64 today = 0;
+};
+
+QByteArray Batch::passwordFor(int index, const QJsonObject &op, QString *error) const {
+    if (op.contains("password_hash")) {
+        const QByteArray hash = op["password_hash"].toString().toUtf8();
+        if (!validField(hash) || hash.isEmpty()) *error = "Invalid password hash";
+        return hash;
+    }
+    if (!op.contains("password")) return QByteArray();
+    if (hashes[size_t(index)].isEmpty()) *error = "Cannot hash password";
+    return hashes[size_t(index)];
+}
+
+bool Batch::allocate(QSet<uint> &used, uint low, uint high, bool fromTop, uint &id) const {
+    // Системные id useradd выдаёт сверху вниз, обычные — снизу вверх
+    for (uint i = 0; low + i <= high; ++i) {
+        const uint candidate = fromTop ? high - i : low + i;
+        if (!used.contains(candidate)) {
+            id = candidate;
+            used.insert(candidate);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool Batch::resolveGroup(const QJsonValue &value, QByteArray &name, uint &gid) const {
+    if (value.isDouble()) {
+        if (!parseId(value, gid)) return false;
+        for (const Row &row : db.group.rows) {
+            bool ok = false;
+            if (row.size() > 2 && field(row, 2).toUInt(&ok) == gid && ok) {
+                name = row[0];
+                return true;
+            }
+        }
+        return false;
+    }
+    name = value.toString().toUtf8();
+    const int index = db.group.find(name);
+    if (index < 0) return false;
+    bool ok = false;
+    gid = field(db.group.rows[index], 2).toUInt(&ok);
+    return ok;
+}
+
+void Batch::setMember(const QByteArray &group, const QByteArray &user, bool member) {
+    for (Table *table : {&db.group, &db.gshadow}) {
+        const int index = table->find(group);
+        if (index < 0) continue;
+        Row &row = table->rows[index];
+        QByteArrayList members;
+        for (const QByteArray &m : field(row, 3).split(',')) {
+            if (!m.isEmpty()) members.append(m);
+        }
+        const bool has = members.contains(user);
+        if (has == member) continue;
+        if (member) members.append(user);
+        else members.removeAll(user);
+        setField(row, 3, members.join(','));
+        table->changed = true;
+    }
+}
+
+QString Batch::createUser(int index, const QJsonObject &op, QJsonObject &item) {
+    const QByteArray name = op["name"].toString().toUtf8();
+    if (!validName(name)) return "Invalid user name";
+    if (db.passwd.find(name) >= 0) return "User already exists";
+    const bool system = op["system"].toBool(false);
+
+    // Проверяем всё до первого изменения: в режиме atomic=false неудачная
+    // операция не должна оставить следов в копии баз
+    QByteArray gecos = op["gecos"].toString().toUtf8();
+    QByteArray home = op.contains("home") ? op["home"].toString().toUtf8() : defaults.homeBase + "/" + name;
+    QByteArray shell = op.contains("shell") ? op["shell"].toString().toUtf8() : defaults.shell;
+    if (!validField(gecos) || !validField(home) || !validField(shell) || !home.startsWith('/'))
+        return "Invalid gecos, home or shell";
+
+    uint uid = 0;
+    if (op.contains("uid")) {
+        if (!parseId(op["uid"], uid)) return "Invalid UID";
+        if (db.uids.contains(uid)) return QString("UID %1 is already used").arg(uid);
+    } else {
+        QSet<uint> probe = db.uids;
+        if (!allocate(probe, system ? defaults.sysUidMin : defaults.uidMin,
+                      system ? defaults.sysUidMax : defaults.uidMax, system, uid))
+            return "No free UID";
+    }
+
+    QByteArray groupName;
+    uint gid = 0;
+    const bool privateGroup = !op.contains("group");
+    if (!privateGroup) {
+        if (!resolveGroup(op["group"], groupName, gid)) return "Primary group does not exist";
+    } else if (db.group.find(name) >= 0) {
+        return "Group with the user's name already exists; pass group explicitly";
+    }
+    QByteArrayList extra;
+    for (const QJsonValue &value : op["groups"].toArray()) {
+        const QByteArray group = value.toString().toUtf8();
+        if (db.group.find(group) < 0) return QString("Group %1 does not exist").arg(value.toString());
+        extra.append(group);
+    }
+    QString error;
+    QByteArray hash = passwordFor(index, op, &error);
+    if (!error.isEmpty()) return error;
+    if (hash.isEmpty()) hash = "!";     // как useradd без пароля: вход по паролю закрыт
+
+    if (privateGroup) {
+        // Личная группа получает gid, равный uid, если он свободен
+        gid = uid;
+        if (db.gids.contains(gid) && !allocate(db.gids, system ? defaults.sysGidMin : defaults.gidMin,
+                                               system ? defaults.sysGidMax : defaults.gidMax, system, gid))
+            return "No free GID";
+        db.gids.insert(gid);
+        db.group.append(Row{name, "x", QByteArray::number(gid), QByteArray()});
+        if (db.gshadow.exists) db.gshadow.append(Row{name, "!", QByteArray(), QByteArray()});
+    }
+    db.uids.insert(uid);
+    db.passwd.append(Row{name, db.shadow.exists ? QByteArray("x") : hash, QByteArray::number(uid),
+                         QByteArray::number(gid), gecos, home, shell});
+    if (db.shadow.exists) {
+        db.shadow.append(Row{name, hash, QByteArray::number(today), defaults.passMinDays, defaults.passMaxDays,
+                             defaults.passWarnAge, QByteArray(), QByteArray(), QByteArray()});
+    }
+    for (const QByteArray &group : extra) setMember(group, name, true);
+
+    if (op["create_home"].toBool(options["create_home"].toBool(defaults.createHome))) {
+        HomeAction action;
+        action.item = index;
+        action.create = true;
+        action.path = home;
+        action.uid = uid;
+        action.gid = gid;
+        homeActions.append(action);
+    }
+    item["uid"] = qint64(uid);
+    item["gid"] = qint64(gid);
+    return QString();
+}
+
+QString Batch::deleteUser(int index, const QJsonObject &op) {
+    const QByteArray name = op["name"].toString().toUtf8();
+    const int row = db.passwd.find(name);
+    if (row < 0) return "No such user";
+    const Row entry = db.passwd.rows[row];
+    bool ok = false;
+    const uint uid = field(entry, 2).toUInt(&ok);
+    if (!ok || uid == 0) return "Refusing to delete a superuser account";
+    const QByteArray gid = field(entry, 3);
+
+    db.passwd.remove(row);
+    db.uids.remove(uid);
+    const int shadowRow = db.shadow.find(name);
+    if (shadowRow >= 0) db.shadow.remove(shadowRow);
+
+    // Членство во всех группах, в gshadow — и среди администраторов
+    for (const Row &group : QList<Row>(db.group.rows)) {
+        if (group.size() > 3) setMember(group[0], name, false);
+    }
+    for (Row &group : db.gshadow.rows) {
+        if (group.size() < 3) continue;
+        QByteArrayList admins = group[2].split(',');
+        if (admins.removeAll(name) > 0) {
+            group[2] = admins.join(',');
+            db.gshadow.changed = true;
+        }
+    }
+
+    // Личная группа уходит вместе с пользователем, если она больше никому не нужна
+    const int groupRow = db.group.find(name);
+    if (groupRow >= 0 && field(db.group.rows[groupRow], 2) == gid && field(db.group.rows[groupRow], 3).isEmpty()) {
+        bool usedElsewhere = false;
+        for (const Row &other : db.passwd.rows) {
+            if (other.size() > 3 && other[3] == gid) usedElsewhere = true;
+        }
+        if (!usedElsewhere) {
+            db.group.remove(groupRow);
+            db.gids.remove(gid.toUInt());
+            const int gshadowRow = db.gshadow.find(name);
+            if (gshadowRow >= 0) db.gshadow.remove(gshadowRow);
+        }
+    }
+
+    if (op["remove_home"].toBool(false)) {
+        HomeAction action;
+        action.item = index;
+        action.path = field(entry, 5);
+        action.mail = defaults.mailDir + "/" + name;
+        action.uid = uid;
+        homeActions.append(action);
+    }
+    return QString();
+}
+
+QString Batch::setPassword(int index, const QJsonObject &op) {
+    const QByteArray name = op["name"].toString().toUtf8();
+    const int row = db.passwd.find(name);
+    if (row < 0) return "No such user";
+    QString error;
+    QByteArray hash = passwordFor(index, op, &error);
+    if (!error.isEmpty()) return error;
+
+    // Хэш живёт в shadow, а без shadow — прямо в passwd
+    const int shadowRow = db.shadow.exists ? db.shadow.find(name) : -1;
+    const QByteArray current = db.shadow.exists ? (shadowRow >= 0 ? field(db.shadow.rows[shadowRow], 1) : QByteArray("!"))
+                                                : field(db.passwd.rows[row], 1);
+    const bool changed = !hash.isEmpty();
+    if (!changed) hash = current;
+
+    // lock/unlock — как usermod -L/-U: восклицательный знак перед хэшем
+    if (op["lock"].toBool(false) && !hash.startsWith('!')) hash.prepend('!');
+    if (op["unlock"].toBool(false)) {
+        while (hash.startsWith('!')) hash.remove(0, 1);
+        if (hash.isEmpty()) return "Cannot unlock an account without a password";
+    }
+
+    if (!db.shadow.exists) {
+        setField(db.passwd.rows[row], 1, hash);
+        db.passwd.changed = true;
+        return QString();
+    }
+    if (shadowRow < 0) {
+        db.shadow.append(Row{name, hash, QByteArray::number(today), defaults.passMinDays, defaults.passMaxDays,
+                             defaults.passWarnAge, QByteArray(), QByteArray(), QByteArray()});
+        return QString();
+    }
+    Row &entry = db.shadow.rows[shadowRow];
+    setField(entry, 1, hash);
+    if (changed) setField(entry, 2, QByteArray::number(today));
+    db.shadow.changed = true;
+    return QString();
+}
+
+QString Batch::changeGroups(const QJsonObject &op) {
+    const QByteArray name = op["name"].toString().toUtf8();
+    if (db.passwd.find(name) < 0) return "No such user";
+    QByteArrayList add, remove;
+    for (const QJsonValue &value : op["add"].toArray()) add.append(value.toString().toUtf8());
+    for (const QJsonValue &value : op["remove"].toArray()) remove.append(value.toString().toUtf8());
+    if (op.contains("set")) {
+        // set — итоговый список: всё, чего в нём нет, снимается
+        for (const QJsonValue &value : op["set"].toArray()) add.append(value.toString().toUtf8());
+        for (const Row &group : db.group.rows) {
+            if (group.size() > 3 && !add.contains(group[0]) && group[3].split(',').contains(name)) remove.append(group[0]);
+        }
+    }
+    for (const QByteArray &group : add + remove) {
+        if (db.group.find(group) < 0) return QString("Group %1 does not exist").arg(QString::fromUtf8(group));
+    }
+    for (const QByteArray &group : remove) setMember(group, name, false);
+    for (const QByteArray &group : add) setMember(group, name, true);
+    return QString();
+}
+
+QString Batch::createGroup(const QJsonObject &op, QJsonObject &item) {
+    const QByteArray name = op["name"].toString().toUtf8();
+    if (!validName(name)) return "Invalid group name";
+    if (db.group.find(name) >= 0) return "Group already exists";
+    QByteArrayList members;
+    for (const QJsonValue &value : op["members"].toArray()) {
+        const QByteArray member = value.toString().toUtf8();
+        if (db.passwd.find(member) < 0) return QString("User %1 does not exist").arg(value.toString());
+        members.append(member);
+    }
+    const bool system = op["system"].toBool(false);
+    uint gid = 0;
+    if (op.contains("gid")) {
+        if (!parseId(op["gid"], gid)) return "Invalid GID";
+        if (db.gids.contains(gid)) return QString("GID %1 is already used").arg(gid);
+        db.gids.insert(gid);
+    } else if (!allocate(db.gids, system ? defaults.sysGidMin : defaults.gidMin,
+                         system ? defaults.sysGidMax : defaults.gidMax, system, gid)) {
+        return "No free GID";
+    }
+    db.group.append(Row{name, "x", QByteArray::number(gid), members.join(',')});
+    if (db.gshadow.exists) db.gshadow.append(Row{name, "!", QByteArray(), members.join(',')});
+    item["gid"] = qint64(gid);
+    return QString();
+}
+
+QString Batch::deleteGroup(const QJsonObject &op) {
+    const QByteArray name = op["name"].toString().toUtf8();
+    const int row = db.group.find(name);
+    if (row < 0) return "No such group";
+    const QByteArray gid = field(db.group.rows[row], 2);
+    for (const Row &user : db.passwd.rows) {
+        if (user.size() > 3 && user[3] == gid)
+            return QString("Group is the primary group of %1").arg(QString::fromUtf8(user[0]));
+    }
+    db.group.remove(row);
+    db.gids.remove(gid.toUInt());
+    const int gshadowRow = db.gshadow.find(name);
+    if (gshadowRow >= 0) db.gshadow.remove(gshadowRow);
+    return QString();
+}
+
+QString Batch::apply(int index, const QJsonObject &op, QJsonObject &item) {
+    const QString kind = op["op"].toString();
+    if (kind == "create") return createUser(index, op, item);
+    if (kind == "delete") return deleteUser(index, op);
+    if (kind == "password") return setPassword(index, op);
+    if (kind == "groups") return changeGroups(op);
+    if (kind == "create_group") return createGroup(op, item);
+    if (kind == "delete_group") return deleteGroup(op);
+    return QString("Unknown operation: %1").arg(kind);
+}
+
+void Batch::runHomeActions(QJsonArray &items) {
+    for (const HomeAction &action : homeActions) {
+        QJsonObject item = items[action.item].toObject();
+        if (item["status"].toString() != "applied") continue;
+        std::error_code ec;
+        const fs::path home(action.path.toStdString());
+        QString warning;
+        if (action.create) {
+            // Существующий каталог не трогаем — как useradd -m
+            if (fs::exists(home, ec)) {
+                warning = "Home directory already exists";
+            } else if (::mkdir(action.path.constData(), 0700) != 0) {
+                warning = "Cannot create home directory: " + errnoText(errno);
+            } else {
+                fs::copy(defaults.skel.toStdString(), home, fs::copy_options::recursive | fs::copy_options::copy_symlinks, ec);
+                if (ec && ec != std::errc::no_such_file_or_directory) warning = "Cannot copy skeleton: " + QString::fromStdString(ec.message());
+                for (auto it = fs::recursive_directory_iterator(home, ec); !ec && it != fs::recursive_directory_iterator(); it.increment(ec)) {
+                    ::lchown(it->path().c_str(), action.uid, action.gid);
+                }
+                ::chown(action.path.constData(), action.uid, action.gid);
+                ::chmod(action.path.constData(), defaults.homeMode);
+            }
+        } else {
+            // Удаляется только каталог, который действительно принадлежит пользователю
+            struct stat st;
+            if (::lstat(action.path.constData(), &st) != 0) {
+                warning = "Home directory does not exist";
+            } else if (!S_ISDIR(st.st_mode) || st.st_uid != action.uid || home.lexically_normal() == "/") {
+                warning = "Home directory is not owned by the user, left in place";
+            } else {
+                fs::remove_all(home, ec);
+                if (ec) warning = "Cannot remove home directory: " + QString::fromStdString(ec.message());
+            }
+            ::unlink(action.mail.constData());
+        }
+        if (warning.isEmpty()) continue;
+        item["warning"] = warning;
+        items[action.item] = item;
+    }
+}
+
+QJsonObject Batch::run() {
+    const qint64 startedMs = nowMs();
+    QJsonObject result;
+    const bool atomic = options["atomic"].toBool(true);
+    const bool dryRun = options["dry_run"].toBool(false);
+    result["atomic"] = atomic;
+    result["dry_run"] = dryRun;
+    result["committed"] = false;
+    if (operations.size() > kMaxOperations) {
+        result["error"] = QString("Too many operations (limit %1)").arg(kMaxOperations);
+        return result;
+    }
+
+    std::vector<QByteArray> plain(size_t(operations.size()));
+    for (int i = 0; i < operations.size(); ++i) {
+        const QJsonObject op = operations[i].toObject();
+        if (op.contains("password") && !op.contains("password_hash")) plain[size_t(i)] = op["password"].toString().toUtf8();
+    }
+    if (!dryRun) hashPasswords(plain, hashes);
+    else for (const QByteArray &password : plain) hashes.push_back(password.isNull() ? QByteArray() : QByteArray("!"));
+
+    db.passwd.path = paths.passwd;
+    db.shadow.path = paths.shadow;
+    db.group.path = paths.group;
+    db.gshadow.path = paths.gshadow;
+    DatabaseLock lock;
+    QString error;
+    if (!dryRun && !lock.acquire(db, paths.isSystem(), &error)) {
+        result["error"] = error;
+        return result;
+    }
+    for (Table *table : db.tables()) {
+        if (!table->load(&error)) {
+            result["error"] = error;
+            return result;
+        }
+    }
+    if (!db.passwd.exists || !db.group.exists) {
+        result["error"] = QString("%1 or %2 is missing").arg(QString::fromLatin1(paths.passwd),
+                                                              QString::fromLatin1(paths.group));
+        return result;
+    }
+    for (const Row &row : db.passwd.rows) {
+        bool ok = false;
+        const uint uid = field(row, 2).toUInt(&ok);
+        if (ok && row.size() > 2) db.uids.insert(uid);
+    }
+    for (const Row &row : db.group.rows) {
+        bool ok = false;
+        const uint gid = field(row, 2).toUInt(&ok);
+        if (ok && row.size() > 2) db.gids.insert(gid);
+    }
+    today = QDateTime::currentSecsSinceEpoch() / 86400;
+
+    QJsonArray items;
+    int applied = 0, failed = 0;
+    for (int i = 0; i < operations.size(); ++i) {
+        const QJsonObject op = operations[i].toObject();
+        QJsonObject item{{"index", i}, {"op", op["op"].toString()}, {"name", op["name"].toString()}};
+        // В атомарном режиме после первой ошибки остальное только проверяется на копии
+        const QString itemError = apply(i, op, item);
+        if (itemError.isEmpty()) {
+            item["status"] = "applied";
+            ++applied;
+        } else {
+            item["status"] = "failed";
+            item["error"] = itemError;
+            ++failed;
+        }
+        items.append(item);
+    }
+
+    bool commitNow = !dryRun && applied > 0 && (!atomic || failed == 0);
+    if (atomic && failed > 0) {
+        // Ничего не записано: проверенные операции помечаются как пропущенные
+        for (int i = 0; i < items.size(); ++i) {
+            QJsonObject item = items[i].toObject();
+            if (item["status"].toString() == "applied") item["status"] = "skipped";
+            items[i] = item;
+        }
+        applied = 0;
+        result["error"] = "Batch rejected: some operations are invalid, nothing was changed";
+    }
+    if (commitNow) {
+        bool rolledBack = false;
+        if (!commit(db, &error, &rolledBack)) {
+            for (int i = 0; i < items.size(); ++i) {
+                QJsonObject item = items[i].toObject();
+                if (item["status"].toString() == "applied") item["status"] = "skipped";
+                items[i] = item;
+            }
+            applied = 0;
+            result["error"] = error;
+            result["rolled_back"] = rolledBack;
+            commitNow = false;
+        }
+    }
+    result["committed"] = commitNow;
+    if (commitNow) {
+        lock.release();
+        if (paths.isSystem()) invalidateCaches(db);
+        runHomeActions(items);
+    }
+    result["items"] = items;
+    result["applied"] = applied;
+    result["failed"] = failed;
+    result["elapsed_ms"] = nowMs() - startedMs;
+    return result;
+}
+
+} // namespace
+
+DatabasePaths DatabasePaths::underRoot(const QByteArray &root) {
+    const DatabasePaths system;
+    DatabasePaths paths;
+    QByteArray prefix = root;
+    while (prefix.endsWith('/')) prefix.chop(1);
+    paths.passwd = prefix + system.passwd;
+    paths.shadow = prefix + system.shadow;
+    paths.group = prefix + system.group;
+    paths.gshadow = prefix + system.gshadow;
+    return paths;
+}
+
+bool DatabasePaths::isSystem() const {
+    const DatabasePaths system;
+    return passwd == system.passwd && shadow == system.shadow
+        && group == system.group && gshadow == system.gshadow;
+}
+
+QJsonObject applyBatch(const QJsonArray &operations, const QJsonObject &options, const DatabasePaths &paths) {
+    Batch batch(operations, options, paths);
+    return batch.run();
+}
+
+} // namespace accounts
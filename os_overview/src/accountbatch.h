@@ -0,0 +1,42 @@
+#ifndef ACCOUNTBATCH_H
+#define ACCOUNTBATCH_H
+
+#include <QJsonArray>
+#include <QJsonObject>
+
+// Пакетное изменение учётных записей без useradd/chpasswd. passwd, shadow,
+// group и gshadow читаются один раз под общей блокировкой (lckpwdf и файлы
+// .lock, как у shadow-utils), операции по очереди проверяются и применяются
+// к копии в памяти, затем изменённые файлы заменяются переименованием.
+//
+// Откат: atomic=true (по умолчанию) — при любой ошибке проверки не пишется
+// ничего; atomic=false — неверные операции пропускаются, остальные
+// применяются. Если сбой случился при замене файлов, уже заменённые
+// возвращаются к прежнему содержимому. Домашние каталоги создаются и
+// удаляются после записи: их ошибки попадают в warning операции и
+// учётные записи не откатывают.
+namespace accounts {
+
+// Файлы баз. По умолчанию — системные в /etc: только для них берётся
+// lckpwdf и сбрасываются кэши nscd/sssd. underRoot — те же файлы в
+// <root>/etc, как у useradd --prefix (образы систем, тесты на копиях).
+struct DatabasePaths {
+    QByteArray passwd = "/etc/passwd";
+    QByteArray shadow = "/etc/shadow";
+    QByteArray group = "/etc/group";
+    QByteArray gshadow = "/etc/gshadow";
+
+    static DatabasePaths underRoot(const QByteArray &root);
+    bool isSystem() const;
+};
+
+// operations: [{op: create | delete | password | groups | create_group | delete_group, name, ...}]
+// options: atomic, dry_run, create_home (умолчание для create, иначе CREATE_HOME из login.defs).
+// Ответ: {items: [{index, op, name, status: applied | failed | skipped, error, warning}],
+// committed, applied, failed, elapsed_ms, error}. Выполняется в вызывающем потоке.
+QJsonObject applyBatch(const QJsonArray &operations, const QJsonObject &options,
+                       const DatabasePaths &paths = DatabasePaths());
+
+} // namespace accounts
+
+#endif // ACCOUNTBATCH_H
@@ -0,0 +1,245 @@
+#include "archivetransfer.h"
+#include "directoryarchive.h"
+#include <QDateTime>
+#include <QDir>
+#include <QIODevice>
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+static const int kPollIntervalMs = 50;
+static const int kChunkSize = 256 * 1024;
+static const size_t kMaxQueuedChunks = 8;                 // готовых порций, ждущих сокета
+static const qint64 kMaxSocketQueue = 4 * 1024 * 1024;     // предел очереди записи клиента
+static const int kCompressionLevel = 3;
+static const int kMaxDownloadsPerClient = 4;
+static const int kMaxUploadsPerClient = 4;
+
+static qint64 nowMs() {
+    return QDateTime::currentMSecsSinceEpoch();
+}
+
+struct ArchiveTransfer::Download {
+    quint64 id = 0;
+    QObject *owner = nullptr;
+    QString path;
+    qint64 startedMs = 0;
+    qint64 sentBytes = 0;
+    std::unique_ptr<DirectoryPacker> packer;
+
+    std::mutex mutex;
+    std::condition_variable spaceAvailable;
+    std::deque<QByteArray> chunks;   // под mutex
+    bool producerDone = false;       // под mutex
+    bool cancelled = false;          // под mutex
+    std::thread producer;
+
+    ~Download() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            cancelled = true;
+        }
+        spaceAvailable.notify_all();
+        if (producer.joinable()) producer.join();
+    }
+
+    void run();
+};
+
+// Поток-производитель: обход, чтение и сжатие идут, пока в очереди есть место
+void ArchiveTransfer::Download::run() {
+    for (;;) {
+        QByteArray chunk = packer->next(kChunkSize);
+        std::unique_lock<std::mutex> lock(mutex);
+        spaceAvailable.wait(lock, [this] { return cancelled || chunks.size() < kMaxQueuedChunks; });
+        if (cancelled) return;
+        if (chunk.isEmpty()) {
+            producerDone = true;
+            return;
+        }
+        chunks.push_back(std::move(chunk));
+    }
+}
+
+struct ArchiveTransfer::Upload {
+    QObject *owner = nullptr;
+    QString path;
+    std::unique_ptr<DirectoryUnpacker> unpacker;
+    qint64 received = 0;
+    qint64 startedMs = 0;
+};
+
+ArchiveTransfer::ArchiveTransfer(QObject *parent) : QObject(parent) {
+    connect(&pollTimer, &QTimer::timeout, this, &ArchiveTransfer::pump);
+}
+
+ArchiveTransfer::~ArchiveTransfer() {
+    // ~Download останавливает и дожидается потоков
+    downloads.clear();
+    uploads.clear();
+}
+
+quint64 ArchiveTransfer::startDownload(QObject *owner, const QString &path, const QStringList &include,
+                                       const QStringList &exclude, QString *error) {
+    int active = 0;
+    for (const auto &download : downloads) {
+        if (download->owner == owner) ++active;
+    }
+    if (active >= kMaxDownloadsPerClient) {
+        if (error) *error = "Too many concurrent downloads";
+        return 0;
+    }
+
+    auto download = std::make_shared<Download>();
+    download->owner = owner;
+    download->path = QDir::cleanPath(path);
+    download->startedMs = nowMs();
+    download->packer = std::make_unique<DirectoryPacker>(download->path, ArchiveFilter(include, exclude), kCompressionLevel);
+    if (path.isEmpty() || !download->packer->open(error)) {
+        if (error && path.isEmpty()) *error = "remotePath is required";
+        return 0;
+    }
+
+    download->id = nextDownloadId++;
+    downloads.insert(download->id, download);
+    // Сокет освободился — сразу отдаём следующую порцию, не дожидаясь таймера
+    if (auto *device = qobject_cast<QIODevice *>(owner)) {
+        connect(device, &QIODevice::bytesWritten, this, &ArchiveTransfer::pump, Qt::UniqueConnection);
+    }
+    if (!pollTimer.isActive()) pollTimer.start(kPollIntervalMs);
+
+    Download *raw = download.get();
+    download->producer = std::thread([raw] { raw->run(); });
+    return download->id;
+}
+
+bool ArchiveTransfer::cancelDownload(QObject *owner, quint64 id) {
+    auto it = downloads.find(id);
+    if (it == downloads.end() || it.value()->owner != owner) return false;
+    downloads.erase(it);
+    if (downloads.isEmpty()) pollTimer.stop();
+    return true;
+}
+
+void ArchiveTransfer::pump() {
+    // flush() сокета может синхронно выдать bytesWritten и вернуть нас сюда же
+    if (pumping) return;
+    pumping = true;
+    QList<quint64> finished;
+    const auto active = downloads.values();
+    for (const auto &download : active) {
+        auto *device = qobject_cast<QIODevice *>(download->owner);
+        while (!device || device->bytesToWrite() < kMaxSocketQueue) {
+            QByteArray chunk;
+            bool done = false;
+            {
+                std::lock_guard<std::mutex> lock(download->mutex);
+                if (!download->chunks.empty()) {
+                    chunk = std::move(download->chunks.front());
+                    download->chunks.pop_front();
+                }
+                done = download->chunks.empty() && download->producerDone;
+            }
+            if (chunk.isEmpty() && !done) break;
+            download->spaceAvailable.notify_one();
+            download->sentBytes += chunk.size();
+
+            QJsonObject status;
+            if (done) {
+                const DirectoryPacker &packer = *download->packer;
+                const QString packError = packer.errorString();
+                status["status"] = packError.isEmpty() ? "success" : "error";
+                if (!packError.isEmpty()) status["error"] = packError;
+                status["path"] = download->path;
+                status["files"] = packer.fileCount();
+                status["directories"] = packer.directoryCount();
+                status["bytes"] = packer.bytesRead();
+                status["skipped"] = packer.skippedCount();
+                status["compressed_bytes"] = download->sentBytes;
+                status["elapsed_ms"] = nowMs() - download->startedMs;
+                finished.append(download->id);
+            }
+            emit downloadData(download->owner, download->id, chunk, done, status);
+            if (done) break;
+        }
+    }
+    for (quint64 id : finished) downloads.remove(id);
+    if (downloads.isEmpty()) pollTimer.stop();
+    pumping = false;
+}
+
+QString ArchiveTransfer::beginUpload(QObject *owner, const QJsonObject &params, QString *error) {
+    int active = 0;
+    for (const auto &upload : uploads) {
+        if (upload->owner == owner) ++active;
+    }
+    if (active >= kMaxUploadsPerClient) {
+        if (error) *error = "Too many concurrent uploads";
+        return QString();
+    }
+    if (params["remotePath"].toString().isEmpty()) {
+        if (error) *error = "remotePath is required";
+        return QString();
+    }
+
+    auto upload = std::make_shared<Upload>();
+    upload->owner = owner;
+    upload->path = QDir::cleanPath(params["remotePath"].toString());
+    upload->startedMs = nowMs();
+    upload->unpacker = std::make_unique<DirectoryUnpacker>(upload->path);
+    if (!upload->unpacker->open(error)) return QString();
+
+    const QString session = QString::number(nextSessionId++);
+    uploads.insert(session, upload);
+    return session;
+}
+
+qint64 ArchiveTransfer::applyChunk(QObject *owner, const QString &session, const QByteArray &data, QString *error) {
+    auto it = uploads.find(session);
+    if (it == uploads.end() || it.value()->owner != owner) {
+        if (error) *error = "Unknown upload session";
+        return -1;
+    }
+    Upload &upload = *it.value();
+    upload.received += data.size();
+    if (!upload.unpacker->feed(data.constData(), data.size())) {
+        if (error) *error = upload.unpacker->errorString();
+        uploads.erase(it);
+        return -1;
+    }
+    return upload.unpacker->bytesWritten();
+}
+
+QJsonObject ArchiveTransfer::finishUpload(QObject *owner, const QString &session, QString *error) {
+    auto it = uploads.find(session);
+    if (it == uploads.end() || it.value()->owner != owner) {
+        if (error) *error = "Unknown upload session";
+        return QJsonObject();
+    }
+    std::shared_ptr<Upload> upload = it.value();
+    uploads.erase(it);
+    if (!upload->unpacker->finish(error)) return QJsonObject();
+
+    QJsonObject result;
+    result["status"] = "success";
+    result["path"] = upload->path;
+    result["files"] = upload->unpacker->fileCount();
+    result["bytes"] = upload->unpacker->bytesWritten();
+    result["compressed_bytes"] = upload->received;
+    result["elapsed_ms"] = nowMs() - upload->startedMs;
+    return result;
+}
+
+void ArchiveTransfer::abortAll(QObject *owner) {
+    for (auto it = downloads.begin(); it != downloads.end();) {
+        if (it.value()->owner == owner) it = downloads.erase(it);
+        else ++it;
+    }
+    for (auto it = uploads.begin(); it != uploads.end();) {
+        if (it.value()->owner == owner) it = uploads.erase(it);
+        else ++it;
+    }
+    if (downloads.isEmpty()) pollTimer.stop();
+}
@@ -0,0 +1,62 @@
+#ifndef ARCHIVETRANSFER_H
+#define ARCHIVETRANSFER_H
+
+#include <QObject>
+#include <QJsonObject>
+#include <QHash>
+#include <QStringList>
+#include <QTimer>
+#include <memory>
+
+// Передача каталогов целиком: tar, сжатый zstd на лету (формат — common/archivestream.h).
+//
+// Скачивание — конвейер с ограниченной памятью: поток обходит дерево, читает и
+// сжимает файлы в очередь из нескольких порций и ждёт, пока основной поток не
+// отдаст их в сокет. Порция уходит клиенту, только пока очередь записи сокета
+// меньше предела, так что медленный клиент тормозит обход, а не раздувает память.
+//
+// Загрузка — обратный путь: клиент шлёт сжатые порции, они распаковываются
+// сразу в целевой каталог (DirectoryUnpacker не выпускает записи за его пределы).
+class ArchiveTransfer : public QObject
+{
+    Q_OBJECT
+public:
+    explicit ArchiveTransfer(QObject *parent = nullptr);
+    ~ArchiveTransfer();
+
+    // owner — сокет клиента: по его очереди записи регулируется отдача.
+    // 0 — ошибка, текст в error.
+    quint64 startDownload(QObject *owner, const QString &path, const QStringList &include,
+                          const QStringList &exclude, QString *error);
+    bool cancelDownload(QObject *owner, quint64 id);
+
+    // params: remotePath. Пустая строка — ошибка
+    QString beginUpload(QObject *owner, const QJsonObject &params, QString *error);
+    // Возвращает число распакованных байт на данный момент; -1 — ошибка, сессия закрыта
+    qint64 applyChunk(QObject *owner, const QString &session, const QByteArray &data, QString *error);
+    // Пустой объект — архив неполный или повреждён
+    QJsonObject finishUpload(QObject *owner, const QString &session, QString *error);
+
+    // Отменить всё, что связано с клиентом (при отключении)
+    void abortAll(QObject *owner);
+
+signals:
+    // Очередная порция архива; done=true — последняя, в status итог или error
+    void downloadData(QObject *owner, quint64 id, const QByteArray &data, bool done, const QJsonObject &status);
+
+private slots:
+    void pump();
+
+private:
+    struct Download;
+    struct Upload;
+
+    QHash<quint64, std::shared_ptr<Download>> downloads;
+    QHash<QString, std::shared_ptr<Upload>> uploads;
+    QTimer pollTimer;
+    quint64 nextDownloadId = 1;
+    quint64 nextSessionId = 1;
+    bool pumping = false;
+};
+
+#endif // ARCHIVETRANSFER_H
@@ -0,0 +1,327 @@
+#include "connectionmanager.h"
+#include "procfs.h"
+#include <QDateTime>
+#include <QSet>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+static const char *kTcpStates[] = {
+    "UNKNOWN", "ESTABLISHED", "SYN_SENT", "SYN_RECV", "FIN_WAIT1", "FIN_WAIT2",
+    "TIME_WAIT", "CLOSE", "CLOSE_WAIT", "LAST_ACK", "LISTEN", "CLOSING", "NEW_SYN_RECV"
+};
+
+// Столько индекс поддерживается после последнего запроса
+static const qint64 kIdleStopMs = 60 * 1000;
+
+static uint64_t parseHex(std::string_view text) {
+    uint64_t value = 0;
+    for (char c : text) {
+        int digit;
+        if      (c >= '0' && c <= '9') digit = c - '0';
+        else if (c >= 'A' && c <= 'F') digit = c - 'A' + 10;
+        else if (c >= 'a' && c <= 'f') digit = c - 'a' + 10;
+        else break;
+        value = (value << 4) | uint64_t(digit);
+    }
+    return value;
+}
+
+static QString toQString(std::string_view v) {
+    return QString::fromUtf8(v.data(), int(v.size()));
+}
+
+// "0100007F:0016" — адрес печатается ядром как 32-битные слова в порядке хоста
+static bool parseEndpoint(std::string_view text, bool v6, QString& address, int& port) {
+    const size_t colon = text.find(':');
+    if (colon == std::string_view::npos) return false;
+    const std::string_view hex = text.substr(0, colon);
+    port = int(parseHex(text.substr(colon + 1)));
+
+    char buffer[INET6_ADDRSTRLEN];
+    if (!v6) {
+        in_addr addr;
+        addr.s_addr = uint32_t(parseHex(hex));
+        inet_ntop(AF_INET, &addr, buffer, sizeof(buffer));
+    } else {
+        if (hex.size() < 32) return false;
+        in6_addr addr;
+        for (int i = 0; i < 4; ++i) {
+            const uint32_t word = uint32_t(parseHex(hex.substr(size_t(i) * 8, 8)));
+            std::memcpy(addr.s6_addr + i * 4, &word, 4);
+        }
+        inet_ntop(AF_INET6, &addr, buffer, sizeof(buffer));
+    }
+    address = QString::fromLatin1(buffer);
+    return true;
+}
+
+ConnectionManager::ConnectionManager(QObject* parent) : QObject(parent) {
+    procFd = ::open("/proc", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    connect(&timer, &QTimer::timeout, this, &ConnectionManager::indexStep);
+}
+
+ConnectionManager::~ConnectionManager() {
+    if (procFd >= 0) ::close(procFd);
+}
+
+void ConnectionManager::start(int interval, int perTick) {
+    tickMs = interval;
+    pidsPerTick = perTick;
+}
+
+// Один шаг индексации: не больше pidsPerTick процессов за тик
+void ConnectionManager::indexStep() {
+    if (procFd < 0) return;
+
+    if (pending.empty()) {
+        const qint64 now = QDateTime::currentMSecsSinceEpoch();
+        if (now - lastRequestMs > kIdleStopMs) {
+            // Запросов давно нет: останавливаемся и не держим индекс, который
+            // без обхода начнёт приписывать сокеты чужим pid
+            timer.stop();
+            owners.clear();
+            inodeToPid.clear();
+            seenInPass.clear();
+            pass = 0;
+            return;
+        }
+        if (pass > 0) {
+            // Процессы, не встреченные за весь проход, завершились
+            for (auto it = owners.begin(); it != owners.end();) {
+                if (seenInPass.value(it.key()) != pass) {
+                    for (quint64 inode : it->inodes) {
+                        if (inodeToPid.value(inode) == it.key()) inodeToPid.remove(inode);
+                    }
+                    seenInPass.remove(it.key());
+                    it = owners.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+            lastPassMs = now - passStartedMs;
+        }
+        ++pass;
+        passStartedMs = now;
+        procfs::DirReader reader;
+        procfs::listPids(procFd, pending, reader);
+    }
+
+    for (int budget = pidsPerTick; budget > 0 && !pending.empty(); --budget) {
+        const int pid = pending.back();
+        pending.pop_back();
+        indexPid(pid);
+    }
+}
+
+void ConnectionManager::indexPid(int pid) {
+    char name[32];
+    std::snprintf(name, sizeof(name), "%d/fd", pid);
+    QVector<quint64> inodes;
+    const int fdDir = ::openat(procFd, name, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fdDir >= 0) {
+        procfs::DirReader reader(8192);
+        reader.reset(fdDir);
+        procfs::DirReader::Entry entry;
+        char target[64];
+        while (reader.next(entry)) {
+            if (entry.name[0] == '.') continue;
+            const ssize_t n = ::readlinkat(fdDir, entry.name, target, sizeof(target) - 1);
+            // Ссылка на сокет выглядит как "socket:[12345]"
+            if (n > 8 && std::memcmp(target, "socket:[", 8) == 0) {
+                inodes.append(procfs::toU64(std::string_view(target + 8, size_t(n - 8))));
+            }
+        }
+        ::close(fdDir);
+    }
+
+    auto it = owners.find(pid);
+    if (it != owners.end()) {
+        for (quint64 inode : it->inodes) {
+            if (inodeToPid.value(inode) == pid) inodeToPid.remove(inode);
+        }
+    }
+    if (inodes.isEmpty()) {
+        if (it != owners.end()) owners.erase(it);
+        seenInPass.remove(pid);
+        return;
+    }
+
+    Owner& owner = owners[pid];
+    std::snprintf(name, sizeof(name), "%d/comm", pid);
+    procfs::FileBuffer comm(64);
+    if (comm.readAt(procFd, name)) owner.name = toQString(comm.view()).trimmed();
+    owner.inodes = inodes;
+    for (quint64 inode : inodes) inodeToPid.insert(inode, pid);
+    seenInPass.insert(pid, pass);
+}
+
+QJsonObject ConnectionManager::getConnections(const QJsonObject& filter) {
+    lastRequestMs = QDateTime::currentMSecsSinceEpoch();
+    if (!timer.isActive() && procFd >= 0) timer.start(tickMs);
+
+    QSet<QString> protos;
+    const QJsonValue protoValue = filter["proto"];
+    if (protoValue.isString()) protos.insert(protoValue.toString());
+    for (const QJsonValue& p : protoValue.toArray()) protos.insert(p.toString());
+    if (protos.isEmpty()) protos = { "tcp", "tcp6", "udp", "udp6", "unix" };
+
+    const QString stateFilter = filter["state"].toString().toUpper();
+    const int portFilter = filter["port"].toInt(0);
+    const int pidFilter = filter["pid"].toInt(0);
+    const int limit = filter["limit"].toInt(0);
+    const bool summary = filter["summary"].toBool(false);
+
+    QJsonArray connections;
+    QHash<int, int> perPid;
+    qint64 matched = 0;
+    qint64 unowned = 0;
+
+    auto accept = [&](int pid) {
+        ++matched;
+        if (summary) {
+            if (pid > 0) perPid[pid]++;
+            else         ++unowned;
+        }
+        return limit <= 0 || connections.size() < limit;
+    };
+    auto withOwner = [this](QJsonObject& row, quint64 inode) {
+        const int pid = inodeToPid.value(inode, 0);
+        if (pid > 0) {
+            row["pid"] = pid;
+            row["process"] = owners.value(pid).name;
+        }
+        return pid;
+    };
+
+    procfs::FileBuffer buffer(256 * 1024);
+    for (const char* proto : { "tcp", "tcp6", "udp", "udp6" }) {
+        if (!protos.contains(proto)) continue;
+        const bool v6 = std::strchr(proto, '6') != nullptr;
+        const bool tcp = proto[0] == 't';
+        if (!buffer.read(QByteArray("/proc/net/").append(proto).constData())) continue;
+
+        procfs::Scanner lines(buffer.view());
+        lines.line(); // заголовок
+        while (!lines.atEnd()) {
+            procfs::Scanner sc(lines.line());
+            if (sc.word().empty()) continue;               // "sl:"
+            const std::string_view local = sc.word();
+            const std::string_view remote = sc.word();
+            const int stateCode = int(parseHex(sc.word()));
+            const std::string_view queues = sc.word();      // tx:rx
+            sc.skipWords(2);                                 // tr:when, retrnsmt
+            uint64_t uid = 0, inode = 0;
+            sc.u64(uid);
+            sc.skipWords(1);                                 // timeout
+            sc.u64(inode);
+
+            QString state;
+            if (tcp) state = QString::fromLatin1(stateCode < 13 ? kTcpStates[stateCode] : "UNKNOWN");
+            else     state = (stateCode == 7) ? "UNCONN" : "ESTABLISHED";
+            if (!stateFilter.isEmpty() && state != stateFilter) continue;
+
+            QString localAddress, remoteAddress;
+            int localPort = 0, remotePort = 0;
+            if (!parseEndpoint(local, v6, localAddress, localPort)) continue;
+            parseEndpoint(remote, v6, remoteAddress, remotePort);
+            if (portFilter > 0 && localPort != portFilter && remotePort != portFilter) continue;
+
+            const int pid = inodeToPid.value(inode, 0);
+            if (pidFilter > 0 && pid != pidFilter) continue;
+            if (!accept(pid)) continue;
+
+            QJsonObject row;
+            row["proto"] = QString::fromLatin1(proto);
+            row["local_address"] = localAddress;
+            row["local_port"] = localPort;
+            row["remote_address"] = remoteAddress;
+            row["remote_port"] = remotePort;
+            row["state"] = state;
+            row["uid"] = qint64(uid);
+            row["inode"] = qint64(inode);
+            const size_t colon = queues.find(':');
+            if (colon != std::string_view::npos) {
+                row["tx_queue"] = qint64(parseHex(queues.substr(0, colon)));
+                row["rx_queue"] = qint64(parseHex(queues.substr(colon + 1)));
+            }
+            withOwner(row, inode);
+            connections.append(row);
+        }
+    }
+
+    if (protos.contains("unix") && buffer.read("/proc/net/unix")) {
+        procfs::Scanner lines(buffer.view());
+        lines.line(); // заголовок
+        while (!lines.atEnd()) {
+            procfs::Scanner sc(lines.line());
+            if (sc.word().empty()) continue;               // "Num:"
+            sc.skipWords(2);                                 // RefCount, Protocol
+            const uint64_t flags = parseHex(sc.word());
+            const uint64_t type = parseHex(sc.word());
+            const uint64_t st = parseHex(sc.word());
+            uint64_t inode = 0;
+            sc.u64(inode);
+            sc.skipSpaces();
+            const std::string_view path = sc.rest();
+
+            // __SO_ACCEPTCON в флагах означает слушающий сокет
+            QString state;
+            if (flags & 0x10000)  state = "LISTEN";
+            else if (st == 3)     state = "CONNECTED";
+            else if (st == 2)     state = "CONNECTING";
+            else if (st == 4)     state = "DISCONNECTING";
+            else                  state = "UNCONNECTED";
+            if (!stateFilter.isEmpty() && state != stateFilter) continue;
+            if (portFilter > 0) continue;
+
+            const int pid = inodeToPid.value(inode, 0);
+            if (pidFilter > 0 && pid != pidFilter) continue;
+            if (!accept(pid)) continue;
+
+            QJsonObject row;
+            row["proto"] = "unix";
+            row["type"] = (type == 1) ? "stream" : (type == 2) ? "dgram" : (type == 5) ? "seqpacket" : "other";
+            row["state"] = state;
+            row["inode"] = qint64(inode);
+            if (!path.empty()) row["path"] = toQString(path);
+            withOwner(row, inode);
+            connections.append(row);
+        }
+    }
+
+    QJsonObject result;
+    result["total"] = matched;
+    result["connections"] = connections;
+    result["index"] = QJsonObject{
+        {"processes", owners.size()},
+        {"sockets", inodeToPid.size()},
+        {"pending", int(pending.size())},
+        {"pass", qint64(pass)},
+        {"last_pass_ms", lastPassMs}
+    };
+    if (summary) {
+        QVector<QPair<int, int>> counts;
+        for (auto it = perPid.cbegin(); it != perPid.cend(); ++it) counts.append({ it.value(), it.key() });
+        std::sort(counts.begin(), counts.end(), [](const QPair<int, int>& a, const QPair<int, int>& b) {
+            return a.first > b.first;
+        });
+        QJsonArray byPid;
+        for (int i = 0; i < counts.size() && i < 50; ++i) {
+            QJsonObject item;
+            item["pid"] = counts[i].second;
+            item["process"] = owners.value(counts[i].second).name;
+            item["sockets"] = counts[i].first;
+            byPid.append(item);
+        }
+        result["by_pid"] = byPid;
+        // Сокеты ядра, чужих пространств имён и ещё не проиндексированных процессов
+        result["unowned"] = unowned;
+    }
+    return result;
+}
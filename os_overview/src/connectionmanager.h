@@ -0,0 +1,57 @@
+#ifndef CONNECTIONMANAGER_H
+#define CONNECTIONMANAGER_H
+
+#include <QObject>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QHash>
+#include <QVector>
+#include <QTimer>
+#include <vector>
+
+// Таблица сокетов из /proc/net/{tcp,tcp6,udp,udp6,unix} и индекс inode → pid.
+// Индекс строится обходом /proc/[pid]/fd порциями по таймеру, поэтому
+// запрос не ждёт полного обхода дескрипторов всех процессов. Обход идёт
+// только пока getConnections кто-то вызывает: после минуты без запросов
+// таймер останавливается, а устаревший индекс сбрасывается.
+class ConnectionManager : public QObject
+{
+    Q_OBJECT
+public:
+    explicit ConnectionManager(QObject *parent = nullptr);
+    ~ConnectionManager();
+
+    // Только параметры обхода; сам обход запускает первый запрос
+    void start(int tickMs = 100, int pidsPerTick = 256);
+
+    // Фильтры: proto (строка или массив), state, port (локальный или удалённый),
+    // pid, limit. summary=true добавляет число сокетов по процессам (by_pid)
+    // и отдельно — сокетов без найденного владельца (unowned).
+    QJsonObject getConnections(const QJsonObject &filter);
+
+private slots:
+    void indexStep();
+
+private:
+    struct Owner {
+        QString name;
+        QVector<quint64> inodes;
+    };
+
+    void indexPid(int pid);
+
+    int procFd = -1;
+    QTimer timer;
+    int tickMs = 100;
+    int pidsPerTick = 256;
+    qint64 lastRequestMs = 0;
+    std::vector<int> pending;      // pid'ы, ещё не обойдённые в текущем проходе
+    QHash<int, Owner> owners;      // pid → его сокеты
+    QHash<quint64, int> inodeToPid;
+    QHash<int, quint64> seenInPass; // pid → номер прохода, в котором он обойдён
+    quint64 pass = 0;
+    qint64 passStartedMs = 0;
+    qint64 lastPassMs = 0;         // длительность последнего полного прохода
+};
+
+#endif // CONNECTIONMANAGER_H
@@ -0,0 +1,664 @@
+#include "contentsearch.h"
+#include "directoryarchive.h"
+#include "regexliteral.h"
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QJsonArray>
+#include <QRegularExpression>
+
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <strings.h>
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace fs = std::filesystem;
+
+static const int kReportIntervalMs = 250;
+static const size_t kSegmentSize = 32 * 1024 * 1024;
+static const size_t kBinaryProbe = 4096;          // NUL в начале файла — считаем двоичным
+static const size_t kMaxLineBytes = 1024;         // длиннее строка обрезается в ответе
+static const int kMaxContext = 5;
+static const int kDefaultMaxMatches = 1000;
+static const int kMaxMatchesLimit = 100000;
+static const qint64 kDefaultMaxBytes = qint64(16) * 1024 * 1024 * 1024;
+static const size_t kMaxFiles = 200000;
+static const int kMaxReportedErrors = 20;
+
+static qint64 nowMs() {
+    return QDateTime::currentMSecsSinceEpoch();
+}
+
+namespace {
+
+enum Truncation { NotTruncated = 0, TruncatedMatches, TruncatedBytes, TruncatedFiles };
+
+struct Hit {
+    uint64_t line = 0;             // в сегменте — от его начала, после публикации — номер в файле
+    std::string text;
+    std::vector<std::string> before, after;
+};
+
+struct SegmentResult {
+    bool done = false;
+    bool partial = false;          // прерван — переводы строк посчитаны не до конца
+    uint64_t newlines = 0;
+    std::vector<Hit> hits;
+};
+
+// Файл могут усечь прямо во время поиска (logrotate copytruncate), и чтение
+// отображения за новым концом даёт SIGBUS. Поток, читающий отображение,
+// регистрирует его здесь; обработчик подменяет хвост отображения от
+// сбойной страницы анонимными нулевыми страницами и отмечает файл усечённым.
+// Прерванное чтение повторяется и видит нули, поиск по файлу останавливается.
+long pageSize = 0;
+struct sigaction previousBusAction;
+thread_local const char *guardedData = nullptr;
+thread_local size_t guardedSize = 0;
+thread_local std::atomic<bool> *guardedFlag = nullptr;
+
+void onBusError(int, siginfo_t *info, void *) {
+    const char *address = static_cast<const char *>(info->si_addr);
+    if (guardedData && address >= guardedData && address < guardedData + guardedSize) {
+        char *from = reinterpret_cast<char *>(reinterpret_cast<uintptr_t>(address) & ~uintptr_t(pageSize - 1));
+        const size_t length = size_t(guardedData + guardedSize - from);
+        if (::mmap(from, length, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0) != MAP_FAILED) {
+            guardedFlag->store(true, std::memory_order_relaxed);
+            return;
+        }
+    }
+    // Не наше отображение: возвращаем прежний обработчик, инструкция
+    // повторится и сигнал обработается как раньше
+    ::sigaction(SIGBUS, &previousBusAction, nullptr);
+}
+
+void installBusHandler() {
+    static std::once_flag installed;
+    std::call_once(installed, [] {
+        pageSize = ::sysconf(_SC_PAGESIZE);
+        struct sigaction action;
+        std::memset(&action, 0, sizeof(action));
+        action.sa_sigaction = onBusError;
+        action.sa_flags = SA_SIGINFO;
+        sigemptyset(&action.sa_mask);
+        ::sigaction(SIGBUS, &action, &previousBusAction);
+    });
+}
+
+// Отображение, которое текущий поток читает, пока жив объект
+class MappingGuard {
+public:
+    MappingGuard(const char *data, size_t size, std::atomic<bool> &truncated) {
+        guardedData = data;
+        guardedSize = size;
+        guardedFlag = &truncated;
+        std::atomic_signal_fence(std::memory_order_seq_cst);
+    }
+    ~MappingGuard() {
+        std::atomic_signal_fence(std::memory_order_seq_cst);
+        guardedData = nullptr;
+        guardedSize = 0;
+        guardedFlag = nullptr;
+    }
+    MappingGuard(const MappingGuard &) = delete;
+    MappingGuard &operator=(const MappingGuard &) = delete;
+};
+
+// Файл отображается первым взявшимся за него потоком и снимается, когда
+// обработан последний сегмент: живых отображений не больше, чем потоков.
+struct FileState {
+    std::string path;
+    size_t size = 0;
+    size_t segments = 0;
+
+    std::once_flag mapped;
+    const char *data = nullptr;
+    int error = 0;
+    bool binary = false;
+    std::atomic<bool> truncated{false};     // хвост подменён нулями после SIGBUS
+    std::atomic<bool> truncationReported{false};
+
+    std::mutex mutex;
+    std::vector<SegmentResult> results;
+    size_t published = 0;
+    uint64_t lineBase = 0;
+    bool stalled = false;          // после прерванного сегмента номера строк неизвестны
+
+    ~FileState() { unmap(); }
+
+    void map(bool allowBinary) {
+        const int fd = ::open(path.c_str(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+        if (fd < 0) {
+            error = errno;
+            return;
+        }
+        void *p = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p == MAP_FAILED) error = errno;
+        ::close(fd);
+        if (error) return;
+        data = static_cast<const char *>(p);
+        ::madvise(p, size, MADV_SEQUENTIAL);
+        if (!allowBinary) {
+            MappingGuard guard(data, size, truncated);
+            if (std::memchr(data, 0, std::min(size, kBinaryProbe))) binary = true;
+        }
+    }
+
+    void unmap() {
+        if (data) ::munmap(const_cast<char *>(data), size);
+        data = nullptr;
+    }
+};
+
+const char *findCaseless(const char *p, const char *end, const std::string &needle) {
+    const size_t length = needle.size();
+    const int lower = std::tolower(static_cast<unsigned char>(needle[0]));
+    const int upper = std::toupper(static_cast<unsigned char>(needle[0]));
+    auto scan = [&](int c) { return static_cast<const char *>(std::memchr(p, c, size_t(end - p))); };
+    // Каждый memchr повторяется, только когда его прошлая находка отвергнута
+    const char *nextLower = scan(lower);
+    const char *nextUpper = lower == upper ? nullptr : scan(upper);
+    for (;;) {
+        const char *hit = nextLower;
+        if (nextUpper && (!hit || nextUpper < hit)) hit = nextUpper;
+        if (!hit || size_t(end - hit) < length) return nullptr;
+        if (::strncasecmp(hit, needle.c_str(), length) == 0) return hit;
+        p = hit + 1;
+        if (hit == nextLower) nextLower = scan(lower);
+        if (hit == nextUpper) nextUpper = scan(upper);
+    }
+}
+
+// Номер строки нужен для каждого сегмента целиком, даже без совпадений,
+// поэтому переводы строк считаются блоками: SSE2 по 16 байт (счётчики в
+// байтах сбрасываются каждые 255 блоков), без него — по 8 байт в слове
+uint64_t countNewlines(const char *p, const char *end) {
+    uint64_t count = 0;
+#ifdef __SSE2__
+    const __m128i newline = _mm_set1_epi8('\n');
+    while (end - p >= 16) {
+        __m128i counters = _mm_setzero_si128();
+        const std::ptrdiff_t blocks = std::min<std::ptrdiff_t>((end - p) / 16, 255);
+        for (std::ptrdiff_t i = 0; i < blocks; ++i, p += 16) {
+            const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+            counters = _mm_sub_epi8(counters, _mm_cmpeq_epi8(chunk, newline));
+        }
+        const __m128i sums = _mm_sad_epu8(counters, _mm_setzero_si128());
+        count += uint64_t(_mm_cvtsi128_si32(sums)) + uint64_t(_mm_extract_epi16(sums, 4));
+    }
+#else
+    static const uint64_t kLow7 = 0x7f7f7f7f7f7f7f7fULL;
+    static const uint64_t kNewlines = 0x0a0a0a0a0a0a0a0aULL;
+    for (; end - p >= 8; p += 8) {
+        uint64_t word;
+        std::memcpy(&word, p, sizeof(word));
+        word ^= kNewlines;                                   // '\n' → нулевой байт
+        const uint64_t zero = ~(((word & kLow7) + kLow7) | word | kLow7);
+        count += uint64_t(__builtin_popcountll(zero));
+    }
+#endif
+    for (; p < end; ++p) count += *p == '\n';
+    return count;
+}
+
+std::string clipLine(const char *begin, const char *end) {
+    if (end > begin && end[-1] == '\r') --end;
+    return std::string(begin, std::min(size_t(end - begin), kMaxLineBytes));
+}
+
+QString decodeLine(const std::string &line) {
+    return QString::fromUtf8(line.data(), int(line.size()));
+}
+
+} // namespace
+
+struct ContentSearch::Job {
+    quint64 id = 0;
+    QStringList roots;
+    QString pattern;
+    bool regex = false;
+    bool ignoreCase = false;
+    bool allowBinary = false;
+    int context = 0;
+    int maxMatches = kDefaultMaxMatches;
+    qint64 maxBytes = kDefaultMaxBytes;
+    ArchiveFilter filter;
+    std::string literal;           // ищется memmem/memchr; пусто — каждая строка идёт в regex
+
+    std::vector<std::shared_ptr<FileState>> files;
+    std::vector<std::pair<uint32_t, uint32_t>> tasks;   // файл, сегмент
+    std::atomic<size_t> nextTask{0};
+
+    std::atomic<bool> cancelled{false};
+    std::atomic<bool> done{false};
+    std::atomic<int> truncated{NotTruncated};
+    std::atomic<uint64_t> scanned{0}, matched{0}, reported{0}, filesScanned{0}, skipped{0};
+    qint64 startedMs = 0;
+    std::atomic<qint64> finishedMs{0};
+
+    std::mutex outputMutex;
+    std::vector<std::pair<std::string, Hit>> output;    // готово к отправке, в порядке строк файла
+    std::vector<std::pair<std::string, int>> errors;
+    uint64_t errorCount = 0;
+    std::thread coordinator;
+
+    ~Job() {
+        cancelled = true;
+        if (coordinator.joinable()) coordinator.join();
+    }
+
+    bool halted() const { return cancelled || truncated != NotTruncated; }
+    void stop(Truncation reason) {
+        int expected = NotTruncated;
+        truncated.compare_exchange_strong(expected, reason);
+    }
+
+    void run(int threads);
+    void collect(const QString &root);
+    void addFile(const std::string &path, size_t size);
+    void work();
+    void scanSegment(FileState &file, uint32_t segment, const QRegularExpression *re);
+    void publish(FileState &file, uint32_t segment, SegmentResult &&result);
+    void fail(const std::string &path, int error);
+};
+
+void ContentSearch::Job::fail(const std::string &path, int error) {
+    std::lock_guard<std::mutex> lock(outputMutex);
+    ++errorCount;
+    if (errors.size() < size_t(kMaxReportedErrors)) errors.emplace_back(path, error);
+}
+
+void ContentSearch::Job::addFile(const std::string &path, size_t size) {
+    if (files.size() >= kMaxFiles) {
+        stop(TruncatedFiles);
+        return;
+    }
+    auto file = std::make_shared<FileState>();
+    file->path = path;
+    file->size = size;
+    file->segments = (size + kSegmentSize - 1) / kSegmentSize;
+    file->results.resize(file->segments);
+    if (file->segments == 0) {
+        ++filesScanned;
+        return;
+    }
+    const uint32_t index = uint32_t(files.size());
+    files.push_back(file);
+    for (uint32_t s = 0; s < file->segments; ++s) tasks.emplace_back(index, s);
+}
+
+void ContentSearch::Job::collect(const QString &root) {
+    const std::string rootPath = QFile::encodeName(root).toStdString();
+    struct stat st;
+    // Явно указанный путь разыменовывается, ссылки внутри дерева — нет
+    if (::stat(rootPath.c_str(), &st) != 0) {
+        fail(rootPath, errno);
+        return;
+    }
+    if (S_ISREG(st.st_mode)) {
+        addFile(rootPath, size_t(st.st_size));
+        return;
+    }
+    if (!S_ISDIR(st.st_mode)) {
+        ++skipped;
+        return;
+    }
+
+    std::error_code ec;
+    fs::recursive_directory_iterator it(rootPath, fs::directory_options::skip_permission_denied, ec);
+    if (ec) {
+        fail(rootPath, ec.value());
+        return;
+    }
+    for (; it != fs::recursive_directory_iterator(); it.increment(ec)) {
+        if (ec) {
+            fail(rootPath, ec.value());
+            break;
+        }
+        if (halted()) return;
+        const fs::path &path = it->path();
+        const std::string relative = path.lexically_relative(rootPath).string();
+        const std::string name = path.filename().string();
+        std::error_code typeError;
+        const fs::file_status status = it->symlink_status(typeError);
+        if (fs::is_directory(status)) {
+            if (filter.excluded(relative, name)) it.disable_recursion_pending();
+            continue;
+        }
+        if (!fs::is_regular_file(status)) continue;
+        if (filter.excluded(relative, name) || !filter.included(relative, name)) continue;
+        std::error_code sizeError;
+        const uintmax_t size = it->file_size(sizeError);
+        if (sizeError) fail(path.string(), sizeError.value());
+        else addFile(path.string(), size_t(size));
+    }
+}
+
+void ContentSearch::Job::run(int threads) {
+    for (const QString &root : roots) {
+        if (halted()) break;
+        collect(root);
+    }
+
+    const int workers = int(std::min<size_t>(size_t(threads), tasks.size()));
+    std::vector<std::thread> pool;
+    for (int i = 1; i < workers; ++i) pool.emplace_back([this] { work(); });
+    if (workers > 0) work();
+    for (std::thread &thread : pool) thread.join();
+
+    files.clear();
+    finishedMs = nowMs();
+    done = true;
+}
+
+void ContentSearch::Job::work() {
+    // Скомпилированное выражение у каждого потока своё
+    std::unique_ptr<QRegularExpression> re;
+    if (regex) {
+        QRegularExpression::PatternOptions options = QRegularExpression::UseUnicodePropertiesOption;
+        if (ignoreCase) options |= QRegularExpression::CaseInsensitiveOption;
+        re.reset(new QRegularExpression(pattern, options));
+        re->optimize();
+    }
+    for (;;) {
+        const size_t index = nextTask++;
+        if (index >= tasks.size() || halted()) break;
+        FileState &file = *files[tasks[index].first];
+        scanSegment(file, tasks[index].second, re.get());
+    }
+}
+
+void ContentSearch::Job::scanSegment(FileState &file, uint32_t segment, const QRegularExpression *re) {
+    std::call_once(file.mapped, [&] {
+        file.map(allowBinary);
+        if (file.error) fail(file.path, file.error);
+        else if (file.binary) ++skipped;
+    });
+    SegmentResult result;
+    if (!file.data || file.binary) {
+        publish(file, segment, std::move(result));
+        return;
+    }
+    MappingGuard guard(file.data, file.size, file.truncated);
+
+    // Сегменту принадлежат строки, которые в нём начинаются; последняя
+    // дочитывается до своего конца, даже если он уже в следующем сегменте
+    const char *data = file.data;
+    const char *fileEnd = data + file.size;
+    const size_t start = size_t(segment) * kSegmentSize;
+    const size_t end = std::min(file.size, start + kSegmentSize);
+    const char *begin = data;
+    if (start > 0) {
+        const char *newline = static_cast<const char *>(std::memchr(data + start - 1, '\n', file.size - start + 1));
+        begin = newline ? newline + 1 : fileEnd;
+    }
+    const char *segmentEnd = fileEnd;
+    if (end < file.size) {
+        const char *newline = static_cast<const char *>(std::memchr(data + end - 1, '\n', file.size - end + 1));
+        if (newline) segmentEnd = newline + 1;
+    }
+    if (begin >= data + end) {
+        publish(file, segment, std::move(result));
+        return;
+    }
+
+    const char *stopAt = segmentEnd;
+    const uint64_t length = uint64_t(segmentEnd - begin);
+    const uint64_t before = scanned.fetch_add(length);
+    if (maxBytes > 0 && before + length > uint64_t(maxBytes)) {
+        stop(TruncatedBytes);
+        stopAt = before >= uint64_t(maxBytes) ? begin : begin + (uint64_t(maxBytes) - before);
+        result.partial = true;
+    }
+
+    const char *p = begin;
+    const char *counted = begin;
+    uint64_t lineIndex = 0;
+    while (p < stopAt) {
+        if (cancelled || (truncated != NotTruncated && !result.partial)) {
+            result.partial = true;
+            break;
+        }
+        // Кандидат: вхождение обязательной подстроки или просто следующая строка
+        const char *hit = p;
+        if (!literal.empty()) {
+            hit = ignoreCase ? findCaseless(p, stopAt, literal)
+                             : static_cast<const char *>(::memmem(p, size_t(stopAt - p), literal.data(), literal.size()));
+            if (!hit) break;
+        }
+        const char *lineStart = hit;
+        if (hit > p) {
+            const char *newline = static_cast<const char *>(::memrchr(p, '\n', size_t(hit - p)));
+            lineStart = newline ? newline + 1 : p;
+        }
+        const char *newline = static_cast<const char *>(std::memchr(hit, '\n', size_t(fileEnd - hit)));
+        const char *lineEnd = newline ? newline : fileEnd;
+        p = newline ? newline + 1 : fileEnd;
+
+        if (re) {
+            const char *textEnd = lineEnd > lineStart && lineEnd[-1] == '\r' ? lineEnd - 1 : lineEnd;
+            const QString line = QString::fromUtf8(lineStart, int(textEnd - lineStart));
+            if (!re->match(line).hasMatch()) continue;
+        }
+        if (matched.fetch_add(1) >= uint64_t(maxMatches)) {
+            stop(TruncatedMatches);
+            result.partial = true;
+            break;
+        }
+
+        lineIndex += countNewlines(counted, lineStart);
+        counted = lineStart;
+        Hit match;
+        match.line = lineIndex;
+        match.text = clipLine(lineStart, lineEnd);
+        // Контекст берётся прямо из отображения и может выходить за сегмент
+        const char *cursor = lineStart;
+        for (int i = 0; i < context && cursor > data; ++i) {
+            const char *prevEnd = cursor - 1;
+            const char *prev = static_cast<const char *>(::memrchr(data, '\n', size_t(prevEnd - data)));
+            const char *prevStart = prev ? prev + 1 : data;
+            match.before.insert(match.before.begin(), clipLine(prevStart, prevEnd));
+            cursor = prevStart;
+        }
+        cursor = p;
+        for (int i = 0; i < context && cursor < fileEnd; ++i) {
+            const char *next = static_cast<const char *>(std::memchr(cursor, '\n', size_t(fileEnd - cursor)));
+            const char *nextEnd = next ? next : fileEnd;
+            match.after.push_back(clipLine(cursor, nextEnd));
+            cursor = next ? next + 1 : fileEnd;
+        }
+        result.hits.push_back(std::move(match));
+    }
+    if (!result.partial) result.newlines = lineIndex + countNewlines(counted, segmentEnd);
+    if (file.truncated.load(std::memory_order_relaxed)) {
+        // Файл усекли во время поиска: номера строк дальше неизвестны
+        result.partial = true;
+        if (!file.truncationReported.exchange(true)) fail(file.path, EIO);
+    }
+    publish(file, segment, std::move(result));
+}
+
+void ContentSearch::Job::publish(FileState &file, uint32_t segment, SegmentResult &&result) {
+    std::vector<std::pair<std::string, Hit>> ready;
+    bool complete = false;
+    {
+        std::lock_guard<std::mutex> lock(file.mutex);
+        file.results[segment] = std::move(result);
+        file.results[segment].done = true;
+        // Сегменты выдаются по порядку: номер строки известен, только когда
+        // посчитаны переводы строк во всех предыдущих
+        while (!file.stalled && file.published < file.segments && file.results[file.published].done) {
+            SegmentResult &ordered = file.results[file.published];
+            for (Hit &hit : ordered.hits) {
+                hit.line += file.lineBase + 1;
+                ready.emplace_back(file.path, std::move(hit));
+            }
+            ordered.hits.clear();
+            ordered.hits.shrink_to_fit();
+            file.lineBase += ordered.newlines;
+            file.stalled = ordered.partial;
+            ++file.published;
+        }
+        complete = file.published == file.segments;
+        if (complete) file.unmap();
+    }
+    if (complete && !file.binary && !file.error) ++filesScanned;
+    if (ready.empty()) return;
+    reported += ready.size();
+    std::lock_guard<std::mutex> lock(outputMutex);
+    for (auto &entry : ready) output.push_back(std::move(entry));
+}
+
+ContentSearch::ContentSearch(QObject *parent) : QObject(parent) {
+    connect(&reportTimer, &QTimer::timeout, this, &ContentSearch::report);
+    installBusHandler();
+}
+
+ContentSearch::~ContentSearch() {
+    // ~Job отменяет поиск и дожидается потоков
+    jobs.clear();
+}
+
+QJsonObject ContentSearch::start(const QStringList &paths, const QString &pattern, const QJsonObject &options,
+                                 QString *error) {
+    if (paths.isEmpty() || pattern.isEmpty()) {
+        if (error) *error = paths.isEmpty() ? "No paths to search" : "Empty pattern";
+        return QJsonObject();
+    }
+    auto job = std::make_shared<Job>();
+    job->pattern = pattern;
+    job->regex = options["regex"].toBool(false);
+    job->ignoreCase = options["ignoreCase"].toBool(false);
+    job->allowBinary = options["binary"].toBool(false);
+    job->context = qBound(0, options["context"].toInt(0), kMaxContext);
+    job->maxMatches = qBound(1, options["maxMatches"].toInt(kDefaultMaxMatches), kMaxMatchesLimit);
+    job->maxBytes = qMax<qint64>(0, qint64(options["maxBytes"].toDouble(double(kDefaultMaxBytes))));
+    QStringList include, exclude;
+    for (const QJsonValue &value : options["include"].toArray()) include.append(value.toString());
+    for (const QJsonValue &value : options["exclude"].toArray()) exclude.append(value.toString());
+    job->filter = ArchiveFilter(include, exclude);
+
+    const std::string utf8 = pattern.toUtf8().toStdString();
+    if (job->regex) {
+        const QRegularExpression re(pattern);
+        if (!re.isValid()) {
+            if (error) *error = QString("Invalid pattern: %1").arg(re.errorString());
+            return QJsonObject();
+        }
+        job->literal = requiredLiteral(utf8);
+    } else {
+        job->literal = utf8;
+    }
+    // Без учёта регистра memchr/strncasecmp понимают только ASCII —
+    // для прочих букв кандидатом считается каждая строка
+    if (job->ignoreCase && std::any_of(job->literal.begin(), job->literal.end(),
+                                       [](char c) { return static_cast<unsigned char>(c) >= 0x80; })) {
+        job->literal.clear();
+        if (!job->regex) {
+            job->regex = true;
+            job->pattern = QRegularExpression::escape(pattern);
+        }
+    }
+
+    job->id = nextSearchId++;
+    for (const QString &path : paths) job->roots.append(QDir::cleanPath(path));
+    job->startedMs = nowMs();
+
+    // Чтение с диска и поиск по страничному кэшу — упор и в I/O, и в CPU
+    const int threads = qBound(2, int(std::thread::hardware_concurrency()), 16);
+    Job *raw = job.get();
+    job->coordinator = std::thread([raw, threads] { raw->run(threads); });
+    jobs.insert(job->id, job);
+
+    if (!reportTimer.isActive()) reportTimer.start(kReportIntervalMs);
+    return QJsonObject{{"search_id", QString::number(job->id)}, {"done", false}};
+}
+
+bool ContentSearch::cancel(quint64 searchId) {
+    auto it = jobs.find(searchId);
+    if (it == jobs.end() || it.value()->done) return false;
+    it.value()->cancelled = true;
+    return true;
+}
+
+void ContentSearch::report() {
+    // Обработчики пишут в сокет и могут отменить поиск — обходим копию
+    const QList<std::shared_ptr<Job>> current = jobs.values();
+    for (const std::shared_ptr<Job> &job : current) {
+        // done читается до вывода: всё найденное к этому моменту уже в output
+        const bool finishedNow = job->done;
+        std::vector<std::pair<std::string, Hit>> batch;
+        {
+            std::lock_guard<std::mutex> lock(job->outputMutex);
+            batch.swap(job->output);
+        }
+
+        QJsonArray found;
+        for (const auto &entry : batch) {
+            QJsonObject match;
+            match["file"] = QFile::decodeName(entry.first.c_str());
+            match["line"] = qint64(entry.second.line);
+            match["text"] = decodeLine(entry.second.text);
+            if (job->context > 0) {
+                QJsonArray before, after;
+                for (const std::string &line : entry.second.before) before.append(decodeLine(line));
+                for (const std::string &line : entry.second.after) after.append(decodeLine(line));
+                match["before"] = before;
+                match["after"] = after;
+            }
+            found.append(match);
+        }
+
+        QJsonObject params;
+        params["search_id"] = QString::number(job->id);
+        params["matches"] = found;
+        params["done"] = finishedNow;
+        const uint64_t scanned = job->scanned;
+        params["scanned_bytes"] = qint64(job->maxBytes > 0 ? qMin(scanned, uint64_t(job->maxBytes)) : scanned);
+        params["files"] = qint64(job->filesScanned.load());
+        params["elapsed_ms"] = (finishedNow ? job->finishedMs.load() : nowMs()) - job->startedMs;
+
+        if (!finishedNow) {
+            if (!found.isEmpty()) emit matches(job->id, params);
+            continue;
+        }
+        static const char *const reasons[] = {"", "matches", "bytes", "files"};
+        params["total_matches"] = qint64(job->reported.load());
+        params["skipped"] = qint64(job->skipped.load());
+        params["truncated"] = QString(reasons[job->truncated.load()]);
+        params["cancelled"] = bool(job->cancelled);
+        QJsonArray errors;
+        {
+            std::lock_guard<std::mutex> lock(job->outputMutex);
+            for (const auto &failure : job->errors) {
+                errors.append(QJsonObject{
+                    {"path", QFile::decodeName(failure.first.c_str())},
+                    {"error", QString::fromLocal8Bit(strerror(failure.second))}
+                });
+            }
+            params["error_count"] = qint64(job->errorCount);
+        }
+        params["errors"] = errors;
+        jobs.remove(job->id);
+        emit finished(job->id, params);
+    }
+    if (jobs.isEmpty()) reportTimer.stop();
+}
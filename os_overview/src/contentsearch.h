@@ -0,0 +1,51 @@
+#ifndef CONTENTSEARCH_H
+#define CONTENTSEARCH_H
+
+#include <QObject>
+#include <QJsonObject>
+#include <QHash>
+#include <QStringList>
+#include <QTimer>
+#include <memory>
+
+// Поиск по содержимому файлов на сервере (удалённый grep). Файлы режутся на
+// сегменты по 32 МБ и сканируются через mmap в нескольких потоках, так что
+// даже один огромный лог ищется параллельно. Кандидаты находятся memmem/memchr
+// по обязательной подстроке шаблона; регулярное выражение проверяет только
+// строки-кандидаты. Совпадения уходят клиенту пачками по мере готовности, в
+// порядке строк внутри файла: номер строки сегмента известен, когда посчитаны
+// переводы строк во всех предыдущих. Усечение файла во время поиска
+// перехватывается (SIGBUS) и сообщается ошибкой по этому файлу.
+class ContentSearch : public QObject
+{
+    Q_OBJECT
+public:
+    explicit ContentSearch(QObject *parent = nullptr);
+    ~ContentSearch();
+
+    // paths — файлы и каталоги (обходятся рекурсивно, ссылки не разыменовываются).
+    // options: regex, ignoreCase, context (строк до/после, до 5), maxMatches,
+    // maxBytes, include/exclude (glob по имени или относительному пути), binary.
+    // Возвращает {search_id, done=false}; пустой объект — ошибка, текст в error.
+    QJsonObject start(const QStringList &paths, const QString &pattern, const QJsonObject &options,
+                      QString *error = nullptr);
+    bool cancel(quint64 searchId);
+
+signals:
+    // {search_id, matches: [{file, line, text, before, after}], scanned_bytes, files}
+    void matches(quint64 searchId, const QJsonObject &batch);
+    // Итог: total_matches, scanned_bytes, files, skipped, truncated (matches|bytes), errors
+    void finished(quint64 searchId, const QJsonObject &status);
+
+private slots:
+    void report();
+
+private:
+    struct Job;
+
+    QHash<quint64, std::shared_ptr<Job>> jobs;
+    QTimer reportTimer;
+    quint64 nextSearchId = 1;
+};
+
+#endif // CONTENTSEARCH_H
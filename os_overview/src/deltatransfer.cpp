@@ -0,0 +1,455 @@
+#include "deltatransfer.h"
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QSaveFile>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+static const int kPollIntervalMs = 50;
+static const int kMinAutoBlockSize = 2048;
+static const int kMaxAutoBlockSize = 128 * 1024;
+static const int kMinBlockSize = 512;
+static const int kMaxBlockSize = 1024 * 1024;
+static const int kSignatureSize = 4 + 16;          // weak (u32 BE) + MD5
+// Сигнатуры и их base64 в ответе должны поместиться в QByteArray
+static const qint64 kMaxSignatureBlocks = 64 * 1024 * 1024 / kSignatureSize;
+static const int kReadBufferSize = 1024 * 1024;
+static const int kCopyBufferSize = 256 * 1024;
+static const int kMaxUploadsPerClient = 4;
+
+enum DeltaOp {
+    OpCopy = 0x01,
+    OpLiteral = 0x02
+};
+
+namespace {
+
+quint32 weakChecksum(const uchar *data, int length) {
+    quint32 a = 0, b = 0;
+    for (int i = 0; i < length; ++i) {
+        a += data[i];
+        b += quint32(length - i) * data[i];
+    }
+    return (a & 0xffff) | (b << 16);
+}
+
+void putU32(char *out, quint32 value) {
+    out[0] = char(value >> 24);
+    out[1] = char(value >> 16);
+    out[2] = char(value >> 8);
+    out[3] = char(value);
+}
+
+quint32 getU32(const uchar *in) {
+    return (quint32(in[0]) << 24) | (quint32(in[1]) << 16) | (quint32(in[2]) << 8) | quint32(in[3]);
+}
+
+qint64 mtimeNs(const struct statx &sx) {
+    return qint64(sx.stx_mtime.tv_sec) * 1000000000 + sx.stx_mtime.tv_nsec;
+}
+
+// Блок порядка √size, как в rsync: число сигнатур и объём литералов растут одинаково
+int autoBlockSize(qint64 size) {
+    const qint64 root = qint64(std::sqrt(double(size))) & ~qint64(1023);
+    return int(qBound<qint64>(kMinAutoBlockSize, root, kMaxAutoBlockSize));
+}
+
+qint64 nowMs() {
+    return QDateTime::currentMSecsSinceEpoch();
+}
+
+} // namespace
+
+struct DeltaTransfer::SignatureJob {
+    quint64 id = 0;
+    QString path;
+    int fd = -1;
+    qint64 size = 0;
+    qint64 mtime = 0;
+    int blockSize = 0;
+    quint64 blockCount = 0;
+    QByteArray signatures;        // blockCount * kSignatureSize, заполняется потоками по своим диапазонам
+
+    std::atomic<bool> cancelled{false};
+    std::atomic<bool> done{false};
+    std::atomic<int> error{0};
+    qint64 startedMs = 0;
+    qint64 finishedMs = 0;
+    std::thread coordinator;
+
+    ~SignatureJob() {
+        cancelled = true;
+        if (coordinator.joinable()) coordinator.join();
+        if (fd >= 0) ::close(fd);
+    }
+
+    void run(int threads);
+    void computeRange(char *out, quint64 first, quint64 last);
+};
+
+void DeltaTransfer::SignatureJob::run(int threads) {
+    char *out = signatures.data();
+    // Каждый поток читает свой непрерывный диапазон: чтение остаётся последовательным
+    const quint64 perThread = (blockCount + quint64(threads) - 1) / quint64(threads);
+    std::vector<std::thread> workers;
+    for (int i = 1; i < threads; ++i) {
+        const quint64 first = perThread * quint64(i);
+        if (first >= blockCount) break;
+        workers.emplace_back(&SignatureJob::computeRange, this, out, first, std::min(blockCount, first + perThread));
+    }
+    computeRange(out, 0, std::min(blockCount, perThread));
+    for (std::thread &worker : workers) worker.join();
+
+    finishedMs = nowMs();
+    done = true;
+}
+
+void DeltaTransfer::SignatureJob::computeRange(char *out, quint64 first, quint64 last) {
+    const int blocksPerRead = std::max(1, kReadBufferSize / blockSize);
+    std::vector<uchar> buffer(size_t(blocksPerRead) * size_t(blockSize));
+    QCryptographicHash md5(QCryptographicHash::Md5);
+
+    for (quint64 block = first; block < last && !cancelled.load(std::memory_order_relaxed);) {
+        const quint64 count = std::min(quint64(blocksPerRead), last - block);
+        const qint64 offset = qint64(block) * blockSize;
+        const size_t wanted = size_t(std::min<qint64>(qint64(count) * blockSize, size - offset));
+        size_t got = 0;
+        while (got < wanted) {
+            const ssize_t n = ::pread(fd, buffer.data() + got, wanted - got, offset + qint64(got));
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) {
+                // Файл укоротили или ошибка чтения: сигнатуры уже недостоверны
+                error = n < 0 ? errno : EIO;
+                cancelled = true;
+                return;
+            }
+            got += size_t(n);
+        }
+
+        for (quint64 i = 0; i < count; ++i) {
+            const uchar *data = buffer.data() + i * quint64(blockSize);
+            const int length = int(std::min<qint64>(blockSize, qint64(wanted) - qint64(i) * blockSize));
+            char *signature = out + (block + i) * kSignatureSize;
+            putU32(signature, weakChecksum(data, length));
+            md5.reset();
+            md5.addData(reinterpret_cast<const char *>(data), length);
+            const QByteArray strong = md5.result();
+            std::memcpy(signature + 4, strong.constData(), 16);
+        }
+        block += count;
+    }
+}
+
+struct DeltaTransfer::Upload {
+    QObject *owner = nullptr;
+    QString path;
+    int baseFd = -1;
+    qint64 baseSize = 0;
+    int blockSize = 0;
+    quint64 blockCount = 0;
+
+    QSaveFile out;
+    QCryptographicHash md5{QCryptographicHash::Md5};
+    qint64 written = 0;
+    qint64 literalBytes = 0;
+    qint64 copiedBytes = 0;
+    qint64 startedMs = 0;
+    QByteArray copyBuffer;
+
+    ~Upload() {
+        if (baseFd >= 0) ::close(baseFd);
+    }
+
+    bool write(const char *data, qint64 length, QString *error);
+    bool copyBlocks(quint64 first, quint64 count, QString *error);
+};
+
+bool DeltaTransfer::Upload::write(const char *data, qint64 length, QString *error) {
+    if (out.write(data, length) != length) {
+        if (error) *error = out.errorString();
+        return false;
+    }
+    md5.addData(data, int(length));
+    written += length;
+    return true;
+}
+
+bool DeltaTransfer::Upload::copyBlocks(quint64 first, quint64 count, QString *error) {
+    if (first >= blockCount || count > blockCount - first) {
+        if (error) *error = "Block reference out of range";
+        return false;
+    }
+    qint64 offset = qint64(first) * blockSize;
+    const qint64 end = std::min(baseSize, qint64(first + count) * blockSize);
+    if (copyBuffer.isEmpty()) copyBuffer.resize(kCopyBufferSize);
+
+    while (offset < end) {
+        const ssize_t n = ::pread(baseFd, copyBuffer.data(), size_t(std::min<qint64>(copyBuffer.size(), end - offset)), offset);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            if (error) *error = n < 0 ? QString::fromLocal8Bit(strerror(errno)) : QString("Base file truncated");
+            return false;
+        }
+        if (!write(copyBuffer.constData(), n, error)) return false;
+        copiedBytes += n;
+        offset += n;
+    }
+    return true;
+}
+
+DeltaTransfer::DeltaTransfer(QObject *parent) : QObject(parent) {
+    connect(&pollTimer, &QTimer::timeout, this, &DeltaTransfer::collectSignatures);
+}
+
+DeltaTransfer::~DeltaTransfer() {
+    // ~SignatureJob дожидается потоков, незавершённые QSaveFile удаляют временные файлы
+    signatureJobs.clear();
+    uploads.clear();
+}
+
+quint64 DeltaTransfer::requestSignature(const QString &path, int blockSize) {
+    auto job = std::make_shared<SignatureJob>();
+    job->id = nextRequestId++;
+    job->path = QDir::cleanPath(path);
+    job->startedMs = nowMs();
+    signatureJobs.insert(job->id, job);
+    if (!pollTimer.isActive()) pollTimer.start(kPollIntervalMs);
+
+    const QByteArray encoded = QFile::encodeName(job->path);
+    job->fd = ::open(encoded.constData(), O_RDONLY | O_CLOEXEC);
+    struct statx sx;
+    if (job->fd < 0 || ::statx(job->fd, "", AT_EMPTY_PATH, STATX_TYPE | STATX_SIZE | STATX_MTIME, &sx) != 0) {
+        job->error = errno;
+        job->done = true;
+        return job->id;
+    }
+    if (!S_ISREG(sx.stx_mode)) {
+        job->error = EISDIR;
+        job->done = true;
+        return job->id;
+    }
+
+    job->size = qint64(sx.stx_size);
+    job->mtime = mtimeNs(sx);
+    job->blockSize = blockSize > 0 ? qBound(kMinBlockSize, blockSize, kMaxBlockSize) : autoBlockSize(job->size);
+    // На очень большом файле блок увеличивается, пока число сигнатур не уложится в лимит;
+    // клиент всё равно берёт block_size из ответа
+    const qint64 minBlockSize = ((job->size + kMaxSignatureBlocks - 1) / kMaxSignatureBlocks + 1023) & ~qint64(1023);
+    if (minBlockSize > kMaxBlockSize) {
+        job->error = EFBIG;
+        job->done = true;
+        return job->id;
+    }
+    job->blockSize = std::max(job->blockSize, int(minBlockSize));
+    job->blockCount = quint64((job->size + job->blockSize - 1) / job->blockSize);
+    job->signatures.resize(int(job->blockCount) * kSignatureSize);
+    if (job->blockCount == 0) {
+        job->finishedMs = nowMs();
+        job->done = true;
+        return job->id;
+    }
+
+    ::posix_fadvise(job->fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    // MD5 упирается в CPU, поэтому потоков не больше, чем ядер
+    const int threads = int(qBound<quint64>(1, std::thread::hardware_concurrency(),
+                                            std::min<quint64>(8, job->blockCount)));
+    SignatureJob *raw = job.get();
+    job->coordinator = std::thread([raw, threads] { raw->run(threads); });
+    return job->id;
+}
+
+void DeltaTransfer::collectSignatures() {
+    QList<quint64> finished;
+    for (const auto &job : signatureJobs) {
+        if (!job->done) continue;
+        finished.append(job->id);
+
+        QJsonObject result;
+        result["path"] = job->path;
+        if (job->error == ENOENT) {
+            result["exists"] = false;
+        } else if (job->error != 0) {
+            result["error"] = QString::fromLocal8Bit(strerror(job->error));
+        } else {
+            result["exists"] = true;
+            result["size"] = job->size;
+            // Наносекунды не помещаются в double без потерь
+            result["mtime"] = QString::number(job->mtime);
+            result["block_size"] = job->blockSize;
+            result["block_count"] = qint64(job->blockCount);
+            result["signatures"] = QString::fromLatin1(job->signatures.toBase64());
+            result["elapsed_ms"] = job->finishedMs - job->startedMs;
+        }
+        emit signatureReady(job->id, result);
+    }
+    for (quint64 id : finished) signatureJobs.remove(id);
+    if (signatureJobs.isEmpty()) pollTimer.stop();
+}
+
+QString DeltaTransfer::beginUpload(QObject *owner, const QJsonObject &params, QString *error) {
+    int active = 0;
+    for (const auto &upload : uploads) {
+        if (upload->owner == owner) ++active;
+    }
+    if (active >= kMaxUploadsPerClient) {
+        if (error) *error = "Too many concurrent uploads";
+        return QString();
+    }
+
+    auto upload = std::make_shared<Upload>();
+    upload->owner = owner;
+    upload->path = QDir::cleanPath(params["remotePath"].toString());
+    upload->startedMs = nowMs();
+    if (params["remotePath"].toString().isEmpty()) {
+        if (error) *error = "remotePath is required";
+        return QString();
+    }
+
+    // Ссылки на блоки относятся к той копии, по которой клиент считал дельту
+    const QByteArray encoded = QFile::encodeName(upload->path);
+    const qint64 expectedSize = qint64(params["base_size"].toDouble(-1));
+    struct statx sx;
+    const int fd = ::open(encoded.constData(), O_RDONLY | O_CLOEXEC);
+    if (fd >= 0) {
+        upload->baseFd = fd;
+        if (::statx(fd, "", AT_EMPTY_PATH, STATX_TYPE | STATX_MODE | STATX_SIZE | STATX_MTIME | STATX_UID | STATX_GID, &sx) != 0
+                || !S_ISREG(sx.stx_mode)) {
+            if (error) *error = "Remote path is not a regular file";
+            return QString();
+        }
+        upload->baseSize = qint64(sx.stx_size);
+        if (expectedSize >= 0 && (upload->baseSize != expectedSize
+                                  || QString::number(mtimeNs(sx)) != params["base_mtime"].toString())) {
+            if (error) *error = "Remote file changed since signature was taken";
+            return QString();
+        }
+    } else if (errno != ENOENT || expectedSize > 0) {
+        if (error) *error = QString::fromLocal8Bit(strerror(errno));
+        return QString();
+    }
+
+    upload->blockSize = params["block_size"].toInt();
+    if (upload->baseSize > 0) {
+        if (upload->blockSize < kMinBlockSize || upload->blockSize > kMaxBlockSize) {
+            if (error) *error = "Invalid block_size";
+            return QString();
+        }
+        upload->blockCount = quint64((upload->baseSize + upload->blockSize - 1) / upload->blockSize);
+    }
+
+    upload->out.setFileName(upload->path);
+    if (!upload->out.open(QIODevice::WriteOnly)) {
+        if (error) *error = upload->out.errorString();
+        return QString();
+    }
+    if (upload->baseFd >= 0) {
+        // Новый файл заменяет старый — владелец и права должны остаться прежними
+        const int outFd = int(upload->out.handle());
+        if (::fchown(outFd, sx.stx_uid, sx.stx_gid) != 0 && errno != EPERM) {
+            if (error) *error = QString::fromLocal8Bit(strerror(errno));
+            upload->out.cancelWriting();
+            return QString();
+        }
+        ::fchmod(outFd, sx.stx_mode & 07777);
+    }
+
+    const QString session = QString::number(nextSessionId++);
+    uploads.insert(session, upload);
+    return session;
+}
+
+qint64 DeltaTransfer::applyChunk(QObject *owner, const QString &session, const QByteArray &ops, QString *error) {
+    auto it = uploads.find(session);
+    if (it == uploads.end() || it.value()->owner != owner) {
+        if (error) *error = "Unknown upload session";
+        return -1;
+    }
+    Upload &upload = *it.value();
+
+    const uchar *p = reinterpret_cast<const uchar *>(ops.constData());
+    const uchar *end = p + ops.size();
+    bool ok = true;
+    while (ok && p < end) {
+        const uchar op = *p++;
+        if (op == OpCopy && end - p >= 8) {
+            const quint32 first = getU32(p);
+            const quint32 count = getU32(p + 4);
+            p += 8;
+            ok = upload.copyBlocks(first, count, error);
+        } else if (op == OpLiteral && end - p >= 4) {
+            const quint32 length = getU32(p);
+            p += 4;
+            if (quint32(end - p) < length) {
+                if (error) *error = "Truncated literal";
+                ok = false;
+                break;
+            }
+            ok = upload.write(reinterpret_cast<const char *>(p), length, error);
+            upload.literalBytes += length;
+            p += length;
+        } else {
+            if (error) *error = "Malformed delta stream";
+            ok = false;
+        }
+    }
+
+    if (!ok) {
+        upload.out.cancelWriting();
+        uploads.erase(it);
+        return -1;
+    }
+    return upload.written;
+}
+
+QJsonObject DeltaTransfer::finishUpload(QObject *owner, const QString &session, qint64 size, const QString &md5,
+                                        QString *error) {
+    auto it = uploads.find(session);
+    if (it == uploads.end() || it.value()->owner != owner) {
+        if (error) *error = "Unknown upload session";
+        return QJsonObject();
+    }
+    std::shared_ptr<Upload> upload = it.value();
+    uploads.erase(it);
+
+    // Слабая сумма могла совпасть случайно, MD5 блока — почти нет, но итог проверяем целиком
+    if (upload->written != size || upload->md5.result().toHex() != md5.toLower().toLatin1()) {
+        upload->out.cancelWriting();
+        if (error) *error = "Reconstructed file does not match (size or MD5)";
+        return QJsonObject();
+    }
+    if (!upload->out.commit()) {
+        if (error) *error = upload->out.errorString();
+        return QJsonObject();
+    }
+
+    QJsonObject result;
+    result["status"] = "success";
+    result["path"] = upload->path;
+    result["size"] = upload->written;
+    result["literal_bytes"] = upload->literalBytes;
+    result["copied_bytes"] = upload->copiedBytes;
+    result["elapsed_ms"] = nowMs() - upload->startedMs;
+    return result;
+}
+
+void DeltaTransfer::abortAll(QObject *owner) {
+    for (auto it = uploads.begin(); it != uploads.end();) {
+        if (it.value()->owner == owner) {
+            it.value()->out.cancelWriting();
+            it = uploads.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
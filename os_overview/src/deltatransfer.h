@@ -0,0 +1,63 @@
+#ifndef DELTATRANSFER_H
+#define DELTATRANSFER_H
+
+#include <QObject>
+#include <QJsonObject>
+#include <QHash>
+#include <QTimer>
+#include <memory>
+
+// Загрузка файла дельтой, как в rsync. Сервер считает сигнатуры блоков своей
+// копии (слабая скользящая сумма + MD5) параллельно по диапазонам файла;
+// клиент присылает только новые данные и ссылки на блоки старой копии.
+// Новый файл собирается через QSaveFile рядом со старым и подменяет его
+// атомарно, только если совпали размер и MD5 всего файла.
+//
+// Слабая сумма блока x[0..L): a = Σ x[i], b = Σ (L - i)·x[i] (обе по модулю 2^16),
+// weak = a | b << 16. Клиент обязан считать её так же.
+//
+// Поток операций (ops) — бинарный, в base64:
+//   0x01 u32 первый_блок u32 число_блоков — копия блоков старого файла
+//   0x02 u32 длина, байты                 — новые данные
+// Числа в big-endian.
+class DeltaTransfer : public QObject
+{
+    Q_OBJECT
+public:
+    explicit DeltaTransfer(QObject *parent = nullptr);
+    ~DeltaTransfer();
+
+    // Запускает подсчёт сигнатур в фоне; результат приходит сигналом
+    // signatureReady с тем же номером. Отсутствующий файл — {exists=false}.
+    quint64 requestSignature(const QString &path, int blockSize);
+
+    // Сессия загрузки принадлежит owner (сокету клиента).
+    // params: remotePath, block_size, base_size, base_mtime из сигнатуры.
+    // Пустая строка — ошибка, текст в error.
+    QString beginUpload(QObject *owner, const QJsonObject &params, QString *error);
+    // Возвращает число записанных байт; -1 — ошибка, сессия закрыта
+    qint64 applyChunk(QObject *owner, const QString &session, const QByteArray &ops, QString *error);
+    // Проверяет size и md5 (hex) и подменяет файл; пустой объект — ошибка
+    QJsonObject finishUpload(QObject *owner, const QString &session, qint64 size, const QString &md5,
+                             QString *error);
+    // Отменить незавершённые загрузки клиента (при отключении)
+    void abortAll(QObject *owner);
+
+signals:
+    void signatureReady(quint64 requestId, const QJsonObject &result);
+
+private slots:
+    void collectSignatures();
+
+private:
+    struct SignatureJob;
+    struct Upload;
+
+    QHash<quint64, std::shared_ptr<SignatureJob>> signatureJobs;
+    QHash<QString, std::shared_ptr<Upload>> uploads;
+    QTimer pollTimer;
+    quint64 nextRequestId = 1;
+    quint64 nextSessionId = 1;
+};
+
+#endif // DELTATRANSFER_H
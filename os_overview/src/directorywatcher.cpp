@@ -0,0 +1,215 @@
+#include "directorywatcher.h"
+#include <QSocketNotifier>
+#include <QDir>
+#include <QFile>
+#include <QJsonObject>
+#include <QDebug>
+
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+
+static const int kCoalesceMs = 250;
+static const int kMaxWatchesPerSubscriber = 64;
+static const int kMaxPendingPerWatch = 10000;
+
+static const uint32_t kWatchMask = IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_MODIFY
+                                 | IN_CLOSE_WRITE | IN_ATTRIB | IN_DELETE_SELF | IN_MOVE_SELF
+                                 | IN_ONLYDIR | IN_EXCL_UNLINK;
+
+enum EventType {
+    EventCreate = 1,
+    EventDelete = 2,
+    EventModify = 4,
+    EventAttrib = 8
+};
+
+DirectoryWatcher::DirectoryWatcher(QObject* parent) : QObject(parent) {
+    fd = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd < 0) {
+        qWarning() << "Directory watcher: inotify_init1 failed:" << strerror(errno);
+        return;
+    }
+    notifier = new QSocketNotifier(fd, QSocketNotifier::Read, this);
+    connect(notifier, &QSocketNotifier::activated, this, &DirectoryWatcher::readEvents);
+
+    flushTimer.setSingleShot(true);
+    connect(&flushTimer, &QTimer::timeout, this, &DirectoryWatcher::flush);
+}
+
+DirectoryWatcher::~DirectoryWatcher() {
+    delete notifier;
+    if (fd >= 0) ::close(fd);
+}
+
+bool DirectoryWatcher::watch(QObject* subscriber, const QString& path) {
+    if (fd < 0) return false;
+    const QString clean = QDir::cleanPath(path);
+
+    auto existing = pathToWatch.constFind(clean);
+    if (existing != pathToWatch.constEnd()) {
+        watches[existing.value()].subscribers.insert(subscriber);
+        return true;
+    }
+
+    int owned = 0;
+    for (const Watch& w : watches) {
+        if (w.subscribers.contains(subscriber)) ++owned;
+    }
+    if (owned >= kMaxWatchesPerSubscriber) return false;
+
+    const int wd = ::inotify_add_watch(fd, QFile::encodeName(clean).constData(), kWatchMask);
+    if (wd < 0) {
+        qWarning() << "Directory watcher: cannot watch" << clean << ":" << strerror(errno);
+        return false;
+    }
+    // Тот же каталог по другому пути получает тот же wd — подписки объединяются
+    Watch& w = watches[wd];
+    if (w.path.isEmpty()) w.path = clean;
+    w.subscribers.insert(subscriber);
+    pathToWatch.insert(clean, wd);
+    return true;
+}
+
+bool DirectoryWatcher::unwatch(QObject* subscriber, const QString& path) {
+    auto it = pathToWatch.constFind(QDir::cleanPath(path));
+    if (it == pathToWatch.constEnd()) return false;
+    const int wd = it.value();
+    Watch& w = watches[wd];
+    if (!w.subscribers.remove(subscriber)) return false;
+    if (w.subscribers.isEmpty()) {
+        ::inotify_rm_watch(fd, wd);
+        dropWatch(wd);
+    }
+    return true;
+}
+
+void DirectoryWatcher::unwatchAll(QObject* subscriber) {
+    QList<int> unused;
+    for (auto it = watches.begin(); it != watches.end(); ++it) {
+        if (it->subscribers.remove(subscriber) && it->subscribers.isEmpty()) unused.append(it.key());
+    }
+    for (int wd : unused) {
+        ::inotify_rm_watch(fd, wd);
+        dropWatch(wd);
+    }
+}
+
+QList<QObject*> DirectoryWatcher::subscribers(const QString& path) const {
+    auto it = pathToWatch.constFind(path);
+    if (it == pathToWatch.constEnd()) return {};
+    return watches.value(it.value()).subscribers.values();
+}
+
+void DirectoryWatcher::dropWatch(int wd) {
+    watches.remove(wd);
+    for (auto it = pathToWatch.begin(); it != pathToWatch.end();) {
+        if (it.value() == wd) it = pathToWatch.erase(it);
+        else ++it;
+    }
+}
+
+void DirectoryWatcher::readEvents() {
+    alignas(inotify_event) char buffer[64 * 1024];
+    for (;;) {
+        const ssize_t length = ::read(fd, buffer, sizeof(buffer));
+        if (length < 0) {
+            if (errno == EINTR) continue;
+            break; // EAGAIN: очередь пуста
+        }
+        if (length == 0) break;
+
+        for (ssize_t offset = 0; offset < length;) {
+            const auto* event = reinterpret_cast<const inotify_event*>(buffer + offset);
+            offset += ssize_t(sizeof(inotify_event) + event->len);
+
+            if (event->mask & IN_Q_OVERFLOW) {
+                overflowed = true;
+                continue;
+            }
+            auto it = watches.find(event->wd);
+            if (it == watches.end()) continue; // IN_IGNORED после inotify_rm_watch
+
+            if (event->mask & (IN_DELETE_SELF | IN_MOVE_SELF | IN_IGNORED)) {
+                const QString path = it->path;
+                const QList<QObject*> affected = it->subscribers.values();
+                if (!(event->mask & IN_IGNORED)) ::inotify_rm_watch(fd, event->wd);
+                dropWatch(event->wd);
+                emit removed(path, affected);
+                continue;
+            }
+
+            int type = 0;
+            if (event->mask & (IN_CREATE | IN_MOVED_TO))       type = EventCreate;
+            else if (event->mask & (IN_DELETE | IN_MOVED_FROM)) type = EventDelete;
+            else if (event->mask & (IN_MODIFY | IN_CLOSE_WRITE)) type = EventModify;
+            else if (event->mask & IN_ATTRIB)                   type = EventAttrib;
+            if (type == 0 || event->len == 0) continue;
+
+            addEvent(*it, QFile::decodeName(event->name), type, event->mask & IN_ISDIR);
+        }
+    }
+    if (!flushTimer.isActive()) flushTimer.start(kCoalesceMs);
+}
+
+void DirectoryWatcher::addEvent(Watch& watch, const QString& name, int type, bool isDir) {
+    auto it = watch.pendingIndex.constFind(name);
+    if (it != watch.pendingIndex.constEnd()) {
+        PendingEvent& event = watch.pending[it.value()];
+        // Файл создан и удалён в пределах одного окна — клиенту о нём знать незачем
+        if (type == EventDelete && (event.mask & EventCreate) && !(event.mask & EventDelete)) {
+            event.mask = 0;
+            watch.pendingIndex.remove(name);
+            return;
+        }
+        event.mask |= type;
+        event.isDir = event.isDir || isDir;
+        return;
+    }
+    if (watch.pending.size() >= kMaxPendingPerWatch) {
+        // Слишком много изменений: дешевле перечитать каталог, чем слать каждое
+        watch.overflowed = true;
+        return;
+    }
+    watch.pendingIndex.insert(name, watch.pending.size());
+    watch.pending.append(PendingEvent{ name, type, isDir });
+}
+
+void DirectoryWatcher::flush() {
+    struct Batch {
+        QString path;
+        QJsonArray events;
+        bool overflow;
+    };
+    QVector<Batch> batches;
+    const bool overflowAll = overflowed;
+    overflowed = false;
+
+    for (Watch& w : watches) {
+        if (overflowAll || w.overflowed) {
+            batches.append(Batch{ w.path, QJsonArray(), true });
+        } else if (!w.pending.isEmpty()) {
+            Batch batch{ w.path, QJsonArray(), false };
+            for (const PendingEvent& event : w.pending) {
+                if (event.mask == 0) continue;
+                QJsonArray types;
+                if (event.mask & EventDelete) types.append("delete");
+                if (event.mask & EventCreate) types.append("create");
+                if (event.mask & EventModify) types.append("modify");
+                if (event.mask & EventAttrib) types.append("attrib");
+                batch.events.append(QJsonObject{
+                    {"name", event.name},
+                    {"types", types},
+                    {"is_dir", event.isDir}
+                });
+            }
+            if (!batch.events.isEmpty()) batches.append(batch);
+        }
+        w.pending.clear();
+        w.pendingIndex.clear();
+        w.overflowed = false;
+    }
+
+    for (const Batch& batch : batches) emit changed(batch.path, batch.events, batch.overflow);
+}
@@ -0,0 +1,66 @@
+#ifndef DIRECTORYWATCHER_H
+#define DIRECTORYWATCHER_H
+
+#include <QObject>
+#include <QJsonArray>
+#include <QHash>
+#include <QSet>
+#include <QTimer>
+#include <QVector>
+
+class QSocketNotifier;
+
+// Общие для всех клиентов подписки inotify на каталоги. Один watch на каталог
+// со счётчиком подписчиков; события копятся и раз в coalesceMs отдаются одним
+// пакетом, где повторы по одному имени схлопнуты.
+class DirectoryWatcher : public QObject
+{
+    Q_OBJECT
+public:
+    explicit DirectoryWatcher(QObject *parent = nullptr);
+    ~DirectoryWatcher();
+
+    bool watch(QObject *subscriber, const QString &path);
+    bool unwatch(QObject *subscriber, const QString &path);
+    // Снять все подписки клиента (при отключении)
+    void unwatchAll(QObject *subscriber);
+
+    QList<QObject *> subscribers(const QString &path) const;
+
+signals:
+    // events: [{name, types: [create|delete|modify|attrib], is_dir}];
+    // overflow=true — ядро потеряло события, каталог нужно перечитать целиком
+    void changed(const QString &path, const QJsonArray &events, bool overflow);
+    // Каталог удалён или перемещён, подписка на него снята
+    void removed(const QString &path, const QList<QObject *> &subscribers);
+
+private slots:
+    void readEvents();
+    void flush();
+
+private:
+    struct PendingEvent {
+        QString name;
+        int mask = 0;          // накопленные типы (EventCreate, ...)
+        bool isDir = false;
+    };
+    struct Watch {
+        QString path;
+        QSet<QObject *> subscribers;
+        QVector<PendingEvent> pending;
+        QHash<QString, int> pendingIndex;   // имя → позиция в pending
+        bool overflowed = false;            // превышен kMaxPendingPerWatch
+    };
+
+    void addEvent(Watch &watch, const QString &name, int type, bool isDir);
+    void dropWatch(int wd);
+
+    int fd = -1;
+    QSocketNotifier *notifier = nullptr;
+    QHash<int, Watch> watches;        // wd → watch
+    QHash<QString, int> pathToWatch;
+    QTimer flushTimer;
+    bool overflowed = false;          // IN_Q_OVERFLOW: потеряны события всех каталогов
+};
+
+#endif // DIRECTORYWATCHER_H
@@ -0,0 +1,468 @@
+#include "diskusagescanner.h"
+#include "procfs.h"
+#include "workqueue.h"
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+static const int kProgressIntervalMs = 500;
+static const qint64 kCacheTtlMs = 5 * 60 * 1000;
+static const int kMaxCachedScans = 16;
+static const int kMaxDepth = 8;
+static const int kMaxChildrenInReply = 200;
+static const int kInodeShards = 64;
+
+namespace {
+
+struct SizeNode {
+    std::string name;
+    SizeNode *parent = nullptr;
+    std::atomic<uint64_t> bytes{0};      // занято на диске (stx_blocks * 512), как считает du
+    std::atomic<uint64_t> apparent{0};   // сумма stx_size
+    std::atomic<uint64_t> files{0};
+    std::atomic<uint64_t> dirs{0};
+    std::vector<std::unique_ptr<SizeNode>> children;  // меняется под Scan::treeMutex
+};
+
+// Открытый каталог; живёт, пока не открыты все его подкаталоги из очередей.
+// open считает дескрипторы, которые обход держит в очередях.
+struct DirHandle {
+    DirHandle(int fd, std::atomic<int> &open) : fd(fd), open(open) { open.fetch_add(1, std::memory_order_relaxed); }
+    ~DirHandle() {
+        ::close(fd);
+        open.fetch_sub(1, std::memory_order_relaxed);
+    }
+    DirHandle(const DirHandle &) = delete;
+    DirHandle &operator=(const DirHandle &) = delete;
+    const int fd;
+    std::atomic<int> &open;
+};
+
+// Подкаталог открывается openat относительно родителя: подмена промежуточного
+// компонента пути на символьную ссылку во время обхода ни на что не влияет.
+// Без родителя name — полный путь: так ставится корень и подкаталоги, когда
+// дескрипторов не хватает (см. Scan::process).
+struct DirTask {
+    std::shared_ptr<const DirHandle> parent;  // пусто — name содержит полный путь
+    std::string name;           // имя в родителе или полный путь
+    SizeNode *node = nullptr;   // узел, в который идут размеры этого каталога
+    int depth = 0;              // глубина относительно корня обхода
+    int retries = 0;            // попытки открыть после EMFILE/ENFILE
+};
+
+// Полный путь открытого каталога; readlink не тратит дескриптор
+bool fdPath(int fd, std::string &path) {
+    char link[32];
+    char buffer[PATH_MAX];
+    snprintf(link, sizeof(link), "/proc/self/fd/%d", fd);
+    const ssize_t n = ::readlink(link, buffer, sizeof(buffer));
+    if (n <= 0 || n >= ssize_t(sizeof(buffer)) || buffer[0] != '/') return false;
+    path.assign(buffer, size_t(n));
+    return true;
+}
+
+std::string childPath(const std::string &dir, const char *name) {
+    return dir.back() == '/' ? dir + name : dir + '/' + name;
+}
+
+// Сколько дескрипторов каталогов обход держит в очередях. Сверх этого
+// подкаталоги ставятся по полному пути, и родитель закрывается сразу после
+// чтения: остальная часть предела остаётся серверу.
+int handleBudget() {
+    struct rlimit limit;
+    if (::getrlimit(RLIMIT_NOFILE, &limit) != 0 || limit.rlim_cur == RLIM_INFINITY) return 4096;
+    return int(std::min<rlim_t>(std::max<rlim_t>(limit.rlim_cur / 4, 64), 1 << 20));
+}
+
+// Учтённые inode с nlink > 1; шарды снижают конкуренцию за мьютекс
+class InodeSet {
+public:
+    bool insert(uint64_t inode) {
+        Shard &shard = shards[inode % kInodeShards];
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        return shard.inodes.insert(inode).second;
+    }
+
+private:
+    struct Shard {
+        std::mutex mutex;
+        std::unordered_set<uint64_t> inodes;
+    };
+    Shard shards[kInodeShards];
+};
+
+void addToChain(SizeNode *node, uint64_t bytes, uint64_t apparent, uint64_t files, uint64_t dirs) {
+    for (; node; node = node->parent) {
+        if (bytes)    node->bytes.fetch_add(bytes, std::memory_order_relaxed);
+        if (apparent) node->apparent.fetch_add(apparent, std::memory_order_relaxed);
+        if (files)    node->files.fetch_add(files, std::memory_order_relaxed);
+        if (dirs)     node->dirs.fetch_add(dirs, std::memory_order_relaxed);
+    }
+}
+
+qint64 nowMs() {
+    return QDateTime::currentMSecsSinceEpoch();
+}
+
+} // namespace
+
+struct DiskUsageScanner::Scan {
+    quint64 id = 0;
+    QString root;
+    int depth = 1;
+    uint32_t devMajor = 0, devMinor = 0;
+
+    SizeNode tree;
+    mutable std::mutex treeMutex;
+    InodeSet hardlinks;
+
+    std::unique_ptr<WorkStealingQueues<DirTask>> queues;
+    std::atomic<bool> cancelled{false};
+    std::atomic<bool> done{false};
+    bool reported = false;                  // finished уже отправлен (главный поток)
+
+    std::atomic<uint64_t> scannedDirs{0}, scannedFiles{0}, errors{0};
+    std::atomic<int> openHandles{0};
+    int handleLimit = 0;
+    qint64 startedMs = 0;
+    std::atomic<qint64> finishedMs{0};
+    std::thread coordinator;
+    QVector<QPair<QString, int>> views;     // запрошенные (path, depth), главный поток
+
+    ~Scan() {
+        cancelled = true;
+        if (coordinator.joinable()) coordinator.join();
+    }
+
+    void run(int threads);
+    void process(int self, const DirTask &task, procfs::DirReader &reader);
+};
+
+void DiskUsageScanner::Scan::run(int threads) {
+    queues = std::make_unique<WorkStealingQueues<DirTask>>(threads);
+    handleLimit = handleBudget();
+    queues->push(0, DirTask{ nullptr, QFile::encodeName(root).toStdString(), &tree, 0 });
+
+    std::vector<procfs::DirReader> readers(size_t(threads), procfs::DirReader(64 * 1024));
+    queues->run(cancelled, [this, &readers](int self, const DirTask &task) {
+        process(self, task, readers[size_t(self)]);
+    });
+
+    finishedMs = nowMs();
+    done = true;
+}
+
+void DiskUsageScanner::Scan::process(int self, const DirTask &task, procfs::DirReader &reader) {
+    const int flags = O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC;
+    const int fd = task.parent ? ::openat(task.parent->fd, task.name.c_str(), flags)
+                               : ::open(task.name.c_str(), flags);
+    if (fd < 0 && (errno == EMFILE || errno == ENFILE)) {
+        // Дескрипторы кончились — не ошибка каталога. Задание возвращается в
+        // очередь по полному пути: ссылка на родителя отпускается, и когда
+        // очереди освободят дескрипторы, каталог откроется заново.
+        std::string path;
+        if (!task.parent) path = task.name;
+        else if (fdPath(task.parent->fd, path)) path = childPath(path, task.name.c_str());
+        if (!path.empty()) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(std::min(1 << std::min(task.retries, 6), 50)));
+            queues->push(self, DirTask{ nullptr, path, task.node, task.depth, task.retries + 1 });
+            return;
+        }
+    }
+    if (fd < 0) {
+        errors.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    const auto handle = std::make_shared<const DirHandle>(fd, openHandles);
+    std::string dirPath;    // полный путь этого каталога, нужен только сверх handleLimit
+
+    uint64_t bytes = 0, apparent = 0, files = 0, dirs = 0;
+    reader.reset(fd);
+    procfs::DirReader::Entry entry;
+    while (reader.next(entry)) {
+        if (entry.name[0] == '.' && (entry.name[1] == 0 || (entry.name[1] == '.' && entry.name[2] == 0))) continue;
+        if (cancelled.load(std::memory_order_relaxed)) break;
+
+        struct statx sx;
+        if (::statx(fd, entry.name, AT_SYMLINK_NOFOLLOW | AT_NO_AUTOMOUNT | AT_STATX_DONT_SYNC,
+                    STATX_TYPE | STATX_NLINK | STATX_INO | STATX_SIZE | STATX_BLOCKS, &sx) != 0) {
+            errors.fetch_add(1, std::memory_order_relaxed);
+            continue;
+        }
+
+        if (S_ISDIR(sx.stx_mode)) {
+            // Точка монтирования другой файловой системы — не спускаемся (du -x)
+            if (sx.stx_dev_major != devMajor || sx.stx_dev_minor != devMinor) continue;
+
+            SizeNode *childNode = task.node;
+            if (task.depth < depth) {
+                auto child = std::make_unique<SizeNode>();
+                child->name = entry.name;
+                child->parent = task.node;
+                childNode = child.get();
+                std::lock_guard<std::mutex> lock(treeMutex);
+                task.node->children.push_back(std::move(child));
+            }
+            ++dirs;
+            // Блоки самого каталога относятся к его поддереву
+            if (childNode == task.node) {
+                bytes += uint64_t(sx.stx_blocks) * 512;
+                apparent += sx.stx_size;
+            } else {
+                addToChain(childNode, uint64_t(sx.stx_blocks) * 512, sx.stx_size, 0, 0);
+            }
+            const bool overBudget = openHandles.load(std::memory_order_relaxed) > handleLimit;
+            if (overBudget && dirPath.empty()) {
+                if (task.parent) fdPath(fd, dirPath);
+                else dirPath = task.name;
+            }
+            if (overBudget && !dirPath.empty()) {
+                queues->push(self, DirTask{ nullptr, childPath(dirPath, entry.name), childNode, task.depth + 1 });
+            } else {
+                queues->push(self, DirTask{ handle, entry.name, childNode, task.depth + 1 });
+            }
+            continue;
+        }
+
+        // Жёсткая ссылка: считаем только первую встреченную
+        if (sx.stx_nlink > 1 && !hardlinks.insert(sx.stx_ino)) continue;
+        ++files;
+        bytes += uint64_t(sx.stx_blocks) * 512;
+        apparent += sx.stx_size;
+    }
+    if (reader.failed()) errors.fetch_add(1, std::memory_order_relaxed);
+
+    scannedDirs.fetch_add(1, std::memory_order_relaxed);
+    scannedFiles.fetch_add(files, std::memory_order_relaxed);
+    addToChain(task.node, bytes, apparent, files, dirs);
+}
+
+// Узел дерева для пути внутри обхода; вызывается под treeMutex
+static const SizeNode *findNode(const SizeNode &tree, const QString &root, const QString &path) {
+    if (path == root) return &tree;
+    const QString prefix = root.endsWith('/') ? root : root + '/';
+    if (!path.startsWith(prefix)) return nullptr;
+
+    const SizeNode *node = &tree;
+    const QStringList parts = path.mid(prefix.size()).split('/', Qt::SkipEmptyParts);
+    for (const QString &part : parts) {
+        const std::string name = QFile::encodeName(part).toStdString();
+        const SizeNode *next = nullptr;
+        for (const auto &child : node->children) {
+            if (child->name == name) { next = child.get(); break; }
+        }
+        if (!next) return nullptr;
+        node = next;
+    }
+    return node;
+}
+
+static int relativeDepth(const QString &root, const QString &path) {
+    if (path == root) return 0;
+    const QString prefix = root.endsWith('/') ? root : root + '/';
+    return path.mid(prefix.size()).split('/', Qt::SkipEmptyParts).size();
+}
+
+static QJsonObject nodeToJson(const SizeNode &node, const QString &path, int depthLeft) {
+    QJsonObject object;
+    object["name"] = QFile::decodeName(node.name.c_str());
+    object["path"] = path;
+    object["bytes"] = qint64(node.bytes.load(std::memory_order_relaxed));
+    object["apparent_bytes"] = qint64(node.apparent.load(std::memory_order_relaxed));
+    object["files"] = qint64(node.files.load(std::memory_order_relaxed));
+    object["dirs"] = qint64(node.dirs.load(std::memory_order_relaxed));
+
+    if (depthLeft > 0 && !node.children.empty()) {
+        std::vector<const SizeNode *> sorted;
+        sorted.reserve(node.children.size());
+        for (const auto &child : node.children) sorted.push_back(child.get());
+        const size_t shown = std::min(sorted.size(), size_t(kMaxChildrenInReply));
+        std::partial_sort(sorted.begin(), sorted.begin() + std::ptrdiff_t(shown), sorted.end(),
+                          [](const SizeNode *a, const SizeNode *b) {
+            return a->bytes.load(std::memory_order_relaxed) > b->bytes.load(std::memory_order_relaxed);
+        });
+
+        const QString prefix = path.endsWith('/') ? path : path + '/';
+        QJsonArray children;
+        for (size_t i = 0; i < shown; ++i) {
+            children.append(nodeToJson(*sorted[i], prefix + QFile::decodeName(sorted[i]->name.c_str()), depthLeft - 1));
+        }
+        object["children"] = children;
+        if (sorted.size() > shown) object["children_omitted"] = int(sorted.size() - shown);
+    }
+    return object;
+}
+
+DiskUsageScanner::DiskUsageScanner(QObject* parent) : QObject(parent) {
+    connect(&progressTimer, &QTimer::timeout, this, &DiskUsageScanner::reportProgress);
+}
+
+DiskUsageScanner::~DiskUsageScanner() {
+    // ~Scan отменяет обход и дожидается потоков
+    scans.clear();
+    retired.clear();
+}
+
+QJsonObject DiskUsageScanner::getDirectorySizes(const QString& path, int depth) {
+    // Корень-ссылка (/lib на merged-usr) иначе не откроется с O_NOFOLLOW
+    const QString requested = path.isEmpty() ? QDir::rootPath() : path;
+    char resolved[PATH_MAX];
+    if (!::realpath(QFile::encodeName(requested).constData(), resolved)) return QJsonObject();
+    const QString clean = QFile::decodeName(resolved);
+    depth = qBound(0, depth, kMaxDepth);
+
+    std::shared_ptr<Scan> covering = findCovering(clean, depth);
+    if (covering) {
+        const qint64 age = covering->done ? nowMs() - covering->finishedMs : 0;
+        if (!covering->done || age < kCacheTtlMs) {
+            QJsonObject result = snapshot(*covering, clean, depth);
+            result["cached"] = bool(covering->done);
+            if (covering->done) result["age_ms"] = age;
+            else if (!covering->views.contains({ clean, depth })) covering->views.append({ clean, depth });
+            return result;
+        }
+    }
+
+    std::shared_ptr<Scan> scan = startScan(clean, depth);
+    if (!scan) return QJsonObject();
+    scan->views.append({ clean, depth });
+
+    // Устаревший результат отдаём сразу, пока новый обход присылает прогресс
+    QJsonObject result = covering ? snapshot(*covering, clean, depth) : snapshot(*scan, clean, depth);
+    result["scan_id"] = QString::number(scan->id);
+    result["done"] = false;
+    result["stale"] = bool(covering);
+    return result;
+}
+
+std::shared_ptr<DiskUsageScanner::Scan> DiskUsageScanner::findCovering(const QString& path, int depth) const {
+    std::shared_ptr<Scan> best;
+    for (const auto& scan : scans) {
+        const QString prefix = scan->root.endsWith('/') ? scan->root : scan->root + '/';
+        if (path != scan->root && !path.startsWith(prefix)) continue;
+        if (relativeDepth(scan->root, path) + depth > scan->depth) continue;
+        {
+            std::lock_guard<std::mutex> lock(scan->treeMutex);
+            if (!findNode(scan->tree, scan->root, path)) continue;
+        }
+        if (!best || scan->startedMs > best->startedMs) best = scan;
+    }
+    return best;
+}
+
+std::shared_ptr<DiskUsageScanner::Scan> DiskUsageScanner::startScan(const QString& root, int depth) {
+    struct statx sx;
+    if (::statx(AT_FDCWD, QFile::encodeName(root).constData(), AT_SYMLINK_NOFOLLOW | AT_NO_AUTOMOUNT,
+                STATX_TYPE | STATX_SIZE | STATX_BLOCKS, &sx) != 0 || !S_ISDIR(sx.stx_mode)) {
+        return nullptr;
+    }
+
+    auto scan = std::make_shared<Scan>();
+    scan->id = nextScanId++;
+    scan->root = root;
+    scan->depth = depth;
+    scan->devMajor = sx.stx_dev_major;
+    scan->devMinor = sx.stx_dev_minor;
+    scan->tree.name = QFile::encodeName(root).toStdString();
+    scan->tree.bytes = uint64_t(sx.stx_blocks) * 512;
+    scan->tree.apparent = sx.stx_size;
+    scan->startedMs = nowMs();
+
+    // Обход упирается в задержки ввода-вывода, а не в CPU, поэтому потоков больше, чем ядер
+    const int threads = qBound(4, int(std::thread::hardware_concurrency()) * 2, 32);
+    Scan *raw = scan.get();
+    scan->coordinator = std::thread([raw, threads] { raw->run(threads); });
+
+    // Предыдущий обход того же корня заменяется; подписчикам незавершённого сообщаем об отмене.
+    // Его потоки дожидаемся в reportProgress, когда отмена дойдёт до них
+    auto previous = scans.find(root);
+    if (previous != scans.end()) {
+        std::shared_ptr<Scan> old = previous.value();
+        scans.erase(previous);
+        if (!old->reported) {
+            const bool wasRunning = !old->done;
+            old->cancelled = true;
+            emitFinished(*old, wasRunning);
+        }
+        retired.push_back(std::move(old));
+    }
+    scans.insert(root, scan);
+    evictOldScans();
+
+    if (!progressTimer.isActive()) progressTimer.start(kProgressIntervalMs);
+    return scan;
+}
+
+QJsonObject DiskUsageScanner::snapshot(const Scan& scan, const QString& path, int depth) const {
+    QJsonObject result;
+    result["scan_id"] = QString::number(scan.id);
+    result["path"] = path;
+    result["depth"] = depth;
+    result["done"] = bool(scan.done);
+    result["scanned_dirs"] = qint64(scan.scannedDirs.load());
+    result["scanned_files"] = qint64(scan.scannedFiles.load());
+    result["errors"] = qint64(scan.errors.load());
+    result["elapsed_ms"] = (scan.done ? scan.finishedMs.load() : nowMs()) - scan.startedMs;
+
+    std::lock_guard<std::mutex> lock(scan.treeMutex);
+    if (const SizeNode* node = findNode(scan.tree, scan.root, path)) {
+        result["tree"] = nodeToJson(*node, path, depth);
+    }
+    return result;
+}
+
+void DiskUsageScanner::emitFinished(Scan& scan, bool cancelled) {
+    scan.reported = true;
+    for (const auto& view : scan.views) {
+        QJsonObject result = snapshot(scan, view.first, view.second);
+        if (cancelled) result["cancelled"] = true;
+        emit finished(scan.id, result);
+    }
+}
+
+void DiskUsageScanner::reportProgress() {
+    bool active = false;
+    for (const auto& scan : scans) {
+        if (scan->reported) continue;
+        if (scan->done) {
+            emitFinished(*scan, false);
+        } else {
+            active = true;
+            for (const auto& view : scan->views) emit progress(scan->id, snapshot(*scan, view.first, view.second));
+        }
+    }
+    // Отменённый обход выставляет done, выйдя из очередей: join тогда не ждёт
+    retired.erase(std::remove_if(retired.begin(), retired.end(), [](const std::shared_ptr<Scan>& scan) {
+        return scan->done.load();
+    }), retired.end());
+    if (!active && retired.empty()) progressTimer.stop();
+}
+
+void DiskUsageScanner::evictOldScans() {
+    while (scans.size() > kMaxCachedScans) {
+        auto oldest = scans.end();
+        for (auto it = scans.begin(); it != scans.end(); ++it) {
+            if (!it.value()->reported) continue;
+            if (oldest == scans.end() || it.value()->finishedMs < oldest.value()->finishedMs) oldest = it;
+        }
+        if (oldest == scans.end()) break;  // все обходы ещё идут
+        // Вытесняются только завершённые обходы, их потоки уже вышли
+        scans.erase(oldest);
+    }
+}
@@ -0,0 +1,56 @@
+#ifndef DISKUSAGESCANNER_H
+#define DISKUSAGESCANNER_H
+
+#include <QObject>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QHash>
+#include <QTimer>
+#include <QVector>
+#include <memory>
+#include <vector>
+
+// Параллельный подсчёт занятого места (аналог du -x) с кэшем результатов.
+// Обход выполняют рабочие потоки с собственными очередями каталогов и кражей
+// работы у соседей; жёсткие ссылки учитываются один раз, точки монтирования
+// не пересекаются. Дерево размеров хранится до запрошенной глубины, более
+// глубокие каталоги суммируются в ближайшего сохранённого предка.
+class DiskUsageScanner : public QObject
+{
+    Q_OBJECT
+public:
+    explicit DiskUsageScanner(QObject *parent = nullptr);
+    ~DiskUsageScanner();
+
+    // Возвращает текущее состояние: готовый результат из кэша либо частичный
+    // снимок идущего обхода (done=false) — тогда дальше приходят progress/finished.
+    // Путь приводится к каноническому (realpath), в ответе он в path.
+    // Пустой объект — каталог не открыть.
+    QJsonObject getDirectorySizes(const QString &path, int depth);
+
+signals:
+    // Снимки приходят по каждому запрошенному у обхода (path, depth):
+    // подкаталог, покрытый идущим обходом корня, получает свой срез
+    void progress(quint64 scanId, const QJsonObject &snapshot);
+    void finished(quint64 scanId, const QJsonObject &result);
+
+private slots:
+    void reportProgress();
+
+private:
+    struct Scan;
+
+    std::shared_ptr<Scan> startScan(const QString &root, int depth);
+    std::shared_ptr<Scan> findCovering(const QString &path, int depth) const;
+    QJsonObject snapshot(const Scan &scan, const QString &path, int depth) const;
+    void emitFinished(Scan &scan, bool cancelled);
+    void evictOldScans();
+
+    QHash<QString, std::shared_ptr<Scan>> scans;  // корень обхода → обход
+    // Заменённые и отменённые обходы: их потоки дожидаемся по таймеру, а не в главном потоке
+    std::vector<std::shared_ptr<Scan>> retired;
+    QTimer progressTimer;
+    quint64 nextScanId = 1;
+};
+
+#endif // DISKUSAGESCANNER_H
@@ -0,0 +1,587 @@
+#include "fileindex.h"
+#include "procfs.h"
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonArray>
+
+#include <fcntl.h>
+#include <fnmatch.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+static const uint32_t kNoEntry = 0xFFFFFFFFu;
+static const int kMaxSearchLimit = 10000;
+// Сколько самых коротких списков триграмм пересекать; остальное отсеет проверка
+static const size_t kMaxIntersectedLists = 3;
+
+struct FileIndexSnapshot {
+    struct DirInfo {
+        uint32_t firstChild = 0;    // дети каталога лежат подряд
+        uint32_t childCount = 0;
+        uint64_t inode = 0;
+        int64_t mtimeSec = 0;
+        uint32_t mtimeNsec = 0;
+    };
+
+    // Запись: имя в общем буфере + родитель. Имя корня — его полный путь
+    std::string names;
+    std::vector<uint32_t> nameOffset;
+    std::vector<uint16_t> nameLength;
+    std::vector<uint32_t> parent;
+    std::vector<uint8_t> isDir;
+    std::unordered_map<uint32_t, DirInfo> dirs;
+    std::vector<uint32_t> roots;
+
+    // Триграммы имён (ASCII в нижнем регистре): отсортированные ключи и
+    // списки записей, сжатые как varint-разности возрастающих id
+    std::vector<uint32_t> trigramKeys;
+    std::vector<uint32_t> trigramCounts;
+    std::vector<uint64_t> postingOffsets;
+    std::vector<uint8_t> postings;
+
+    int64_t builtAtMs = 0;
+    int64_t buildMs = 0;
+    uint64_t scannedDirs = 0;
+    uint64_t reusedDirs = 0;
+
+    uint32_t size() const { return uint32_t(parent.size()); }
+    std::string_view name(uint32_t id) const {
+        return std::string_view(names.data() + nameOffset[id], nameLength[id]);
+    }
+
+    uint32_t addEntry(std::string_view entryName, uint32_t parentId, bool dir) {
+        nameOffset.push_back(uint32_t(names.size()));
+        nameLength.push_back(uint16_t(std::min<size_t>(entryName.size(), 0xFFFF)));
+        names.append(entryName.data(), nameLength.back());
+        parent.push_back(parentId);
+        isDir.push_back(dir ? 1 : 0);
+        return size() - 1;
+    }
+
+    std::string path(uint32_t id) const {
+        std::vector<uint32_t> chain;
+        for (uint32_t p = id; p != kNoEntry; p = parent[p]) chain.push_back(p);
+        std::string result(name(chain.back()));
+        for (auto it = chain.rbegin() + 1; it != chain.rend(); ++it) {
+            if (result.empty() || result.back() != '/') result += '/';
+            result += name(*it);
+        }
+        return result;
+    }
+
+    size_t memoryBytes() const {
+        return names.capacity()
+             + nameOffset.capacity() * sizeof(uint32_t)
+             + nameLength.capacity() * sizeof(uint16_t)
+             + parent.capacity() * sizeof(uint32_t)
+             + isDir.capacity()
+             + dirs.size() * (sizeof(std::pair<const uint32_t, DirInfo>) + 2 * sizeof(void*))
+             + dirs.bucket_count() * sizeof(void*)
+             + roots.capacity() * sizeof(uint32_t)
+             + trigramKeys.capacity() * sizeof(uint32_t)
+             + trigramCounts.capacity() * sizeof(uint32_t)
+             + postingOffsets.capacity() * sizeof(uint64_t)
+             + postings.capacity();
+    }
+};
+
+namespace {
+
+inline char lowerAscii(char c) {
+    return (c >= 'A' && c <= 'Z') ? char(c - 'A' + 'a') : c;
+}
+
+std::string toLowerAscii(std::string_view text) {
+    std::string result(text);
+    for (char& c : result) c = lowerAscii(c);
+    return result;
+}
+
+inline uint32_t trigramKey(const char* p) {
+    return (uint32_t(uint8_t(lowerAscii(p[0]))) << 16)
+         | (uint32_t(uint8_t(lowerAscii(p[1]))) << 8)
+         |  uint32_t(uint8_t(lowerAscii(p[2])));
+}
+
+void appendVarint(std::vector<uint8_t>& out, uint32_t value) {
+    while (value >= 0x80) {
+        out.push_back(uint8_t(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(uint8_t(value));
+}
+
+void buildTrigrams(FileIndexSnapshot& s) {
+    struct Builder {
+        std::vector<uint8_t> data;
+        uint32_t last = 0;
+        uint32_t count = 0;
+    };
+    std::unordered_map<uint32_t, Builder> builders;
+    builders.reserve(1 << 16);
+
+    std::vector<uint32_t> keys;
+    for (uint32_t id = 0; id < s.size(); ++id) {
+        const std::string_view name = s.name(id);
+        if (name.size() < 3) continue;
+        keys.clear();
+        for (size_t i = 0; i + 3 <= name.size(); ++i) keys.push_back(trigramKey(name.data() + i));
+        std::sort(keys.begin(), keys.end());
+        keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+        for (uint32_t key : keys) {
+            Builder& b = builders[key];
+            appendVarint(b.data, id - b.last);
+            b.last = id;
+            ++b.count;
+        }
+    }
+
+    s.trigramKeys.reserve(builders.size());
+    for (const auto& item : builders) s.trigramKeys.push_back(item.first);
+    std::sort(s.trigramKeys.begin(), s.trigramKeys.end());
+
+    size_t total = 0;
+    for (const auto& item : builders) total += item.second.data.size();
+    s.postings.reserve(total);
+    s.trigramCounts.reserve(s.trigramKeys.size());
+    s.postingOffsets.reserve(s.trigramKeys.size() + 1);
+    for (uint32_t key : s.trigramKeys) {
+        Builder& b = builders[key];
+        s.postingOffsets.push_back(s.postings.size());
+        s.trigramCounts.push_back(b.count);
+        s.postings.insert(s.postings.end(), b.data.begin(), b.data.end());
+        std::vector<uint8_t>().swap(b.data);
+    }
+    s.postingOffsets.push_back(s.postings.size());
+}
+
+void decodePostings(const FileIndexSnapshot& s, size_t keyIndex, std::vector<uint32_t>& out) {
+    out.clear();
+    out.reserve(s.trigramCounts[keyIndex]);
+    const uint8_t* p = s.postings.data() + s.postingOffsets[keyIndex];
+    const uint8_t* end = s.postings.data() + s.postingOffsets[keyIndex + 1];
+    uint32_t value = 0;
+    while (p < end) {
+        uint32_t delta = 0;
+        int shift = 0;
+        while (*p & 0x80) {
+            delta |= uint32_t(*p++ & 0x7F) << shift;
+            shift += 7;
+        }
+        delta |= uint32_t(*p++) << shift;
+        value += delta;
+        out.push_back(value);
+    }
+}
+
+bool sameMtime(const FileIndexSnapshot::DirInfo& info, const struct statx& sx) {
+    return info.inode == sx.stx_ino && info.mtimeSec == sx.stx_mtime.tv_sec
+        && info.mtimeNsec == sx.stx_mtime.tv_nsec;
+}
+
+std::string joinPath(const std::string& dir, std::string_view name) {
+    std::string result = dir;
+    if (result.empty() || result.back() != '/') result += '/';
+    result += name;
+    return result;
+}
+
+std::shared_ptr<FileIndexSnapshot> buildSnapshot(const std::vector<std::string>& roots,
+                                                 const FileIndexSnapshot* prev,
+                                                 const std::atomic<bool>& cancelled) {
+    const int64_t started = QDateTime::currentMSecsSinceEpoch();
+    auto s = std::make_shared<FileIndexSnapshot>();
+    if (prev) {
+        s->names.reserve(prev->names.size());
+        s->nameOffset.reserve(prev->size());
+        s->nameLength.reserve(prev->size());
+        s->parent.reserve(prev->size());
+        s->isDir.reserve(prev->size());
+    }
+
+    struct Pending {
+        uint32_t entry;
+        std::string path;
+        uint32_t prevEntry;     // та же запись в прошлом снимке или kNoEntry
+        uint32_t devMajor, devMinor;
+    };
+    std::deque<Pending> queue;
+
+    for (const std::string& root : roots) {
+        struct statx sx;
+        if (::statx(AT_FDCWD, root.c_str(), AT_NO_AUTOMOUNT, STATX_TYPE, &sx) != 0 || !S_ISDIR(sx.stx_mode)) continue;
+        const uint32_t id = s->addEntry(root, kNoEntry, true);
+        s->roots.push_back(id);
+        uint32_t prevRoot = kNoEntry;
+        if (prev) {
+            for (uint32_t r : prev->roots) {
+                if (prev->name(r) == root) prevRoot = r;
+            }
+        }
+        queue.push_back(Pending{ id, root, prevRoot, sx.stx_dev_major, sx.stx_dev_minor });
+    }
+
+    procfs::DirReader reader(64 * 1024);
+    std::unordered_map<std::string_view, uint32_t> prevChildren;
+    while (!queue.empty() && !cancelled.load(std::memory_order_relaxed)) {
+        Pending dir = std::move(queue.front());
+        queue.pop_front();
+
+        struct statx sx;
+        if (::statx(AT_FDCWD, dir.path.c_str(), AT_SYMLINK_NOFOLLOW | AT_NO_AUTOMOUNT,
+                    STATX_TYPE | STATX_INO | STATX_MTIME, &sx) != 0) continue;
+        // Не выходим за пределы файловой системы корня
+        if (sx.stx_dev_major != dir.devMajor || sx.stx_dev_minor != dir.devMinor) continue;
+
+        FileIndexSnapshot::DirInfo info;
+        info.firstChild = s->size();
+        info.inode = sx.stx_ino;
+        info.mtimeSec = sx.stx_mtime.tv_sec;
+        info.mtimeNsec = sx.stx_mtime.tv_nsec;
+
+        const FileIndexSnapshot::DirInfo* prevInfo = nullptr;
+        if (prev && dir.prevEntry != kNoEntry) {
+            auto it = prev->dirs.find(dir.prevEntry);
+            if (it != prev->dirs.end()) prevInfo = &it->second;
+        }
+
+        if (prevInfo && sameMtime(*prevInfo, sx)) {
+            // Состав каталога не менялся — копируем детей из прошлого снимка
+            for (uint32_t c = prevInfo->firstChild; c < prevInfo->firstChild + prevInfo->childCount; ++c) {
+                const uint32_t id = s->addEntry(prev->name(c), dir.entry, prev->isDir[c]);
+                if (prev->isDir[c]) {
+                    queue.push_back(Pending{ id, joinPath(dir.path, prev->name(c)), c, dir.devMajor, dir.devMinor });
+                }
+            }
+            ++s->reusedDirs;
+        } else {
+            const int fd = ::open(dir.path.c_str(), O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+            if (fd < 0) continue;
+            prevChildren.clear();
+            if (prevInfo) {
+                for (uint32_t c = prevInfo->firstChild; c < prevInfo->firstChild + prevInfo->childCount; ++c) {
+                    if (prev->isDir[c]) prevChildren.emplace(prev->name(c), c);
+                }
+            }
+            reader.reset(fd);
+            procfs::DirReader::Entry entry;
+            while (reader.next(entry)) {
+                if (entry.name[0] == '.' && (entry.name[1] == 0 || (entry.name[1] == '.' && entry.name[2] == 0))) continue;
+                bool isDir = entry.type == DT_DIR;
+                if (entry.type == DT_UNKNOWN) {
+                    struct statx child;
+                    isDir = ::statx(fd, entry.name, AT_SYMLINK_NOFOLLOW | AT_NO_AUTOMOUNT, STATX_TYPE, &child) == 0
+                         && S_ISDIR(child.stx_mode);
+                }
+                const std::string_view name(entry.name);
+                const uint32_t id = s->addEntry(name, dir.entry, isDir);
+                if (isDir) {
+                    auto found = prevChildren.find(name);
+                    queue.push_back(Pending{ id, joinPath(dir.path, name),
+                                             found != prevChildren.end() ? found->second : kNoEntry,
+                                             dir.devMajor, dir.devMinor });
+                }
+            }
+            ::close(fd);
+            ++s->scannedDirs;
+        }
+        info.childCount = s->size() - info.firstChild;
+        s->dirs.emplace(dir.entry, info);
+    }
+    if (cancelled.load()) return nullptr;
+
+    buildTrigrams(*s);
+    s->builtAtMs = QDateTime::currentMSecsSinceEpoch();
+    s->buildMs = s->builtAtMs - started;
+    return s;
+}
+
+// Литеральные куски шаблона, которые обязаны входить в имя найденной записи
+std::vector<std::string> requiredLiterals(const std::string& pattern, bool glob, bool pathMode) {
+    std::vector<std::string> literals;
+    std::string tail = pattern;
+    if (pathMode) tail = pattern.substr(pattern.rfind('/') + 1);
+    if (!glob) {
+        literals.push_back(tail);
+        return literals;
+    }
+
+    std::string current;
+    for (size_t i = 0; i < tail.size(); ++i) {
+        const char c = tail[i];
+        if (c == '\\' && i + 1 < tail.size()) {
+            current += tail[++i];
+        } else if (c == '*' || c == '?' || c == '[') {
+            if (c == '[') {
+                while (i < tail.size() && tail[i] != ']') ++i;
+            }
+            literals.push_back(current);
+            current.clear();
+        } else {
+            current += c;
+        }
+    }
+    literals.push_back(current);
+    // С путём «*» может захватить «/», поэтому надёжен только конечный кусок
+    if (pathMode) literals.erase(literals.begin(), literals.end() - 1);
+    return literals;
+}
+
+// Литеральные куски каталожной части шаблона (до последнего «/»). Текст пути
+// перед этим «/» состоит только из имён предков, поэтому каждый кусок без «/»
+// целиком лежит в имени одного из предков найденной записи
+std::vector<std::string> directoryLiterals(const std::string& pattern, bool glob) {
+    std::vector<std::string> literals;
+    const std::string dir = pattern.substr(0, pattern.rfind('/'));
+    std::string current;
+    for (size_t i = 0; i < dir.size(); ++i) {
+        const char c = dir[i];
+        if (glob && c == '\\' && i + 1 < dir.size()) {
+            if (dir[++i] != '/') {
+                current += dir[i];
+                continue;
+            }
+        } else if (glob && c == '[') {
+            while (i < dir.size() && dir[i] != ']') ++i;
+        } else if (c != '/' && !(glob && (c == '*' || c == '?'))) {
+            current += c;
+            continue;
+        }
+        if (current.size() >= 3) literals.push_back(current);
+        current.clear();
+    }
+    if (current.size() >= 3) literals.push_back(current);
+    return literals;
+}
+
+// Добавляет списки триграмм куска в lists и оставляет kMaxIntersectedLists
+// самых коротких; false, если какой-то триграммы нет в индексе
+bool trigramLists(const FileIndexSnapshot& s, const std::string& literal, std::vector<size_t>& lists) {
+    for (size_t i = 0; i + 3 <= literal.size(); ++i) {
+        const uint32_t key = trigramKey(literal.data() + i);
+        auto it = std::lower_bound(s.trigramKeys.begin(), s.trigramKeys.end(), key);
+        if (it == s.trigramKeys.end() || *it != key) return false;
+        lists.push_back(size_t(it - s.trigramKeys.begin()));
+    }
+    std::sort(lists.begin(), lists.end());
+    lists.erase(std::unique(lists.begin(), lists.end()), lists.end());
+    std::sort(lists.begin(), lists.end(), [&s](size_t a, size_t b) {
+        return s.trigramCounts[a] < s.trigramCounts[b];
+    });
+    if (lists.size() > kMaxIntersectedLists) lists.resize(kMaxIntersectedLists);
+    return true;
+}
+
+void intersectLists(const FileIndexSnapshot& s, const std::vector<size_t>& lists, std::vector<uint32_t>& out) {
+    decodePostings(s, lists[0], out);
+    std::vector<uint32_t> next, merged;
+    for (size_t i = 1; i < lists.size() && !out.empty(); ++i) {
+        decodePostings(s, lists[i], next);
+        merged.clear();
+        std::set_intersection(out.begin(), out.end(), next.begin(), next.end(),
+                              std::back_inserter(merged));
+        out.swap(merged);
+    }
+}
+
+} // namespace
+
+FileIndex::FileIndex(QObject* parent) : QObject(parent) {
+    connect(&rescanTimer, &QTimer::timeout, this, &FileIndex::rescan);
+}
+
+FileIndex::~FileIndex() {
+    cancelled = true;
+    if (builder.joinable()) builder.join();
+}
+
+void FileIndex::start(const QStringList& indexRoots, int rescanIntervalSec) {
+    roots = indexRoots;
+    if (roots.isEmpty()) return;
+    rescan();
+    rescanTimer.start(qMax(10, rescanIntervalSec) * 1000);
+}
+
+void FileIndex::rescan() {
+    if (building) return;
+    if (builder.joinable()) builder.join();
+
+    std::vector<std::string> rootPaths;
+    for (const QString& root : roots) rootPaths.push_back(QFile::encodeName(root).toStdString());
+    std::shared_ptr<const FileIndexSnapshot> previous = current();
+
+    building = true;
+    builder = std::thread([this, rootPaths, previous] {
+        std::shared_ptr<FileIndexSnapshot> built = buildSnapshot(rootPaths, previous.get(), cancelled);
+        if (built) {
+            std::lock_guard<std::mutex> lock(snapshotMutex);
+            snapshot = std::move(built);
+        }
+        building = false;
+    });
+}
+
+std::shared_ptr<const FileIndexSnapshot> FileIndex::current() const {
+    std::lock_guard<std::mutex> lock(snapshotMutex);
+    return snapshot;
+}
+
+QJsonObject FileIndex::search(const QString& patternText, int limit, QString* error) const {
+    if (patternText.endsWith('/')) {
+        if (error) *error = "pattern must not end with '/'";
+        return QJsonObject();
+    }
+    QElapsedTimer timer;
+    timer.start();
+    limit = qBound(1, limit, kMaxSearchLimit);
+
+    QJsonObject result;
+    result["pattern"] = patternText;
+    const std::shared_ptr<const FileIndexSnapshot> snap = current();
+    if (!snap || patternText.isEmpty()) {
+        result["ready"] = bool(snap);
+        result["results"] = QJsonArray();
+        result["total"] = 0;
+        return result;
+    }
+    const FileIndexSnapshot& s = *snap;
+
+    const std::string pattern = QFile::encodeName(patternText).toStdString();
+    const std::string lowered = toLowerAscii(pattern);
+    const bool glob = pattern.find_first_of("*?[") != std::string::npos;
+    const bool pathMode = pattern.find('/') != std::string::npos;
+
+    // Кандидаты — пересечение самых коротких списков триграмм
+    std::vector<size_t> lists;
+    bool impossible = false;
+    for (const std::string& part : requiredLiterals(lowered, glob, pathMode)) {
+        if (!trigramLists(s, part, lists)) {
+            impossible = true;
+            break;
+        }
+    }
+
+    std::vector<uint32_t> candidates;
+    const bool indexed = !impossible && !lists.empty();
+    if (indexed) intersectLists(s, lists, candidates);
+
+    // Имя записи слишком короткое для триграмм — отбираем записи по предкам:
+    // берём самый редкий кусок каталожной части и помечаем каталоги, в чьих
+    // именах он встречается, вместе со всеми их потомками
+    std::vector<uint8_t> underMatch;
+    std::string ancestorLiteral;
+    if (!indexed && !impossible && pathMode) {
+        std::vector<size_t> best;
+        for (const std::string& part : directoryLiterals(lowered, glob)) {
+            std::vector<size_t> partLists;
+            if (!trigramLists(s, part, partLists)) {
+                impossible = true;
+                break;
+            }
+            if (best.empty() || s.trigramCounts[partLists[0]] < s.trigramCounts[best[0]]) {
+                best.swap(partLists);
+                ancestorLiteral = part;
+            }
+        }
+        if (!impossible && !best.empty()) {
+            std::vector<uint32_t> dirs;
+            intersectLists(s, best, dirs);
+            underMatch.assign(s.size(), 0);
+            for (uint32_t id : dirs) {
+                if (s.isDir[id] && toLowerAscii(s.name(id)).find(ancestorLiteral) != std::string::npos) {
+                    underMatch[id] = 1;
+                }
+            }
+            // Родитель всегда добавляется раньше детей, так что хватает одного прохода
+            for (uint32_t id = 0; id < s.size(); ++id) {
+                if (s.parent[id] != kNoEntry && underMatch[s.parent[id]]) underMatch[id] = 1;
+            }
+        }
+    }
+
+    // Проверка кандидата: glob — fnmatch целиком, подстрока — без учёта регистра;
+    // в режиме пути совпадение должно заканчиваться в имени самой записи
+    std::string path, lowerPath;
+    auto matches = [&](uint32_t id) {
+        if (!pathMode) {
+            const std::string_view name = s.name(id);
+            if (glob) {
+                path.assign(name.data(), name.size());
+                return ::fnmatch(pattern.c_str(), path.c_str(), FNM_CASEFOLD) == 0;
+            }
+            lowerPath = toLowerAscii(name);
+            return lowerPath.find(lowered) != std::string::npos;
+        }
+        path = s.path(id);
+        if (glob) return ::fnmatch(pattern.c_str(), path.c_str(), FNM_CASEFOLD) == 0;
+        lowerPath = toLowerAscii(path);
+        const size_t nameStart = lowerPath.size() - s.name(id).size();
+        for (size_t pos = lowerPath.find(lowered); pos != std::string::npos; pos = lowerPath.find(lowered, pos + 1)) {
+            if (pos + lowered.size() > nameStart) return true;
+        }
+        return false;
+    };
+
+    QJsonArray results;
+    qint64 total = 0;
+    auto consider = [&](uint32_t id) {
+        if (!matches(id)) return;
+        ++total;
+        if (results.size() < limit) {
+            results.append(QJsonObject{
+                {"path", QFile::decodeName(s.path(id).c_str())},
+                {"is_dir", bool(s.isDir[id])}
+            });
+        }
+    };
+    if (indexed) {
+        for (uint32_t id : candidates) consider(id);
+    } else if (!underMatch.empty()) {
+        for (uint32_t id = 0; id < s.size(); ++id) {
+            if (s.parent[id] != kNoEntry && underMatch[s.parent[id]]) consider(id);
+        }
+    } else if (!impossible) {
+        for (uint32_t id = 0; id < s.size(); ++id) consider(id);
+    }
+
+    result["ready"] = true;
+    result["results"] = results;
+    result["total"] = total;
+    result["truncated"] = total > results.size();
+    result["indexed"] = indexed || !underMatch.empty();
+    result["took_ms"] = timer.elapsed();
+    result["index_age_ms"] = QDateTime::currentMSecsSinceEpoch() - s.builtAtMs;
+    return result;
+}
+
+QJsonObject FileIndex::stats() const {
+    QJsonObject stats;
+    stats["enabled"] = isEnabled();
+    stats["roots"] = QJsonArray::fromStringList(roots);
+    stats["building"] = building.load();
+
+    const std::shared_ptr<const FileIndexSnapshot> snap = current();
+    stats["ready"] = bool(snap);
+    if (snap) {
+        stats["entries"] = qint64(snap->size());
+        stats["directories"] = qint64(snap->dirs.size());
+        stats["trigrams"] = qint64(snap->trigramKeys.size());
+        stats["memory_bytes"] = qint64(snap->memoryBytes());
+        stats["names_bytes"] = qint64(snap->names.size());
+        stats["postings_bytes"] = qint64(snap->postings.size());
+        stats["built_at"] = QDateTime::fromMSecsSinceEpoch(snap->builtAtMs).toString(Qt::ISODate);
+        stats["age_ms"] = QDateTime::currentMSecsSinceEpoch() - snap->builtAtMs;
+        stats["last_build_ms"] = qint64(snap->buildMs);
+        stats["scanned_dirs"] = qint64(snap->scannedDirs);
+        stats["reused_dirs"] = qint64(snap->reusedDirs);
+    }
+    return stats;
+}
@@ -0,0 +1,53 @@
+#ifndef FILEINDEX_H
+#define FILEINDEX_H
+
+#include <QObject>
+#include <QJsonObject>
+#include <QStringList>
+#include <QTimer>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+struct FileIndexSnapshot;
+
+// Фоновый индекс имён файлов под заданными корнями для searchFiles.
+// Записи хранятся компактно (имя в общем буфере + индекс родителя), поиск
+// идёт по триграммам имён с последующей проверкой кандидатов. Индекс
+// перестраивается периодически: каталоги с неизменившимися inode и mtime
+// не перечитываются, их содержимое берётся из предыдущего снимка.
+class FileIndex : public QObject
+{
+    Q_OBJECT
+public:
+    explicit FileIndex(QObject *parent = nullptr);
+    ~FileIndex();
+
+    void start(const QStringList &roots, int rescanIntervalSec = 300);
+    bool isEnabled() const { return !roots.isEmpty(); }
+
+    // pattern — подстрока или glob (*, ?, [..]); со «/» сравнивается с полным путём,
+    // иначе с именем. Регистр не учитывается. Шаблон, оканчивающийся на «/»,
+    // отклоняется: совпадение обязано заканчиваться в имени записи.
+    QJsonObject search(const QString &pattern, int limit, QString *error = nullptr) const;
+    // Размер индекса в памяти и его свежесть
+    QJsonObject stats() const;
+
+private slots:
+    void rescan();
+
+private:
+    std::shared_ptr<const FileIndexSnapshot> current() const;
+
+    QStringList roots;
+    QTimer rescanTimer;
+    std::thread builder;
+    std::atomic<bool> building{false};
+    std::atomic<bool> cancelled{false};
+
+    mutable std::mutex snapshotMutex;
+    std::shared_ptr<const FileIndexSnapshot> snapshot;
+};
+
+#endif // FILEINDEX_H
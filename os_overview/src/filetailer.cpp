@@ -0,0 +1,306 @@
+#include "filetailer.h"
+#include <QSocketNotifier>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QIODevice>
+#include <QDebug>
+
+#include <fcntl.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+
+static const int kCoalesceMs = 200;
+static const int kBackwardBlockSize = 64 * 1024;
+static const qint64 kMaxTailBytes = 4 * 1024 * 1024;      // предел начального хвоста
+static const int kMaxTailLines = 100000;
+static const int kMaxPushBytes = 1024 * 1024;             // за одно уведомление
+static const qint64 kMaxSocketQueue = 4 * 1024 * 1024;
+static const int kMaxTailsPerClient = 16;
+
+static const uint32_t kFileMask = IN_MODIFY | IN_ATTRIB | IN_CLOSE_WRITE | IN_MOVE_SELF | IN_DELETE_SELF;
+static const uint32_t kDirMask = IN_CREATE | IN_MOVED_TO | IN_ONLYDIR;
+
+namespace {
+
+// Читает до maxBytes с offset; короче — значит, достигнут конец файла
+QByteArray readAt(int fd, qint64 offset, qint64 maxBytes) {
+    QByteArray data;
+    if (fd < 0 || maxBytes <= 0) return data;
+    data.resize(int(maxBytes));
+    qint64 got = 0;
+    while (got < maxBytes) {
+        const ssize_t n = ::pread(fd, data.data() + got, size_t(maxBytes - got), offset + got);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        got += n;
+    }
+    data.resize(int(got));
+    return data;
+}
+
+// Начало последних lines строк: блоки читаются с конца, пока не встретится
+// нужное число переводов строки. Завершающий '\n' файла строку не начинает.
+qint64 findLinesStart(int fd, qint64 size, int lines) {
+    if (lines <= 0) return size;
+    const qint64 limit = qMax<qint64>(0, size - kMaxTailBytes);
+    int found = 0;
+    qint64 end = size;
+    while (end > limit) {
+        const qint64 start = qMax(limit, end - kBackwardBlockSize);
+        const QByteArray chunk = readAt(fd, start, end - start);
+        if (chunk.size() != end - start) return limit;
+        for (int i = chunk.size() - 1; i >= 0; --i) {
+            if (chunk[i] != '\n' || start + i == size - 1) continue;
+            if (++found == lines) return start + i + 1;
+        }
+        end = start;
+    }
+    return limit;
+}
+
+} // namespace
+
+FileTailer::FileTailer(QObject *parent) : QObject(parent) {
+    fd = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd < 0) {
+        qWarning() << "File tailer: inotify_init1 failed:" << strerror(errno);
+        return;
+    }
+    notifier = new QSocketNotifier(fd, QSocketNotifier::Read, this);
+    connect(notifier, &QSocketNotifier::activated, this, &FileTailer::readEvents);
+
+    flushTimer.setSingleShot(true);
+    connect(&flushTimer, &QTimer::timeout, this, &FileTailer::flush);
+}
+
+FileTailer::~FileTailer() {
+    for (Tail &tail : tails) closeFile(tail);
+    delete notifier;
+    if (fd >= 0) ::close(fd);
+}
+
+bool FileTailer::openFile(Tail &tail) {
+    const QByteArray encoded = QFile::encodeName(tail.path);
+    // O_NONBLOCK: открытие FIFO по ошибочному пути не должно повесить сервер
+    tail.fd = ::open(encoded.constData(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+    if (tail.fd < 0) return false;
+    struct stat st;
+    if (::fstat(tail.fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        closeFile(tail);
+        errno = EINVAL;
+        return false;
+    }
+    tail.device = st.st_dev;
+    tail.inode = st.st_ino;
+    return true;
+}
+
+void FileTailer::closeFile(Tail &tail) {
+    if (tail.fd >= 0) ::close(tail.fd);
+    tail.fd = -1;
+}
+
+int FileTailer::addWatch(const QByteArray &path, uint32_t mask, quint64 id) {
+    const int wd = ::inotify_add_watch(fd, path.constData(), mask);
+    if (wd >= 0) watchers[wd].insert(id);
+    return wd;
+}
+
+void FileTailer::releaseWatch(int wd, quint64 id) {
+    if (wd < 0) return;
+    auto it = watchers.find(wd);
+    if (it == watchers.end()) return;
+    it->remove(id);
+    if (it->isEmpty()) {
+        ::inotify_rm_watch(fd, wd);
+        watchers.erase(it);
+    }
+}
+
+QJsonObject FileTailer::tail(QObject *owner, const QString &path, int lines, bool follow, QString *error) {
+    Tail tail;
+    tail.path = QDir::cleanPath(path);
+    tail.fileName = QFile::encodeName(QFileInfo(tail.path).fileName());
+    if (!openFile(tail)) {
+        if (error) *error = errno == EINVAL ? QString("Not a regular file") : QString::fromLocal8Bit(strerror(errno));
+        return QJsonObject();
+    }
+
+    struct stat st;
+    ::fstat(tail.fd, &st);
+    const qint64 size = qint64(st.st_size);
+    const qint64 begin = findLinesStart(tail.fd, size, qMin(lines, kMaxTailLines));
+    const QByteArray data = readAt(tail.fd, begin, size - begin);
+    tail.offset = begin + data.size();
+
+    QJsonObject result;
+    result["path"] = tail.path;
+    result["offset"] = begin;
+    result["size"] = size;
+    result["data"] = QString::fromLatin1(data.toBase64());
+    if (!follow) {
+        closeFile(tail);
+        return result;
+    }
+
+    int active = 0;
+    for (const Tail &t : tails) {
+        if (t.owner == owner) ++active;
+    }
+    if (fd < 0 || active >= kMaxTailsPerClient) {
+        if (error) *error = fd < 0 ? "inotify is unavailable" : "Too many tail subscriptions";
+        closeFile(tail);
+        return QJsonObject();
+    }
+
+    tail.id = nextId++;
+    tail.owner = owner;
+    tail.fileWd = addWatch(QFile::encodeName(tail.path), kFileMask, tail.id);
+    // Каталог — чтобы заметить новый файл с тем же именем после ротации
+    tail.dirWd = addWatch(QFile::encodeName(QFileInfo(tail.path).absolutePath()), kDirMask, tail.id);
+    if (tail.fileWd < 0 || tail.dirWd < 0) {
+        if (error) *error = QString::fromLocal8Bit(strerror(errno));
+        releaseWatch(tail.fileWd, tail.id);
+        releaseWatch(tail.dirWd, tail.id);
+        closeFile(tail);
+        return QJsonObject();
+    }
+    tails.insert(tail.id, tail);
+    result["subscription"] = QString::number(tail.id);
+    return result;
+}
+
+bool FileTailer::stop(QObject *owner, quint64 id) {
+    auto it = tails.constFind(id);
+    if (it == tails.constEnd() || it->owner != owner) return false;
+    remove(id);
+    return true;
+}
+
+void FileTailer::stopAll(QObject *owner) {
+    QList<quint64> owned;
+    for (const Tail &tail : tails) {
+        if (tail.owner == owner) owned.append(tail.id);
+    }
+    for (quint64 id : owned) remove(id);
+}
+
+void FileTailer::remove(quint64 id) {
+    auto it = tails.find(id);
+    if (it == tails.end()) return;
+    closeFile(*it);
+    releaseWatch(it->fileWd, id);
+    releaseWatch(it->dirWd, id);
+    tails.erase(it);
+}
+
+void FileTailer::markDirty(quint64 id) {
+    auto it = tails.find(id);
+    if (it == tails.end()) return;
+    it->dirty = true;
+    if (!flushTimer.isActive()) flushTimer.start(kCoalesceMs);
+}
+
+void FileTailer::readEvents() {
+    alignas(inotify_event) char buffer[16 * 1024];
+    for (;;) {
+        const ssize_t length = ::read(fd, buffer, sizeof(buffer));
+        if (length < 0) {
+            if (errno == EINTR) continue;
+            break; // EAGAIN: очередь пуста
+        }
+        for (char *p = buffer; p < buffer + length;) {
+            const auto *event = reinterpret_cast<const inotify_event *>(p);
+            p += sizeof(inotify_event) + event->len;
+
+            if (event->mask & IN_Q_OVERFLOW) {
+                for (const Tail &tail : tails) markDirty(tail.id);
+                continue;
+            }
+            const QSet<quint64> ids = watchers.value(event->wd);
+            for (quint64 id : ids) {
+                auto it = tails.find(id);
+                if (it == tails.end()) continue;
+                // В каталоге интересно только появление файла с нашим именем
+                if (event->wd == it->dirWd && (event->len == 0 || QByteArray(event->name) != it->fileName)) continue;
+                markDirty(id);
+            }
+            if (event->mask & IN_IGNORED) {
+                // Ядро само сняло watch (файл удалён): при ротации он появится заново
+                for (quint64 id : ids) {
+                    auto it = tails.find(id);
+                    if (it == tails.end()) continue;
+                    if (it->fileWd == event->wd) it->fileWd = -1;
+                    if (it->dirWd == event->wd) it->dirWd = -1;
+                }
+                watchers.remove(event->wd);
+            }
+        }
+    }
+}
+
+void FileTailer::flush() {
+    bool pending = false;
+    // Обработчик уведомления пишет в сокет и может закрыть подписку — ключи копируются
+    const QList<quint64> ids = tails.keys();
+    for (quint64 id : ids) {
+        auto it = tails.find(id);
+        if (it == tails.end() || !it->dirty) continue;
+        Tail &tail = *it;
+        auto *device = qobject_cast<QIODevice *>(tail.owner);
+        if (device && device->bytesToWrite() >= kMaxSocketQueue) {
+            pending = true;
+            continue;
+        }
+        tail.dirty = false;
+
+        QJsonObject params;
+        struct stat st;
+        if (tail.fd >= 0 && ::fstat(tail.fd, &st) == 0 && qint64(st.st_size) < tail.offset) {
+            tail.offset = 0;
+            params["truncated"] = true;
+        }
+        const QByteArray data = readAt(tail.fd, tail.offset, kMaxPushBytes);
+
+        // Короткое чтение — старый файл дочитан. Проверяем, не лежит ли по пути
+        // уже новый: событие каталога о нём могло прийти вместе с дописыванием
+        // старого, и следующего может не быть
+        const QByteArray encoded = QFile::encodeName(tail.path);
+        const bool rotated = data.size() < kMaxPushBytes && ::stat(encoded.constData(), &st) == 0
+                && (st.st_ino != tail.inode || st.st_dev != tail.device || tail.fd < 0);
+        if (!data.isEmpty() || !params.isEmpty()) {
+            if (push(tail, params, data)) pending = true;
+            // Обработчик мог закрыть подписку
+            it = tails.find(id);
+            if (it == tails.end()) continue;
+        }
+        if (!rotated) continue;
+
+        Tail &current = *it;
+        closeFile(current);
+        releaseWatch(current.fileWd, id);
+        current.fileWd = -1;
+        if (!openFile(current)) continue;
+        current.fileWd = addWatch(encoded, kFileMask, id);
+        current.offset = 0;
+        if (push(current, QJsonObject{{"rotated", true}}, readAt(current.fd, 0, kMaxPushBytes))) pending = true;
+    }
+    if (pending) flushTimer.start(kCoalesceMs);
+}
+
+bool FileTailer::push(Tail &tail, QJsonObject params, const QByteArray &data) {
+    params["subscription"] = QString::number(tail.id);
+    params["path"] = tail.path;
+    params["offset"] = tail.offset;
+    params["data"] = QString::fromLatin1(data.toBase64());
+    tail.offset += data.size();
+    // Дописано больше порции — остаток уйдёт следующими
+    const bool more = data.size() == kMaxPushBytes;
+    if (more) tail.dirty = true;
+    emit appended(tail.owner, params);
+    return more;
+}
@@ -0,0 +1,74 @@
+#ifndef FILETAILER_H
+#define FILETAILER_H
+
+#include <QObject>
+#include <QJsonObject>
+#include <QHash>
+#include <QSet>
+#include <QTimer>
+#include <sys/types.h>
+
+class QSocketNotifier;
+
+// Хвост файла, как tail -F. Последние строки ищутся чтением блоков с конца,
+// так что размер файла не важен. Подписка следит через inotify за самим
+// файлом (дописывание, усечение) и за его каталогом: при ротации сначала
+// дочитывается старый файл, затем открывается новый с тем же именем.
+// События копятся и разбираются раз в несколько сотен миллисекунд, порция
+// на клиента ограничена, пока его очередь записи не разойдётся.
+class FileTailer : public QObject
+{
+    Q_OBJECT
+public:
+    explicit FileTailer(QObject *parent = nullptr);
+    ~FileTailer();
+
+    // Последние lines строк: {path, offset, size, data (base64)}. follow=true —
+    // подписка на дописанное, номер в "subscription". Пустой объект — ошибка.
+    QJsonObject tail(QObject *owner, const QString &path, int lines, bool follow, QString *error);
+    bool stop(QObject *owner, quint64 id);
+    // Снять все подписки клиента (при отключении)
+    void stopAll(QObject *owner);
+
+signals:
+    // params: {subscription, path, offset, data (base64)}; rotated — дальше идёт
+    // новый файл, truncated — файл усекли и чтение началось сначала
+    void appended(QObject *owner, const QJsonObject &params);
+
+private slots:
+    void readEvents();
+    void flush();
+
+private:
+    struct Tail {
+        quint64 id = 0;
+        QObject *owner = nullptr;
+        QString path;
+        QByteArray fileName;        // имя в каталоге — для событий ротации
+        int fd = -1;
+        dev_t device = 0;
+        ino_t inode = 0;
+        qint64 offset = 0;          // до куда файл уже отдан
+        int fileWd = -1;
+        int dirWd = -1;
+        bool dirty = false;
+    };
+
+    bool openFile(Tail &tail);
+    void closeFile(Tail &tail);
+    int addWatch(const QByteArray &path, uint32_t mask, quint64 id);
+    void releaseWatch(int wd, quint64 id);
+    void markDirty(quint64 id);
+    // Отдать порцию подписчику; true — в файле осталось ещё
+    bool push(Tail &tail, QJsonObject params, const QByteArray &data);
+    void remove(quint64 id);
+
+    int fd = -1;
+    QSocketNotifier *notifier = nullptr;
+    QHash<quint64, Tail> tails;
+    QHash<int, QSet<quint64>> watchers;    // wd → подписки (один файл могут смотреть несколько)
+    QTimer flushTimer;
+    quint64 nextId = 1;
+};
+
+#endif // FILETAILER_H
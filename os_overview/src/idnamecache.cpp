@@ -0,0 +1,94 @@
+#include "idnamecache.h"
+#include <QDateTime>
+
+#include <sys/stat.h>
+#include <pwd.h>
+#include <grp.h>
+#include <cerrno>
+#include <vector>
+
+static const qint64 kCheckIntervalMs = 1000;
+static const qint64 kMaxAgeMs = 10 * 60 * 1000;
+
+IdNameCache::FileStamp IdNameCache::stamp(const char* path) {
+    FileStamp result;
+    struct stat st;
+    if (::stat(path, &st) == 0) {
+        result.inode = st.st_ino;
+        result.mtimeNs = qint64(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+        result.size = st.st_size;
+    }
+    return result;
+}
+
+// useradd/groupadd заменяют файл переименованием, поэтому сравниваем и inode
+void IdNameCache::revalidateLocked() {
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    if (now - lastCheckMs < kCheckIntervalMs) return;
+    lastCheckMs = now;
+
+    const FileStamp passwd = stamp("/etc/passwd");
+    const FileStamp group = stamp("/etc/group");
+    if (passwd != passwdStamp || group != groupStamp || now - clearedAtMs > kMaxAgeMs) {
+        passwdStamp = passwd;
+        groupStamp = group;
+        clearedAtMs = now;
+        users.clear();
+        groups.clear();
+        ++gen;
+    }
+}
+
+quint64 IdNameCache::generation() {
+    std::lock_guard<std::mutex> lock(mutex);
+    revalidateLocked();
+    return gen;
+}
+
+QString IdNameCache::userName(uint uid) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        revalidateLocked();
+        auto it = users.constFind(uid);
+        if (it != users.constEnd()) return it.value();
+    }
+
+    // Поиск через NSS может быть медленным — выполняем его без блокировки
+    QString name = QString::number(uid);
+    std::vector<char> buffer(1024);
+    struct passwd pwd;
+    struct passwd* result = nullptr;
+    int rc;
+    while ((rc = getpwuid_r(uid, &pwd, buffer.data(), buffer.size(), &result)) == ERANGE) {
+        buffer.resize(buffer.size() * 2);
+    }
+    if (rc == 0 && result) name = QString::fromLocal8Bit(result->pw_name);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    users.insert(uid, name);
+    return name;
+}
+
+QString IdNameCache::groupName(uint gid) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        revalidateLocked();
+        auto it = groups.constFind(gid);
+        if (it != groups.constEnd()) return it.value();
+    }
+
+    QString name = QString::number(gid);
+    std::vector<char> buffer(4096);
+    struct group grp;
+    struct group* result = nullptr;
+    int rc;
+    // Группы с большим числом участников не помещаются в стандартный буфер
+    while ((rc = getgrgid_r(gid, &grp, buffer.data(), buffer.size(), &result)) == ERANGE) {
+        buffer.resize(buffer.size() * 2);
+    }
+    if (rc == 0 && result) name = QString::fromLocal8Bit(result->gr_name);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    groups.insert(gid, name);
+    return name;
+}
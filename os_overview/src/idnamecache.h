@@ -0,0 +1,43 @@
+#ifndef IDNAMECACHE_H
+#define IDNAMECACHE_H
+
+#include <QHash>
+#include <QString>
+#include <mutex>
+
+// Общий кэш uid/gid → имя для листингов файлов и процессов. getpwuid_r/getgrgid_r
+// могут уходить в NSS (LDAP, sssd), поэтому каждое имя разрешается один раз.
+// Кэш сбрасывается, когда меняются /etc/passwd или /etc/group (проверка не чаще
+// раза в секунду), и в любом случае раз в несколько минут — ради записей из NSS.
+// Потокобезопасен.
+class IdNameCache
+{
+public:
+    QString userName(uint uid);
+    QString groupName(uint gid);
+    // Увеличивается при каждом сбросе: по нему владельцы кэшированных имён
+    // понимают, что их копии устарели
+    quint64 generation();
+
+private:
+    struct FileStamp {
+        quint64 inode = 0;
+        qint64 mtimeNs = 0;
+        qint64 size = -1;
+        bool operator!=(const FileStamp &other) const {
+            return inode != other.inode || mtimeNs != other.mtimeNs || size != other.size;
+        }
+    };
+    static FileStamp stamp(const char *path);
+    void revalidateLocked();
+
+    std::mutex mutex;
+    QHash<uint, QString> users;
+    QHash<uint, QString> groups;
+    FileStamp passwdStamp, groupStamp;
+    qint64 lastCheckMs = 0;
+    qint64 clearedAtMs = 0;
+    quint64 gen = 1;
+};
+
+#endif // IDNAMECACHE_H
@@ -0,0 +1,426 @@
+#include "journalreader.h"
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QIODevice>
+#include <QSocketNotifier>
+
+#include <systemd/sd-journal.h>
+#include <systemd/sd-id128.h>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+
+static const int kCoalesceMs = 250;
+static const int kDefaultLimit = 200;
+static const int kMaxLimit = 5000;
+static const int kMaxPushEntries = 500;                   // за одно уведомление
+static const int kMaxScanPerFlush = 20000;                // записей, просмотренных подпиской за раз
+static const qint64 kReadBudgetMs = 300;                  // дольше чтение не держит поток сервера
+static const size_t kDataThreshold = 64 * 1024;           // длиннее MESSAGE обрезается
+static const qint64 kMaxSocketQueue = 4 * 1024 * 1024;
+static const int kMaxFollowersPerClient = 8;
+static const double kMaxExactUsec = 9007199254740992.0;   // 2^53: дальше double теряет целые
+
+namespace {
+
+QString errnoText(int error) {
+    return QString::fromLocal8Bit(strerror(error < 0 ? -error : error));
+}
+
+// Значение поля текущей записи без префикса "ИМЯ="
+QByteArray fieldValue(sd_journal *journal, const char *field) {
+    const void *data = nullptr;
+    size_t length = 0;
+    if (sd_journal_get_data(journal, field, &data, &length) < 0) return QByteArray();
+    const size_t prefix = strlen(field) + 1;
+    if (length < prefix) return QByteArray();
+    return QByteArray(static_cast<const char *>(data) + prefix, int(length - prefix));
+}
+
+QString currentCursor(sd_journal *journal) {
+    char *cursor = nullptr;
+    if (sd_journal_get_cursor(journal, &cursor) < 0 || !cursor) return QString();
+    const QString result = QString::fromLatin1(cursor);
+    free(cursor);
+    return result;
+}
+
+// ISO 8601 или число микросекунд с эпохи; 0 — не задано
+bool parseTime(const QJsonValue &value, quint64 &usec) {
+    usec = 0;
+    if (value.isUndefined() || value.isNull()) return true;
+    if (value.isDouble()) {
+        // Только неотрицательное целое: отрицательное или NaN при приведении
+        // к quint64 дало бы мусорную метку
+        const double number = value.toDouble();
+        if (!(number >= 0 && number <= kMaxExactUsec) || std::floor(number) != number) return false;
+        usec = quint64(number);
+        return true;
+    }
+    const QDateTime time = QDateTime::fromString(value.toString(), Qt::ISODateWithMs);
+    if (!time.isValid() || time.toMSecsSinceEpoch() < 0) return false;
+    usec = quint64(time.toMSecsSinceEpoch()) * 1000;
+    return true;
+}
+
+int addMatch(sd_journal *journal, const QByteArray &match) {
+    return sd_journal_add_match(journal, match.constData(), size_t(match.size()));
+}
+
+} // namespace
+
+JournalReader::JournalReader(QObject *parent) : QObject(parent) {
+    flushTimer.setSingleShot(true);
+    connect(&flushTimer, &QTimer::timeout, this, &JournalReader::flush);
+}
+
+JournalReader::~JournalReader() {
+    const QList<quint64> ids = followers.keys();
+    for (quint64 id : ids) remove(id);
+}
+
+bool JournalReader::parseFilter(const QJsonObject &query, Filter &filter, QString *error) {
+    QJsonArray units = query["units"].toArray();
+    if (query.contains("unit")) units.append(query["unit"]);
+    for (const QJsonValue &value : units) {
+        const QString unit = value.toString();
+        if (unit.isEmpty()) continue;
+        // Как journalctl -u: имя без суффикса — служба
+        filter.units << (unit.contains('.') ? unit : unit + ".service");
+    }
+
+    if (query.contains("priority")) {
+        filter.priority = query["priority"].toInt(-1);
+        if (filter.priority < 0 || filter.priority > 7) {
+            if (error) *error = "priority must be 0..7";
+            return false;
+        }
+    }
+
+    const QString boot = query["boot"].toString();
+    if (boot == "current") {
+        sd_id128_t id;
+        char text[33];
+        if (sd_id128_get_boot(&id) < 0) {
+            if (error) *error = "Cannot determine current boot id";
+            return false;
+        }
+        filter.bootId = QByteArray(sd_id128_to_string(id, text));
+    } else if (!boot.isEmpty()) {
+        filter.bootId = boot.toLatin1().replace("-", "").toLower();
+        const bool hex = std::all_of(filter.bootId.cbegin(), filter.bootId.cend(), [](char c) {
+            return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'f');
+        });
+        if (filter.bootId.size() != 32 || !hex) {
+            if (error) *error = "Invalid boot id";
+            return false;
+        }
+    }
+
+    if (!parseTime(query["since"], filter.sinceUs) || !parseTime(query["until"], filter.untilUs)) {
+        if (error) *error = "since/until must be ISO 8601 or a non-negative integer of microseconds";
+        return false;
+    }
+
+    filter.text = query["match"].toString();
+    filter.useRegex = query["regex"].toBool(false) && !filter.text.isEmpty();
+    if (filter.useRegex) {
+        filter.regex = QRegularExpression(filter.text, QRegularExpression::CaseInsensitiveOption);
+        if (!filter.regex.isValid()) {
+            if (error) *error = "Invalid regular expression: " + filter.regex.errorString();
+            return false;
+        }
+        filter.regex.optimize();
+    }
+    return true;
+}
+
+// Юнит, приоритет и загрузка — матчи sd_journal, как их строит journalctl:
+// (_SYSTEMD_UNIT=… ИЛИ (UNIT=… И _PID=1)) И PRIORITY∈{0..p} И _BOOT_ID=…
+sd_journal *JournalReader::open(const Filter &filter, QString *error) {
+    sd_journal *journal = nullptr;
+    int r = sd_journal_open(&journal, SD_JOURNAL_LOCAL_ONLY);
+    if (r < 0) {
+        if (error) *error = "Cannot open journal: " + errnoText(r);
+        return nullptr;
+    }
+    sd_journal_set_data_threshold(journal, kDataThreshold);
+
+    r = 0;
+    if (!filter.units.isEmpty()) {
+        for (const QString &unit : filter.units) r = qMin(r, addMatch(journal, "_SYSTEMD_UNIT=" + unit.toUtf8()));
+        // Сообщения самого systemd о юните: «Started …», «Stopped …»
+        r = qMin(r, sd_journal_add_disjunction(journal));
+        for (const QString &unit : filter.units) r = qMin(r, addMatch(journal, "UNIT=" + unit.toUtf8()));
+        r = qMin(r, addMatch(journal, "_PID=1"));
+        r = qMin(r, sd_journal_add_conjunction(journal));
+    }
+    if (filter.priority >= 0) {
+        for (int p = 0; p <= filter.priority; ++p) r = qMin(r, addMatch(journal, "PRIORITY=" + QByteArray::number(p)));
+        r = qMin(r, sd_journal_add_conjunction(journal));
+    }
+    if (!filter.bootId.isEmpty()) r = qMin(r, addMatch(journal, "_BOOT_ID=" + filter.bootId));
+    if (r < 0) {
+        if (error) *error = "Invalid journal filter: " + errnoText(r);
+        sd_journal_close(journal);
+        return nullptr;
+    }
+    return journal;
+}
+
+// Проверка текста и сборка записи; время проверяет вызывающий — ему важно,
+// вышли ли мы за диапазон, а не только подходит ли запись
+bool JournalReader::accepts(sd_journal *journal, const Filter &filter, QJsonObject &entry) {
+    const QString message = QString::fromUtf8(fieldValue(journal, "MESSAGE"));
+    if (filter.useRegex) {
+        if (!filter.regex.match(message).hasMatch()) return false;
+    } else if (!filter.text.isEmpty() && !message.contains(filter.text, Qt::CaseInsensitive)) {
+        return false;
+    }
+
+    quint64 realtime = 0, monotonic = 0;
+    sd_id128_t boot;
+    char bootText[33];
+    sd_journal_get_realtime_usec(journal, &realtime);
+    entry = QJsonObject();
+    entry["cursor"] = currentCursor(journal);
+    entry["realtime_usec"] = qint64(realtime);
+    entry["time"] = QDateTime::fromMSecsSinceEpoch(qint64(realtime / 1000)).toString(Qt::ISODateWithMs);
+    if (sd_journal_get_monotonic_usec(journal, &monotonic, &boot) >= 0) entry["boot"] = QString::fromLatin1(sd_id128_to_string(boot, bootText));
+
+    bool ok = false;
+    const int priority = fieldValue(journal, "PRIORITY").toInt(&ok);
+    if (ok) entry["priority"] = priority;
+    QByteArray unit = fieldValue(journal, "_SYSTEMD_UNIT");
+    if (unit.isEmpty()) unit = fieldValue(journal, "UNIT");
+    if (!unit.isEmpty()) entry["unit"] = QString::fromUtf8(unit);
+    QByteArray identifier = fieldValue(journal, "SYSLOG_IDENTIFIER");
+    if (identifier.isEmpty()) identifier = fieldValue(journal, "_COMM");
+    if (!identifier.isEmpty()) entry["identifier"] = QString::fromUtf8(identifier);
+    const qint64 pid = fieldValue(journal, "_PID").toLongLong(&ok);
+    if (ok) entry["pid"] = pid;
+    entry["message"] = message;
+    return true;
+}
+
+QJsonObject JournalReader::read(const QJsonObject &query, QString *error) {
+    Filter filter;
+    if (!parseFilter(query, filter, error)) return QJsonObject();
+    sd_journal *journal = open(filter, error);
+    if (!journal) return QJsonObject();
+
+    const bool forward = query["direction"].toString() == "forward";
+    const int limit = qBound(1, query["limit"].toInt(kDefaultLimit), kMaxLimit);
+    const QByteArray cursor = query["cursor"].toString().toLatin1();
+    int r;
+    if (!cursor.isEmpty()) r = sd_journal_seek_cursor(journal, cursor.constData());
+    else if (forward) r = filter.sinceUs ? sd_journal_seek_realtime_usec(journal, filter.sinceUs) : sd_journal_seek_head(journal);
+    else r = filter.untilUs ? sd_journal_seek_realtime_usec(journal, filter.untilUs) : sd_journal_seek_tail(journal);
+    if (r < 0) {
+        if (error) *error = "Cannot seek journal: " + errnoText(r);
+        sd_journal_close(journal);
+        return QJsonObject();
+    }
+
+    QJsonArray entries;
+    QString position;
+    bool done = false;
+    bool first = true;
+    qint64 scanned = 0;
+    QElapsedTimer timer;
+    timer.start();
+    while (entries.size() < limit) {
+        r = forward ? sd_journal_next(journal) : sd_journal_previous(journal);
+        if (r <= 0) {
+            done = true;
+            break;
+        }
+        // Запись под самим курсором уже была на прошлой странице
+        const bool atCursor = first && !cursor.isEmpty() && sd_journal_test_cursor(journal, cursor.constData()) > 0;
+        first = false;
+        if (atCursor) continue;
+
+        quint64 realtime = 0;
+        sd_journal_get_realtime_usec(journal, &realtime);
+        // Журнал упорядочен по времени лишь приблизительно, но выход за
+        // границу в направлении чтения означает конец диапазона
+        if (forward && filter.untilUs && realtime > filter.untilUs) {
+            done = true;
+            break;
+        }
+        if (!forward && filter.sinceUs && realtime < filter.sinceUs) {
+            done = true;
+            break;
+        }
+        position = currentCursor(journal);
+        QJsonObject entry;
+        const bool inRange = (!filter.sinceUs || realtime >= filter.sinceUs) && (!filter.untilUs || realtime <= filter.untilUs);
+        if (inRange && accepts(journal, filter, entry)) entries.append(entry);
+        // Редкий текст может не найтись на всём журнале — страница
+        // возвращается по времени, а продолжение начнётся с position
+        if ((++scanned & 1023) == 0 && timer.elapsed() > kReadBudgetMs) break;
+    }
+    sd_journal_close(journal);
+
+    QJsonObject result;
+    result["entries"] = entries;
+    result["direction"] = forward ? "forward" : "backward";
+    result["cursor"] = position.isEmpty() ? QString::fromLatin1(cursor) : position;
+    result["scanned"] = scanned;
+    result["done"] = done;
+    return result;
+}
+
+QJsonObject JournalReader::follow(QObject *owner, const QJsonObject &query, QString *error) {
+    int active = 0;
+    for (const Follower &f : followers) {
+        if (f.owner == owner) ++active;
+    }
+    if (active >= kMaxFollowersPerClient) {
+        if (error) *error = "Too many journal subscriptions";
+        return QJsonObject();
+    }
+
+    Follower follower;
+    if (!parseFilter(query, follower.filter, error)) return QJsonObject();
+    follower.journal = open(follower.filter, error);
+    if (!follower.journal) return QJsonObject();
+    sd_journal *journal = follower.journal;
+
+    // Начальная порция — последние lines подходящих записей, от старых к новым
+    QJsonArray backlog;
+    QString position;
+    const QByteArray cursor = query["cursor"].toString().toLatin1();
+    if (!cursor.isEmpty()) {
+        // Продолжение после разрыва: следующая next() даст запись после курсора
+        if (sd_journal_seek_cursor(journal, cursor.constData()) >= 0 && sd_journal_next(journal) > 0
+                && sd_journal_test_cursor(journal, cursor.constData()) <= 0) {
+            sd_journal_previous(journal);
+        }
+        position = QString::fromLatin1(cursor);
+    } else {
+        const int lines = qBound(0, query["lines"].toInt(100), kMaxLimit);
+        sd_journal_seek_tail(journal);
+        QList<QJsonObject> newestFirst;
+        QElapsedTimer timer;
+        timer.start();
+        qint64 scanned = 0;
+        while (newestFirst.size() < lines && sd_journal_previous(journal) > 0) {
+            if (position.isEmpty()) position = currentCursor(journal);
+            quint64 realtime = 0;
+            sd_journal_get_realtime_usec(journal, &realtime);
+            if (follower.filter.sinceUs && realtime < follower.filter.sinceUs) break;
+            QJsonObject entry;
+            if (accepts(journal, follower.filter, entry)) newestFirst.append(entry);
+            if ((++scanned & 1023) == 0 && timer.elapsed() > kReadBudgetMs) break;
+        }
+        for (auto it = newestFirst.crbegin(); it != newestFirst.crend(); ++it) backlog.append(*it);
+        // Новые записи читаются после самой свежей из просмотренных: всё, что
+        // дописали, пока читался хвост, подберёт первый flush
+        if (!position.isEmpty()) {
+            const QByteArray newest = position.toLatin1();
+            sd_journal_seek_cursor(journal, newest.constData());
+            sd_journal_next(journal);
+        } else {
+            sd_journal_seek_tail(journal);
+            sd_journal_previous(journal);
+        }
+    }
+
+    const int fd = sd_journal_get_fd(journal);
+    if (fd < 0) {
+        if (error) *error = "Cannot watch journal: " + errnoText(fd);
+        sd_journal_close(journal);
+        return QJsonObject();
+    }
+    follower.id = nextId++;
+    follower.owner = owner;
+    follower.notifier = new QSocketNotifier(fd, QSocketNotifier::Read, this);
+    const quint64 id = follower.id;
+    connect(follower.notifier, &QSocketNotifier::activated, this, [this, id]() {
+        auto it = followers.find(id);
+        if (it == followers.end()) return;
+        // process() разбирает события inotify; новые записи или файлы — повод почитать
+        if (sd_journal_process(it->journal) != SD_JOURNAL_NOP) markDirty(id);
+    });
+    followers.insert(id, follower);
+    markDirty(id);
+
+    QJsonObject result;
+    result["subscription"] = QString::number(id);
+    result["entries"] = backlog;
+    result["cursor"] = position;
+    return result;
+}
+
+bool JournalReader::stop(QObject *owner, quint64 id) {
+    auto it = followers.constFind(id);
+    if (it == followers.constEnd() || it->owner != owner) return false;
+    remove(id);
+    return true;
+}
+
+void JournalReader::stopAll(QObject *owner) {
+    QList<quint64> owned;
+    for (const Follower &f : followers) {
+        if (f.owner == owner) owned.append(f.id);
+    }
+    for (quint64 id : owned) remove(id);
+}
+
+void JournalReader::remove(quint64 id) {
+    auto it = followers.find(id);
+    if (it == followers.end()) return;
+    delete it->notifier;
+    sd_journal_close(it->journal);
+    followers.erase(it);
+}
+
+void JournalReader::markDirty(quint64 id) {
+    auto it = followers.find(id);
+    if (it == followers.end()) return;
+    it->dirty = true;
+    if (!flushTimer.isActive()) flushTimer.start(kCoalesceMs);
+}
+
+void JournalReader::flush() {
+    bool pending = false;
+    // Обработчик уведомления пишет в сокет и может закрыть подписку — ключи копируются
+    const QList<quint64> ids = followers.keys();
+    for (quint64 id : ids) {
+        auto it = followers.find(id);
+        if (it == followers.end() || !it->dirty) continue;
+        Follower &follower = *it;
+        auto *device = qobject_cast<QIODevice *>(follower.owner);
+        if (device && device->bytesToWrite() >= kMaxSocketQueue) {
+            // Клиент не успевает: позиция в журнале стоит на месте
+            pending = true;
+            continue;
+        }
+        follower.dirty = false;
+
+        QJsonArray batch;
+        QString position;
+        int scanned = 0;
+        while (batch.size() < kMaxPushEntries && scanned < kMaxScanPerFlush) {
+            const int r = sd_journal_next(follower.journal);
+            if (r <= 0) break;
+            ++scanned;
+            position = currentCursor(follower.journal);
+            quint64 realtime = 0;
+            sd_journal_get_realtime_usec(follower.journal, &realtime);
+            if (follower.filter.untilUs && realtime > follower.filter.untilUs) continue;
+            QJsonObject entry;
+            if (accepts(follower.journal, follower.filter, entry)) batch.append(entry);
+        }
+        if (batch.size() == kMaxPushEntries || scanned == kMaxScanPerFlush) {
+            // Записей больше, чем влезает в порцию — остаток уйдёт следующими
+            follower.dirty = true;
+            pending = true;
+        }
+        if (batch.isEmpty()) continue;
+        emit entries(follower.owner, QJsonObject{{"subscription", QString::number(id)}, {"entries", batch}, {"cursor", position}});
+    }
+    if (pending) flushTimer.start(kCoalesceMs);
+}
@@ -0,0 +1,83 @@
+#ifndef JOURNALREADER_H
+#define JOURNALREADER_H
+
+#include <QObject>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QHash>
+#include <QRegularExpression>
+#include <QTimer>
+
+struct sd_journal;
+class QSocketNotifier;
+
+// Чтение журнала systemd через sd_journal. Фильтры по юниту, приоритету и
+// загрузке становятся матчами sd_journal и отбрасывают записи ещё в индексах
+// журнала; время и текст проверяются на сервере, так что клиенту уходят
+// только подходящие записи. Страницы сшиваются курсорами sd_journal.
+//
+// Подписка держит свой sd_journal и позицию в нём. Новые записи читаются
+// пачкой раз в 250 мс, не больше 500 записей за раз; пока очередь
+// записи клиента не разошлась, чтение стоит — буфером служит сам журнал,
+// а не память сервера.
+class JournalReader : public QObject
+{
+    Q_OBJECT
+public:
+    explicit JournalReader(QObject *parent = nullptr);
+    ~JournalReader();
+
+    // query: unit (или units), priority (0–7, включительно), since/until (ISO 8601
+    // не раньше 1970 или целое число микросекунд ≥ 0), boot ("current" или id), match (подстрока без учёта
+    // регистра; regex=true — регулярное выражение), cursor и direction
+    // (backward — от новых к старым, по умолчанию; forward), limit.
+    // Ответ: {entries: [{cursor, time, realtime_usec, priority, unit, identifier,
+    // pid, boot, message}], cursor — продолжение, done}. Пустой объект — ошибка.
+    QJsonObject read(const QJsonObject &query, QString *error);
+    // Те же фильтры; lines — сколько последних записей вернуть сразу, cursor —
+    // продолжить после него. Дальше приходят уведомления entries с номером
+    // подписки. Пустой объект — ошибка.
+    QJsonObject follow(QObject *owner, const QJsonObject &query, QString *error);
+    bool stop(QObject *owner, quint64 id);
+    void stopAll(QObject *owner);
+
+signals:
+    // params: {subscription, entries, cursor}
+    void entries(QObject *owner, const QJsonObject &params);
+
+private slots:
+    void flush();
+
+private:
+    struct Filter {
+        QStringList units;
+        int priority = -1;
+        QByteArray bootId;
+        quint64 sinceUs = 0;
+        quint64 untilUs = 0;
+        QString text;
+        QRegularExpression regex;
+        bool useRegex = false;
+    };
+
+    struct Follower {
+        quint64 id = 0;
+        QObject *owner = nullptr;
+        sd_journal *journal = nullptr;
+        QSocketNotifier *notifier = nullptr;
+        Filter filter;
+        bool dirty = false;
+    };
+
+    static bool parseFilter(const QJsonObject &query, Filter &filter, QString *error);
+    static sd_journal *open(const Filter &filter, QString *error);
+    static bool accepts(sd_journal *journal, const Filter &filter, QJsonObject &entry);
+    void markDirty(quint64 id);
+    void remove(quint64 id);
+
+    QHash<quint64, Follower> followers;
+    QTimer flushTimer;
+    quint64 nextId = 1;
+};
+
+#endif // JOURNALREADER_H
@@ -1,15 +1,52 @@
 #include "server.h"
 #include "networkdiscovery.h"
 #include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDebug>
+#include <sys/resource.h>
 
 int main(int argc, char *argv[]) {
     QCoreApplication a(argc, argv);
 
+    // Обходы каталогов (права, занятость диска) держат открытыми дескрипторы
+    // каталогов с необойдёнными подкаталогами: мягкого предела 1024 мало
+    struct rlimit limit;
+    if (::getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max) {
+        limit.rlim_cur = limit.rlim_max;
+        ::setrlimit(RLIMIT_NOFILE, &limit);
+    }
+
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    QCommandLineOption procEventsOption("proc-events",
+        "Track processes via netlink fork/exec/exit events; full scans run every <ms>.", "ms");
+    parser.addOption(procEventsOption);
+    QCommandLineOption indexRootOption("index-root",
+        "Build a background filename index for searchFiles under <path> (repeatable).", "path");
+    parser.addOption(indexRootOption);
+    QCommandLineOption indexIntervalOption("index-interval",
+        "Rescan indexed roots every <sec> seconds (default 300).", "sec", "300");
+    parser.addOption(indexIntervalOption);
+    parser.process(a);
+
     Server server;
     if(!server.start(12345)) {
         return 1;
     }
 
+    if (parser.isSet(procEventsOption)) {
+        int reconcileMs = parser.value(procEventsOption).toInt();
+        if (reconcileMs <= 0) reconcileMs = 2000;
+        // Без CAP_NET_ADMIN подписка не удастся — остаёмся на полных обходах
+        if (!server.enableProcessEvents(reconcileMs)) {
+            qWarning() << "Process event tracking unavailable, falling back to full scans";
+        }
+    }
+
+    if (parser.isSet(indexRootOption)) {
+        server.enableFileIndex(parser.values(indexRootOption), parser.value(indexIntervalOption).toInt());
+    }
+
     // Запуск обнаружения на UDP порту 45454
     server.startDiscovery(45454, 12345);
 
@@ -0,0 +1,661 @@
+#include "permissionengine.h"
+#include "idnamecache.h"
+#include "procfs.h"
+#include "workqueue.h"
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QRegularExpression>
+#include <QStringList>
+
+#include <sys/acl.h>
+#include <acl/libacl.h>
+#include <sys/stat.h>
+#include <sys/xattr.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pwd.h>
+#include <grp.h>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+static const int kProgressIntervalMs = 500;
+static const int kMaxReportedFailures = 100;
+
+namespace {
+
+// Одна запись из спецификации setfacl -m
+struct AclEntrySpec {
+    acl_tag_t tag = ACL_UNDEFINED_TAG;
+    id_t id = 0;                     // для ACL_USER / ACL_GROUP
+    unsigned perms = 0;              // ACL_READ | ACL_WRITE | ACL_EXECUTE
+    bool conditionalExecute = false; // X: x только каталогам и уже исполняемым файлам
+};
+
+struct PermissionSpec {
+    bool hasMode = false;
+    mode_t mode = 0;
+    std::vector<AclEntrySpec> access;
+    std::vector<AclEntrySpec> defaults;
+    bool explicitAccessMask = false;
+    bool explicitDefaultMask = false;
+};
+
+enum ApplyTarget {
+    TargetFiles = 1,
+    TargetDirs = 2,
+    TargetAll = TargetFiles | TargetDirs
+};
+
+bool resolveId(const QString &name, bool group, id_t &id) {
+    bool numeric = false;
+    const uint value = name.toUInt(&numeric);
+    if (numeric) {
+        id = value;
+        return true;
+    }
+    const QByteArray encoded = name.toLocal8Bit();
+    std::vector<char> buffer(16 * 1024);
+    for (;;) {
+        int rc;
+        if (group) {
+            struct group gr, *found = nullptr;
+            rc = ::getgrnam_r(encoded.constData(), &gr, buffer.data(), buffer.size(), &found);
+            if (rc == 0 && found) { id = found->gr_gid; return true; }
+        } else {
+            struct passwd pw, *found = nullptr;
+            rc = ::getpwnam_r(encoded.constData(), &pw, buffer.data(), buffer.size(), &found);
+            if (rc == 0 && found) { id = found->pw_uid; return true; }
+        }
+        if (rc != ERANGE || buffer.size() >= 1024 * 1024) return false;
+        buffer.resize(buffer.size() * 2);
+    }
+}
+
+bool parsePerms(const QString &text, AclEntrySpec &entry) {
+    entry.perms = 0;
+    if (text.size() == 1 && text[0] >= QLatin1Char('0') && text[0] <= QLatin1Char('7')) {
+        const unsigned digit = unsigned(text[0].unicode() - '0');
+        if (digit & 4) entry.perms |= ACL_READ;
+        if (digit & 2) entry.perms |= ACL_WRITE;
+        if (digit & 1) entry.perms |= ACL_EXECUTE;
+        return true;
+    }
+    for (const QChar c : text) {
+        switch (c.unicode()) {
+        case 'r': entry.perms |= ACL_READ; break;
+        case 'w': entry.perms |= ACL_WRITE; break;
+        case 'x': entry.perms |= ACL_EXECUTE; break;
+        case 'X': entry.conditionalExecute = true; break;
+        case '-': break;
+        default:  return false;
+        }
+    }
+    return true;
+}
+
+bool parseSpec(const QString &text, PermissionSpec &spec, QString &error) {
+    const QString trimmed = text.trimmed();
+    if (trimmed.isEmpty()) {
+        error = "Empty permission spec";
+        return false;
+    }
+
+    // Восьмеричный режим: 755, 0644, 1777
+    bool octal = false;
+    const uint mode = trimmed.toUInt(&octal, 8);
+    if (octal && trimmed.size() <= 4) {
+        if (mode > 07777) {
+            error = "Mode out of range";
+            return false;
+        }
+        spec.hasMode = true;
+        spec.mode = mode_t(mode);
+        return true;
+    }
+
+    const QStringList items = trimmed.split(QRegularExpression("[,\\s]+"), Qt::SkipEmptyParts);
+    for (const QString &item : items) {
+        QStringList parts = item.split(':');
+        bool isDefault = false;
+        if (parts.size() >= 3 && (parts[0] == "d" || parts[0] == "default")) {
+            isDefault = true;
+            parts.removeFirst();
+        }
+        // Для other и mask setfacl допускает форму без квалификатора: o:r-x
+        if (parts.size() == 2) parts.insert(1, QString());
+        if (parts.size() != 3) {
+            error = QString("Malformed ACL entry: %1").arg(item);
+            return false;
+        }
+
+        AclEntrySpec entry;
+        const QString tag = parts[0];
+        const QString qualifier = parts[1];
+        if (tag == "u" || tag == "user") {
+            entry.tag = qualifier.isEmpty() ? ACL_USER_OBJ : ACL_USER;
+        } else if (tag == "g" || tag == "group") {
+            entry.tag = qualifier.isEmpty() ? ACL_GROUP_OBJ : ACL_GROUP;
+        } else if (tag == "m" || tag == "mask") {
+            entry.tag = ACL_MASK;
+        } else if (tag == "o" || tag == "other") {
+            entry.tag = ACL_OTHER;
+        } else {
+            error = QString("Unknown ACL tag: %1").arg(tag);
+            return false;
+        }
+        if ((entry.tag == ACL_MASK || entry.tag == ACL_OTHER) && !qualifier.isEmpty()) {
+            error = QString("Unexpected qualifier in: %1").arg(item);
+            return false;
+        }
+        if ((entry.tag == ACL_USER || entry.tag == ACL_GROUP)
+                && !resolveId(qualifier, entry.tag == ACL_GROUP, entry.id)) {
+            error = QString("Unknown %1: %2").arg(entry.tag == ACL_GROUP ? "group" : "user", qualifier);
+            return false;
+        }
+        if (!parsePerms(parts[2], entry)) {
+            error = QString("Bad permissions in: %1").arg(item);
+            return false;
+        }
+
+        if (isDefault) {
+            spec.defaults.push_back(entry);
+            if (entry.tag == ACL_MASK) spec.explicitDefaultMask = true;
+        } else {
+            spec.access.push_back(entry);
+            if (entry.tag == ACL_MASK) spec.explicitAccessMask = true;
+        }
+    }
+    return true;
+}
+
+bool entryQualifier(acl_entry_t entry, id_t &id) {
+    void *qualifier = ::acl_get_qualifier(entry);
+    if (!qualifier) return false;
+    id = *static_cast<id_t *>(qualifier);
+    ::acl_free(qualifier);
+    return true;
+}
+
+acl_entry_t findEntry(acl_t acl, acl_tag_t tag, id_t id) {
+    acl_entry_t entry;
+    for (int rc = ::acl_get_entry(acl, ACL_FIRST_ENTRY, &entry); rc == 1;
+         rc = ::acl_get_entry(acl, ACL_NEXT_ENTRY, &entry)) {
+        acl_tag_t entryTag;
+        if (::acl_get_tag_type(entry, &entryTag) != 0 || entryTag != tag) continue;
+        if (tag != ACL_USER && tag != ACL_GROUP) return entry;
+        id_t entryId;
+        if (entryQualifier(entry, entryId) && entryId == id) return entry;
+    }
+    return nullptr;
+}
+
+// Пустой default ACL заполняется базовыми записями из access ACL, как делает setfacl
+bool seedDefaultAcl(const char *path, acl_t &acl) {
+    acl_t access = ::acl_get_file(path, ACL_TYPE_ACCESS);
+    if (!access) return false;
+    acl_entry_t source;
+    bool ok = true;
+    for (int rc = ::acl_get_entry(access, ACL_FIRST_ENTRY, &source); rc == 1 && ok;
+         rc = ::acl_get_entry(access, ACL_NEXT_ENTRY, &source)) {
+        acl_tag_t tag;
+        if (::acl_get_tag_type(source, &tag) != 0) { ok = false; break; }
+        if (tag != ACL_USER_OBJ && tag != ACL_GROUP_OBJ && tag != ACL_OTHER) continue;
+        acl_entry_t copy;
+        ok = ::acl_create_entry(&acl, &copy) == 0 && ::acl_copy_entry(copy, source) == 0;
+    }
+    ::acl_free(access);
+    return ok;
+}
+
+// Владеющая ссылка на объект libacl
+class AclHandle {
+public:
+    explicit AclHandle(acl_t acl = nullptr) : acl(acl) { }
+    ~AclHandle() { if (acl) ::acl_free(acl); }
+    AclHandle(const AclHandle &) = delete;
+    AclHandle &operator=(const AclHandle &) = delete;
+
+    acl_t acl;
+};
+
+// Дополняет ACL записями спецификации и записывает, если он изменился.
+// Возвращает 0 или errno.
+int modifyAcl(const char *path, acl_type_t type, const std::vector<AclEntrySpec> &entries,
+              bool explicitMask, bool executable, bool &changed) {
+    AclHandle handle(::acl_get_file(path, type));
+    if (!handle.acl) return errno;
+    if (type == ACL_TYPE_DEFAULT && ::acl_entries(handle.acl) == 0 && !seedDefaultAcl(path, handle.acl)) {
+        return errno ? errno : EINVAL;
+    }
+    const AclHandle original(::acl_dup(handle.acl));
+
+    for (const AclEntrySpec &spec : entries) {
+        acl_entry_t entry = findEntry(handle.acl, spec.tag, spec.id);
+        if (!entry) {
+            if (::acl_create_entry(&handle.acl, &entry) != 0 || ::acl_set_tag_type(entry, spec.tag) != 0) return errno;
+            if ((spec.tag == ACL_USER || spec.tag == ACL_GROUP) && ::acl_set_qualifier(entry, &spec.id) != 0) return errno;
+        }
+        acl_permset_t permset;
+        if (::acl_get_permset(entry, &permset) != 0) return errno;
+        ::acl_clear_perms(permset);
+        if (spec.perms & ACL_READ)    ::acl_add_perm(permset, ACL_READ);
+        if (spec.perms & ACL_WRITE)   ::acl_add_perm(permset, ACL_WRITE);
+        if ((spec.perms & ACL_EXECUTE) || (spec.conditionalExecute && executable)) {
+            ::acl_add_perm(permset, ACL_EXECUTE);
+        }
+        if (::acl_set_permset(entry, permset) != 0) return errno;
+    }
+
+    if (!explicitMask && ::acl_calc_mask(&handle.acl) != 0) return errno;
+    if (::acl_valid(handle.acl) != 0) return EINVAL;
+
+    // Повторное применение того же ACL к дереву не должно переписывать xattr каждого файла
+    if (original.acl && ::acl_cmp(original.acl, handle.acl) == 0) return 0;
+    if (::acl_set_file(path, type, handle.acl) != 0) return errno;
+    changed = true;
+    return 0;
+}
+
+// Применяет спецификацию к файлу, открытому с O_PATH. fchmod и acl_set_fd
+// с таким дескриптором не работают, поэтому изменения идут через
+// /proc/self/fd/N: ссылка ведёт ровно на открытый inode, что бы ни лежало
+// сейчас по исходному пути. mode — текущий st_mode. Возвращает 0 или errno.
+int applySpec(const PermissionSpec &spec, int fd, unsigned mode, bool isDir, bool &changed) {
+    changed = false;
+    char path[32];
+    std::snprintf(path, sizeof(path), "/proc/self/fd/%d", fd);
+    if (spec.hasMode && (mode & 07777) != spec.mode) {
+        if (::fchmodat(AT_FDCWD, path, spec.mode, 0) != 0) return errno;
+        changed = true;
+    }
+    const bool executable = isDir || (mode & 0111);
+    if (!spec.access.empty()) {
+        const int error = modifyAcl(path, ACL_TYPE_ACCESS, spec.access, spec.explicitAccessMask,
+                                    executable, changed);
+        if (error) return error;
+    }
+    if (isDir && !spec.defaults.empty()) {
+        const int error = modifyAcl(path, ACL_TYPE_DEFAULT, spec.defaults, spec.explicitDefaultMask,
+                                    true, changed);
+        if (error) return error;
+    }
+    return 0;
+}
+
+// Расширенный ACL есть, только если есть соответствующий xattr: один
+// lgetxattr дешевле, чем acl_get_file с разбором и stat внутри
+bool hasAclXattr(const char *path, const char *attr) {
+    return ::lgetxattr(path, attr, nullptr, 0) > 0;
+}
+
+QString permsToString(acl_permset_t permset) {
+    QString result(3, '-');
+    if (::acl_get_perm(permset, ACL_READ) == 1)    result[0] = 'r';
+    if (::acl_get_perm(permset, ACL_WRITE) == 1)   result[1] = 'w';
+    if (::acl_get_perm(permset, ACL_EXECUTE) == 1) result[2] = 'x';
+    return result;
+}
+
+unsigned modeFromDirentType(unsigned char type) {
+    switch (type) {
+    case DT_DIR:  return S_IFDIR;
+    case DT_REG:  return S_IFREG;
+    case DT_LNK:  return S_IFLNK;
+    case DT_FIFO: return S_IFIFO;
+    case DT_SOCK: return S_IFSOCK;
+    case DT_CHR:  return S_IFCHR;
+    case DT_BLK:  return S_IFBLK;
+    default:      return 0;
+    }
+}
+
+// Владеющий дескриптор каталога; живёт, пока не открыты все его подкаталоги
+struct DirHandle {
+    explicit DirHandle(int fd) : fd(fd) { }
+    ~DirHandle() { ::close(fd); }
+    DirHandle(const DirHandle &) = delete;
+    DirHandle &operator=(const DirHandle &) = delete;
+    const int fd;
+};
+
+// Подкаталог открывается openat с O_NOFOLLOW относительно родителя: подмена
+// компонента пути на символьную ссылку во время обхода не уводит его наружу
+struct DirTask {
+    std::shared_ptr<const DirHandle> parent;
+    std::string name;           // имя в родителе; у корня — "."
+    std::string path;           // для отчёта об ошибках
+};
+
+qint64 nowMs() {
+    return QDateTime::currentMSecsSinceEpoch();
+}
+
+} // namespace
+
+struct PermissionEngine::Job {
+    quint64 id = 0;
+    QString root;
+    PermissionSpec spec;
+    int target = TargetAll;
+
+    std::unique_ptr<WorkStealingQueues<DirTask>> queues;
+    std::atomic<bool> cancelled{false};
+    std::atomic<bool> done{false};
+
+    std::atomic<uint64_t> files{0}, dirs{0}, changed{0}, skipped{0}, failed{0};
+    qint64 startedMs = 0;
+    std::atomic<qint64> finishedMs{0};
+
+    mutable std::mutex failuresMutex;
+    std::vector<std::pair<std::string, int>> failures;  // первые ошибки: путь, errno
+    std::map<int, uint64_t> errorCounts;
+    std::thread coordinator;
+
+    ~Job() {
+        cancelled = true;
+        if (coordinator.joinable()) coordinator.join();
+    }
+
+    void run(int threads);
+    void process(int self, const DirTask &task, procfs::DirReader &reader);
+    void applyOne(int fd, const std::string &path, unsigned mode, bool isDir);
+    void fail(const std::string &path, int error);
+};
+
+void PermissionEngine::Job::run(int threads) {
+    const std::string rootPath = QFile::encodeName(root).toStdString();
+    const int rootFd = ::open(rootPath.c_str(), O_PATH | O_CLOEXEC);
+    struct statx sx;
+    if (rootFd < 0) {
+        fail(rootPath, errno);
+    } else if (::statx(rootFd, "", AT_EMPTY_PATH, STATX_TYPE | STATX_MODE, &sx) != 0) {
+        fail(rootPath, errno);
+        ::close(rootFd);
+    } else {
+        const auto handle = std::make_shared<const DirHandle>(rootFd);
+        const bool isDir = S_ISDIR(sx.stx_mode);
+        if (target & (isDir ? TargetDirs : TargetFiles)) {
+            applyOne(rootFd, rootPath, sx.stx_mode, isDir);
+        }
+        if (isDir) {
+            queues = std::make_unique<WorkStealingQueues<DirTask>>(threads);
+            queues->push(0, DirTask{ handle, ".", rootPath });
+            std::vector<procfs::DirReader> readers(size_t(threads), procfs::DirReader(64 * 1024));
+            queues->run(cancelled, [this, &readers](int self, const DirTask &task) {
+                process(self, task, readers[size_t(self)]);
+            });
+        }
+    }
+    finishedMs = nowMs();
+    done = true;
+}
+
+void PermissionEngine::Job::process(int self, const DirTask &task, procfs::DirReader &reader) {
+    const int fd = ::openat(task.parent->fd, task.name.c_str(), O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+    if (fd < 0) {
+        fail(task.path, errno);
+        return;
+    }
+    const auto handle = std::make_shared<const DirHandle>(fd);
+
+    reader.reset(fd);
+    procfs::DirReader::Entry entry;
+    while (reader.next(entry)) {
+        if (entry.name[0] == '.' && (entry.name[1] == 0 || (entry.name[1] == '.' && entry.name[2] == 0))) continue;
+        if (cancelled.load(std::memory_order_relaxed)) break;
+
+        std::string childPath = task.path;
+        if (childPath.back() != '/') childPath += '/';
+        childPath += entry.name;
+
+        unsigned mode = modeFromDirentType(entry.type);
+        if (mode == 0) {
+            struct statx sx;
+            if (::statx(fd, entry.name, AT_SYMLINK_NOFOLLOW | AT_STATX_DONT_SYNC, STATX_TYPE, &sx) != 0) {
+                if (errno != ENOENT) fail(childPath, errno);
+                continue;
+            }
+            mode = sx.stx_mode;
+        }
+
+        // Права символьной ссылки не используются, а chmod прошёл бы к её цели
+        if (S_ISLNK(mode)) {
+            skipped.fetch_add(1, std::memory_order_relaxed);
+            continue;
+        }
+        bool isDir = S_ISDIR(mode);
+        if (target & (isDir ? TargetDirs : TargetFiles)) {
+            // d_type мог устареть: тип и режим берутся с дескриптора, через
+            // который потом идут изменения
+            const int entryFd = ::openat(fd, entry.name, O_PATH | O_NOFOLLOW | O_CLOEXEC);
+            if (entryFd < 0) {
+                if (errno != ENOENT) fail(childPath, errno);
+                continue;
+            }
+            struct statx sx;
+            if (::statx(entryFd, "", AT_EMPTY_PATH | AT_STATX_DONT_SYNC, STATX_TYPE | STATX_MODE, &sx) != 0) {
+                fail(childPath, errno);
+                ::close(entryFd);
+                continue;
+            }
+            isDir = S_ISDIR(sx.stx_mode);
+            if (!S_ISLNK(sx.stx_mode) && (target & (isDir ? TargetDirs : TargetFiles))) {
+                applyOne(entryFd, childPath, sx.stx_mode, isDir);
+            } else {
+                skipped.fetch_add(1, std::memory_order_relaxed);
+            }
+            ::close(entryFd);
+        } else {
+            skipped.fetch_add(1, std::memory_order_relaxed);
+        }
+        if (isDir) queues->push(self, DirTask{ handle, entry.name, std::move(childPath) });
+    }
+    if (reader.failed()) fail(task.path, reader.errorCode());
+}
+
+void PermissionEngine::Job::applyOne(int fd, const std::string &path, unsigned mode, bool isDir) {
+    bool wasChanged = false;
+    const int error = applySpec(spec, fd, mode, isDir, wasChanged);
+    (isDir ? dirs : files).fetch_add(1, std::memory_order_relaxed);
+    if (error) {
+        fail(path, error);
+        return;
+    }
+    if (wasChanged) changed.fetch_add(1, std::memory_order_relaxed);
+}
+
+void PermissionEngine::Job::fail(const std::string &path, int error) {
+    failed.fetch_add(1, std::memory_order_relaxed);
+    std::lock_guard<std::mutex> lock(failuresMutex);
+    ++errorCounts[error];
+    if (failures.size() < size_t(kMaxReportedFailures)) failures.emplace_back(path, error);
+}
+
+PermissionEngine::PermissionEngine(QObject *parent) : QObject(parent) {
+    connect(&progressTimer, &QTimer::timeout, this, &PermissionEngine::reportProgress);
+}
+
+PermissionEngine::~PermissionEngine() {
+    // ~Job отменяет обход и дожидается потоков
+    jobs.clear();
+}
+
+void PermissionEngine::setIdNameCache(IdNameCache *cache) {
+    idNames = cache;
+}
+
+bool PermissionEngine::apply(const QString &path, const QString &specText, QString *error) {
+    PermissionSpec spec;
+    QString parseError;
+    if (!parseSpec(specText, spec, parseError)) {
+        if (error) *error = parseError;
+        return false;
+    }
+
+    const QByteArray encoded = QFile::encodeName(path);
+    const int fd = ::open(encoded.constData(), O_PATH | O_CLOEXEC);
+    struct statx sx;
+    int rc = 0;
+    if (fd < 0 || ::statx(fd, "", AT_EMPTY_PATH, STATX_TYPE | STATX_MODE, &sx) != 0) {
+        rc = errno;
+    } else {
+        bool changed = false;
+        rc = applySpec(spec, fd, sx.stx_mode, S_ISDIR(sx.stx_mode), changed);
+    }
+    if (fd >= 0) ::close(fd);
+    if (rc != 0) {
+        if (error) *error = QString::fromLocal8Bit(strerror(rc));
+        return false;
+    }
+    return true;
+}
+
+QJsonArray PermissionEngine::aclEntries(const QString &path, bool isDir) const {
+    QJsonArray result;
+    const QByteArray encoded = QFile::encodeName(path);
+
+    for (const bool isDefault : {false, true}) {
+        if (isDefault && !isDir) break;
+        if (!hasAclXattr(encoded.constData(), isDefault ? "system.posix_acl_default"
+                                                        : "system.posix_acl_access")) continue;
+        acl_t acl = ::acl_get_file(encoded.constData(), isDefault ? ACL_TYPE_DEFAULT : ACL_TYPE_ACCESS);
+        if (!acl) continue;
+
+        // Маска ограничивает именованные записи и группу-владельца
+        QString mask;
+        acl_entry_t entry;
+        if (acl_entry_t maskEntry = findEntry(acl, ACL_MASK, 0)) {
+            acl_permset_t permset;
+            if (::acl_get_permset(maskEntry, &permset) == 0) mask = permsToString(permset);
+        }
+
+        for (int rc = ::acl_get_entry(acl, ACL_FIRST_ENTRY, &entry); rc == 1;
+             rc = ::acl_get_entry(acl, ACL_NEXT_ENTRY, &entry)) {
+            acl_tag_t tag;
+            acl_permset_t permset;
+            if (::acl_get_tag_type(entry, &tag) != 0 || ::acl_get_permset(entry, &permset) != 0) continue;
+
+            QJsonObject object;
+            const QString perms = permsToString(permset);
+            object["perms"] = perms;
+            object["default"] = isDefault;
+            id_t id = 0;
+            switch (tag) {
+            case ACL_USER_OBJ:  object["tag"] = "user_obj"; break;
+            case ACL_GROUP_OBJ: object["tag"] = "group_obj"; break;
+            case ACL_MASK:      object["tag"] = "mask"; break;
+            case ACL_OTHER:     object["tag"] = "other"; break;
+            case ACL_USER:
+            case ACL_GROUP:
+                object["tag"] = tag == ACL_USER ? "user" : "group";
+                if (entryQualifier(entry, id)) {
+                    object["id"] = qint64(id);
+                    if (idNames) object["name"] = tag == ACL_USER ? idNames->userName(id) : idNames->groupName(id);
+                }
+                break;
+            default:
+                continue;
+            }
+            if (!mask.isEmpty() && (tag == ACL_USER || tag == ACL_GROUP || tag == ACL_GROUP_OBJ)) {
+                QString effective = perms;
+                for (int i = 0; i < 3; ++i) {
+                    if (mask[i] == '-') effective[i] = '-';
+                }
+                if (effective != perms) object["effective"] = effective;
+            }
+            result.append(object);
+        }
+        ::acl_free(acl);
+    }
+    return result;
+}
+
+QJsonObject PermissionEngine::startApply(const QString &path, const QString &specText,
+                                         const QJsonObject &options, QString *error) {
+    auto job = std::make_shared<Job>();
+    QString parseError;
+    if (!parseSpec(specText, job->spec, parseError)) {
+        if (error) *error = parseError;
+        return QJsonObject();
+    }
+    const QString applyTo = options["applyTo"].toString("all");
+    if (applyTo == "files")     job->target = TargetFiles;
+    else if (applyTo == "dirs") job->target = TargetDirs;
+    else if (applyTo != "all") {
+        if (error) *error = QString("Unknown applyTo: %1").arg(applyTo);
+        return QJsonObject();
+    }
+
+    job->id = nextJobId++;
+    job->root = QDir::cleanPath(path);
+    job->startedMs = nowMs();
+
+    // Основное время уходит на ожидание записи xattr и inode, а не на CPU
+    const int threads = qBound(2, int(std::thread::hardware_concurrency()) * 2, 16);
+    Job *raw = job.get();
+    job->coordinator = std::thread([raw, threads] { raw->run(threads); });
+    jobs.insert(job->id, job);
+
+    if (!progressTimer.isActive()) progressTimer.start(kProgressIntervalMs);
+    return status(*job, false);
+}
+
+bool PermissionEngine::cancel(quint64 jobId) {
+    auto it = jobs.find(jobId);
+    if (it == jobs.end() || it.value()->done) return false;
+    it.value()->cancelled = true;
+    return true;
+}
+
+QJsonObject PermissionEngine::status(const Job &job, bool final) const {
+    QJsonObject result;
+    result["job_id"] = QString::number(job.id);
+    result["path"] = job.root;
+    result["done"] = final;
+    result["files"] = qint64(job.files.load());
+    result["dirs"] = qint64(job.dirs.load());
+    result["changed"] = qint64(job.changed.load());
+    result["skipped"] = qint64(job.skipped.load());
+    result["failed"] = qint64(job.failed.load());
+    result["elapsed_ms"] = (job.done ? job.finishedMs.load() : nowMs()) - job.startedMs;
+    if (!final) return result;
+
+    result["cancelled"] = bool(job.cancelled);
+    std::lock_guard<std::mutex> lock(job.failuresMutex);
+    QJsonArray failures;
+    for (const auto &failure : job.failures) {
+        failures.append(QJsonObject{
+            {"path", QFile::decodeName(failure.first.c_str())},
+            {"error", QString::fromLocal8Bit(strerror(failure.second))}
+        });
+    }
+    result["failures"] = failures;
+    QJsonObject byReason;
+    for (const auto &count : job.errorCounts) {
+        byReason[QString::fromLocal8Bit(strerror(count.first))] = qint64(count.second);
+    }
+    result["errors_by_reason"] = byReason;
+    return result;
+}
+
+void PermissionEngine::reportProgress() {
+    QList<quint64> finishedJobs;
+    for (const auto &job : jobs) {
+        if (job->done) {
+            emit finished(job->id, status(*job, true));
+            finishedJobs.append(job->id);
+        } else {
+            emit progress(job->id, status(*job, false));
+        }
+    }
+    // Завершённый обход больше не нужен: итог уже отправлен
+    for (quint64 id : finishedJobs) jobs.remove(id);
+    if (jobs.isEmpty()) progressTimer.stop();
+}
@@ -0,0 +1,63 @@
+#ifndef PERMISSIONENGINE_H
+#define PERMISSIONENGINE_H
+
+#include <QObject>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QHash>
+#include <QTimer>
+#include <memory>
+
+class IdNameCache;
+
+// Права доступа и POSIX ACL без запуска setfacl/chmod: libacl (acl_get_file,
+// acl_set_file) и fchmodat прямо в процессе сервера. Каждый файл открывается
+// с O_PATH | O_NOFOLLOW, тип проверяется и изменения вносятся по этому дескриптору.
+// Спецификация — восьмеричный режим ("755") или записи в формате setfacl -m:
+// "u:alice:rwx,g::r-x,m::rwx,o::---,d:u:alice:rX". Записи добавляются или
+// заменяются, остальные сохраняются; маска пересчитывается, если не задана явно.
+// Рекурсивное применение идёт параллельным обходом и сообщает прогресс.
+class PermissionEngine : public QObject
+{
+    Q_OBJECT
+public:
+    explicit PermissionEngine(QObject *parent = nullptr);
+    ~PermissionEngine();
+
+    void setIdNameCache(IdNameCache *cache);
+
+    // Применить к одному файлу; при ошибке false и текст в error
+    bool apply(const QString &path, const QString &spec, QString *error = nullptr);
+
+    // Расширенные записи ACL (access и, для каталога, default):
+    // [{tag, id, name, perms, effective, default}]. Пустой массив — у файла
+    // только биты режима, libacl при этом не вызывается.
+    QJsonArray aclEntries(const QString &path, bool isDir) const;
+
+    // Рекурсивное применение в фоне. options: applyTo (all|files|dirs).
+    // Возвращает {job_id, done=false}, дальше приходят progress/finished;
+    // пустой объект — ошибка, её текст в error.
+    QJsonObject startApply(const QString &path, const QString &spec, const QJsonObject &options,
+                           QString *error = nullptr);
+    bool cancel(quint64 jobId);
+
+signals:
+    void progress(quint64 jobId, const QJsonObject &status);
+    // status содержит failures (первые ошибки) и errors_by_reason
+    void finished(quint64 jobId, const QJsonObject &status);
+
+private slots:
+    void reportProgress();
+
+private:
+    struct Job;
+
+    QJsonObject status(const Job &job, bool final) const;
+
+    IdNameCache *idNames = nullptr;
+    QHash<quint64, std::shared_ptr<Job>> jobs;
+    QTimer progressTimer;
+    quint64 nextJobId = 1;
+};
+
+#endif // PERMISSIONENGINE_H
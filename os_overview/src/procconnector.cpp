@@ -0,0 +1,135 @@
+#include "procconnector.h"
+#include <QSocketNotifier>
+#include <QDebug>
+
+#include <sys/socket.h>
+#include <linux/netlink.h>
+#include <linux/connector.h>
+#include <linux/cn_proc.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+
+namespace {
+
+// Коды событий из uapi cn_proc.h. До ядра 6.6 перечисление вложено в
+// proc_event (proc_event::PROC_EVENT_FORK), начиная с 6.6 это отдельный
+// enum proc_cn_event, и квалифицированные имена перестают компилироваться,
+// а неквалифицированные не компилируются в C++ со старыми заголовками.
+// Значения — часть ABI и не меняются.
+constexpr uint32_t kEventFork = 0x00000001;
+constexpr uint32_t kEventExec = 0x00000002;
+constexpr uint32_t kEventExit = 0x80000000;
+
+} // namespace
+
+ProcConnector::ProcConnector(QObject* parent) : QObject(parent) { }
+
+ProcConnector::~ProcConnector() {
+    stop();
+}
+
+bool ProcConnector::start() {
+    if (fd >= 0) return true;
+
+    fd = ::socket(PF_NETLINK, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, NETLINK_CONNECTOR);
+    if (fd < 0) {
+        qWarning() << "Proc connector: socket failed:" << strerror(errno);
+        return false;
+    }
+
+    // При всплесках fork маленький буфер быстро переполняется, просим побольше
+    int bufferSize = 4 * 1024 * 1024;
+    if (::setsockopt(fd, SOL_SOCKET, SO_RCVBUFFORCE, &bufferSize, sizeof(bufferSize)) < 0) {
+        ::setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &bufferSize, sizeof(bufferSize));
+    }
+
+    sockaddr_nl addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.nl_family = AF_NETLINK;
+    addr.nl_groups = CN_IDX_PROC;
+    if (::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 || !sendControl(PROC_CN_MCAST_LISTEN)) {
+        qWarning() << "Proc connector: subscribe failed:" << strerror(errno);
+        ::close(fd);
+        fd = -1;
+        return false;
+    }
+
+    notifier = new QSocketNotifier(fd, QSocketNotifier::Read, this);
+    connect(notifier, &QSocketNotifier::activated, this, &ProcConnector::readEvents);
+    qInfo() << "Proc connector: listening for fork/exec/exit events";
+    return true;
+}
+
+void ProcConnector::stop() {
+    if (fd < 0) return;
+    delete notifier;
+    notifier = nullptr;
+    sendControl(PROC_CN_MCAST_IGNORE);
+    ::close(fd);
+    fd = -1;
+}
+
+bool ProcConnector::sendControl(int op) {
+    alignas(nlmsghdr) char buffer[NLMSG_SPACE(sizeof(cn_msg) + sizeof(proc_cn_mcast_op))];
+    std::memset(buffer, 0, sizeof(buffer));
+
+    auto* header = reinterpret_cast<nlmsghdr*>(buffer);
+    header->nlmsg_len = NLMSG_LENGTH(sizeof(cn_msg) + sizeof(proc_cn_mcast_op));
+    header->nlmsg_type = NLMSG_DONE;
+    header->nlmsg_pid = uint32_t(::getpid());
+
+    auto* message = reinterpret_cast<cn_msg*>(NLMSG_DATA(header));
+    message->id.idx = CN_IDX_PROC;
+    message->id.val = CN_VAL_PROC;
+    message->len = sizeof(proc_cn_mcast_op);
+    const auto mcastOp = static_cast<proc_cn_mcast_op>(op);
+    std::memcpy(message->data, &mcastOp, sizeof(mcastOp));
+
+    return ::send(fd, buffer, header->nlmsg_len, 0) == ssize_t(header->nlmsg_len);
+}
+
+void ProcConnector::readEvents() {
+    alignas(nlmsghdr) char buffer[16384];
+    for (;;) {
+        const ssize_t received = ::recv(fd, buffer, sizeof(buffer), 0);
+        if (received < 0) {
+            if (errno == EINTR) continue;
+            if (errno == ENOBUFS) {
+                emit overflowed();
+                continue;
+            }
+            return; // EAGAIN: очередь пуста
+        }
+        if (received == 0) return;
+
+        int length = int(received);
+        for (auto* header = reinterpret_cast<nlmsghdr*>(buffer); NLMSG_OK(header, length);
+             header = NLMSG_NEXT(header, length)) {
+            if (header->nlmsg_type == NLMSG_ERROR || header->nlmsg_type == NLMSG_NOOP) continue;
+
+            const auto* message = reinterpret_cast<const cn_msg*>(NLMSG_DATA(header));
+            if (message->id.idx != CN_IDX_PROC || message->id.val != CN_VAL_PROC) continue;
+            const auto* event = reinterpret_cast<const proc_event*>(message->data);
+
+            switch (uint32_t(event->what)) {
+            case kEventFork:
+                // Создание потока тоже приходит как fork, нас интересуют только процессы
+                if (event->event_data.fork.child_pid == event->event_data.fork.child_tgid) {
+                    emit forked(event->event_data.fork.child_tgid, event->event_data.fork.parent_tgid);
+                }
+                break;
+            case kEventExec:
+                emit executed(event->event_data.exec.process_tgid);
+                break;
+            case kEventExit:
+                if (event->event_data.exit.process_pid == event->event_data.exit.process_tgid) {
+                    emit exited(event->event_data.exit.process_tgid, int(event->event_data.exit.exit_code));
+                }
+                break;
+            default:
+                break;
+            }
+        }
+    }
+}
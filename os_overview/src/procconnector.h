@@ -0,0 +1,38 @@
+#ifndef PROCCONNECTOR_H
+#define PROCCONNECTOR_H
+
+#include <QObject>
+
+class QSocketNotifier;
+
+// Подписка на события fork/exec/exit через NETLINK_CONNECTOR (cn_proc).
+// Требует CAP_NET_ADMIN; при ошибке start() возвращает false.
+class ProcConnector : public QObject
+{
+    Q_OBJECT
+public:
+    explicit ProcConnector(QObject *parent = nullptr);
+    ~ProcConnector();
+
+    bool start();
+    void stop();
+    bool isActive() const { return fd >= 0; }
+
+signals:
+    void forked(int pid, int parentPid);
+    void executed(int pid);
+    void exited(int pid, int exitCode);
+    // Ядро отбросило часть событий (ENOBUFS) — таблицу нужно сверить полным обходом
+    void overflowed();
+
+private slots:
+    void readEvents();
+
+private:
+    bool sendControl(int op);
+
+    int fd = -1;
+    QSocketNotifier *notifier = nullptr;
+};
+
+#endif // PROCCONNECTOR_H
@@ -1,35 +1,648 @@
 #include "processmanager.h"
+#include "procfs.h"
+#include "procconnector.h"
+#include "idnamecache.h"
 #include <QJsonArray>
 #include <QJsonObject>
 #include <QProcess>
-#include <QRegularExpression>
 #include <QTextStream>
+#include <QHash>
+#include <QThread>
+#include <QDateTime>
+#include <QRegularExpression>
 
-QJsonArray ProcessManager::getProcessListAsJsonArray() const {
-    QJsonArray processesArray;
+#include <algorithm>
+#include <vector>
 
 #ifdef Q_OS_LINUX
-    QProcess process;
-    process.start("ps", QStringList() << "-eo" << "pid,comm,state,ppid,utime,stime,rss,user,args");
-    process.waitForFinished();
-    QByteArray output = process.readAllStandardOutput();
-    QStringList lines = QString(output).split('\n', Qt::SkipEmptyParts);
-    for (const QString& line : lines) {
-        QStringList parts = line.trimmed().split(QRegularExpression("\\s+"), Qt::SkipEmptyParts);
-        if (parts.size() >= 9) {
-            QJsonObject processObj;
-            processObj["pid"] = parts[0].toInt();
-            processObj["name"] = parts[1];
-            processObj["state"] = parts[2];
-            processObj["ppid"] = parts[3].toInt();
-            processObj["utime"] = parts[4].toLongLong();
-            processObj["stime"] = parts[5].toLongLong();
-            processObj["rss"] = parts[6].toLongLong() * 1024; // rss в KB, конвертируем в байты
-            processObj["user"] = parts[7];
-            processObj["cmdline"] = parts.mid(8).join(" ");
-            processesArray.append(processObj);
+#include <fcntl.h>
+#include <unistd.h>
+#include <thread>
+#include <cstdio>
+#endif
+
+// Больше этого числа процессов обход /proc делится между потоками
+static const size_t kParallelThreshold = 2000;
+// Размер журнала событий fork/exec/exit
+static const int kEventLogCapacity = 8192;
+// Сколько копятся fork/exec перед перечитыванием процессов
+static const int kPendingFlushMs = 20;
+// Пауза перед полным обходом после переполнения буфера сокета
+static const int kResyncDelayMs = 200;
+// Сколько живёт закэшированная детализация процесса
+static const qint64 kDetailTtlMs = 2000;
+
+static QString toQString(std::string_view v) {
+    return QString::fromUtf8(v.data(), int(v.size()));
+}
+
+// Результат чтения одного pid; таблица обновляется уже после чтения
+struct ProcessManager::ScannedProcess {
+    int pid = 0;
+    quint64 starttime = 0;
+    QByteArray comm;
+    char state = '?';
+    int ppid = 0;
+    quint64 utime = 0, stime = 0;
+    qint64 rss = 0;
+    bool hasIo = false;
+    quint64 readBytes = 0, writeBytes = 0;
+    bool hasStatus = false;
+    uint uid = 0;
+    bool hasCmdline = false;
+    QString cmdline;
+};
+
+ProcessManager::ProcessManager(QObject* parent) : QObject(parent) {
+    clock.start();
+#ifdef Q_OS_LINUX
+    procFd = ::open("/proc", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+#endif
+    connect(&reconcileTimer, &QTimer::timeout, this, &ProcessManager::refresh);
+    resyncTimer.setSingleShot(true);
+    connect(&resyncTimer, &QTimer::timeout, this, &ProcessManager::refresh);
+    pendingTimer.setSingleShot(true);
+    connect(&pendingTimer, &QTimer::timeout, this, &ProcessManager::flushPendingPids);
+}
+
+ProcessManager::~ProcessManager() {
+#ifdef Q_OS_LINUX
+    if (procFd >= 0) ::close(procFd);
+#endif
+}
+
+void ProcessManager::setIdNameCache(IdNameCache* cache) {
+    idNames = cache;
+}
+
+QString ProcessManager::userName(uint uid) {
+    return idNames ? idNames->userName(uid) : QString::number(uid);
+}
+
+// Всегда читаются меняющиеся stat, statm и io. status (владелец) — для новых
+// процессов, cmdline — для новых и после exec; extraMask добавляет части принудительно.
+bool ProcessManager::scanProcess(procfs::ProcessReader& reader, int pid, int extraMask, ScannedProcess& p) const {
+#ifdef Q_OS_LINUX
+    static const qint64 pageSize = sysconf(_SC_PAGESIZE);
+    procfs::ProcessSample sample;
+    // Процесс мог завершиться между перечислением и чтением
+    if (!reader.read(procFd, pid, sample, procfs::ProcessReader::Stat
+                     | procfs::ProcessReader::Statm | procfs::ProcessReader::Io)) return false;
+
+    p.pid = pid;
+    p.starttime = sample.stat.starttime;
+    p.comm = QByteArray(sample.stat.comm.data(), int(sample.stat.comm.size()));
+    p.state = sample.stat.state;
+    p.ppid = sample.stat.ppid;
+    p.utime = sample.stat.utime;
+    p.stime = sample.stat.stime;
+    p.rss = qint64(sample.residentPages) * pageSize;
+    p.hasIo = sample.hasIo;
+    p.readBytes = sample.io.readBytes;
+    p.writeBytes = sample.io.writeBytes;
+
+    // Таблицу здесь только читаем: при параллельном обходе её меняет лишь applyScan после join
+    const auto known = table.constFind(pid);
+    const bool same = known != table.constEnd() && known->starttime == p.starttime;
+    int mask = extraMask;
+    if (!same) mask |= procfs::ProcessReader::Status;
+    if (!same || known->comm != p.comm) mask |= procfs::ProcessReader::Cmdline;
+    if (mask && reader.read(procFd, pid, sample, mask)) {
+        p.hasStatus = (mask & procfs::ProcessReader::Status);
+        p.uid = sample.status.uid[1];
+        p.hasCmdline = (mask & procfs::ProcessReader::Cmdline);
+        // У потоков ядра cmdline пустой, как и ps показываем имя в скобках
+        p.cmdline = sample.cmdline.empty()
+                ? QString("[%1]").arg(QString::fromUtf8(p.comm))
+                : toQString(sample.cmdline);
+    }
+    return true;
+#else
+    Q_UNUSED(reader); Q_UNUSED(pid); Q_UNUSED(extraMask); Q_UNUSED(p);
+    return false;
+#endif
+}
+
+void ProcessManager::applyScan(const ScannedProcess& p, qint64 now) {
+#ifdef Q_OS_LINUX
+    static const double ticksPerSecond = double(sysconf(_SC_CLK_TCK));
+#else
+    static const double ticksPerSecond = 100.0;
+#endif
+    ProcessEntry& e = table[p.pid];
+    const bool same = e.generation != 0 && e.starttime == p.starttime;
+    if (!same) {
+        // Новый процесс или pid переиспользован: начинаем историю заново
+        e = ProcessEntry();
+        e.starttime = p.starttime;
+    } else {
+        const double seconds = double(now - e.sampledAtMs) / 1000.0;
+        if (seconds > 0.0) {
+            const quint64 ticks = (p.utime + p.stime) - (e.utime + e.stime);
+            e.cpuPercent = 100.0 * double(ticks) / ticksPerSecond / seconds;
+            if (p.hasIo && e.hasIo) {
+                e.readRate = double(p.readBytes - e.readBytes) / seconds;
+                e.writeRate = double(p.writeBytes - e.writeBytes) / seconds;
+            }
+        }
+        e.rssGrowth = p.rss - e.rss;
+    }
+    if (p.hasStatus) e.uid = p.uid;
+    // Имя владельца разрешается для нового процесса и после смены /etc/passwd
+    const quint64 namesGeneration = idNames ? idNames->generation() : 0;
+    if (p.hasStatus || e.userGeneration != namesGeneration) {
+        e.user = userName(e.uid);
+        e.userGeneration = namesGeneration;
+    }
+    if (p.hasCmdline) e.cmdline = p.cmdline;
+    if (e.comm != p.comm) {
+        e.comm = p.comm;
+        e.name = QString::fromUtf8(p.comm);
+    }
+    e.state = QString(QChar::fromLatin1(p.state));
+    e.ppid = p.ppid;
+    e.utime = p.utime;
+    e.stime = p.stime;
+    e.rss = p.rss;
+    e.hasIo = p.hasIo;
+    e.readBytes = p.readBytes;
+    e.writeBytes = p.writeBytes;
+    e.sampledAtMs = now;
+    e.generation = generation;
+}
+
+void ProcessManager::refresh() {
+#ifdef Q_OS_LINUX
+    if (procFd < 0) return;
+
+    std::vector<int> pids;
+    procfs::DirReader dirReader;
+    procfs::listPids(procFd, pids, dirReader);
+
+    const size_t workers = (pids.size() >= kParallelThreshold)
+            ? size_t(qBound(1, QThread::idealThreadCount(), 8)) : 1;
+    std::vector<std::vector<ScannedProcess>> parts(workers);
+    auto scan = [&](size_t index) {
+        procfs::ProcessReader reader;
+        const size_t begin = pids.size() * index / workers;
+        const size_t end = pids.size() * (index + 1) / workers;
+        parts[index].reserve(end - begin);
+        for (size_t i = begin; i < end; ++i) {
+            ScannedProcess p;
+            if (scanProcess(reader, pids[i], 0, p)) parts[index].push_back(std::move(p));
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < workers; ++i) threads.emplace_back(scan, i);
+    scan(0);
+    for (std::thread& t : threads) t.join();
+
+    ++generation;
+    const qint64 now = clock.elapsed();
+    for (const std::vector<ScannedProcess>& part : parts) {
+        for (const ScannedProcess& p : part) applyScan(p, now);
+    }
+
+    // Завершившиеся процессы
+    for (auto it = table.begin(); it != table.end();) {
+        if (it->generation != generation) it = table.erase(it);
+        else ++it;
+    }
+#endif
+}
+
+bool ProcessManager::refreshPid(int pid, int extraMask) {
+    procfs::ProcessReader reader;
+    ScannedProcess p;
+    if (!scanProcess(reader, pid, extraMask, p)) return false;
+    applyScan(p, clock.elapsed());
+    return true;
+}
+
+bool ProcessManager::enableEventTracking(int reconcileIntervalMs) {
+#ifdef Q_OS_LINUX
+    if (!connector) {
+        connector = new ProcConnector(this);
+        connect(connector, &ProcConnector::forked, this, &ProcessManager::onForked);
+        connect(connector, &ProcConnector::executed, this, &ProcessManager::onExecuted);
+        connect(connector, &ProcConnector::exited, this, &ProcessManager::onExited);
+        // Потерянные события восполняем полным обходом — отложенным, чтобы не
+        // останавливать приём событий и не обходить /proc на каждый ENOBUFS
+        connect(connector, &ProcConnector::overflowed, this, &ProcessManager::scheduleResync);
+    }
+    if (!connector->start()) return false;
+    events.reserve(kEventLogCapacity);
+    refresh();
+    reconcileTimer.start(reconcileIntervalMs);
+    return true;
+#else
+    Q_UNUSED(reconcileIntervalMs);
+    return false;
+#endif
+}
+
+void ProcessManager::scheduleResync() {
+    if (!resyncTimer.isActive()) resyncTimer.start(kResyncDelayMs);
+}
+
+void ProcessManager::onForked(int pid, int parentPid) {
+    ProcessEvent event;
+    event.type = "fork";
+    event.pid = pid;
+    event.ppid = parentPid;
+    queuePid(pid, 0, logEvent(event));
+}
+
+void ProcessManager::onExecuted(int pid) {
+    ProcessEvent event;
+    event.type = "exec";
+    event.pid = pid;
+    const quint64 seq = logEvent(event);
+    // После exec мог смениться владелец (setuid) и командная строка
+    queuePid(pid, procfs::ProcessReader::Status | procfs::ProcessReader::Cmdline, seq);
+}
+
+void ProcessManager::onExited(int pid, int exitCode) {
+    // Процесс ещё не перечитан после fork/exec: пока он зомби, /proc/pid доступен
+    if (pendingPids.contains(pid)) {
+        const PendingPid pending = pendingPids.take(pid);
+        refreshPid(pid, pending.mask);
+        auto entry = table.constFind(pid);
+        for (quint64 seq : pending.seqs) {
+            ProcessEvent *logged = loggedEvent(seq);
+            if (logged && entry != table.cend()) fillEvent(*logged, *entry);
+        }
+    }
+
+    ProcessEvent event;
+    event.type = "exit";
+    event.pid = pid;
+    event.exitCode = exitCode;
+    auto it = table.find(pid);
+    if (it != table.end()) {
+        fillEvent(event, *it);
+        table.erase(it);
+    }
+    logEvent(event);
+}
+
+void ProcessManager::queuePid(int pid, int extraMask, quint64 seq) {
+    PendingPid& pending = pendingPids[pid];
+    pending.mask |= extraMask;
+    pending.seqs.append(seq);
+    if (!pendingTimer.isActive()) pendingTimer.start(kPendingFlushMs);
+}
+
+void ProcessManager::flushPendingPids() {
+    QHash<int, PendingPid> pending;
+    pending.swap(pendingPids);
+    for (auto it = pending.cbegin(); it != pending.cend(); ++it) {
+        if (!refreshPid(it.key(), it->mask)) continue;
+        const ProcessEntry& entry = table[it.key()];
+        for (quint64 seq : it->seqs) {
+            if (ProcessEvent *logged = loggedEvent(seq)) fillEvent(*logged, entry);
         }
     }
+}
+
+void ProcessManager::fillEvent(ProcessEvent& event, const ProcessEntry& entry) const {
+    if (event.type != "fork") event.ppid = entry.ppid;
+    event.name = entry.name;
+    event.user = entry.user;
+    if (event.type != "fork") event.cmdline = entry.cmdline;
+}
+
+quint64 ProcessManager::logEvent(ProcessEvent event) {
+    event.seq = nextEventSeq++;
+    event.timestampMs = QDateTime::currentMSecsSinceEpoch();
+    if (events.size() < kEventLogCapacity) events.append(event);
+    else events[int((event.seq - 1) % kEventLogCapacity)] = event;
+    return event.seq;
+}
+
+ProcessManager::ProcessEvent *ProcessManager::loggedEvent(quint64 seq) {
+    // В буфере лежат события [nextEventSeq - events.size(), nextEventSeq)
+    if (seq == 0 || seq >= nextEventSeq || seq + quint64(events.size()) < nextEventSeq) return nullptr;
+    return &events[int((seq - 1) % kEventLogCapacity)];
+}
+
+QJsonObject ProcessManager::getProcessEvents(quint64 since, int limit) const {
+    // Самое старое событие, ещё хранящееся в кольцевом буфере
+    const quint64 oldest = (nextEventSeq > quint64(events.size())) ? nextEventSeq - quint64(events.size()) : 1;
+    // since = 0 — «с самого старого из сохранённых», а не отставание клиента
+    if (since == 0) since = oldest;
+    quint64 seq = qMax(since, oldest);
+    const quint64 end = (limit > 0) ? qMin(nextEventSeq, seq + quint64(limit)) : nextEventSeq;
+
+    QJsonArray list;
+    for (; seq < end; ++seq) {
+        const ProcessEvent& e = events[int((seq - 1) % kEventLogCapacity)];
+        QJsonObject obj;
+        obj["seq"] = qint64(e.seq);
+        obj["type"] = e.type;
+        obj["pid"] = e.pid;
+        obj["ppid"] = e.ppid;
+        obj["name"] = e.name;
+        if (!e.cmdline.isEmpty()) obj["cmdline"] = e.cmdline;
+        if (!e.user.isEmpty()) obj["user"] = e.user;
+        if (e.type == "exit") obj["exit_code"] = e.exitCode;
+        obj["timestamp"] = QDateTime::fromMSecsSinceEpoch(e.timestampMs).toString(Qt::ISODateWithMs);
+        list.append(obj);
+    }
+
+    QJsonObject result;
+    result["events"] = list;
+    result["next_seq"] = qint64(end);
+    // Клиент отстал и часть событий уже вытеснена из буфера
+    if (since < oldest) result["dropped"] = qint64(oldest - since);
+    result["tracking"] = connector && connector->isActive();
+    return result;
+}
+
+QJsonObject ProcessManager::getProcessDetail(int pid) {
+#ifdef Q_OS_LINUX
+    if (procFd < 0 || pid <= 0) return QJsonObject();
+
+    char name[16];
+    std::snprintf(name, sizeof(name), "%d", pid);
+    const int dirFd = ::openat(procFd, name, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dirFd < 0) return QJsonObject();
+
+    // starttime отличает процесс от нового владельца того же pid
+    procfs::FileBuffer buffer(1024);
+    procfs::PidStat stat;
+    if (!buffer.readAt(dirFd, "stat") || !procfs::parsePidStat(buffer.view(), stat)) {
+        ::close(dirFd);
+        return QJsonObject();
+    }
+
+    const qint64 now = clock.elapsed();
+    auto cached = detailCache.constFind(pid);
+    if (cached != detailCache.constEnd() && cached->starttime == stat.starttime
+            && now - cached->fetchedAtMs < kDetailTtlMs) {
+        ::close(dirFd);
+        return cached->detail;
+    }
+
+    // Заодно выбрасываем устаревшие записи, чтобы кэш не рос
+    for (auto it = detailCache.begin(); it != detailCache.end();) {
+        if (now - it->fetchedAtMs >= kDetailTtlMs) it = detailCache.erase(it);
+        else ++it;
+    }
+
+    QJsonObject detail = readProcessDetail(dirFd);
+    ::close(dirFd);
+    detail["pid"] = pid;
+    detail["name"] = toQString(stat.comm);
+    detail["starttime"] = qint64(stat.starttime);
+    detail["state"] = QString(QChar::fromLatin1(stat.state));
+    detail["ppid"] = stat.ppid;
+    detail["nice"] = qint64(stat.nice);
+    detail["priority"] = qint64(stat.priority);
+    detail["minor_faults"] = qint64(stat.minflt);
+    detail["major_faults"] = qint64(stat.majflt);
+    detail["vsize"] = qint64(stat.vsize);
+    detailCache.insert(pid, DetailCacheEntry{ stat.starttime, now, detail });
+    return detail;
+#else
+    Q_UNUSED(pid);
+    return QJsonObject();
+#endif
+}
+
+QJsonObject ProcessManager::readProcessDetail(int dirFd) {
+    QJsonObject detail;
+#ifdef Q_OS_LINUX
+    procfs::FileBuffer buffer;
+
+    if (buffer.readAt(dirFd, "status")) {
+        procfs::PidStatus status;
+        procfs::parsePidStatus(buffer.view(), status);
+        detail["uid"] = qint64(status.uid[0]);
+        detail["euid"] = qint64(status.uid[1]);
+        detail["gid"] = qint64(status.gid[0]);
+        detail["egid"] = qint64(status.gid[1]);
+        detail["threads"] = qint64(status.threads);
+        detail["voluntary_ctxt_switches"] = qint64(status.voluntarySwitches);
+        detail["nonvoluntary_ctxt_switches"] = qint64(status.nonvoluntarySwitches);
+    }
+
+    // PSS/USS считаются ядром обходом всех VMA, поэтому только по запросу
+    if (buffer.readAt(dirFd, "smaps_rollup")) {
+        procfs::SmapsRollup smaps;
+        if (procfs::parseSmapsRollup(buffer.view(), smaps)) {
+            QJsonObject memory;
+            memory["rss"] = qint64(smaps.rssKb) * 1024;
+            memory["pss"] = qint64(smaps.pssKb) * 1024;
+            memory["uss"] = qint64(smaps.ussKb()) * 1024;
+            memory["shared"] = qint64(smaps.sharedCleanKb + smaps.sharedDirtyKb) * 1024;
+            memory["swap"] = qint64(smaps.swapKb) * 1024;
+            memory["swap_pss"] = qint64(smaps.swapPssKb) * 1024;
+            detail["memory"] = memory;
+        }
+    }
+
+    if (buffer.readAt(dirFd, "io")) {
+        procfs::PidIo io;
+        if (procfs::parsePidIo(buffer.view(), io)) {
+            QJsonObject ioObj;
+            ioObj["rchar"] = qint64(io.rchar);
+            ioObj["wchar"] = qint64(io.wchar);
+            ioObj["read_bytes"] = qint64(io.readBytes);
+            ioObj["write_bytes"] = qint64(io.writeBytes);
+            detail["io"] = ioObj;
+        }
+    }
+
+    // Открытые дескрипторы по типам: файл, сокет, канал, anon_inode, устройство
+    const int fdDir = ::openat(dirFd, "fd", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fdDir >= 0) {
+        QHash<QString, int> types;
+        int total = 0;
+        procfs::DirReader reader;
+        reader.reset(fdDir);
+        procfs::DirReader::Entry entry;
+        char target[512];
+        while (reader.next(entry)) {
+            if (entry.name[0] == '.') continue;
+            ++total;
+            const ssize_t n = ::readlinkat(fdDir, entry.name, target, sizeof(target) - 1);
+            if (n < 0) continue;
+            const std::string_view link(target, size_t(n));
+            QString type = "file";
+            if      (link.compare(0, 7, "socket:") == 0)     type = "socket";
+            else if (link.compare(0, 5, "pipe:") == 0)       type = "pipe";
+            else if (link.compare(0, 11, "anon_inode:") == 0) type = "anon_inode";
+            else if (link.compare(0, 5, "/dev/") == 0)       type = "device";
+            types[type]++;
+        }
+        ::close(fdDir);
+        QJsonObject byType;
+        for (auto it = types.cbegin(); it != types.cend(); ++it) byType[it.key()] = it.value();
+        detail["fds"] = QJsonObject{ {"total", total}, {"by_type", byType} };
+    }
+
+    // Формат limits — колонки, выровненные пробелами; название лимита само содержит пробелы
+    if (buffer.readAt(dirFd, "limits")) {
+        static const QRegularExpression columns("\\s{2,}");
+        const QStringList lines = toQString(buffer.view()).split('\n', Qt::SkipEmptyParts);
+        QJsonObject limits;
+        for (int i = 1; i < lines.size(); ++i) {
+            const QStringList parts = lines[i].trimmed().split(columns, Qt::SkipEmptyParts);
+            if (parts.size() < 3) continue;
+            QJsonObject limit;
+            limit["soft"] = parts[1];
+            limit["hard"] = parts[2];
+            if (parts.size() > 3) limit["units"] = parts[3];
+            limits[parts[0]] = limit;
+        }
+        detail["limits"] = limits;
+    }
+
+    if (buffer.readAt(dirFd, "cgroup")) {
+        QJsonArray cgroups;
+        procfs::Scanner lines(buffer.view());
+        while (!lines.atEnd()) {
+            const std::string_view line = lines.line();
+            if (!line.empty()) cgroups.append(toQString(line));
+        }
+        detail["cgroup"] = cgroups;
+    }
+#else
+    Q_UNUSED(dirFd);
+#endif
+    return detail;
+}
+
+QJsonObject ProcessManager::entryToJson(int pid, const ProcessEntry& entry) {
+    QJsonObject processObj;
+    processObj["pid"] = pid;
+    processObj["name"] = entry.name;
+    processObj["state"] = entry.state;
+    processObj["ppid"] = entry.ppid;
+    processObj["utime"] = qint64(entry.utime);
+    processObj["stime"] = qint64(entry.stime);
+    processObj["rss"] = entry.rss;
+    processObj["user"] = entry.user;
+    processObj["uid"] = qint64(entry.uid);
+    processObj["cmdline"] = entry.cmdline;
+    processObj["starttime"] = qint64(entry.starttime);
+    processObj["cpu_percent"] = entry.cpuPercent;
+    processObj["read_bytes_per_sec"] = entry.readRate;
+    processObj["write_bytes_per_sec"] = entry.writeRate;
+    processObj["rss_growth"] = entry.rssGrowth;
+    return processObj;
+}
+
+// Поля, по которым queryProcesses умеет сортировать (все разбираются в numericField)
+static const QStringList kSortKeys{
+    "pid", "ppid", "utime", "stime", "rss", "starttime",
+    "cpu_percent", "read_bytes_per_sec", "write_bytes_per_sec", "rss_growth"};
+
+bool ProcessManager::numericField(const QString& field, int pid, const ProcessEntry& entry, double& value) {
+    if      (field == "pid")                 value = pid;
+    else if (field == "ppid")                value = entry.ppid;
+    else if (field == "utime")               value = double(entry.utime);
+    else if (field == "stime")               value = double(entry.stime);
+    else if (field == "rss")                 value = double(entry.rss);
+    else if (field == "starttime")           value = double(entry.starttime);
+    else if (field == "cpu_percent")         value = entry.cpuPercent;
+    else if (field == "read_bytes_per_sec")  value = entry.readRate;
+    else if (field == "write_bytes_per_sec") value = entry.writeRate;
+    else if (field == "rss_growth")          value = double(entry.rssGrowth);
+    else return false;
+    return true;
+}
+
+QJsonObject ProcessManager::queryProcesses(const QJsonObject& query, QString* error) {
+    const QString sortBy = query["sortBy"].toString("pid");
+    if (!kSortKeys.contains(sortBy)) {
+        if (error) *error = QString("unknown sortBy \"%1\", expected one of: %2").arg(sortBy, kSortKeys.join(", "));
+        return QJsonObject();
+    }
+
+    // В режиме событий таблица уже актуальна, полный обход делает таймер сверки
+    if (!reconcileTimer.isActive()) refresh();
+
+    const QString user = query["user"].toString();
+    const QString state = query["state"].toString();
+    const QString name = query["name"].toString();
+    const QString cmdline = query["cmdline"].toString();
+
+    struct Row { int pid; const ProcessEntry* entry; double key; };
+    std::vector<Row> rows;
+    rows.reserve(size_t(table.size()));
+    for (auto it = table.cbegin(); it != table.cend(); ++it) {
+        const ProcessEntry& e = it.value();
+        if (!user.isEmpty() && e.user != user) continue;
+        if (!state.isEmpty() && !e.state.startsWith(state)) continue;
+        if (!name.isEmpty() && !e.name.contains(name, Qt::CaseInsensitive)) continue;
+        if (!cmdline.isEmpty() && !e.cmdline.contains(cmdline, Qt::CaseInsensitive)) continue;
+        rows.push_back({ it.key(), &e, double(it.key()) });
+    }
+
+    // По умолчанию — по pid по возрастанию, для остальных колонок — по убыванию
+    const bool descending = query["order"].toString(sortBy == "pid" ? "asc" : "desc") == "desc";
+    for (Row& row : rows) {
+        numericField(sortBy, row.pid, *row.entry, row.key);
+    }
+    auto less = [descending](const Row& a, const Row& b) {
+        if (a.key != b.key) return descending ? a.key > b.key : a.key < b.key;
+        return a.pid < b.pid;
+    };
+
+    const size_t total = rows.size();
+    const size_t offset = qMin(size_t(qMax(0, query["offset"].toInt(0))), total);
+    const int limit = query["limit"].toInt(0);
+    const size_t end = (limit > 0) ? qMin(offset + size_t(limit), total) : total;
+    // Для top-N хватает частичной сортировки первых offset + limit строк
+    if (end < total) std::partial_sort(rows.begin(), rows.begin() + std::ptrdiff_t(end), rows.end(), less);
+    else             std::sort(rows.begin(), rows.end(), less);
+
+    QStringList fields;
+    for (const QJsonValue& field : query["fields"].toArray()) fields << field.toString();
+
+    // Имена владельцев повторяются из строки в строку — по запросу отдаём их словарём
+    const bool numericIds = query["numericIds"].toBool(false);
+    QJsonObject users;
+
+    QJsonArray processes;
+    for (size_t i = offset; i < end; ++i) {
+        QJsonObject processObj = entryToJson(rows[i].pid, *rows[i].entry);
+        if (numericIds) {
+            processObj.remove("user");
+            users[QString::number(rows[i].entry->uid)] = rows[i].entry->user;
+        }
+        if (!fields.isEmpty()) {
+            QJsonObject projected;
+            for (const QString& field : fields) {
+                if (processObj.contains(field)) projected[field] = processObj[field];
+            }
+            processObj = projected;
+        }
+        processes.append(processObj);
+    }
+
+    QJsonObject result;
+    result["total"] = qint64(total);
+    result["offset"] = qint64(offset);
+    if (end < total) result["next_offset"] = qint64(end);
+    result["processes"] = processes;
+    if (numericIds) result["users"] = users;
+    return result;
+}
+
+QJsonArray ProcessManager::getProcessListAsJsonArray() {
+    QJsonArray processesArray;
+
+#ifdef Q_OS_LINUX
+    if (!reconcileTimer.isActive()) refresh();
+    QList<int> pids = table.keys();
+    std::sort(pids.begin(), pids.end());
+    for (int pid : pids) {
+        processesArray.append(entryToJson(pid, table.value(pid)));
+    }
 #elif defined(Q_OS_WIN)
     QProcess process;
     process.start("tasklist", QStringList() << "/v" << "/fo" << "csv");
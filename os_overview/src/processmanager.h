@@ -1,12 +1,132 @@
 #ifndef PROCESSMANAGER_H
 #define PROCESSMANAGER_H
 
+#include <QObject>
 #include <QJsonArray>
+#include <QJsonObject>
+#include <QHash>
+#include <QVector>
+#include <QElapsedTimer>
+#include <QTimer>
 
-class ProcessManager
+namespace procfs { class ProcessReader; }
+class ProcConnector;
+class IdNameCache;
+
+class ProcessManager : public QObject
 {
+    Q_OBJECT
 public:
-    QJsonArray getProcessListAsJsonArray() const;
+    explicit ProcessManager(QObject *parent = nullptr);
+    ~ProcessManager();
+
+    void setIdNameCache(IdNameCache *cache);
+
+    QJsonArray getProcessListAsJsonArray();
+    // Выборка по таблице: фильтры user/state/name/cmdline, sortBy + order,
+    // limit/offset и проекция fields. Возвращает {total, offset, processes}.
+    // numericIds=true — вместо имени владельца uid и общий словарь users.
+    // Неизвестный sortBy — пустой объект и текст ошибки в error.
+    QJsonObject queryProcesses(const QJsonObject &query, QString *error = nullptr);
+    // Подробности по одному процессу: smaps_rollup, io, fd, limits, cgroup, потоки.
+    // Дорогие источники читаются только здесь; результат кэшируется на пару секунд.
+    // Пустой объект — процесса нет.
+    QJsonObject getProcessDetail(int pid);
+
+    // Режим событий cn_proc: таблица обновляется по fork/exec/exit, а полный
+    // обход выполняется только раз в reconcileIntervalMs для сверки и расчёта скоростей
+    bool enableEventTracking(int reconcileIntervalMs = 2000);
+    // Журнал fork/exec/exit с номера since (только в режиме событий)
+    QJsonObject getProcessEvents(quint64 since, int limit) const;
+
+private slots:
+    void onForked(int pid, int parentPid);
+    void onExecuted(int pid);
+    void onExited(int pid, int exitCode);
+    void flushPendingPids();
+    void scheduleResync();
+
+private:
+    // Состояние процесса между обходами. Ключ таблицы — pid, а starttime
+    // отличает новый процесс, получивший тот же pid.
+    struct ProcessEntry {
+        quint64 starttime = 0;
+        QByteArray comm;          // для обнаружения exec: при смене перечитываем cmdline
+        QString name;
+        uint uid = 0;
+        QString user;             // перечитывается при смене поколения IdNameCache
+        quint64 userGeneration = 0;
+        QString cmdline;          // кэшируется до следующего exec
+        QString state;
+        int ppid = 0;
+        quint64 utime = 0, stime = 0;
+        qint64 rss = 0;
+        quint64 readBytes = 0, writeBytes = 0;
+        bool hasIo = false;
+
+        double cpuPercent = 0.0;
+        double readRate = 0.0, writeRate = 0.0;  // байт/с
+        qint64 rssGrowth = 0;                   // изменение rss с прошлого обхода
+        qint64 sampledAtMs = 0;
+        quint64 generation = 0;
+    };
+    struct ScannedProcess;
+
+    struct ProcessEvent {
+        quint64 seq = 0;
+        QString type;             // fork, exec, exit
+        int pid = 0;
+        int ppid = 0;
+        int exitCode = 0;
+        QString name;
+        QString cmdline;
+        QString user;
+        qint64 timestampMs = 0;
+    };
+
+    struct DetailCacheEntry {
+        quint64 starttime = 0;
+        qint64 fetchedAtMs = 0;
+        QJsonObject detail;
+    };
+
+    void refresh();
+    bool scanProcess(procfs::ProcessReader &reader, int pid, int extraMask, ScannedProcess &out) const;
+    void applyScan(const ScannedProcess &scanned, qint64 now);
+    bool refreshPid(int pid, int extraMask);
+    // Событие ждёт перечитывания процесса: данные появятся в flushPendingPids
+    void queuePid(int pid, int extraMask, quint64 seq);
+    void fillEvent(ProcessEvent &event, const ProcessEntry &entry) const;
+    // Возвращает присвоенный событию seq
+    quint64 logEvent(ProcessEvent event);
+    // Событие из кольцевого буфера; nullptr — уже вытеснено или seq неверен
+    ProcessEvent *loggedEvent(quint64 seq);
+    QString userName(uint uid);
+
+    static QJsonObject readProcessDetail(int dirFd);
+    static QJsonObject entryToJson(int pid, const ProcessEntry &entry);
+    static bool numericField(const QString &field, int pid, const ProcessEntry &entry, double &value);
+
+    int procFd = -1;
+    QHash<int, ProcessEntry> table;
+    quint64 generation = 0;
+    QElapsedTimer clock;
+    IdNameCache *idNames = nullptr;
+    QHash<int, DetailCacheEntry> detailCache;
+
+    ProcConnector *connector = nullptr;
+    QTimer reconcileTimer;
+    QTimer resyncTimer;            // полный обход после потери событий (ENOBUFS)
+    // Процессы из fork/exec, ещё не перечитанные из /proc: всплеск событий по
+    // одному pid даёт одно чтение с объединённой маской
+    struct PendingPid {
+        int mask = 0;
+        QVector<quint64> seqs;     // события, которым нужны имя, владелец, cmdline
+    };
+    QHash<int, PendingPid> pendingPids;
+    QTimer pendingTimer;
+    QVector<ProcessEvent> events;  // кольцевой буфер
+    quint64 nextEventSeq = 1;
 };
 
 #endif // PROCESSMANAGER_H
@@ -0,0 +1,332 @@
+#include "procfs.h"
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/syscall.h>
+#include <cerrno>
+#include <cstdio>
+#include <algorithm>
+
+namespace procfs {
+
+FileBuffer::FileBuffer(size_t initialCapacity) : data(initialCapacity) { }
+
+bool FileBuffer::read(const char* path) {
+    const int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+    const bool ok = readFd(fd);
+    ::close(fd);
+    return ok;
+}
+
+bool FileBuffer::readAt(int dirfd, const char* relativePath) {
+    const int fd = ::openat(dirfd, relativePath, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+    const bool ok = readFd(fd);
+    ::close(fd);
+    return ok;
+}
+
+// Читаем с нулевого смещения до EOF; если буфер заполнился целиком, удваиваем и пробуем ещё
+bool FileBuffer::readFd(int fd) {
+    length = 0;
+    for (;;) {
+        if (length == data.size()) data.resize(data.empty() ? 4096 : data.size() * 2);
+        const ssize_t n = ::pread(fd, data.data() + length, data.size() - length, off_t(length));
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        if (n == 0) return true;
+        length += size_t(n);
+    }
+}
+
+void FileBuffer::replaceAll(char from, char to) {
+    std::replace(data.begin(), data.begin() + std::ptrdiff_t(length), from, to);
+}
+
+// Раскладка записи getdents64 (в glibc нет публичного определения)
+struct LinuxDirent64 {
+    uint64_t d_ino;
+    int64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[];
+};
+
+DirReader::DirReader(size_t bufferSize) : buffer(bufferSize) { }
+
+void DirReader::reset(int dirfd) {
+    fd = dirfd;
+    pos = length = 0;
+    error = 0;
+}
+
+bool DirReader::next(Entry& entry) {
+    if (pos >= length) {
+        long n;
+        do {
+            n = ::syscall(SYS_getdents64, fd, buffer.data(), buffer.size());
+        } while (n < 0 && errno == EINTR);
+        if (n <= 0) {
+            error = n < 0 ? errno : 0;
+            return false;
+        }
+        pos = 0;
+        length = size_t(n);
+    }
+    const auto* d = reinterpret_cast<const LinuxDirent64*>(buffer.data() + pos);
+    pos += d->d_reclen;
+    entry.inode = d->d_ino;
+    entry.offset = d->d_off;
+    entry.type = d->d_type;
+    entry.name = d->d_name;
+    return true;
+}
+
+ProcFile::ProcFile(const char* path) : fd(::open(path, O_RDONLY | O_CLOEXEC)) { }
+
+ProcFile::~ProcFile() {
+    if (fd >= 0) ::close(fd);
+}
+
+bool ProcFile::refresh() {
+    return fd >= 0 && buffer.readFd(fd);
+}
+
+static bool startsWith(std::string_view s, std::string_view prefix) {
+    return s.size() >= prefix.size() && s.compare(0, prefix.size(), prefix) == 0;
+}
+
+static void readCpuTimes(Scanner& sc, CpuTimes& t) {
+    sc.u64(t.user); sc.u64(t.nice); sc.u64(t.system); sc.u64(t.idle);
+    sc.u64(t.iowait); sc.u64(t.irq); sc.u64(t.softirq); sc.u64(t.steal);
+}
+
+bool parseStat(std::string_view text, StatSnapshot& out) {
+    out.cores.clear();
+    bool sawTotal = false;
+    Scanner lines(text);
+    while (!lines.atEnd()) {
+        Scanner sc(lines.line());
+        const std::string_view key = sc.word();
+        if (key == "cpu") {
+            readCpuTimes(sc, out.total);
+            sawTotal = true;
+        } else if (startsWith(key, "cpu")) {
+            out.cores.emplace_back();
+            readCpuTimes(sc, out.cores.back());
+        } else if (key == "ctxt") {
+            sc.u64(out.contextSwitches);
+        } else if (key == "processes") {
+            sc.u64(out.processesCreated);
+        } else if (key == "procs_running") {
+            sc.u64(out.procsRunning);
+        } else if (key == "procs_blocked") {
+            sc.u64(out.procsBlocked);
+        }
+    }
+    return sawTotal;
+}
+
+bool parseMeminfo(std::string_view text, MemInfo& out) {
+    Scanner lines(text);
+    int found = 0;
+    while (!lines.atEnd()) {
+        Scanner sc(lines.line());
+        const std::string_view key = sc.word();
+        uint64_t* target = nullptr;
+        if      (key == "MemTotal:")     target = &out.totalKb;
+        else if (key == "MemFree:")      target = &out.freeKb;
+        else if (key == "MemAvailable:") target = &out.availableKb;
+        else if (key == "Buffers:")      target = &out.buffersKb;
+        else if (key == "Cached:")       target = &out.cachedKb;
+        else if (key == "SwapTotal:")    target = &out.swapTotalKb;
+        else if (key == "SwapFree:")     target = &out.swapFreeKb;
+        if (target && sc.u64(*target)) ++found;
+    }
+    return found > 0;
+}
+
+// Формат: "pid (comm) state ppid ...". comm может содержать пробелы и скобки,
+// поэтому ищем последнюю ')'.
+bool parsePidStat(std::string_view text, PidStat& out) {
+    const size_t open = text.find('(');
+    const size_t close = text.rfind(')');
+    if (open == std::string_view::npos || close == std::string_view::npos || close < open) return false;
+
+    uint64_t pid = 0;
+    Scanner(text.substr(0, open)).u64(pid);
+    out.pid = int(pid);
+    out.comm = text.substr(open + 1, close - open - 1);
+
+    Scanner sc(text.substr(close + 1));
+    const std::string_view state = sc.word();
+    out.state = state.empty() ? '?' : state[0];
+    int64_t ppid = 0;
+    sc.i64(ppid);
+    out.ppid = int(ppid);
+    sc.skipWords(4);                 // pgrp session tty_nr tpgid
+    sc.skipWords(1);                 // flags
+    sc.u64(out.minflt);
+    sc.skipWords(1);                 // cminflt
+    sc.u64(out.majflt);
+    sc.skipWords(1);                 // cmajflt
+    sc.u64(out.utime);
+    sc.u64(out.stime);
+    sc.skipWords(2);                 // cutime cstime
+    sc.i64(out.priority);
+    sc.i64(out.nice);
+    sc.i64(out.numThreads);
+    sc.skipWords(1);                 // itrealvalue
+    sc.u64(out.starttime);
+    sc.u64(out.vsize);
+    return sc.i64(out.rssPages);
+}
+
+static void readIds(Scanner& sc, uint32_t (&ids)[4]) {
+    for (uint32_t& id : ids) {
+        uint64_t value = 0;
+        sc.u64(value);
+        id = uint32_t(value);
+    }
+}
+
+bool parsePidStatus(std::string_view text, PidStatus& out) {
+    Scanner lines(text);
+    bool sawUid = false;
+    while (!lines.atEnd()) {
+        const std::string_view line = lines.line();
+        Scanner sc(line);
+        const std::string_view key = sc.word();
+        if (key == "Name:") {
+            sc.skipSpaces();
+            out.name = sc.rest();
+        } else if (key == "Uid:") {
+            readIds(sc, out.uid);
+            sawUid = true;
+        } else if (key == "Gid:") {
+            readIds(sc, out.gid);
+        } else if (key == "VmRSS:") {
+            sc.u64(out.vmRssKb);
+        } else if (key == "VmSwap:") {
+            sc.u64(out.vmSwapKb);
+        } else if (key == "Threads:") {
+            sc.i64(out.threads);
+        } else if (key == "voluntary_ctxt_switches:") {
+            sc.u64(out.voluntarySwitches);
+        } else if (key == "nonvoluntary_ctxt_switches:") {
+            sc.u64(out.nonvoluntarySwitches);
+        }
+    }
+    return sawUid;
+}
+
+bool parsePidIo(std::string_view text, PidIo& out) {
+    Scanner lines(text);
+    int found = 0;
+    while (!lines.atEnd()) {
+        Scanner sc(lines.line());
+        const std::string_view key = sc.word();
+        uint64_t* target = nullptr;
+        if      (key == "rchar:")       target = &out.rchar;
+        else if (key == "wchar:")       target = &out.wchar;
+        else if (key == "read_bytes:")  target = &out.readBytes;
+        else if (key == "write_bytes:") target = &out.writeBytes;
+        if (target && sc.u64(*target)) ++found;
+    }
+    return found > 0;
+}
+
+bool parseSmapsRollup(std::string_view text, SmapsRollup& out) {
+    Scanner lines(text);
+    int found = 0;
+    while (!lines.atEnd()) {
+        Scanner sc(lines.line());
+        const std::string_view key = sc.word();
+        uint64_t* target = nullptr;
+        if      (key == "Rss:")           target = &out.rssKb;
+        else if (key == "Pss:")           target = &out.pssKb;
+        else if (key == "Shared_Clean:")  target = &out.sharedCleanKb;
+        else if (key == "Shared_Dirty:")  target = &out.sharedDirtyKb;
+        else if (key == "Private_Clean:") target = &out.privateCleanKb;
+        else if (key == "Private_Dirty:") target = &out.privateDirtyKb;
+        else if (key == "Swap:")          target = &out.swapKb;
+        else if (key == "SwapPss:")       target = &out.swapPssKb;
+        if (target && sc.u64(*target)) ++found;
+    }
+    return found > 0;
+}
+
+bool parseDiskstats(std::string_view text, std::vector<DiskStat>& out) {
+    out.clear();
+    Scanner lines(text);
+    while (!lines.atEnd()) {
+        Scanner sc(lines.line());
+        uint64_t major = 0, minor = 0;
+        if (!sc.u64(major) || !sc.u64(minor)) continue;
+        DiskStat d;
+        d.major = uint32_t(major);
+        d.minor = uint32_t(minor);
+        d.name = sc.word();
+        sc.u64(d.readsCompleted); sc.u64(d.readsMerged); sc.u64(d.sectorsRead); sc.u64(d.readTimeMs);
+        sc.u64(d.writesCompleted); sc.u64(d.writesMerged); sc.u64(d.sectorsWritten); sc.u64(d.writeTimeMs);
+        sc.u64(d.ioInProgress); sc.u64(d.ioTimeMs); sc.u64(d.weightedIoTimeMs);
+        out.push_back(d);
+    }
+    return !out.empty();
+}
+
+bool listPids(int procFd, std::vector<int>& out, DirReader& reader) {
+    out.clear();
+    if (::lseek(procFd, 0, SEEK_SET) < 0) return false;
+    reader.reset(procFd);
+    DirReader::Entry entry;
+    while (reader.next(entry)) {
+        if (entry.type != DT_DIR && entry.type != DT_UNKNOWN) continue;
+        uint64_t pid = 0;
+        const std::string_view name(entry.name);
+        Scanner sc(name);
+        if (!sc.u64(pid) || !sc.atEnd()) continue;
+        out.push_back(int(pid));
+    }
+    return !reader.failed();
+}
+
+bool ProcessReader::read(int procFd, int pid, ProcessSample& out, int mask) {
+    char name[16];
+    std::snprintf(name, sizeof(name), "%d", pid);
+    const int pidFd = ::openat(procFd, name, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (pidFd < 0) return false; // процесс уже завершился
+
+    bool ok = true;
+    if (mask & Stat) {
+        ok = statBuffer.readAt(pidFd, "stat") && parsePidStat(statBuffer.view(), out.stat);
+    }
+    if (ok && (mask & Statm) && statmBuffer.readAt(pidFd, "statm")) {
+        Scanner sc(statmBuffer.view());
+        sc.skipWords(1); // size
+        sc.u64(out.residentPages);
+        sc.u64(out.sharedPages);
+    }
+    if (ok && (mask & Status)) {
+        ok = statusBuffer.readAt(pidFd, "status") && parsePidStatus(statusBuffer.view(), out.status);
+    }
+    if (ok && (mask & Cmdline)) {
+        out.cmdline = std::string_view();
+        if (cmdlineBuffer.readAt(pidFd, "cmdline")) {
+            cmdlineBuffer.replaceAll('\0', ' ');
+            std::string_view view = cmdlineBuffer.view();
+            while (!view.empty() && view.back() == ' ') view.remove_suffix(1);
+            out.cmdline = view;
+        }
+    }
+    if (ok && (mask & Io)) {
+        out.hasIo = ioBuffer.readAt(pidFd, "io") && parsePidIo(ioBuffer.view(), out.io);
+    }
+    ::close(pidFd);
+    return ok;
+}
+
+} // namespace procfs
@@ -0,0 +1,262 @@
+#ifndef PROCFS_H
+#define PROCFS_H
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+// Разбор файлов procfs без выделения памяти в установившемся режиме:
+// буферы переиспользуются между чтениями, строки отдаются как string_view
+// поверх буфера и действительны до следующего чтения.
+namespace procfs {
+
+// Буфер для чтения целого файла. Растёт только если файл не влез,
+// после прогрева повторные чтения не аллоцируют.
+class FileBuffer {
+public:
+    explicit FileBuffer(size_t initialCapacity = 16 * 1024);
+
+    bool read(const char *path);
+    bool readAt(int dirfd, const char *relativePath);
+    bool readFd(int fd);
+
+    std::string_view view() const { return std::string_view(data.data(), length); }
+    // Замена символа на месте (например, NUL-разделителей в cmdline)
+    void replaceAll(char from, char to);
+
+private:
+    std::vector<char> data;
+    size_t length = 0;
+};
+
+// Обход каталога через getdents64 с переиспользуемым буфером.
+// Имена указывают внутрь буфера и действительны до следующего вызова next().
+class DirReader {
+public:
+    struct Entry {
+        uint64_t inode = 0;
+        int64_t offset = 0;       // cookie для lseek, чтобы продолжить чтение после этой записи
+        unsigned char type = 0;   // DT_DIR, DT_REG, ... или DT_UNKNOWN
+        const char *name = nullptr;
+    };
+
+    explicit DirReader(size_t bufferSize = 32 * 1024);
+
+    // Начать чтение нового каталога (дескриптор не закрывается)
+    void reset(int dirfd);
+    // false — каталог закончился или произошла ошибка (см. failed())
+    bool next(Entry &entry);
+    bool failed() const { return error != 0; }
+    // errno последнего неудачного getdents64
+    int errorCode() const { return error; }
+
+private:
+    std::vector<char> buffer;
+    int fd = -1;
+    size_t pos = 0, length = 0;
+    int error = 0;
+};
+
+// Постоянно открытый файл, который перечитывается через pread с нулевого смещения
+// (seq_file в procfs это поддерживает): экономит open/close на каждом опросе.
+class ProcFile {
+public:
+    explicit ProcFile(const char *path);
+    ~ProcFile();
+    ProcFile(const ProcFile &) = delete;
+    ProcFile &operator=(const ProcFile &) = delete;
+
+    bool refresh();
+    std::string_view view() const { return buffer.view(); }
+
+private:
+    int fd;
+    FileBuffer buffer;
+};
+
+// Последовательный разбор текста: пробелы, слова, целые числа
+class Scanner {
+public:
+    explicit Scanner(std::string_view text) : s(text) { }
+
+    bool atEnd() const { return pos >= s.size(); }
+    std::string_view rest() const { return s.substr(pos); }
+
+    void skipSpaces() {
+        while (pos < s.size() && (s[pos] == ' ' || s[pos] == '\t')) ++pos;
+    }
+    // Возвращает строку без '\n' и переходит на следующую
+    std::string_view line() {
+        const size_t end = s.find('\n', pos);
+        const size_t stop = (end == std::string_view::npos) ? s.size() : end;
+        std::string_view result = s.substr(pos, stop - pos);
+        pos = (end == std::string_view::npos) ? s.size() : end + 1;
+        return result;
+    }
+    std::string_view word() {
+        skipSpaces();
+        const size_t start = pos;
+        while (pos < s.size() && s[pos] != ' ' && s[pos] != '\t' && s[pos] != '\n') ++pos;
+        return s.substr(start, pos - start);
+    }
+    // Слишком длинное число насыщается до UINT64_MAX, цифры всё равно съедаются
+    bool u64(uint64_t &out) {
+        skipSpaces();
+        if (pos >= s.size() || unsigned(s[pos] - '0') > 9) return false;
+        uint64_t value = 0;
+        while (pos < s.size() && unsigned(s[pos] - '0') <= 9) {
+            const unsigned digit = unsigned(s[pos] - '0');
+            value = (value > (UINT64_MAX - digit) / 10) ? UINT64_MAX : value * 10 + digit;
+            ++pos;
+        }
+        out = value;
+        return true;
+    }
+    // Насыщается до INT64_MIN / INT64_MAX
+    bool i64(int64_t &out) {
+        skipSpaces();
+        const bool negative = pos < s.size() && s[pos] == '-';
+        if (negative) ++pos;
+        uint64_t value = 0;
+        if (!u64(value)) return false;
+        if (negative) out = value >= uint64_t(INT64_MAX) + 1 ? INT64_MIN : -int64_t(value);
+        else          out = value > uint64_t(INT64_MAX) ? INT64_MAX : int64_t(value);
+        return true;
+    }
+    void skip(size_t n) { pos = (pos + n < s.size()) ? pos + n : s.size(); }
+    void skipWords(int n) { while (n-- > 0) word(); }
+
+private:
+    std::string_view s;
+    size_t pos = 0;
+};
+
+inline uint64_t toU64(std::string_view text) {
+    uint64_t value = 0;
+    Scanner(text).u64(value);
+    return value;
+}
+
+// /proc/stat
+struct CpuTimes {
+    uint64_t user = 0, nice = 0, system = 0, idle = 0;
+    uint64_t iowait = 0, irq = 0, softirq = 0, steal = 0;
+
+    uint64_t busy() const { return user + nice + system + irq + softirq + steal; }
+    uint64_t total() const { return busy() + idle + iowait; }
+};
+
+struct StatSnapshot {
+    CpuTimes total;
+    std::vector<CpuTimes> cores; // переиспользуется между разборами
+    uint64_t contextSwitches = 0;
+    uint64_t processesCreated = 0;
+    uint64_t procsRunning = 0;
+    uint64_t procsBlocked = 0;
+};
+
+bool parseStat(std::string_view text, StatSnapshot &out);
+
+// /proc/meminfo, значения в КБ
+struct MemInfo {
+    uint64_t totalKb = 0, freeKb = 0, availableKb = 0;
+    uint64_t buffersKb = 0, cachedKb = 0;
+    uint64_t swapTotalKb = 0, swapFreeKb = 0;
+};
+
+bool parseMeminfo(std::string_view text, MemInfo &out);
+
+// /proc/[pid]/stat. comm указывает внутрь буфера.
+struct PidStat {
+    int pid = 0;
+    std::string_view comm;
+    char state = '?';
+    int ppid = 0;
+    uint64_t minflt = 0, majflt = 0;
+    uint64_t utime = 0, stime = 0;       // в тиках
+    int64_t priority = 0, nice = 0;
+    int64_t numThreads = 0;
+    uint64_t starttime = 0;              // в тиках с момента загрузки
+    uint64_t vsize = 0;                  // в байтах
+    int64_t rssPages = 0;
+};
+
+bool parsePidStat(std::string_view text, PidStat &out);
+
+// /proc/[pid]/status
+struct PidStatus {
+    std::string_view name;
+    uint32_t uid[4] = { 0, 0, 0, 0 };    // real, effective, saved, fs
+    uint32_t gid[4] = { 0, 0, 0, 0 };
+    uint64_t vmRssKb = 0, vmSwapKb = 0;
+    int64_t threads = 0;
+    uint64_t voluntarySwitches = 0, nonvoluntarySwitches = 0;
+};
+
+bool parsePidStatus(std::string_view text, PidStatus &out);
+
+// /proc/[pid]/io (нужны права ptrace на процесс)
+struct PidIo {
+    uint64_t rchar = 0, wchar = 0;
+    uint64_t readBytes = 0, writeBytes = 0; // реально дошедшее до блочного уровня
+};
+
+bool parsePidIo(std::string_view text, PidIo &out);
+
+// /proc/[pid]/smaps_rollup, значения в КБ
+struct SmapsRollup {
+    uint64_t rssKb = 0, pssKb = 0;
+    uint64_t sharedCleanKb = 0, sharedDirtyKb = 0;
+    uint64_t privateCleanKb = 0, privateDirtyKb = 0;
+    uint64_t swapKb = 0, swapPssKb = 0;
+
+    uint64_t ussKb() const { return privateCleanKb + privateDirtyKb; }
+};
+
+bool parseSmapsRollup(std::string_view text, SmapsRollup &out);
+
+// /proc/diskstats. name указывает внутрь буфера.
+struct DiskStat {
+    uint32_t major = 0, minor = 0;
+    std::string_view name;
+    uint64_t readsCompleted = 0, readsMerged = 0, sectorsRead = 0, readTimeMs = 0;
+    uint64_t writesCompleted = 0, writesMerged = 0, sectorsWritten = 0, writeTimeMs = 0;
+    uint64_t ioInProgress = 0, ioTimeMs = 0, weightedIoTimeMs = 0;
+};
+
+// out переиспользуется: clear() сохраняет ёмкость
+bool parseDiskstats(std::string_view text, std::vector<DiskStat> &out);
+
+// Все числовые подкаталоги /proc; out переиспользуется
+bool listPids(int procFd, std::vector<int> &out, DirReader &reader);
+
+// Снимок процесса из stat, statm, status и cmdline.
+// Строки указывают внутрь буферов ProcessReader.
+struct ProcessSample {
+    PidStat stat;
+    PidStatus status;
+    uint64_t residentPages = 0;           // statm
+    uint64_t sharedPages = 0;
+    std::string_view cmdline;             // аргументы через пробел
+    PidIo io;
+    bool hasIo = false;                   // io недоступен без прав на процесс
+};
+
+class ProcessReader {
+public:
+    enum Part { Stat = 1, Statm = 2, Status = 4, Cmdline = 8, Io = 16, All = 31 };
+
+    // procFd — дескриптор каталога /proc; читаются только части из mask
+    bool read(int procFd, int pid, ProcessSample &out, int mask = All);
+
+private:
+    FileBuffer statBuffer{ 1024 };
+    FileBuffer statmBuffer{ 256 };
+    FileBuffer statusBuffer{ 4096 };
+    FileBuffer cmdlineBuffer{ 4096 };
+    FileBuffer ioBuffer{ 512 };
+};
+
+} // namespace procfs
+
+#endif // PROCFS_H
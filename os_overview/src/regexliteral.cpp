@@ -0,0 +1,72 @@
+#include "regexliteral.h"
+#include <vector>
+
+std::string requiredLiteral(const std::string &pattern) {
+    // Альтернатива и встроенные флаги ((?i) и т.п.) ломают простой разбор
+    if (pattern.find('|') != std::string::npos || pattern.find("(?") != std::string::npos) return std::string();
+    static const std::string special = "\\^$.|?*+()[]{}";
+    std::string best, run;
+    // Лучшие подстроки объемлющих групп: подстрока из группы засчитывается,
+    // только если за ')' не идёт квантификатор, делающий группу необязательной
+    std::vector<std::string> outer;
+    auto closeRun = [&] {
+        if (run.size() > best.size()) best = run;
+        run.clear();
+    };
+    for (size_t i = 0; i < pattern.size(); ++i) {
+        const char c = pattern[i];
+        if (c == '\\') {
+            if (i + 1 < pattern.size() && special.find(pattern[i + 1]) != std::string::npos) {
+                run += pattern[++i];
+                continue;
+            }
+            closeRun();            // \d, \w, \b, \x..: не буквальный символ
+            ++i;
+            continue;
+        }
+        if (c == '?' || c == '*' || c == '{') {
+            // Предыдущий символ необязателен
+            if (!run.empty()) run.pop_back();
+            closeRun();
+            if (c == '{') {
+                const size_t close = pattern.find('}', i);
+                if (close != std::string::npos) i = close;
+            }
+            continue;
+        }
+        if (c == '[') {
+            closeRun();
+            size_t j = i + 1;
+            if (j < pattern.size() && pattern[j] == '^') ++j;
+            if (j < pattern.size() && pattern[j] == ']') ++j;
+            while (j < pattern.size() && pattern[j] != ']') j += pattern[j] == '\\' ? 2 : 1;
+            i = j;
+            continue;
+        }
+        if (c == '(') {
+            closeRun();
+            outer.push_back(std::move(best));
+            best.clear();
+            continue;
+        }
+        if (c == ')') {
+            closeRun();
+            if (outer.empty()) continue;
+            std::string inner = std::move(best);
+            best = std::move(outer.back());
+            outer.pop_back();
+            const char next = i + 1 < pattern.size() ? pattern[i + 1] : '\0';
+            if (next == '?' || next == '*' || next == '{') continue;
+            if (inner.size() > best.size()) best = std::move(inner);
+            continue;
+        }
+        if (special.find(c) != std::string::npos) {
+            // '+' оставляет символ обязательным, остальное обрывает подстроку
+            closeRun();
+            continue;
+        }
+        run += c;
+    }
+    closeRun();
+    return best;
+}
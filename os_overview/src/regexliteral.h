@@ -0,0 +1,13 @@
+#ifndef REGEXLITERAL_H
+#define REGEXLITERAL_H
+
+#include <string>
+
+// Самая длинная подстрока, без которой регулярное выражение (PCRE) не может
+// совпасть: по ней ContentSearch отбирает строки-кандидаты через memmem.
+// Пустая — выделить не удалось, проверяется каждая строка. Разбор
+// консервативный: всё необязательное (?, *, {..}, в том числе у групп),
+// альтернативы и встроенные флаги дают пустой результат или отбрасываются.
+std::string requiredLiteral(const std::string &pattern);
+
+#endif // REGEXLITERAL_H
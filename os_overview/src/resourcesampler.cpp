@@ -0,0 +1,242 @@
+#include "resourcesampler.h"
+#include <QFile>
+#include <QDir>
+#include <QDateTime>
+#include <QMetaObject>
+#include <QMutexLocker>
+
+static const QString kCgroupRoot = QStringLiteral("/sys/fs/cgroup");
+
+ResourceSampler::ResourceSampler(QObject* parent) : QObject(parent) {
+    clock.start();
+    connect(&timer, &QTimer::timeout, this, &ResourceSampler::sample);
+}
+
+ResourceSampler::~ResourceSampler() {
+    cancelled = true;
+    if (worker.joinable()) worker.join();
+}
+
+void ResourceSampler::start(int intervalMs) {
+    sample();
+    timer.start(intervalMs);
+}
+
+QJsonObject ResourceSampler::systemPressure() const {
+    QMutexLocker locker(&mutex);
+    return pressure;
+}
+
+QJsonObject ResourceSampler::unitResources(const QString& unit) const {
+    QMutexLocker locker(&mutex);
+    return units.value(unit);
+}
+
+QJsonObject ResourceSampler::unitUsage(const QString& unit) const {
+    QMutexLocker locker(&mutex);
+    return units.value(unit)["usage"].toObject();
+}
+
+QJsonObject ResourceSampler::snapshot() const {
+    QMutexLocker locker(&mutex);
+    QJsonObject cgroups;
+    for (auto it = units.cbegin(); it != units.cend(); ++it) {
+        cgroups[it.key()] = it.value();
+    }
+    return QJsonObject{
+        {"pressure", pressure},
+        {"cgroups", cgroups},
+        {"timestamp", QDateTime::fromMSecsSinceEpoch(sampledAt).toString(Qt::ISODate)}
+    };
+}
+
+// Тик таймера: запускаем обход, если предыдущий уже закончился
+void ResourceSampler::sample() {
+    if (collecting) return;
+    if (worker.joinable()) worker.join();
+    collecting = true;
+    worker = std::thread([this] { collect(); });
+}
+
+void ResourceSampler::collect() {
+    QJsonObject newPressure;
+    for (const char* resource : { "cpu", "memory", "io" }) {
+        QJsonObject psi = readPressure(QString("/proc/pressure/%1").arg(resource));
+        if (!psi.isEmpty()) newPressure[resource] = psi;
+    }
+
+    QHash<QString, QJsonObject> newUnits;
+    walkCgroups(kCgroupRoot, QString(), 0, newUnits);
+    if (cancelled) {
+        collecting = false;
+        return;
+    }
+
+    // Юниты, чьих cgroup больше нет, уходят из previous сами
+    const qint64 nowMs = clock.elapsed();
+    QHash<QString, Counters> next;
+    for (auto it = newUnits.begin(); it != newUnits.end(); ++it) {
+        it.value()["usage"] = computeUsage(it.key(), it.value(), nowMs, next);
+    }
+    previous.swap(next);
+
+    {
+        QMutexLocker locker(&mutex);
+        pressure = newPressure;
+        units.swap(newUnits);
+        sampledAt = QDateTime::currentMSecsSinceEpoch();
+    }
+    collecting = false;
+    // Подписчики (ServiceManager) живут в главном потоке
+    QMetaObject::invokeMethod(this, [this] { emit sampled(); }, Qt::QueuedConnection);
+}
+
+QJsonObject ResourceSampler::computeUsage(const QString& unit, const QJsonObject& cgroup, qint64 nowMs,
+                                          QHash<QString, Counters>& next) const {
+    const QJsonObject io = cgroup["io"].toObject();
+    Counters counters;
+    counters.cpuUsec = qint64(cgroup["cpu"].toObject()["usage_usec"].toDouble());
+    counters.readBytes = qint64(io["rbytes"].toDouble());
+    counters.writeBytes = qint64(io["wbytes"].toDouble());
+    counters.atMs = nowMs;
+
+    const qint64 memoryCurrent = qint64(cgroup["memory_current"].toDouble(-1));
+    const auto prev = previous.constFind(unit);
+    // Пересозданная cgroup (служба перезапущена) начинает счётчики с нуля
+    const bool continued = prev != previous.cend() && prev->atMs < nowMs
+                           && counters.cpuUsec >= prev->cpuUsec
+                           && counters.readBytes >= prev->readBytes
+                           && counters.writeBytes >= prev->writeBytes;
+
+    // memory.peak есть с ядра 5.19; на старых ядрах — максимум по нашим снимкам
+    counters.memoryPeak = qint64(cgroup["memory_peak"].toDouble(-1));
+    if (counters.memoryPeak < 0) {
+        counters.memoryPeak = qMax(memoryCurrent, continued ? prev->memoryPeak : qint64(-1));
+    }
+    next.insert(unit, counters);
+
+    QJsonObject usage;
+    if (memoryCurrent >= 0) usage["memory_current"] = memoryCurrent;
+    if (counters.memoryPeak >= 0) usage["memory_peak"] = counters.memoryPeak;
+    if (cgroup.contains("tasks")) usage["tasks"] = cgroup["tasks"];
+    if (continued) {
+        const double seconds = (nowMs - prev->atMs) / 1000.0;
+        // Процент одного ядра, как в top: 200 — два ядра заняты целиком
+        const double cpuPercent = (counters.cpuUsec - prev->cpuUsec) / (seconds * 10000.0);
+        usage["cpu_percent"] = qRound(cpuPercent * 10) / 10.0;
+        usage["io_read_bps"] = qRound64((counters.readBytes - prev->readBytes) / seconds);
+        usage["io_write_bps"] = qRound64((counters.writeBytes - prev->writeBytes) / seconds);
+    }
+    return usage;
+}
+
+// Обходим только каталоги юнитов systemd: *.slice, *.service, *.scope.
+// В службу спускаемся тоже: у user@.service и служб с делегированием свои
+// дочерние cgroup. Их юниты получают префикс службы, чтобы dbus.service
+// пользовательского менеджера не затёр системный.
+void ResourceSampler::walkCgroups(const QString& dir, const QString& prefix, int depth,
+                                  QHash<QString, QJsonObject>& out) const {
+    if (depth > 8 || cancelled) return;
+    const QStringList children = QDir(dir).entryList(QDir::Dirs | QDir::NoDotAndDotDot);
+    for (const QString& name : children) {
+        const bool slice = name.endsWith(".slice");
+        const bool service = name.endsWith(".service");
+        if (!slice && !service && !name.endsWith(".scope")) continue;
+        const QString path = dir + '/' + name;
+        QJsonObject cgroup = readCgroup(path);
+        cgroup["cgroup"] = path.mid(kCgroupRoot.size());
+        out.insert(prefix + name, cgroup);
+        if (slice)        walkCgroups(path, prefix, depth + 1, out);
+        else if (service) walkCgroups(path, prefix + name + '/', depth + 1, out);
+    }
+}
+
+QJsonObject ResourceSampler::readCgroup(const QString& dir) {
+    QJsonObject cgroup;
+    cgroup["cpu"] = readKeyValues(dir + "/cpu.stat");
+    cgroup["memory_events"] = readKeyValues(dir + "/memory.events");
+    cgroup["io"] = readIoStat(dir + "/io.stat");
+
+    const qint64 memoryCurrent = readValue(dir + "/memory.current");
+    if (memoryCurrent >= 0) cgroup["memory_current"] = memoryCurrent;
+    const qint64 memoryPeak = readValue(dir + "/memory.peak");
+    if (memoryPeak >= 0) cgroup["memory_peak"] = memoryPeak;
+    const qint64 tasks = readValue(dir + "/pids.current");
+    if (tasks >= 0) cgroup["tasks"] = tasks;
+
+    QJsonObject cgroupPressure;
+    for (const char* resource : { "cpu", "memory", "io" }) {
+        QJsonObject psi = readPressure(QString("%1/%2.pressure").arg(dir, resource));
+        if (!psi.isEmpty()) cgroupPressure[resource] = psi;
+    }
+    cgroup["pressure"] = cgroupPressure;
+    return cgroup;
+}
+
+// Формат: "some avg10=0.00 avg60=0.00 avg300=0.00 total=0" и такая же строка "full"
+QJsonObject ResourceSampler::readPressure(const QString& path) {
+    QJsonObject result;
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) return result;
+    const QList<QByteArray> lines = file.readAll().split('\n');
+    for (const QByteArray& line : lines) {
+        const QList<QByteArray> parts = line.simplified().split(' ');
+        if (parts.size() < 2) continue;
+        QJsonObject values;
+        for (int i = 1; i < parts.size(); ++i) {
+            const int eq = parts[i].indexOf('=');
+            if (eq <= 0) continue;
+            const QByteArray key = parts[i].left(eq);
+            const QByteArray value = parts[i].mid(eq + 1);
+            if (key == "total") values[QString::fromLatin1(key)] = value.toLongLong();
+            else                values[QString::fromLatin1(key)] = value.toDouble();
+        }
+        result[QString::fromLatin1(parts[0])] = values;
+    }
+    return result;
+}
+
+// Формат "ключ значение" построчно: cpu.stat, memory.events
+QJsonObject ResourceSampler::readKeyValues(const QString& path) {
+    QJsonObject result;
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) return result;
+    const QList<QByteArray> lines = file.readAll().split('\n');
+    for (const QByteArray& line : lines) {
+        const int space = line.indexOf(' ');
+        if (space <= 0) continue;
+        result[QString::fromLatin1(line.left(space))] = line.mid(space + 1).trimmed().toLongLong();
+    }
+    return result;
+}
+
+// Формат: "8:0 rbytes=... wbytes=... rios=... wios=... dbytes=... dios=...", суммируем по устройствам
+QJsonObject ResourceSampler::readIoStat(const QString& path) {
+    QHash<QByteArray, qint64> totals;
+    QFile file(path);
+    if (file.open(QIODevice::ReadOnly)) {
+        const QList<QByteArray> lines = file.readAll().split('\n');
+        for (const QByteArray& line : lines) {
+            const QList<QByteArray> parts = line.split(' ');
+            for (int i = 1; i < parts.size(); ++i) {
+                const int eq = parts[i].indexOf('=');
+                if (eq <= 0) continue;
+                totals[parts[i].left(eq)] += parts[i].mid(eq + 1).toLongLong();
+            }
+        }
+    }
+    QJsonObject result;
+    for (auto it = totals.cbegin(); it != totals.cend(); ++it) {
+        result[QString::fromLatin1(it.key())] = it.value();
+    }
+    return result;
+}
+
+// Файл из одного числа (memory.current, pids.current); -1 — файла нет
+qint64 ResourceSampler::readValue(const QString& path) {
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) return -1;
+    bool ok = false;
+    const qint64 value = file.readAll().trimmed().toLongLong(&ok);
+    return ok ? value : -1;
+}
@@ -0,0 +1,76 @@
+#ifndef RESOURCESAMPLER_H
+#define RESOURCESAMPLER_H
+
+#include <QObject>
+#include <QJsonObject>
+#include <QHash>
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QTimer>
+#include <atomic>
+#include <thread>
+
+// Фоновый сборщик Pressure Stall Information и метрик cgroup v2.
+// Обход /sys/fs/cgroup идёт в отдельном потоке, готовый снимок публикуется
+// под mutex; запросы только читают последний снимок, поэтому остаются дешёвыми.
+// Счётчики cgroup (cpu.stat, io.stat) накопительные: скорости считаются
+// по разнице с предыдущим проходом и кладутся в usage каждого юнита.
+class ResourceSampler : public QObject
+{
+    Q_OBJECT
+public:
+    explicit ResourceSampler(QObject *parent = nullptr);
+    ~ResourceSampler();
+
+    void start(int intervalMs = 2000);
+
+    // /proc/pressure/{cpu,memory,io}
+    QJsonObject systemPressure() const;
+    // Разбивка по юниту systemd (foo.service, system.slice, ...); пустой объект, если cgroup не найдена.
+    // Юниты пользовательских менеджеров — под именем с префиксом: user@1000.service/app.slice
+    QJsonObject unitResources(const QString &unit) const;
+    // Сводка юнита: {cpu_percent, memory_current, memory_peak, io_read_bps,
+    // io_write_bps, tasks}; скоростей нет, пока не накопилось двух проходов
+    QJsonObject unitUsage(const QString &unit) const;
+    // Полный снимок: системный PSI и все слайсы/службы
+    QJsonObject snapshot() const;
+
+signals:
+    // Новый снимок готов; испускается в потоке объекта
+    void sampled();
+
+private slots:
+    void sample();
+
+private:
+    // Накопительные счётчики юнита с прошлого прохода
+    struct Counters {
+        qint64 cpuUsec = 0;
+        qint64 readBytes = 0;
+        qint64 writeBytes = 0;
+        qint64 memoryPeak = 0;
+        qint64 atMs = 0;
+    };
+
+    void collect();
+    void walkCgroups(const QString &dir, const QString &prefix, int depth, QHash<QString, QJsonObject> &out) const;
+    static QJsonObject readCgroup(const QString &dir);
+    static QJsonObject readPressure(const QString &path);
+    static QJsonObject readKeyValues(const QString &path);
+    static QJsonObject readIoStat(const QString &path);
+    static qint64 readValue(const QString &path);
+    QJsonObject computeUsage(const QString &unit, const QJsonObject &cgroup, qint64 nowMs, QHash<QString, Counters> &next) const;
+
+    QTimer timer;
+    mutable QMutex mutex;
+    QJsonObject pressure;
+    QHash<QString, QJsonObject> units;
+    QHash<QString, Counters> previous;    // только из потока обхода
+    QElapsedTimer clock;
+    std::thread worker;
+    std::atomic<bool> collecting{false};
+    std::atomic<bool> cancelled{false};
+    qint64 sampledAt = 0;
+};
+
+#endif // RESOURCESAMPLER_H
@@ -0,0 +1,98 @@
+#ifndef WORKQUEUE_H
+#define WORKQUEUE_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Очереди заданий для параллельного обхода дерева каталогов. У каждого потока
+// своя очередь: владелец берёт с конца (в глубину, по тёплому кэшу dentry), вор
+// забирает с начала — там каталоги ближе к корню, обычно самые крупные.
+// Счётчик outstanding включает задания в очередях и в обработке, поэтому его
+// ноль означает, что обход закончен.
+template <typename Task>
+class WorkStealingQueues {
+public:
+    explicit WorkStealingQueues(int threads) {
+        for (int i = 0; i < threads; ++i) queues.push_back(std::make_unique<Queue>());
+    }
+
+    int threads() const { return int(queues.size()); }
+
+    void push(int self, Task task) {
+        outstanding.fetch_add(1, std::memory_order_relaxed);
+        Queue &queue = *queues[size_t(self)];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.tasks.push_back(std::move(task));
+    }
+
+    // Цикл рабочего потока: process(self, task) может добавлять новые задания.
+    // Возвращается, когда работы не осталось или cancelled стал true.
+    template <typename Process>
+    void work(int self, const std::atomic<bool> &cancelled, Process &&process) {
+        int idle = 0;
+        while (!cancelled.load(std::memory_order_relaxed)) {
+            Task task;
+            if (pop(self, task)) {
+                idle = 0;
+                process(self, task);
+                // Дочерние задания уже в очереди, поэтому ноль значит «работы больше нет»
+                outstanding.fetch_sub(1, std::memory_order_acq_rel);
+                continue;
+            }
+            if (outstanding.load(std::memory_order_acquire) == 0) break;
+            if (++idle < 64) std::this_thread::yield();
+            else             std::this_thread::sleep_for(std::chrono::microseconds(200));
+        }
+    }
+
+    // Запускает threads() потоков (нулевой — вызывающий) и ждёт их завершения
+    template <typename Process>
+    void run(const std::atomic<bool> &cancelled, Process process) {
+        std::vector<std::thread> workers;
+        for (int i = 1; i < threads(); ++i) {
+            workers.emplace_back([this, i, &cancelled, &process] { work(i, cancelled, process); });
+        }
+        work(0, cancelled, process);
+        for (std::thread &worker : workers) worker.join();
+    }
+
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    bool pop(int self, Task &task) {
+        const int count = threads();
+        {
+            Queue &own = *queues[size_t(self)];
+            std::lock_guard<std::mutex> lock(own.mutex);
+            if (!own.tasks.empty()) {
+                task = std::move(own.tasks.back());
+                own.tasks.pop_back();
+                return true;
+            }
+        }
+        for (int i = 1; i < count; ++i) {
+            Queue &victim = *queues[size_t((self + i) % count)];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (!victim.tasks.empty()) {
+                task = std::move(victim.tasks.front());
+                victim.tasks.pop_front();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::atomic<int64_t> outstanding{0};
+};
+
+#endif // WORKQUEUE_H
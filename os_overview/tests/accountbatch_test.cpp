@@ -0,0 +1,266 @@
+#include "accountbatch.h"
+
+#include <gtest/gtest.h>
+#include <QDir>
+#include <QFile>
+#include <QTemporaryDir>
+
+// Пакеты идут по копиям баз во временном каталоге (DatabasePaths::underRoot):
+// тесты не требуют root и ничего не меняют в системе
+namespace {
+
+const char *kUser = "os-overview-test-user";
+const char *kGroup = "os-overview-test-group";
+
+const char *kPasswd =
+    "root:x:0:0:root:/root:/bin/bash\n"
+    "daemon:x:1:1:daemon:/usr/sbin:/usr/sbin/nologin\n"
+    "alice:x:1000:1000::/home/alice:/bin/sh\n";
+const char *kShadow =
+    "root:*:19000:0:99999:7:::\n"
+    "daemon:*:19000:0:99999:7:::\n"
+    "alice:!:19000:0:99999:7:::\n";
+const char *kGroupDb =
+    "root:x:0:\n"
+    "daemon:x:1:\n"
+    "users:x:100:\n"
+    "alice:x:1000:\n";
+const char *kGshadow =
+    "root:*::\n"
+    "daemon:*::\n"
+    "users:*::\n"
+    "alice:!::\n";
+
+QJsonObject item(const QJsonObject &result, int index) {
+    return result["items"].toArray()[index].toObject();
+}
+
+QByteArray readFile(const QByteArray &path) {
+    QFile file(QFile::decodeName(path));
+    return file.open(QIODevice::ReadOnly) ? file.readAll() : QByteArray();
+}
+
+bool writeFile(const QByteArray &path, const QByteArray &data) {
+    QFile file(QFile::decodeName(path));
+    return file.open(QIODevice::WriteOnly) && file.write(data) == data.size();
+}
+
+class AccountBatch : public ::testing::Test {
+protected:
+    void SetUp() override {
+        ASSERT_TRUE(root.isValid());
+        ASSERT_TRUE(QDir(root.path()).mkpath("etc"));
+        paths = accounts::DatabasePaths::underRoot(QFile::encodeName(root.path()));
+        ASSERT_TRUE(writeFile(paths.passwd, kPasswd));
+        ASSERT_TRUE(writeFile(paths.shadow, kShadow));
+        ASSERT_TRUE(writeFile(paths.group, kGroupDb));
+        ASSERT_TRUE(writeFile(paths.gshadow, kGshadow));
+    }
+
+    // Домашние каталоги не создаются: умолчание из login.defs хоста не в счёт
+    QJsonObject run(const QJsonArray &operations, QJsonObject options = QJsonObject()) {
+        options["create_home"] = false;
+        return accounts::applyBatch(operations, options, paths);
+    }
+
+    QJsonObject dryRun(const QJsonArray &operations, bool atomic = false) {
+        return run(operations, QJsonObject{{"dry_run", true}, {"atomic", atomic}});
+    }
+
+    void expectUnchanged() {
+        EXPECT_EQ(readFile(paths.passwd), kPasswd);
+        EXPECT_EQ(readFile(paths.shadow), kShadow);
+        EXPECT_EQ(readFile(paths.group), kGroupDb);
+        EXPECT_EQ(readFile(paths.gshadow), kGshadow);
+        EXPECT_EQ(QDir(root.path() + "/etc").entryList(QDir::Files).size(), 4);
+    }
+
+    QTemporaryDir root;
+    accounts::DatabasePaths paths;
+};
+
+} // namespace
+
+TEST_F(AccountBatch, RejectsInvalidUid) {
+    const QJsonValue invalid[] = {-1, 4294967295.0, 1e12, 1000.5, QString("1000"), true, QJsonValue::Null};
+    QJsonArray operations;
+    for (const QJsonValue &uid : invalid) {
+        operations.append(QJsonObject{{"op", "create"}, {"name", kUser}, {"group", "root"}, {"uid", uid}});
+    }
+    const QJsonObject result = dryRun(operations);
+    ASSERT_TRUE(result["error"].isUndefined()) << result["error"].toString().toStdString();
+    EXPECT_EQ(result["failed"].toInt(), operations.size());
+    for (int i = 0; i < operations.size(); ++i) {
+        EXPECT_EQ(item(result, i)["status"].toString(), "failed") << i;
+        EXPECT_EQ(item(result, i)["error"].toString(), "Invalid UID") << i;
+    }
+}
+
+TEST_F(AccountBatch, RejectsInvalidGid) {
+    const QJsonValue invalid[] = {-5, 4294967295.0, 2.25, QString("50")};
+    QJsonArray operations;
+    for (const QJsonValue &gid : invalid) {
+        operations.append(QJsonObject{{"op", "create_group"}, {"name", kGroup}, {"gid", gid}});
+    }
+    const QJsonObject result = dryRun(operations);
+    EXPECT_EQ(result["failed"].toInt(), operations.size());
+    for (int i = 0; i < operations.size(); ++i) {
+        EXPECT_EQ(item(result, i)["error"].toString(), "Invalid GID") << i;
+    }
+}
+
+TEST_F(AccountBatch, RejectsInvalidPrimaryGroupId) {
+    const QJsonObject result = dryRun(QJsonArray{
+        QJsonObject{{"op", "create"}, {"name", kUser}, {"group", -1}},
+    });
+    EXPECT_EQ(item(result, 0)["error"].toString(), "Primary group does not exist");
+}
+
+TEST_F(AccountBatch, AcceptsLargestValidIds) {
+    const QJsonObject result = dryRun(QJsonArray{
+        QJsonObject{{"op", "create_group"}, {"name", kGroup}, {"gid", 4294967294.0}},
+        QJsonObject{{"op", "create"}, {"name", kUser}, {"group", "root"}, {"uid", 4294967293.0}},
+    });
+    ASSERT_EQ(result["applied"].toInt(), 2) << item(result, 0)["error"].toString().toStdString()
+                                            << item(result, 1)["error"].toString().toStdString();
+    EXPECT_EQ(item(result, 0)["gid"].toDouble(), 4294967294.0);
+    EXPECT_EQ(item(result, 1)["uid"].toDouble(), 4294967293.0);
+    EXPECT_FALSE(result["committed"].toBool());
+}
+
+TEST_F(AccountBatch, RejectsDuplicateIdsWithinBatch) {
+    const QJsonObject result = dryRun(QJsonArray{
+        QJsonObject{{"op", "create_group"}, {"name", kGroup}, {"gid", 4294967000.0}},
+        QJsonObject{{"op", "create_group"}, {"name", QString(kGroup) + "2"}, {"gid", 4294967000.0}},
+    });
+    EXPECT_EQ(item(result, 0)["status"].toString(), "applied");
+    EXPECT_EQ(item(result, 1)["error"].toString(), "GID 4294967000 is already used");
+}
+
+TEST_F(AccountBatch, RejectsInvalidNamesAndFields) {
+    const QJsonObject result = dryRun(QJsonArray{
+        QJsonObject{{"op", "create"}, {"name", "Bad Name"}},
+        QJsonObject{{"op", "create"}, {"name", kUser}, {"group", "root"}, {"shell", "/bin/sh:x"}},
+        QJsonObject{{"op", "create_group"}, {"name", "9group"}},
+        QJsonObject{{"op", "rename"}, {"name", kUser}},
+    });
+    EXPECT_EQ(item(result, 0)["error"].toString(), "Invalid user name");
+    EXPECT_EQ(item(result, 1)["error"].toString(), "Invalid gecos, home or shell");
+    EXPECT_EQ(item(result, 2)["error"].toString(), "Invalid group name");
+    EXPECT_EQ(item(result, 3)["error"].toString(), "Unknown operation: rename");
+}
+
+TEST_F(AccountBatch, AtomicBatchSkipsValidOperationsOnError) {
+    const QJsonObject result = dryRun(QJsonArray{
+        QJsonObject{{"op", "create_group"}, {"name", kGroup}},
+        QJsonObject{{"op", "create"}, {"name", kUser}, {"group", "root"}, {"uid", -1}},
+    }, true);
+    EXPECT_EQ(item(result, 0)["status"].toString(), "skipped");
+    EXPECT_EQ(item(result, 1)["status"].toString(), "failed");
+    EXPECT_EQ(result["applied"].toInt(), 0);
+    EXPECT_FALSE(result["error"].toString().isEmpty());
+}
+
+TEST_F(AccountBatch, RejectsOversizedBatch) {
+    QJsonArray operations;
+    for (int i = 0; i <= 10000; ++i) operations.append(QJsonObject{{"op", "delete_group"}, {"name", kGroup}});
+    const QJsonObject result = dryRun(operations);
+    EXPECT_TRUE(result["items"].isUndefined());
+    EXPECT_FALSE(result["error"].toString().isEmpty());
+}
+
+TEST_F(AccountBatch, UnderRootPaths) {
+    const accounts::DatabasePaths system;
+    EXPECT_TRUE(system.isSystem());
+    EXPECT_TRUE(accounts::DatabasePaths::underRoot("/").isSystem());
+    const accounts::DatabasePaths image = accounts::DatabasePaths::underRoot("/srv/image/");
+    EXPECT_FALSE(image.isSystem());
+    EXPECT_EQ(image.passwd, "/srv/image/etc/passwd");
+    EXPECT_EQ(image.gshadow, "/srv/image/etc/gshadow");
+}
+
+TEST_F(AccountBatch, DryRunLeavesFilesUntouched) {
+    const QJsonObject result = dryRun(QJsonArray{
+        QJsonObject{{"op", "create_group"}, {"name", kGroup}},
+    });
+    EXPECT_EQ(result["applied"].toInt(), 1);
+    EXPECT_FALSE(result["committed"].toBool());
+    expectUnchanged();
+}
+
+TEST_F(AccountBatch, CommitsMultipleOperations) {
+    const QJsonObject result = run(QJsonArray{
+        QJsonObject{{"op", "create_group"}, {"name", kGroup}, {"gid", 2000}},
+        QJsonObject{{"op", "create"}, {"name", kUser}, {"uid", 2001}, {"group", kGroup}, {"groups", QJsonArray{"users"}},
+                    {"home", "/nonexistent"}, {"shell", "/bin/false"}, {"password_hash", "$6$salt$hash"}},
+        QJsonObject{{"op", "password"}, {"name", "alice"}, {"password_hash", "$6$other$hash"}},
+        QJsonObject{{"op", "delete"}, {"name", "daemon"}},
+    });
+    ASSERT_TRUE(result["committed"].toBool()) << result["error"].toString().toStdString();
+    EXPECT_EQ(result["applied"].toInt(), 4);
+    EXPECT_EQ(result["failed"].toInt(), 0);
+
+    const QByteArray passwd = readFile(paths.passwd);
+    EXPECT_FALSE(passwd.contains("daemon:"));
+    EXPECT_TRUE(passwd.contains(QByteArray(kUser) + ":x:2001:2000::/nonexistent:/bin/false\n"));
+    const QByteArray shadow = readFile(paths.shadow);
+    EXPECT_TRUE(shadow.contains(QByteArray(kUser) + ":$6$salt$hash:"));
+    EXPECT_TRUE(shadow.contains("alice:$6$other$hash:"));
+    EXPECT_FALSE(shadow.contains("daemon:"));
+    const QByteArray group = readFile(paths.group);
+    EXPECT_TRUE(group.contains(QByteArray(kGroup) + ":x:2000:\n"));
+    EXPECT_TRUE(group.contains(QByteArray("users:x:100:") + kUser + "\n"));
+    // Личная группа daemon ушла вместе с пользователем
+    EXPECT_FALSE(group.contains("daemon:"));
+    EXPECT_TRUE(readFile(paths.gshadow).contains(QByteArray(kGroup) + ":!::\n"));
+
+    // Резервные копии с прежним содержимым, блокировки и временные файлы убраны
+    EXPECT_EQ(readFile(paths.passwd + "-"), kPasswd);
+    EXPECT_EQ(readFile(paths.group + "-"), kGroupDb);
+    for (const QByteArray &path : {paths.passwd, paths.shadow, paths.group, paths.gshadow}) {
+        EXPECT_FALSE(QFile::exists(QFile::decodeName(path + ".lock"))) << path.constData();
+        EXPECT_FALSE(QFile::exists(QFile::decodeName(path + "+"))) << path.constData();
+    }
+}
+
+TEST_F(AccountBatch, AtomicBatchWritesNothingAfterFailedOperation) {
+    const QJsonObject result = run(QJsonArray{
+        QJsonObject{{"op", "create_group"}, {"name", kGroup}},
+        QJsonObject{{"op", "password"}, {"name", "alice"}, {"password_hash", "$6$other$hash"}},
+        QJsonObject{{"op", "delete"}, {"name", "nobody-here"}},
+    });
+    EXPECT_FALSE(result["committed"].toBool());
+    EXPECT_EQ(item(result, 0)["status"].toString(), "skipped");
+    EXPECT_EQ(item(result, 1)["status"].toString(), "skipped");
+    EXPECT_EQ(item(result, 2)["error"].toString(), "No such user");
+    expectUnchanged();
+}
+
+TEST_F(AccountBatch, NonAtomicBatchCommitsValidOperations) {
+    const QJsonObject result = run(QJsonArray{
+        QJsonObject{{"op", "create_group"}, {"name", kGroup}, {"gid", 2000}},
+        QJsonObject{{"op", "delete"}, {"name", "nobody-here"}},
+    }, QJsonObject{{"atomic", false}});
+    ASSERT_TRUE(result["committed"].toBool()) << result["error"].toString().toStdString();
+    EXPECT_EQ(item(result, 0)["status"].toString(), "applied");
+    EXPECT_EQ(item(result, 1)["status"].toString(), "failed");
+    EXPECT_TRUE(readFile(paths.group).contains(QByteArray(kGroup) + ":x:2000:\n"));
+    EXPECT_EQ(readFile(paths.passwd), kPasswd);
+}
+
+TEST_F(AccountBatch, RollsBackWhenReplacingFails) {
+    // Каталог на месте временного файла: group и gshadow уже заменены,
+    // когда запись passwd срывается, и должны вернуться к прежнему виду
+    ASSERT_TRUE(QDir().mkdir(QFile::decodeName(paths.passwd + "+")));
+    const QJsonObject result = run(QJsonArray{
+        QJsonObject{{"op", "create"}, {"name", kUser}, {"uid", 2001}, {"home", "/nonexistent"}},
+    });
+    EXPECT_FALSE(result["committed"].toBool());
+    EXPECT_TRUE(result["rolled_back"].toBool());
+    EXPECT_EQ(item(result, 0)["status"].toString(), "skipped");
+    EXPECT_FALSE(result["error"].toString().isEmpty());
+    EXPECT_EQ(readFile(paths.passwd), kPasswd);
+    EXPECT_EQ(readFile(paths.shadow), kShadow);
+    EXPECT_EQ(readFile(paths.group), kGroupDb);
+    EXPECT_EQ(readFile(paths.gshadow), kGshadow);
+}
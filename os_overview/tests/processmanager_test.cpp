@@ -0,0 +1,77 @@
+#include "processmanager.h"
+
+#include <QCoreApplication>
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+// События подаются прямым вызовом слотов, как их вызвал бы ProcConnector;
+// в роли нового процесса — сам тест, его /proc/self всегда доступен
+namespace {
+
+bool logFork(ProcessManager &manager) {
+    return QMetaObject::invokeMethod(&manager, "onForked", Qt::DirectConnection,
+                                     Q_ARG(int, int(::getpid())), Q_ARG(int, int(::getppid())));
+}
+
+bool logExec(ProcessManager &manager) {
+    return QMetaObject::invokeMethod(&manager, "onExecuted", Qt::DirectConnection, Q_ARG(int, int(::getpid())));
+}
+
+QJsonArray events(const ProcessManager &manager) {
+    return manager.getProcessEvents(0, 0)["events"].toArray();
+}
+
+} // namespace
+
+TEST(ProcessEvents, ForkAndExecAreFilledAfterFlush) {
+    ProcessManager manager;
+    ASSERT_TRUE(logFork(manager));
+    ASSERT_TRUE(logExec(manager));
+    // До перечитывания процесса имени ещё нет
+    EXPECT_TRUE(events(manager)[0].toObject()["name"].toString().isEmpty());
+
+    ASSERT_TRUE(QMetaObject::invokeMethod(&manager, "flushPendingPids", Qt::DirectConnection));
+    const QJsonArray logged = events(manager);
+    ASSERT_EQ(logged.size(), 2);
+    const QJsonObject forked = logged[0].toObject();
+    const QJsonObject executed = logged[1].toObject();
+    EXPECT_EQ(forked["type"].toString(), "fork");
+    EXPECT_FALSE(forked["name"].toString().isEmpty());
+    EXPECT_EQ(forked["user"].toString(), QString::number(::getuid()));
+    EXPECT_EQ(forked["ppid"].toInt(), int(::getppid()));
+    EXPECT_EQ(executed["type"].toString(), "exec");
+    EXPECT_EQ(executed["name"].toString(), forked["name"].toString());
+    EXPECT_EQ(executed["user"].toString(), QString::number(::getuid()));
+    EXPECT_FALSE(executed["cmdline"].toString().isEmpty());
+}
+
+TEST(ProcessEvents, ExitBeforeFlushFillsPendingEvents) {
+    ProcessManager manager;
+    ASSERT_TRUE(logFork(manager));
+    ASSERT_TRUE(QMetaObject::invokeMethod(&manager, "onExited", Qt::DirectConnection,
+                                          Q_ARG(int, int(::getpid())), Q_ARG(int, 0)));
+    const QJsonArray logged = events(manager);
+    ASSERT_EQ(logged.size(), 2);
+    EXPECT_FALSE(logged[0].toObject()["name"].toString().isEmpty());
+    EXPECT_EQ(logged[0].toObject()["user"].toString(), QString::number(::getuid()));
+    EXPECT_EQ(logged[1].toObject()["type"].toString(), "exit");
+    EXPECT_EQ(logged[1].toObject()["name"].toString(), logged[0].toObject()["name"].toString());
+}
+
+TEST(ProcessEvents, SinceZeroStartsFromOldest) {
+    ProcessManager manager;
+    ASSERT_TRUE(logFork(manager));
+    ASSERT_TRUE(logExec(manager));
+    const QJsonObject result = manager.getProcessEvents(0, 1);
+    ASSERT_EQ(result["events"].toArray().size(), 1);
+    EXPECT_EQ(result["events"].toArray()[0].toObject()["seq"].toInt(), 1);
+    EXPECT_EQ(result["next_seq"].toInt(), 2);
+    EXPECT_TRUE(result["dropped"].isUndefined());
+}
+
+int main(int argc, char **argv) {
+    // Таймеры ProcessManager требуют экземпляра приложения
+    QCoreApplication app(argc, argv);
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,49 @@
+#include "regexliteral.h"
+
+#include <gtest/gtest.h>
+
+TEST(RequiredLiteral, PlainText) {
+    EXPECT_EQ(requiredLiteral("connection refused"), "connection refused");
+}
+
+TEST(RequiredLiteral, LongestRunBetweenMetacharacters) {
+    EXPECT_EQ(requiredLiteral("^kernel: .*oom"), "kernel: ");
+    EXPECT_EQ(requiredLiteral("id=\\d+ user=root"), " user=root");
+    EXPECT_EQ(requiredLiteral("a[xyz]bcdef"), "bcdef");
+}
+
+TEST(RequiredLiteral, EscapedMetacharactersAreLiteral) {
+    EXPECT_EQ(requiredLiteral("libc\\.so\\.6"), "libc.so.6");
+}
+
+TEST(RequiredLiteral, QuantifiedCharacterIsOptional) {
+    EXPECT_EQ(requiredLiteral("colou?r"), "colo");
+    EXPECT_EQ(requiredLiteral("ab*cd"), "cd");
+    EXPECT_EQ(requiredLiteral("abc{0,2}de"), "ab");
+    EXPECT_EQ(requiredLiteral("abcd+"), "abcd");
+}
+
+TEST(RequiredLiteral, OptionalGroupIsIgnored) {
+    EXPECT_EQ(requiredLiteral("(foo)?bar"), "bar");
+    EXPECT_EQ(requiredLiteral("(abc)*x"), "x");
+    EXPECT_EQ(requiredLiteral("ab(cd){0,2}e"), "ab");
+    EXPECT_EQ(requiredLiteral("error: (disk )?full"), "error: ");
+    EXPECT_EQ(requiredLiteral("x(longer text)?y"), "x");
+}
+
+TEST(RequiredLiteral, OptionalOuterGroupDropsNestedLiterals) {
+    EXPECT_EQ(requiredLiteral("a((bcdef)+)?g"), "a");
+    EXPECT_EQ(requiredLiteral("((abcdef)x)*yz"), "yz");
+}
+
+TEST(RequiredLiteral, MandatoryGroupKeepsLiteral) {
+    EXPECT_EQ(requiredLiteral("(timeout)+ after"), "timeout");
+    EXPECT_EQ(requiredLiteral("x(failed)y"), "failed");
+    EXPECT_EQ(requiredLiteral("a((bcdef))g"), "bcdef");
+}
+
+TEST(RequiredLiteral, UnsupportedConstructsGiveNothing) {
+    EXPECT_EQ(requiredLiteral("foo|bar"), "");
+    EXPECT_EQ(requiredLiteral("(?i)error"), "");
+    EXPECT_EQ(requiredLiteral("(?:abc)def"), "");
+}